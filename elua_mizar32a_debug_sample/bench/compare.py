@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Compares two result files written by bench/run.lua (for example the runs
+# for two commits) and flags the workloads that got slower or use more heap
+#
+# Usage: compare.py [--threshold <percent>] <old.csv> <new.csv>
+#   --threshold  regression threshold in percent (default 10)
+# The exit code is 1 if at least one regression was found.
+
+import sys
+
+FIELDS = ( "time_s", "peak_kb", "gc_cycles" )
+
+def load( fname ):
+  res, header = {}, None
+  for line in open( fname ):
+    line = line.strip()
+    if not line or line.startswith( "#" ):
+      continue
+    cols = line.split( "," )
+    if header is None:
+      header = cols
+      continue
+    row = dict( zip( header, cols ) )
+    res[ row[ "name" ] ] = row
+  return res
+
+def change( old, new ):
+  if old <= 0:
+    return 0.0
+  return ( new - old ) * 100.0 / old
+
+def main( args ):
+  threshold = 10.0
+  if len( args ) >= 2 and args[ 0 ] == "--threshold":
+    threshold = float( args[ 1 ] )
+    args = args[ 2: ]
+  if len( args ) != 2:
+    sys.stderr.write( "Usage: compare.py [--threshold <percent>] <old.csv> <new.csv>\n" )
+    return 2
+  old, new = load( args[ 0 ] ), load( args[ 1 ] )
+  print( "%-20s %10s %10s %8s %8s %8s %8s" % ( "workload", "old(s)", "new(s)", "time%", "peak%", "gc_old", "gc_new" ) )
+  regressions = 0
+  for name in new:
+    if name not in old:
+      print( "%-20s (new workload)" % name )
+      continue
+    o, n = old[ name ], new[ name ]
+    if o[ "iterations" ] != n[ "iterations" ]:
+      print( "%-20s (iteration count changed, skipped)" % name )
+      continue
+    dt = change( float( o[ "time_s" ] ), float( n[ "time_s" ] ) )
+    dp = change( float( o[ "peak_kb" ] ), float( n[ "peak_kb" ] ) )
+    flag = ""
+    if dt > threshold or dp > threshold:
+      flag = "  <-- regression"
+      regressions += 1
+    print( "%-20s %10s %10s %+7.1f%% %+7.1f%% %8s %8s%s" % ( name, o[ "time_s" ], n[ "time_s" ], dt, dp,
+           o[ "gc_cycles" ], n[ "gc_cycles" ], flag ) )
+  print( "%d regression(s) above %.1f%%" % ( regressions, threshold ) )
+  return 1 if regressions else 0
+
+if __name__ == "__main__":
+  sys.exit( main( sys.argv[ 1: ] ) )
@@ -0,0 +1,336 @@
+-- Core workloads for bench/run.lua: each entry is { name, iterations, f }
+-- where f( n ) runs the workload n times. Keep the iteration counts small
+-- enough for the target, the runner scales them up on the desktop.
+
+local workloads = {}
+local function add( name, iters, f )
+  workloads[ #workloads + 1 ] = { name = name, iters = iters, f = f }
+end
+
+-- Tables created and dropped in a loop, array and hash parts
+add( "table_churn", 2000, function( n )
+  local keep = {}
+  for i = 1, n do
+    local t = { i, i + 1, i + 2, x = i, y = i * 2 }
+    for j = 1, 8 do t[ #t + 1 ] = j end
+    t.name = "k" .. ( i % 16 )
+    keep[ i % 32 + 1 ] = t
+  end
+  return #keep
+end )
+
+-- Table insertion/removal at the end and in the middle
+add( "table_insert", 2000, function( n )
+  local t = {}
+  for i = 1, n do
+    table.insert( t, i )
+    if i % 4 == 0 then table.remove( t, #t / 2 + 1 ) end
+  end
+  return #t
+end )
+
+-- Arrays filled in a loop (like sample buffers), presized when possible
+add( "table_fill", 200, function( n )
+  local create = table.create or function() return {} end
+  local s = 0
+  for i = 1, n do
+    local t = create( 256 )
+    for j = 1, 256 do t[ j ] = j end
+    s = s + #t
+  end
+  return s
+end )
+
+-- A buffer reused between iterations, bulk copies between tables
+if table.clear and table.move then
+  add( "table_reuse", 200, function( n )
+    local buf, dst = {}, {}
+    for i = 1, n do
+      table.clear( buf )
+      for j = 1, 128 do buf[ j ] = i + j end
+      table.move( buf, 1, 128, #dst + 1, dst )
+      if #dst >= 4096 then table.clear( dst ) end
+    end
+    return #dst
+  end )
+end
+
+-- table.sort on 10k element arrays: numbers, strings, with a comparison
+-- function and already sorted input
+local function sortdata( n )
+  local nums, strs = {}, {}
+  local x = 12345
+  for i = 1, n do
+    x = ( x * 1103515245 + 12345 ) % 2147483648
+    nums[ i ], strs[ i ] = x, "k" .. x
+  end
+  return nums, strs
+end
+
+local function copy( t )
+  local c = {}
+  for i = 1, #t do c[ i ] = t[ i ] end
+  return c
+end
+
+add( "sort_numbers", 2, function( n )
+  local nums = sortdata( 10000 )
+  for i = 1, n do
+    local t = copy( nums )
+    table.sort( t )
+    table.sort( t )
+  end
+  return n
+end )
+
+add( "sort_strings", 1, function( n )
+  local _, strs = sortdata( 10000 )
+  for i = 1, n do table.sort( copy( strs ) ) end
+  return n
+end )
+
+add( "sort_comp", 1, function( n )
+  local nums = sortdata( 10000 )
+  for i = 1, n do table.sort( copy( nums ), function( a, b ) return a > b end ) end
+  return n
+end )
+
+-- String building with concatenation, table.concat and string.rep
+add( "string_build", 500, function( n )
+  local len = 0
+  for i = 1, n do
+    local s = ""
+    for j = 1, 10 do s = s .. j .. "," end
+    local parts = {}
+    for j = 1, 10 do parts[ j ] = tostring( i * j ) end
+    len = len + #s + #table.concat( parts, ";" ) + #string.rep( "ab", 8 )
+  end
+  return len
+end )
+
+-- Library string functions on short strings
+add( "string_ops", 1000, function( n )
+  local c = 0
+  local s = "temperature=23.5;humidity=41;pressure=1013"
+  for i = 1, n do
+    c = c + #s:upper() + ( s:find( "humidity", 1, true ) or 0 )
+    for k, v in s:gmatch( "(%w+)=([%d%.]+)" ) do c = c + #k end
+    c = c + #s:gsub( ";", "\n" ) + s:byte( i % #s + 1 )
+  end
+  return c
+end )
+
+-- Plain searches in a repetitive buffer (HTTP headers, binary logs)
+add( "string_find", 200, function( n )
+  local buf = string.rep( "Header-Name: aaaaaaaaaaaaaaaaaaaa\r\n", 40 ) .. "Content-Length: 42\r\n\r\n"
+  local c = 0
+  for i = 1, n do
+    c = c + buf:find( "\r\n\r\n", 1, true ) + buf:find( "Content-Length:", 1, true )
+    c = c + ( buf:find( "aaaaaaaaaaaaaaaaaaab", 1, true ) or 0 )
+    c = c + select( 2, buf:gsub( "\r\n", "\n" ) )
+  end
+  return c
+end )
+
+-- Splitting CSV style records
+add( "string_split", 500, function( n )
+  local rec = "2024-01-01,12:00:00,sensor7,23.5,41,1013,ok,,,end"
+  local split = string.split or function( s, sep )
+    local t = {}
+    for f in ( s .. sep ):gmatch( "(.-)" .. sep ) do t[ #t + 1 ] = f end
+    return t
+  end
+  local c = 0
+  for i = 1, n do c = c + #split( rec, "," ) end
+  return c
+end )
+
+-- The same few patterns applied over and over (protocol parsing)
+add( "string_match", 500, function( n )
+  local lines = { "+CSQ: 23,99", "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M",
+                  "temp=23.5 hum=41 [ok]", "OK" }
+  local c = 0
+  for i = 1, n do
+    local l = lines[ i % #lines + 1 ]
+    local rssi = l:match( "^%+CSQ: (%d+),(%d+)" )
+    if rssi then c = c + rssi end
+    for k, v in l:gmatch( "(%a+)=([%d%.]+)" ) do c = c + #k end
+    if l:find( "%$GP%u%u%u," ) then c = c + select( 2, l:gsub( ",", ";" ) ) end
+    c = c + #l:gsub( "%[(%a+)%]", "<%1>" )
+  end
+  return c
+end )
+
+-- Precompiled POSIX regular expressions (only if the regex module is available)
+if regex then
+  add( "regex_match", 500, function( n )
+    local kv, num = regex.compile( "([a-z]+)=([0-9.]+)" ), regex.compile( "[0-9]+" )
+    local buf = string.rep( "temp=23.5 hum=41 ", 8 ) .. "status=1"
+    local c = 0
+    for i = 1, n do
+      for k, v in kv:gmatch( buf ) do c = c + #k end
+      c = c + ( num:test( buf, 40 ) and 1 or 0 ) + select( 2, num:gsub( buf, "#" ) )
+    end
+    return c
+  end )
+end
+
+add( "string_format", 1000, function( n )
+  local len = 0
+  for i = 1, n do
+    len = len + #string.format( "%d %5.2f %s %x %-8s|", i, i / 7, "value", i, "pad" )
+  end
+  return len
+end )
+
+-- Closure creation and calls through upvalues
+add( "closures", 2000, function( n )
+  local s = 0
+  for i = 1, n do
+    local function counter()
+      local c = i
+      return function() c = c + 1; return c end
+    end
+    local f = counter()
+    s = s + f() + f()
+  end
+  return s
+end )
+
+-- Coroutine creation, resume and yield
+add( "coroutines", 500, function( n )
+  local s = 0
+  for i = 1, n do
+    local co = coroutine.wrap( function( a )
+      for j = 1, 4 do a = coroutine.yield( a + j ) end
+      return a
+    end )
+    local v = co( i )
+    for j = 1, 4 do v = co( v ) end
+    s = s + v
+  end
+  return s
+end )
+
+-- Binary packing (only if the pack module is available)
+if pack then
+  add( "pack_unpack", 1000, function( n )
+    local s = 0
+    for i = 1, n do
+      local p = pack.pack( "<IhbAd", i, -i % 32768, i % 256, "abcd", i / 3 )
+      local _, a, b, c, d = pack.unpack( p, "<IhbA4" )
+      s = s + a + b + c + #d
+    end
+    return s
+  end )
+end
+
+-- Telemetry records decoded and encoded with a compiled codec
+if pack and pack.compile then
+  add( "pack_codec", 200, function( n )
+    local rec = pack.compile( "<HhhhI" )
+    local parts = {}
+    for i = 1, 64 do parts[ i ] = rec:pack( i, -i, i * 2, -i * 3, i * 1000 ) end
+    local data, vals, buf = table.concat( parts ), {}, pack.buffer( rec:size() * 64 )
+    local s = 0
+    for i = 1, n do
+      local t, nrec = rec:unpackall( data, 1, nil, vals )
+      local pos = 1
+      for r = 0, nrec - 1 do
+        local k = r * 5
+        pos = rec:packinto( buf, pos, t[ k + 1 ], t[ k + 2 ], t[ k + 3 ], t[ k + 4 ], t[ k + 5 ] + 1 )
+      end
+      s = s + nrec
+    end
+    return s
+  end )
+end
+
+-- Bit maps (free block maps, pin masks): the bulk functions and the same
+-- work done element by element in Lua
+if bitarray and bitarray.fill then
+  add( "bitarray_bulk", 200, function( n )
+    local a, b = bitarray.new( 1024, 1 ), bitarray.new( 1024, 1 )
+    local c = 0
+    for i = 1, n do
+      bitarray.fill( a, 0 )
+      bitarray.fill( a, 1, i % 64 + 1, i % 64 + 600 )
+      bitarray.fill( b, 1, 300, 1024 )
+      bitarray.band( a, b )
+      c = c + bitarray.popcount( a ) + bitarray.find_first_set( a ) + ( bitarray.find_first_clear( a, 400 ) or 0 )
+      bitarray.shift( a, 3 )
+    end
+    return c
+  end )
+
+  add( "bitarray_loop", 200, function( n )
+    local a, b = bitarray.new( 1024, 1 ), bitarray.new( 1024, 1 )
+    local c = 0
+    for i = 1, n do
+      for k = 1, 1024 do a[ k ] = 0 end
+      for k = i % 64 + 1, i % 64 + 600 do a[ k ] = 1 end
+      for k = 300, 1024 do b[ k ] = 1 end
+      for k = 1, 1024 do if b[ k ] == 0 then a[ k ] = 0 end end
+      local first, clear = nil, nil
+      for k = 1, 1024 do
+        if a[ k ] ~= 0 then
+          c = c + 1
+          first = first or k
+        elseif k >= 400 and not clear then
+          clear = k
+        end
+      end
+      c = c + first + ( clear or 0 )
+      for k = 1024, 4, -1 do a[ k ] = a[ k - 3 ] end
+      a[ 1 ], a[ 2 ], a[ 3 ] = 0, 0, 0
+    end
+    return c
+  end )
+end
+
+-- Short lived garbage with a growing set of live objects, forces GC cycles
+add( "gc_stress", 200, function( n )
+  local live = {}
+  for i = 1, n do
+    local t = {}
+    for j = 1, 20 do t[ j ] = { j, tostring( j ) } end
+    live[ i % 50 + 1 ] = t
+  end
+  return #live
+end )
+
+-- Many distinct short strings (keys, formatted values) created and dropped
+add( "string_churn", 500, function( n )
+  local keep, c = {}, 0
+  for i = 1, n do
+    for j = 1, 20 do
+      local s = "id" .. i .. ":" .. j
+      c = c + #s:sub( 2, -2 )
+      keep[ j ] = s
+    end
+  end
+  return c + #keep
+end )
+
+-- Mixed small objects (closures, upvalues, small tables and strings)
+add( "gc_churn", 500, function( n )
+  local live = {}
+  for i = 1, n do
+    local v = i
+    local obj = { f = function() return v end, s = tostring( i ), { i } }
+    live[ i % 64 + 1 ] = obj
+  end
+  return #live
+end )
+
+-- Weak valued cache refilled between GC steps
+add( "gc_weak", 200, function( n )
+  local cache = setmetatable( {}, { __mode = "v" } )
+  for i = 1, n do
+    for j = 1, 10 do cache[ j ] = { i, j } end
+    if i % 20 == 0 then collectgarbage( "step" ) end
+  end
+  return 0
+end )
+
+return workloads
@@ -0,0 +1,43 @@
+-- Shell copy timing on eLua: creates a file on the first mount point and
+-- copies it with the shell 'cp' command to every mount point (the first one
+-- included), then copies each copy back to the first mount point.
+-- Usage: cp.lua [size_kb] [mount point ...] (default: 1024 /mmc /f)
+-- The output is CSV like bench/run.lua: name,bytes,time_s,kb_per_s
+-- tests/cp/run.sh runs the same copies on the host, on simulated file systems.
+
+assert( elua and elua.shell, "elua.shell not available" )
+
+local size = ( tonumber( arg and arg[ 1 ] ) or 1024 ) * 1024
+local mounts = { "/mmc", "/f" }
+if arg and #arg > 1 then mounts = { select( 2, unpack( arg ) ) } end
+
+local function cp( name, src, dest )
+  collectgarbage( "collect" )
+  local t0 = tmr.read( tmr.SYS_TIMER )
+  elua.shell( string.format( "cp %s %s -f", src, dest ) )
+  local dt = tmr.getdiffnow( tmr.SYS_TIMER, t0 ) / 1e6
+  print( string.format( "%s,%d,%.4f,%.1f", name, size, dt, dt > 0 and size / 1024 / dt or 0 ) )
+end
+
+local function tag( root )
+  return ( root:gsub( "[^%w]", "" ) )
+end
+
+local src = mounts[ 1 ] .. "/cpbench.dat"
+local f = assert( io.open( src, "wb" ) )
+local block = string.rep( "0123456789abcdef", 64 )
+for i = 1, size / #block do assert( f:write( block ) ) end
+f:close()
+
+print( "# " .. _VERSION .. " eLua " .. elua.version() )
+print( "name,bytes,time_s,kb_per_s" )
+for _, root in ipairs( mounts ) do
+  local dest = root .. "/cpbench2.dat"
+  cp( "cp_" .. tag( mounts[ 1 ] ) .. "_" .. tag( root ), src, dest )
+  if root ~= mounts[ 1 ] then
+    cp( "cp_" .. tag( root ) .. "_" .. tag( mounts[ 1 ] ), dest, mounts[ 1 ] .. "/cpbench3.dat" )
+    os.remove( mounts[ 1 ] .. "/cpbench3.dat" )
+  end
+  os.remove( dest )
+end
+os.remove( src )
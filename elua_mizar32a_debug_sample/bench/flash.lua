@@ -0,0 +1,39 @@
+-- Internal flash write cost on eLua: writes files of different sizes with
+-- different chunk sizes on the flash file systems and reports how many flash
+-- program operations each KB of data needed (from elua.flashstats).
+-- Usage: flash.lua [mount point ...] (default: /wo /f)
+-- The output is CSV like bench/run.lua:
+--   name,bytes,time_s,writes,programs,programs_per_kb
+
+assert( elua and elua.flashstats, "elua.flashstats not available" )
+
+local mounts = { "/wo", "/f" }
+if arg and #arg > 0 then mounts = { unpack( arg ) } end
+
+local function run( root, size, chunk )
+  local name = string.format( "%s/fbench%d_%d.dat", root, size, chunk )
+  local data = string.rep( "x", chunk )
+  collectgarbage( "collect" )
+  elua.flashstats( true )
+  local t0 = tmr.read( tmr.SYS_TIMER )
+  local f = io.open( name, "wb" )
+  if not f then
+    print( string.format( "# %s: cannot create file", name ) )
+    return
+  end
+  for i = 1, size / chunk do f:write( data ) end
+  f:close()
+  local dt = tmr.getdiffnow( tmr.SYS_TIMER, t0 ) / 1e6
+  local writes, bytes, programs = elua.flashstats()
+  os.remove( name )
+  print( string.format( "flash_%s_%d_%d,%d,%.4f,%d,%d,%.2f", root:gsub( "[^%w]", "" ), size, chunk,
+    bytes, dt, writes, programs, programs * 1024 / size ) )
+end
+
+print( "# " .. _VERSION .. " eLua " .. elua.version() )
+print( "name,bytes,time_s,writes,programs,programs_per_kb" )
+for _, root in ipairs( mounts ) do
+  for _, chunk in ipairs{ 16, 128, 512 } do
+    run( root, 4096, chunk )
+  end
+end
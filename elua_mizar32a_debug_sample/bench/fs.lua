@@ -0,0 +1,79 @@
+-- Filesystem workloads for bench/run.lua. Returns a function that builds
+-- the workload list for a given mount point (for example "/wo", "/f" or
+-- "/mmc" on eLua, any writable directory on the PC). All the files are
+-- created with a "bench" prefix and removed at the end of each workload.
+
+local function fname( root, i )
+  return string.format( "%s/bench%d.dat", root, i )
+end
+
+local function write_file( name, data, count )
+  local f = assert( io.open( name, "wb" ) )
+  for i = 1, count do assert( f:write( data ) ) end
+  f:close()
+end
+
+return function( root )
+  local workloads = {}
+  local tag = root:gsub( "[^%w]", "" )
+  if tag == "" then tag = "root" end
+  local function add( name, iters, f )
+    workloads[ #workloads + 1 ] = { name = name .. "_" .. tag, iters = iters, f = f }
+  end
+  local block = string.rep( "0123456789abcdef", 16 )   -- 256 bytes
+
+  -- Sequential write of a 16k file in 256 byte chunks
+  add( "fs_write", 4, function( n )
+    for i = 1, n do
+      write_file( fname( root, 0 ), block, 64 )
+    end
+    os.remove( fname( root, 0 ) )
+    return n
+  end )
+
+  -- Sequential read of the same file, small and large requests
+  add( "fs_read", 4, function( n )
+    write_file( fname( root, 0 ), block, 64 )
+    local total = 0
+    for i = 1, n do
+      local f = assert( io.open( fname( root, 0 ), "rb" ) )
+      while true do
+        local d = f:read( i % 2 == 0 and 64 or 1024 )
+        if not d then break end
+        total = total + #d
+      end
+      f:close()
+    end
+    os.remove( fname( root, 0 ) )
+    return total
+  end )
+
+  -- Many small files created, read back and removed
+  add( "fs_small", 4, function( n )
+    local total = 0
+    for i = 1, n do
+      for j = 1, 8 do write_file( fname( root, j ), block, 1 ) end
+      for j = 1, 8 do
+        local f = assert( io.open( fname( root, j ), "rb" ) )
+        total = total + #f:read( "*a" )
+        f:close()
+      end
+      for j = 1, 8 do os.remove( fname( root, j ) ) end
+    end
+    return total
+  end )
+
+  -- Append to an existing file (worst case for log style writes)
+  add( "fs_append", 4, function( n )
+    write_file( fname( root, 0 ), "", 0 )
+    for i = 1, n * 16 do
+      local f = assert( io.open( fname( root, 0 ), "ab" ) )
+      f:write( "log line ", i, "\n" )
+      f:close()
+    end
+    os.remove( fname( root, 0 ) )
+    return n
+  end )
+
+  return workloads
+end
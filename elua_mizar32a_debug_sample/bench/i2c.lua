@@ -0,0 +1,69 @@
+-- I2C register read timing on eLua: compares the byte-by-byte Lua sequence
+-- (start, address, write, restart, address, read, stop) with i2c.transfer
+-- and with a poll list reading the same register for several sensors.
+-- Needs a slave on the bus, e.g. an EEPROM or a temperature sensor.
+-- Usage: i2c.lua [address] [register] [length] [iterations] [speed]
+-- The output is CSV like bench/run.lua: name,iterations,time_s,us_per_read
+
+local address = tonumber( arg and arg[ 1 ] ) or 0x50
+local reg = tonumber( arg and arg[ 2 ] ) or 0
+local len = tonumber( arg and arg[ 3 ] ) or 2
+local iters = tonumber( arg and arg[ 4 ] ) or 200
+local speed = tonumber( arg and arg[ 5 ] ) or i2c.FAST
+local id = 0
+local nsensors = 4
+
+local function lua_read()
+  i2c.start( id )
+  if not i2c.address( id, address, i2c.TRANSMITTER ) then
+    i2c.stop( id )
+    return nil
+  end
+  i2c.write( id, reg )
+  i2c.start( id )
+  i2c.address( id, address, i2c.RECEIVER )
+  local s = i2c.read( id, len )
+  i2c.stop( id )
+  return s
+end
+
+local function transfer_read()
+  return i2c.transfer( id, address, reg, len )
+end
+
+local function run( name, n, reads, f )
+  local t0 = tmr.read( tmr.SYS_TIMER )
+  f( n )
+  local dt = tmr.getdiffnow( tmr.SYS_TIMER, t0 )
+  print( string.format( "%s,%d,%.4f,%.1f", name, n, dt / 1e6, dt / ( n * reads ) ) )
+end
+
+print( string.format( "# I2C speed %d Hz, slave 0x%02X, register %d, %d bytes", i2c.setup( id, speed ), address, reg, len ) )
+if not transfer_read() then
+  print( "# no answer from the slave" )
+  return
+end
+if lua_read() ~= transfer_read() then
+  print( "# warning: the two read methods returned different data" )
+end
+print( "name,iterations,time_s,us_per_read" )
+run( "lua_bytes", iters, 1, function( n )
+  for i = 1, n do lua_read() end
+end )
+run( "transfer", iters, 1, function( n )
+  for i = 1, n do transfer_read() end
+end )
+-- Several sensors (here the same slave) read in one call
+local list = {}
+for i = 1, nsensors do list[ i ] = { address, reg, len } end
+local plist = i2c.pollist( id, list )
+local results
+run( "lua_bytes_x" .. nsensors, iters, nsensors, function( n )
+  for i = 1, n do
+    results = results or {}
+    for j = 1, nsensors do results[ j ] = lua_read() end
+  end
+end )
+run( "pollist_x" .. nsensors, iters, nsensors, function( n )
+  for i = 1, n do results = plist:run( results ) end
+end )
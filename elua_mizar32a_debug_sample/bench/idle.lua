@@ -0,0 +1,35 @@
+-- CPU idle during blocking waits on eLua: waits on an ADC burst and on a
+-- UART receive that times out, and reports how much of the wait time the
+-- CPU spent asleep (cpu.idlestats). On parts where platform_cpu_idle can't
+-- sleep atomically and there is no periodic timer interrupt, 'sleeps' stays
+-- at 0 and the waits poll.
+-- The wakeup latency is the gap between an ISR event and the next idle_end
+-- event in a BUILD_TRACE build (tools/trace_decode.py --pairs).
+-- Usage: idle.lua [adc channel] [uart id] [iterations]
+-- The output is CSV like bench/run.lua: name,iterations,time_s,sleeps,idle_pct
+
+local ch = tonumber( arg and arg[ 1 ] ) or 0
+local uid = tonumber( arg and arg[ 2 ] ) or 1
+local iters = tonumber( arg and arg[ 3 ] ) or 20
+
+local function run( name, n, f )
+  cpu.idlestats( true )
+  local t0 = tmr.read( tmr.SYS_TIMER )
+  for i = 1, n do f() end
+  local dt = tmr.getdiffnow( tmr.SYS_TIMER, t0 )
+  local _, sleeps, idle_us = cpu.idlestats()
+  print( string.format( "%s,%d,%.4f,%d,%.1f", name, n, dt / 1e6, sleeps, 100 * idle_us / dt ) )
+end
+
+print( "name,iterations,time_s,sleeps,idle_pct" )
+if adc then
+  adc.setclock( ch, 100, 0 )
+  adc.setblocking( ch, 1 )
+  run( "adc_burst_64", iters, function()
+    adc.sample( ch, 64 )
+    adc.getsamples( ch, 64 )
+  end )
+end
+run( "uart_timeout_100ms", iters, function()
+  uart.read( uid, 1, 100000, tmr.SYS_TIMER )
+end )
@@ -0,0 +1,71 @@
+-- Benchmark runner for the eLua core. Runs the workloads in core.lua, the
+-- virtual machine loops in vm.lua and, for every mount point given on the
+-- command line, the filesystem workloads in fs.lua. The output is CSV on
+-- stdout, one line per workload:
+--   name,iterations,time_s,base_kb,peak_kb,gc_cycles
+-- 'base_kb' is the heap in use before the workload, 'peak_kb' the maximum
+-- heap reached while it ran (including the free room in the slab pages) and
+-- 'gc_cycles' the number of GC cycles it completed (both from
+-- collectgarbage( "peak" ) and collectgarbage( "cycles" ), reported as -1 on
+-- interpreters that don't implement them). Lines starting with '#' are
+-- comments; the last one gives the KB held in slab pages and the KB used by
+-- blocks in them. Compare two runs with bench/compare.py.
+-- Usage: run.lua [scale] [mount point ...]
+--   eLua:    run.lua 1 /wo /f /mmc
+--   desktop: run.lua 20 /tmp
+
+local scale = tonumber( arg and arg[ 1 ] ) or 1
+local dir = ( arg and arg[ 0 ] or "" ):match( "^(.*)[/\\]" ) or "."
+
+local function gcinfo( opt, reset )
+  local ok, v = pcall( collectgarbage, opt, reset )
+  return ok and v or -1
+end
+
+-- Prefer the system timer on eLua, os.clock elsewhere
+local timer_start, timer_elapsed
+if tmr and tmr.SYS_TIMER then
+  timer_start = function() return tmr.read( tmr.SYS_TIMER ) end
+  timer_elapsed = function( t0 ) return tmr.getdiffnow( tmr.SYS_TIMER, t0 ) / 1e6 end
+else
+  timer_start = os.clock
+  timer_elapsed = function( t0 ) return os.clock() - t0 end
+end
+
+local function run( w )
+  local n = math.max( 1, math.floor( w.iters * scale ) )
+  collectgarbage( "collect" )
+  local base = collectgarbage( "count" )
+  gcinfo( "peak", 1 )
+  gcinfo( "cycles", 1 )
+  local t0 = timer_start()
+  w.f( n )
+  local dt = timer_elapsed( t0 )
+  local peak, cycles = gcinfo( "peak" ), gcinfo( "cycles" )
+  print( string.format( "%s,%d,%.4f,%d,%d,%d", w.name, n, dt, base, peak, cycles ) )
+end
+
+print( "# " .. _VERSION .. ( elua and elua.version and ( " eLua " .. elua.version() ) or "" ) )
+print( "name,iterations,time_s,base_kb,peak_kb,gc_cycles" )
+for _, fname in ipairs{ "/core.lua", "/vm.lua" } do
+  for _, w in ipairs( dofile( dir .. fname ) ) do
+    run( w )
+  end
+end
+-- Slab allocator pages and the part of them used by blocks, after a full
+-- collection (what the pages cost on top of the 'count' heap)
+local ok, pages, used = pcall( collectgarbage, "slab" )
+if ok and pages then
+  collectgarbage( "collect" )
+  pages, used = collectgarbage( "slab" )
+  print( string.format( "# slab_kb,%.1f,%.1f", pages, used ) )
+end
+if arg then
+  local fsbench = dofile( dir .. "/fs.lua" )
+  for i = 2, #arg do
+    for _, w in ipairs( fsbench( arg[ i ] ) ) do
+      local ok, err = pcall( run, w )
+      if not ok then print( "# " .. w.name .. " failed: " .. tostring( err ) ) end
+    end
+  end
+end
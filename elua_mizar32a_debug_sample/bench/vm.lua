@@ -0,0 +1,145 @@
+-- Virtual machine workloads for bench/run.lua: small loops dominated by a
+-- given mix of opcodes. Same format as core.lua: each entry is
+-- { name, iterations, f } where f( n ) runs the loop n times.
+
+local workloads = {}
+local function add( name, iters, f )
+  workloads[ #workloads + 1 ] = { name = name, iters = iters, f = f }
+end
+
+-- MOVE, LOADK, FORLOOP
+add( "vm_move_loadk", 200000, function( n )
+  local a, b, c
+  for i = 1, n do
+    a = 1; b = a; c = b; a = c
+  end
+  return a
+end )
+
+-- ADD, SUB, MUL, DIV, MOD
+add( "vm_arith", 200000, function( n )
+  local x, y = 0, 3
+  for i = 1, n do
+    x = ( x + i * y - 1 ) % 1000 / 2
+  end
+  return x
+end )
+
+-- LT, LE, EQ, TEST, JMP
+add( "vm_compare_jump", 200000, function( n )
+  local c, t = 0, true
+  for i = 1, n do
+    if i < 100 then c = c + 1 elseif i <= 200 then c = c - 1 end
+    if i == c then c = 0 end
+    if t and not ( i > c ) then c = c + 1 end
+  end
+  return c
+end )
+
+-- GETTABLE, SETTABLE with numeric and string keys
+add( "vm_table_access", 100000, function( n )
+  local t = { 1, 2, 3, 4, x = 0, y = 0 }
+  for i = 1, n do
+    t.x = t.y + t[ 1 ]
+    t[ 2 ] = t.x + t[ 3 ]
+    t.y = t[ 2 ] - t[ 4 ]
+  end
+  return t.y
+end )
+
+-- GETGLOBAL, SETGLOBAL
+add( "vm_globals", 100000, function( n )
+  vm_global = 0
+  for i = 1, n do
+    vm_global = vm_global + 1
+  end
+  return vm_global
+end )
+
+-- GETUPVAL, SETUPVAL
+add( "vm_upvalues", 200000, function( n )
+  local u = 0
+  local function f()
+    for i = 1, n do
+      u = u + 1
+    end
+  end
+  f()
+  return u
+end )
+
+-- CALL, RETURN
+add( "vm_calls", 100000, function( n )
+  local function sum( a, b ) return a + b end
+  local s = 0
+  for i = 1, n do
+    s = sum( s, i )
+  end
+  return s
+end )
+
+-- SELF, CALL, RETURN
+add( "vm_method_calls", 100000, function( n )
+  local obj = { v = 0 }
+  function obj:inc( d ) self.v = self.v + d end
+  for i = 1, n do
+    obj:inc( 1 )
+  end
+  return obj.v
+end )
+
+-- TAILCALL
+add( "vm_tailcalls", 100000, function( n )
+  local function loop( i ) if i == 0 then return 0 end return loop( i - 1 ) end
+  return loop( n )
+end )
+
+-- CLOSURE, CLOSE
+add( "vm_closures", 20000, function( n )
+  local f
+  for i = 1, n do
+    f = function() return i end
+  end
+  return f()
+end )
+
+-- VARARG
+add( "vm_varargs", 50000, function( n )
+  local function sel( ... ) local a, b = ... return a end
+  local s = 0
+  for i = 1, n do
+    s = s + sel( i, 2, 3 )
+  end
+  return s
+end )
+
+-- TFORLOOP over ipairs and pairs
+add( "vm_tforloop", 20000, function( n )
+  local t = { 1, 2, 3, 4, 5, 6, 7, 8, a = 1, b = 2 }
+  local s = 0
+  for i = 1, n / 10 do
+    for _, v in ipairs( t ) do s = s + v end
+    for _, v in pairs( t ) do s = s + v end
+  end
+  return s
+end )
+
+-- NEWTABLE, SETLIST
+add( "vm_table_ctor", 20000, function( n )
+  local t
+  for i = 1, n do
+    t = { i, i, i, i }
+  end
+  return #t
+end )
+
+-- CONCAT
+add( "vm_concat", 20000, function( n )
+  local s
+  for i = 1, n do
+    s = "a" .. i .. "b"
+  end
+  return s
+end )
+
+return workloads
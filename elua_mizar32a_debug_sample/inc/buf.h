@@ -64,6 +64,7 @@ unsigned buf_get_size( unsigned resid, unsigned resnum );
 unsigned buf_get_count( unsigned resid, unsigned resnum );
 int buf_write( unsigned resid, unsigned resnum, t_buf_data *data );
 int buf_read( unsigned resid, unsigned resnum, t_buf_data *data );
+unsigned buf_read_block( unsigned resid, unsigned resnum, t_buf_data *data, unsigned count );
 void buf_flush( unsigned resid, unsigned resnum );
 
 #endif
@@ -32,6 +32,77 @@
 
 typedef int ( *p_cmn_fs_walker_cb )( const char*, const struct dm_dirent*, void*, int );
 
+// Event wait: the condition checked by cmn_wait_event (non-zero when met)
+typedef int ( *p_cmn_wait_cond )( void* );
+
+// Event tracing (BUILD_TRACE)
+// Event ids, the arguments of each event are listed in the comments
+// Keep in sync with the names in common.c and tools/trace_decode.py
+enum
+{
+  CMN_TRACE_NONE,
+  CMN_TRACE_INT_ADD,            // Lua interrupt queued (id, resnum)
+  CMN_TRACE_INT_DROP,           // Lua interrupt lost, queue full (id, resnum)
+  CMN_TRACE_INT_HOOK,           // Lua interrupt dispatched (id, resnum)
+  CMN_TRACE_UART_RX,            // UART byte received (id, data)
+  CMN_TRACE_UIP_LOOP,           // uIP main loop (elapsed ms, 0)
+  CMN_TRACE_DISK_READ,          // disk_read start (sector, count)
+  CMN_TRACE_DISK_READ_END,      // disk_read end (drive, sectors not read)
+  CMN_TRACE_DISK_WRITE,         // disk_write start (sector, count)
+  CMN_TRACE_DISK_WRITE_END,     // disk_write end (drive, sectors not written)
+  CMN_TRACE_GC_FULL,            // luaC_fullgc start (total bytes, 0)
+  CMN_TRACE_GC_FULL_END,        // luaC_fullgc end (total bytes, 0)
+  CMN_TRACE_NIFFS_GC,           // niffs_gc start (free pages, deleted pages)
+  CMN_TRACE_NIFFS_GC_END,       // niffs_gc end (result, freed pages)
+  CMN_TRACE_IDLE,               // CPU going to sleep in cmn_wait_event (timer id, us left or 0xFFFFFFFF)
+  CMN_TRACE_IDLE_END,           // CPU woke up in cmn_wait_event (0, 0)
+  CMN_TRACE_LAST,
+  CMN_TRACE_USER = 0x100        // first id available to application code
+};
+
+// A trace record. 'seq' (the lower bits of the record counter) tells the
+// decoder if a record was overwritten while the buffer was being dumped
+typedef struct
+{
+  u32 timestamp;                // system timer (us), lower 32 bits
+  u16 id;
+  u16 seq;
+  u32 arg1, arg2;
+} cmn_trace_record;
+
+// A CAN frame in the receive queue of common_can.c
+typedef struct
+{
+  u32 id;                       // CAN ID
+  u32 timestamp;                // reception time: system timer (us), lower 32 bits
+  u8 idtype;                    // ELUA_CAN_ID_STD or ELUA_CAN_ID_EXT
+  u8 len;
+  u8 data[ PLATFORM_CAN_MAXLEN ];
+} cmn_can_frame;
+
+// Maximum number of CAN acceptance filters for each interface
+#ifndef CAN_MAX_FILTERS
+#define CAN_MAX_FILTERS         8
+#endif
+
+// CAN acceptance filter: frames of type 'idtype' with
+// ( canid & mask ) == ( id & mask ) are accepted
+typedef struct
+{
+  u32 id;
+  u32 mask;
+  u8 idtype;
+} cmn_can_filter;
+
+#ifdef BUILD_TRACE
+#ifndef CMN_TRACE_LOG_SIZE
+#define CMN_TRACE_LOG_SIZE      8
+#endif
+#define CMN_TRACE( id, arg1, arg2 )     cmn_trace( id, ( u32 )( arg1 ), ( u32 )( arg2 ) )
+#else
+#define CMN_TRACE( id, arg1, arg2 )
+#endif
+
 // Functions exported by the common platform layer
 void cmn_platform_init(void);
 void cmn_virtual_timer_cb(void);
@@ -46,6 +117,15 @@ void cmn_systimer_set_interrupt_freq( u32 freq_hz );
 void cmn_systimer_set_interrupt_period_us( u32 period );
 void cmn_systimer_periodic(void);
 timer_data_type cmn_systimer_get(void);
+// Waiting for events
+int cmn_wait_event( p_cmn_wait_cond cond, void *arg, unsigned timer_id, timer_data_type timeout );
+void cmn_wait_get_stats( u32 *pwaits, u32 *psleeps, u64 *pidle_us, int reset );
+// CAN receive queue and filters
+void cmn_can_rx_handler( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data );
+unsigned cmn_can_get_count( unsigned id );
+unsigned cmn_can_recv( unsigned id, cmn_can_frame *frames, unsigned maxframes );
+int cmn_can_set_filters( unsigned id, const cmn_can_filter *filters, unsigned nfilters );
+void cmn_can_get_stats( unsigned id, u32 *preceived, u32 *pfiltered, u32 *pdropped, int reset );
 // Filesystem-related functions
 int cmn_fs_walkdir( const char *path, p_cmn_fs_walker_cb cb, void *pdata, int recursive );
 char* cmn_fs_split_path( const char *path, const char **pmask );
@@ -61,6 +141,13 @@ char lastchar( const char *s );
 char firstchar( const char *s );
 const char* cmn_str64( u64 x );
 void cmn_get_timeout_data( lua_State *L, int pidx, unsigned *pid, timer_data_type *ptimeout );
+// Event tracing
+void cmn_trace( u16 id, u32 arg1, u32 arg2 );
+int cmn_trace_enable( int enable );
+void cmn_trace_clear(void);
+unsigned cmn_trace_count(void);
+int cmn_trace_get( unsigned n, cmn_trace_record *prec );
+const char* cmn_trace_event_name( u16 id );
 
 #endif // #ifndef __COMMON_H__
 
@@ -6,12 +6,20 @@
 // BogdanM: dlmalloc() tuning for eLua
 
 #include <unistd.h>
+#define USE_DL_PREFIX 
+#ifdef USE_HEAP_REGIONS
+// Each memory region is an mspace created over a fixed base (see elua_heap.c),
+// so there's no global heap and no sbrk() that could overlap the regions
+#define MSPACES                   1
+#define ONLY_MSPACES              1
+#define HAVE_MORECORE             0
+#else
 extern void* elua_sbrk( ptrdiff_t incr );
 #define MORECORE                  elua_sbrk  
-#define USE_DL_PREFIX 
 #define MSPACES                   0
 #define HAVE_MORECORE             1
 #define MORECORE_CONTIGUOUS       1
+#endif
 #define MORECORE_CANNOT_TRIM 
 #define HAVE_MMAP                 0 
 #define HAVE_MREMAP               0 
@@ -38,6 +38,23 @@ typedef struct
   volatile u8         seq_ctr, seq_len;
 } elua_adc_dev_state;
 
+// Continuous acquisition: the platform fills two blocks in turn (usually
+// with DMA); a block is handed to the consumer when complete and is lost
+// if not read before the other block is complete too. The flags are written
+// both by the interrupt handler and from the main context, so each one has
+// its own byte (bit fields would share a read-modify-write)
+typedef struct
+{
+  u16                 *blocks[ 2 ];
+  u16                 blocksize; // samples per block
+  volatile u8         running;
+  volatile u8         notify; // Whether to signal INT_ADC_BLOCK
+  volatile u8         ready; // Whether the block not being filled holds unread samples
+  volatile u8         filling; // Block being filled
+  volatile u32        seq; // Number of complete blocks
+  volatile u32        overruns; // Number of blocks lost
+} elua_adc_stream_state;
+
 // Channel Management
 #define ACTIVATE_CHANNEL( d, id ) ( d->ch_active |= ( ( u32 )1 << ( id ) ) )
 #define INACTIVATE_CHANNEL( d, id ) ( d->ch_active &= ~( ( u32 )1 << ( id ) ) )
@@ -50,6 +67,7 @@ elua_adc_dev_state *adc_get_dev_state( unsigned dev_id );
 void adc_smooth_data( unsigned id );
 elua_adc_ch_state *adc_get_ch_state( unsigned id );
 u16 adc_get_processed_sample( unsigned id );
+u16 adc_get_processed_samples( unsigned id, u16 *dest, u16 count );
 void adc_init_ch_state( unsigned id );
 int adc_update_smoothing( unsigned id, u8 loglen );
 void adc_flush_smoothing( unsigned id );
@@ -57,5 +75,13 @@ u16 adc_samples_requested( unsigned id );
 u16 adc_samples_available( unsigned id );
 u16 adc_wait_samples( unsigned id, unsigned samples );
 
+// Continuous acquisition
+elua_adc_stream_state *adc_get_stream_state( void );
+u32 adc_stream_start( u32 chmask, unsigned timer_id, u32 freq, u16 blocksize );
+void adc_stream_stop( void );
+u16 *adc_stream_block_done( void );
+u16 *adc_stream_peek( u32 *pseq );
+int adc_stream_release( u32 seq );
+
 #endif
 
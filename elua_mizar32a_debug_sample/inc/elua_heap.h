@@ -0,0 +1,62 @@
+// Region aware heap: one dlmalloc mspace per memory region
+
+#ifndef __ELUA_HEAP_H__
+#define __ELUA_HEAP_H__
+
+#include <stddef.h>
+#include "type.h"
+
+#ifdef USE_HEAP_REGIONS
+
+#ifndef USE_MULTIPLE_ALLOCATOR
+#error "USE_HEAP_REGIONS requires USE_MULTIPLE_ALLOCATOR"
+#endif
+
+#include "dlmalloc.h"
+
+// Maximum number of memory regions (MEM_START_ADDRESS entries) handled
+#ifndef ELUA_HEAP_MAX_REGIONS
+#define ELUA_HEAP_MAX_REGIONS           4
+#endif
+
+// Allocations up to this size go to the fast region with the "split" policy
+#ifndef ELUA_HEAP_SPLIT_THRESHOLD
+#define ELUA_HEAP_SPLIT_THRESHOLD       256
+#endif
+
+#ifndef ELUA_HEAP_DEFAULT_POLICY
+#define ELUA_HEAP_DEFAULT_POLICY        ELUA_HEAP_POLICY_SPLIT
+#endif
+
+// Placement policies. The first region in MEM_START_ADDRESS is considered the
+// "fast" one (internal SRAM), the last one the "slow" one (SDRAM)
+enum
+{
+  ELUA_HEAP_POLICY_FAST_FIRST,  // fill the regions in order (legacy sbrk behaviour)
+  ELUA_HEAP_POLICY_SPLIT,       // small/hot blocks -> fast region, large blocks -> slow region
+  ELUA_HEAP_POLICY_SLOW_FIRST,  // fill the regions in reverse order
+  ELUA_HEAP_POLICY_LAST
+};
+
+// Placement hints
+enum
+{
+  ELUA_HEAP_HINT_ANY,           // let the policy decide based on the size
+  ELUA_HEAP_HINT_FAST,          // hot object, keep in fast memory if possible
+  ELUA_HEAP_HINT_LARGE          // bulk buffer, keep out of fast memory if possible
+};
+
+void* elua_heap_malloc( size_t size );
+void* elua_heap_calloc( size_t nelem, size_t elem_size );
+void elua_heap_free( void *ptr );
+void* elua_heap_realloc( void *ptr, size_t size );
+void* elua_heap_realloc_hint( void *ptr, size_t size, int hint );
+int elua_heap_set_policy( int policy, u32 threshold );
+int elua_heap_get_policy( u32 *pthreshold );
+unsigned elua_heap_get_num_regions( void );
+int elua_heap_get_region_info( unsigned id, u32 *pstart, u32 *psize, struct mallinfo *pinfo );
+struct mallinfo elua_heap_mallinfo( void );
+
+#endif // #ifdef USE_HEAP_REGIONS
+
+#endif // #ifndef __ELUA_HEAP_H__
@@ -35,6 +35,11 @@ typedef struct
 // C interrupt handlers
 typedef void( *elua_int_c_handler )( elua_int_resnum resnum );
 
+// Lua hook type (same as lua_Hook, declared here to avoid including lua.h)
+struct lua_State;
+struct lua_Debug;
+typedef void( *elua_int_p_hook )( struct lua_State *L, struct lua_Debug *ar );
+
 // Handler key in the registry
 #define LUA_INT_HANDLER_KEY             ( int )&elua_int_add
 
@@ -51,6 +56,7 @@ void elua_int_cleanup(void);
 void elua_int_disable_all(void);
 elua_int_c_handler elua_int_set_c_handler( elua_int_id inttype, elua_int_c_handler phandler );
 elua_int_c_handler elua_int_get_c_handler( elua_int_id inttype );
+void elua_int_set_idle_hook( elua_int_p_hook hook, int mask, int count );
 
 #endif
 
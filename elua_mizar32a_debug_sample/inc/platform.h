@@ -58,7 +58,9 @@ enum
   PLATFORM_IO_PORT_SET_VALUE,
   PLATFORM_IO_PORT_GET_VALUE,
   PLATFORM_IO_PORT_DIR_INPUT,
-  PLATFORM_IO_PORT_DIR_OUTPUT
+  PLATFORM_IO_PORT_DIR_OUTPUT,
+  // Pin operations added later (kept last so the values above don't change)
+  PLATFORM_IO_PIN_TOGGLE
 };
 
 // The platform I/O functions
@@ -155,6 +157,10 @@ enum
 int platform_can_exists( unsigned id );
 u32 platform_can_setup( unsigned id, u32 clock );
 int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data );
+// Received frames reach the common receive queue (src/common_can.c) either
+// from the driver's RX interrupt through cmn_can_rx_handler, or by polling
+// platform_can_recv (which should then always return PLATFORM_ERR for
+// interrupt driven drivers)
 int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data );
 
 // *****************************************************************************
@@ -242,6 +248,13 @@ void platform_pwm_start( unsigned id );
 void platform_pwm_stop( unsigned id );
 u32 platform_pwm_set_clock( unsigned id, u32 data );
 u32 platform_pwm_get_clock( unsigned id );
+// Raw duty cycle access (used by the wave module): the period of a channel
+// that was set up and a new duty cycle, both in PWM clock ticks. Call
+// platform_pwm_prepare_duty_ticks once before a series of updates. The duty
+// cycle update must be fast enough to be called from an interrupt handler.
+u32 platform_pwm_get_period( unsigned id );
+void platform_pwm_prepare_duty_ticks( unsigned id );
+void platform_pwm_set_duty_ticks( unsigned id, u32 ticks );
 
 // *****************************************************************************
 // CPU specific functions
@@ -262,6 +275,13 @@ int platform_cpu_set_interrupt( elua_int_id id, elua_int_resnum resnum, int stat
 int platform_cpu_get_interrupt( elua_int_id id, elua_int_resnum resnum );
 int platform_cpu_get_interrupt_flag( elua_int_id id, elua_int_resnum resnum, int clear );
 u32 platform_cpu_get_frequency(void);
+// Put the CPU to sleep until the next interrupt. Must be called with the
+// global interrupts disabled, returns with the interrupts enabled. 'bounded'
+// is true if a periodic interrupt wakes the CPU anyway. If the CPU can't
+// enable the interrupts and sleep atomically it only sleeps when 'bounded' is
+// true (an interrupt taken just before the sleep is then noticed at the next
+// periodic one); otherwise it returns 0 without sleeping.
+int platform_cpu_idle( int bounded );
 
 // *****************************************************************************
 // The platform ADC functions
@@ -272,6 +292,8 @@ int  platform_adc_start_sequence(void);
 void platform_adc_stop( unsigned id );
 u32  platform_adc_set_clock( unsigned id, u32 frequency);
 int  platform_adc_check_timer_id( unsigned id, unsigned timer_id );
+u32  platform_adc_stream_start( u32 chmask, unsigned timer_id, u32 freq, u16 *first, u16 *second, u16 count );
+void platform_adc_stream_stop(void);
 
 // ADC Common Functions
 int  platform_adc_exists( unsigned id );
@@ -306,6 +328,10 @@ void platform_i2c_send_stop( unsigned id );
 int platform_i2c_send_address( unsigned id, u16 address, int direction );
 int platform_i2c_send_byte( unsigned id, u8 data );
 int platform_i2c_recv_byte( unsigned id, int ack );
+// Complete transaction: START, write 'wlen' bytes, repeated START, read 'rlen'
+// bytes, STOP. Returns the number of bytes read or -1 if the slave didn't
+// acknowledge its address or the written data
+int platform_i2c_transfer( unsigned id, u16 address, const u8 *wdata, unsigned wlen, u8 *rdata, unsigned rlen );
 
 // *****************************************************************************
 // Ethernet specific functions
@@ -322,6 +348,9 @@ u32 platform_eth_get_elapsed_time(void);
 u32 platform_flash_get_first_free_block_address( u32 *psect );
 u32 platform_flash_get_sector_of_address( u32 addr );
 u32 platform_flash_write( const void *from, u32 toaddr, u32 size );
+// Program the writes still gathered by platform_flash_write (see common.c)
+void platform_flash_sync(void);
+void platform_flash_get_stats( u32 *pwrites, u32 *pbytes, u32 *pprograms, u32 *pprogrammed, int reset );
 u32 platform_s_flash_write( const void *from, u32 toaddr, u32 size );
 u32 platform_flash_get_num_sectors(void);
 int platform_flash_erase_sector( u32 sector_id );
@@ -69,6 +69,7 @@ SHELL_FUNC( shell_mkdir );
 SHELL_FUNC( shell_wofmt );
 SHELL_FUNC( shell_ed );
 SHELL_FUNC( shell_clear );
+SHELL_FUNC( shell_trace );
 
 #endif // #ifndef __SHELL_H__
 
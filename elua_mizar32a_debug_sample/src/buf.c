@@ -203,5 +203,41 @@ int buf_read( unsigned resid, unsigned resnum, t_buf_data *data )
   return PLATFORM_OK;
 }
 
+// Get up to 'count' elements from the buffer at once
+// resid - resource ID (BUF_ID_UART ...)
+// resnum - resource number (0, 1, 2...)
+// data - pointer for where data should go (room for 'count' elements)
+// count - maximum number of elements to get
+// Returns the number of elements copied to 'data'
+unsigned buf_read_block( unsigned resid, unsigned resnum, t_buf_data *data, unsigned count )
+{
+  BUF_CHECK_RESNUM( resid, resnum );
+  BUF_GETPTR( resid, resnum );
+
+  int old_status;
+  unsigned first;
+
+  if( pbuf->logsize == BUF_SIZE_NONE )
+    return 0;
+  count = UMIN( count, READ16( pbuf->count ) );
+  if( count == 0 )
+    return 0;
+  count <<= pbuf->logdsize;
+
+  // The data can wrap around the end of the buffer, copy it in (at most) two parts
+  first = UMIN( count, BUF_BYTESIZE( pbuf ) - pbuf->rptr );
+  memcpy( data, pbuf->buf + pbuf->rptr, first );
+  if( first < count )
+    memcpy( data + first, pbuf->buf, count - first );
+  pbuf->rptr = ( pbuf->rptr + count ) & ( BUF_BYTESIZE( pbuf ) - 1 );
+  count >>= pbuf->logdsize;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  pbuf->count -= count;
+  platform_cpu_set_global_interrupts( old_status );
+
+  return count;
+}
+
 #endif // #ifdef BUF_ENABLE
 
@@ -12,6 +12,7 @@
 #include "elua_adc.h"
 #include "term.h"
 #include "xmodem.h"
+#include "utils.h"
 #include "lua.h"
 #include "lapi.h"
 #include "lauxlib.h"
@@ -526,10 +527,43 @@ u32 platform_flash_get_first_free_block_address( u32 *psect )
   return temp + 1;
 }
 
-u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
+// Write statistics: platform_flash_write calls and bytes, pages programmed
+// (each one is a program cycle) and bytes passed to platform_s_flash_write
+static struct
 {
-#ifndef INTERNAL_FLASH_WRITE_UNIT_SIZE
+  u32 writes, bytes;
+  u32 programs, programmed;
+} flashh_stats;
+
+// Unit of a program cycle for the statistics (one for each call if unknown)
+#if defined( INTERNAL_FLASH_PAGE_SIZE )
+#define FLASHH_PAGE_SIZE        INTERNAL_FLASH_PAGE_SIZE
+#elif defined( INTERNAL_FLASH_WRITE_UNIT_SIZE )
+#define FLASHH_PAGE_SIZE        INTERNAL_FLASH_WRITE_UNIT_SIZE
+#endif
+
+// Helper: write to flash through platform_s_flash_write, counting the pages
+// programmed
+static u32 flashh_s_write( const void *from, u32 toaddr, u32 size )
+{
+  if( size > 0 )
+  {
+#ifdef FLASHH_PAGE_SIZE
+    flashh_stats.programs += ( toaddr + size - 1 ) / FLASHH_PAGE_SIZE - toaddr / FLASHH_PAGE_SIZE + 1;
+#else
+    flashh_stats.programs ++;
+#endif
+    flashh_stats.programmed += size;
+  }
   return platform_s_flash_write( from, toaddr, size );
+}
+
+// Helper: write any number of bytes at any address, with writes of
+// INTERNAL_FLASH_WRITE_UNIT_SIZE bytes if the platform needs them
+static u32 flashh_write( const void *from, u32 toaddr, u32 size )
+{
+#ifndef INTERNAL_FLASH_WRITE_UNIT_SIZE
+  return flashh_s_write( from, toaddr, size );
 #else // #ifindef INTERNAL_FLASH_WRITE_UNIT_SIZE
   u32 temp, rest, ssize = size;
   unsigned i;
@@ -546,7 +580,7 @@ u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
     memcpy( tmpdata, ( const void* )temp, blksize );
     for( i = rest; size && ( i < blksize ); i ++, size --, pfrom ++ )
       tmpdata[ i ] = *pfrom;
-    platform_s_flash_write( tmpdata, temp, blksize );
+    flashh_s_write( tmpdata, temp, blksize );
     if( size == 0 )
       return ssize;
     toaddr = temp + blksize;
@@ -558,7 +592,7 @@ u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
   // Program the blocks now
   if( temp )
   {
-    platform_s_flash_write( pfrom, toaddr, temp );
+    flashh_s_write( pfrom, toaddr, temp );
     toaddr += temp;
     pfrom += temp;
   }
@@ -568,12 +602,103 @@ u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
     memcpy( tmpdata, ( const void* )toaddr, blksize );
     for( i = 0; size && ( i < rest ); i ++, size --, pfrom ++ )
       tmpdata[ i ] = *pfrom;
-    platform_s_flash_write( tmpdata, toaddr, blksize );
+    flashh_s_write( tmpdata, toaddr, blksize );
   }
   return ssize;
 #endif // #ifndef INTERNAL_FLASH_WRITE_UNIT_SIZE
 }
 
+#ifdef INTERNAL_FLASH_PAGE_SIZE
+
+// Write coalescing: the writes to a flash page are gathered in a RAM copy of
+// the page and programmed together when a write goes to another page, when
+// the end of the page is written or on platform_flash_sync. A small write
+// would otherwise cost a full page program cycle. The flash contents are not
+// updated until then, so the users must sync before reading back data they
+// wrote (WOFS syncs on open and close).
+
+#define FLASHH_NO_PAGE          0xFFFFFFFF
+
+static u8 flashh_wbuf[ INTERNAL_FLASH_PAGE_SIZE ];
+static u32 flashh_wbuf_page = FLASHH_NO_PAGE;
+static u32 flashh_wbuf_lo, flashh_wbuf_hi; // range of the page that must be written
+
+void platform_flash_sync(void)
+{
+  if( flashh_wbuf_page == FLASHH_NO_PAGE )
+    return;
+  if( flashh_wbuf_hi > flashh_wbuf_lo )
+    flashh_write( flashh_wbuf + flashh_wbuf_lo, flashh_wbuf_page + flashh_wbuf_lo, flashh_wbuf_hi - flashh_wbuf_lo );
+  flashh_wbuf_page = FLASHH_NO_PAGE;
+}
+
+u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
+{
+  const u8 *pfrom = ( const u8* )from;
+  u32 page, offset, len, ssize = size;
+
+  flashh_stats.writes ++;
+  flashh_stats.bytes += size;
+  while( size > 0 )
+  {
+    page = toaddr & ~( INTERNAL_FLASH_PAGE_SIZE - 1 );
+    offset = toaddr - page;
+    len = UMIN( size, INTERNAL_FLASH_PAGE_SIZE - offset );
+    if( page != flashh_wbuf_page || len == INTERNAL_FLASH_PAGE_SIZE )
+      platform_flash_sync();
+    if( len == INTERNAL_FLASH_PAGE_SIZE )
+    {
+      // A full page, nothing to gather
+      flashh_write( pfrom, toaddr, len );
+    }
+    else
+    {
+      if( page != flashh_wbuf_page )
+      {
+        memcpy( flashh_wbuf, ( const void* )page, INTERNAL_FLASH_PAGE_SIZE );
+        flashh_wbuf_page = page;
+        flashh_wbuf_lo = INTERNAL_FLASH_PAGE_SIZE;
+        flashh_wbuf_hi = 0;
+      }
+      memcpy( flashh_wbuf + offset, pfrom, len );
+      flashh_wbuf_lo = UMIN( flashh_wbuf_lo, offset );
+      flashh_wbuf_hi = UMAX( flashh_wbuf_hi, offset + len );
+      // The end of the page was written, a sequential writer is done with it
+      if( offset + len == INTERNAL_FLASH_PAGE_SIZE )
+        platform_flash_sync();
+    }
+    toaddr += len;
+    pfrom += len;
+    size -= len;
+  }
+  return ssize;
+}
+
+#else // #ifdef INTERNAL_FLASH_PAGE_SIZE
+
+void platform_flash_sync(void)
+{
+}
+
+u32 platform_flash_write( const void *from, u32 toaddr, u32 size )
+{
+  flashh_stats.writes ++;
+  flashh_stats.bytes += size;
+  return flashh_write( from, toaddr, size );
+}
+
+#endif // #ifdef INTERNAL_FLASH_PAGE_SIZE
+
+void platform_flash_get_stats( u32 *pwrites, u32 *pbytes, u32 *pprograms, u32 *pprogrammed, int reset )
+{
+  *pwrites = flashh_stats.writes;
+  *pbytes = flashh_stats.bytes;
+  *pprograms = flashh_stats.programs;
+  *pprogrammed = flashh_stats.programmed;
+  if( reset )
+    memset( &flashh_stats, 0, sizeof( flashh_stats ) );
+}
+
 #endif // #ifdef BUILD_WOFS
 
 // ****************************************************************************
@@ -650,3 +775,94 @@ void cmn_get_timeout_data( lua_State *L, int pidx, unsigned *pid, timer_data_typ
     luaL_error( L, "the system timer is not implemented on this platform" );
 }
 
+
+// ****************************************************************************
+// Event tracing
+// Fixed size records go to a ring buffer, the oldest ones are overwritten.
+// cmn_trace can be called from both interrupt and task context: only the slot
+// reservation (an index increment) runs with the interrupts masked, the record
+// itself is filled with the interrupts enabled. An interrupt preempting a
+// writer simply gets the next slot.
+
+#ifdef BUILD_TRACE
+
+#define CMN_TRACE_SIZE          ( 1 << CMN_TRACE_LOG_SIZE )
+#define CMN_TRACE_MASK          ( CMN_TRACE_SIZE - 1 )
+
+static cmn_trace_record cmn_trace_buf[ CMN_TRACE_SIZE ];
+static volatile u32 cmn_trace_idx; // number of records written since the last clear
+static volatile u8 cmn_trace_on = 1;
+
+static const char* const cmn_trace_names[] =
+{
+  "none", "int_add", "int_drop", "int_hook", "uart_rx", "uip_loop",
+  "disk_read", "disk_read_end", "disk_write", "disk_write_end",
+  "gc_full", "gc_full_end", "niffs_gc", "niffs_gc_end", "idle", "idle_end"
+};
+
+void cmn_trace( u16 id, u32 arg1, u32 arg2 )
+{
+  cmn_trace_record *prec;
+  u32 idx;
+  int old_status;
+
+  if( !cmn_trace_on )
+    return;
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  idx = cmn_trace_idx ++;
+  platform_cpu_set_global_interrupts( old_status );
+  prec = cmn_trace_buf + ( idx & CMN_TRACE_MASK );
+  prec->timestamp = ( u32 )platform_timer_read_sys();
+  prec->id = id;
+  prec->seq = ( u16 )idx;
+  prec->arg1 = arg1;
+  prec->arg2 = arg2;
+}
+
+// Enable or disable tracing, returns the previous state
+int cmn_trace_enable( int enable )
+{
+  int prev = cmn_trace_on;
+
+  cmn_trace_on = enable ? 1 : 0;
+  return prev;
+}
+
+void cmn_trace_clear(void)
+{
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  cmn_trace_idx = 0;
+  platform_cpu_set_global_interrupts( old_status );
+}
+
+// Number of records available in the buffer
+unsigned cmn_trace_count(void)
+{
+  u32 idx = cmn_trace_idx;
+
+  return idx > CMN_TRACE_SIZE ? CMN_TRACE_SIZE : ( unsigned )idx;
+}
+
+// Get the n-th available record (0 is the oldest one)
+// Returns 0 if the record does not exist, 1 otherwise
+int cmn_trace_get( unsigned n, cmn_trace_record *prec )
+{
+  u32 idx = cmn_trace_idx;
+  u32 first = idx > CMN_TRACE_SIZE ? idx - CMN_TRACE_SIZE : 0;
+
+  if( first + n >= idx )
+    return 0;
+  *prec = cmn_trace_buf[ ( first + n ) & CMN_TRACE_MASK ];
+  return 1;
+}
+
+const char* cmn_trace_event_name( u16 id )
+{
+  if( id < CMN_TRACE_LAST )
+    return cmn_trace_names[ id ];
+  return id >= CMN_TRACE_USER ? "user" : "unknown";
+}
+
+#endif // #ifdef BUILD_TRACE
@@ -0,0 +1,140 @@
+// Common implementation: CAN receive queue and acceptance filters
+
+#include "platform_conf.h"
+#include "common.h"
+#include "utils.h"
+#include <string.h>
+
+#if NUM_CAN > 0
+
+// Frames in the receive queue of each CAN interface (must be a power of 2)
+#ifndef CAN_RX_QUEUE_SIZE
+#define CAN_RX_QUEUE_SIZE     16
+#endif
+
+#if ( CAN_RX_QUEUE_SIZE & ( CAN_RX_QUEUE_SIZE - 1 ) ) != 0 || CAN_RX_QUEUE_SIZE > 0x8000
+#error "CAN_RX_QUEUE_SIZE must be a power of 2 not larger than 32768"
+#endif
+
+// The queue is written only by cmn_can_rx_handler and read only by
+// cmn_can_recv, so 'head' and 'tail' (free running) need no locking
+typedef struct
+{
+  cmn_can_frame frames[ CAN_RX_QUEUE_SIZE ];
+  volatile u16 head, tail;
+  u8 nfilters;
+  cmn_can_filter filters[ CAN_MAX_FILTERS ];
+  volatile u32 received, filtered, dropped;
+} cmn_can_state;
+
+static cmn_can_state can_state[ NUM_CAN ];
+
+#define CAN_QUEUE_COUNT( pc )   ( ( u16 )( ( pc )->head - ( pc )->tail ) )
+
+// Check a frame against the acceptance filters (everything passes if there
+// are no filters)
+static int cmn_can_accept( const cmn_can_state *pc, u32 canid, u8 idtype )
+{
+  const cmn_can_filter *pf;
+  unsigned i;
+
+  if( pc->nfilters == 0 )
+    return 1;
+  for( i = 0, pf = pc->filters; i < pc->nfilters; i ++, pf ++ )
+    if( pf->idtype == idtype && ( ( canid ^ pf->id ) & pf->mask ) == 0 )
+      return 1;
+  return 0;
+}
+
+// Called by the CAN driver (usually from its RX interrupt) for every
+// received frame. The frame is timestamped and queued if it passes the
+// filters. If the queue is full the new frame is dropped.
+void cmn_can_rx_handler( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data )
+{
+  cmn_can_state *pc = can_state + id;
+  cmn_can_frame *pf;
+
+  if( !cmn_can_accept( pc, canid, idtype ) )
+  {
+    pc->filtered ++;
+    return;
+  }
+  if( CAN_QUEUE_COUNT( pc ) == CAN_RX_QUEUE_SIZE )
+  {
+    pc->dropped ++;
+    return;
+  }
+  pf = pc->frames + ( pc->head & ( CAN_RX_QUEUE_SIZE - 1 ) );
+  pf->id = canid;
+  pf->timestamp = ( u32 )platform_timer_read_sys();
+  pf->idtype = idtype;
+  pf->len = UMIN( len, PLATFORM_CAN_MAXLEN );
+  memcpy( pf->data, data, pf->len );
+  pc->head ++;
+  pc->received ++;
+}
+
+// Move the frames of a polled driver to the queue
+static void cmn_can_poll( unsigned id )
+{
+  cmn_can_state *pc = can_state + id;
+  u32 canid;
+  u8 idtype, len, data[ PLATFORM_CAN_MAXLEN ];
+
+  while( CAN_QUEUE_COUNT( pc ) < CAN_RX_QUEUE_SIZE && platform_can_recv( id, &canid, &idtype, &len, data ) == PLATFORM_OK )
+    cmn_can_rx_handler( id, canid, idtype, len, data );
+}
+
+// Return the number of frames waiting in the queue
+unsigned cmn_can_get_count( unsigned id )
+{
+  cmn_can_poll( id );
+  return CAN_QUEUE_COUNT( can_state + id );
+}
+
+// Remove up to 'maxframes' frames from the queue, return the number of frames
+unsigned cmn_can_recv( unsigned id, cmn_can_frame *frames, unsigned maxframes )
+{
+  cmn_can_state *pc = can_state + id;
+  unsigned i, n;
+
+  cmn_can_poll( id );
+  n = UMIN( CAN_QUEUE_COUNT( pc ), maxframes );
+  for( i = 0; i < n; i ++, pc->tail ++ )
+    frames[ i ] = pc->frames[ pc->tail & ( CAN_RX_QUEUE_SIZE - 1 ) ];
+  return n;
+}
+
+// Set the acceptance filters (none to accept all frames). The frames already
+// in the queue are not affected.
+int cmn_can_set_filters( unsigned id, const cmn_can_filter *filters, unsigned nfilters )
+{
+  cmn_can_state *pc = can_state + id;
+  int old_status;
+
+  if( nfilters > CAN_MAX_FILTERS )
+    return PLATFORM_ERR;
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  if( nfilters > 0 )
+    memcpy( pc->filters, filters, nfilters * sizeof( cmn_can_filter ) );
+  pc->nfilters = nfilters;
+  platform_cpu_set_global_interrupts( old_status );
+  return PLATFORM_OK;
+}
+
+// Return the number of received, filtered and dropped (queue full) frames
+void cmn_can_get_stats( unsigned id, u32 *preceived, u32 *pfiltered, u32 *pdropped, int reset )
+{
+  cmn_can_state *pc = can_state + id;
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  *preceived = pc->received;
+  *pfiltered = pc->filtered;
+  *pdropped = pc->dropped;
+  if( reset )
+    pc->received = pc->filtered = pc->dropped = 0;
+  platform_cpu_set_global_interrupts( old_status );
+}
+
+#endif // #if NUM_CAN > 0
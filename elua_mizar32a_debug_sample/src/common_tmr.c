@@ -461,3 +461,94 @@ timer_data_type cmn_systimer_get(void)
   return ( timer_data_type )crtsys;
 }
 
+
+// ****************************************************************************
+// Waiting for events
+// cmn_wait_event puts the CPU to sleep between the checks of the condition
+// when an interrupt is guaranteed to wake it up in time: always if there is
+// no timeout (the interrupt that makes the condition true wakes it), and with
+// a timeout only if at least one periodic timer interrupt (the system timer
+// or the virtual timers) is due before it expires. Otherwise it polls.
+// On CPUs that can't enable the interrupts and sleep atomically (the UC3A0)
+// an interrupt that comes right before the sleep only wakes the CPU at the
+// next periodic timer interrupt. On those it sleeps only when there is one,
+// and such a missed wakeup is late by at most cmn_wait_wake_period() us
+// (100 ms with the virtual timers at 10 Hz on the Mizar32); without any
+// periodic interrupt it polls.
+
+static u32 cmn_wait_waits, cmn_wait_sleeps;
+static u64 cmn_wait_idle_us;
+
+// Return the longest interval (in us) between two periodic timer interrupts,
+// 0 if there are no periodic interrupts
+static timer_data_type cmn_wait_wake_period(void)
+{
+  timer_data_type period = SYSTIMER_SUPPORT ? cmn_systimer_us_per_interrupt : 0;
+
+#if VTMR_NUM_TIMERS > 0
+  if( period == 0 || period > 1000000 / VTMR_FREQ_HZ )
+    period = 1000000 / VTMR_FREQ_HZ;
+#endif
+  return period;
+}
+
+// Wait until 'cond( arg )' is true or until 'timeout' us elapsed on timer
+// 'timer_id' (0 checks the condition once, PLATFORM_TIMER_INF_TIMEOUT waits
+// forever). 'cond' is called with the interrupts disabled and must only
+// depend on data changed by interrupt handlers. Returns 1 if the condition
+// was met, 0 on timeout.
+int cmn_wait_event( p_cmn_wait_cond cond, void *arg, unsigned timer_id, timer_data_type timeout )
+{
+  timer_data_type tmrstart = 0, elapsed = 0, period, tsleep = 0;
+  int old_status;
+
+  if( cond( arg ) )
+    return 1;
+  if( timeout == 0 )
+    return 0;
+  cmn_wait_waits ++;
+  period = cmn_wait_wake_period();
+  if( timeout != PLATFORM_TIMER_INF_TIMEOUT )
+    tmrstart = platform_timer_start( timer_id );
+  while( 1 )
+  {
+    if( timeout != PLATFORM_TIMER_INF_TIMEOUT && ( elapsed = platform_timer_get_diff_crt( timer_id, tmrstart ) ) >= timeout )
+      return cond( arg ) ? 1 : 0;
+    if( SYSTIMER_SUPPORT )
+      tsleep = platform_timer_read_sys();
+    old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+    if( cond( arg ) )
+    {
+      platform_cpu_set_global_interrupts( old_status );
+      return 1;
+    }
+    if( old_status && ( timeout == PLATFORM_TIMER_INF_TIMEOUT || ( period > 0 && timeout - elapsed > period ) ) )
+    {
+      CMN_TRACE( CMN_TRACE_IDLE, timer_id, timeout == PLATFORM_TIMER_INF_TIMEOUT ? 0xFFFFFFFF : timeout - elapsed );
+      if( platform_cpu_idle( period > 0 ) )
+      {
+        cmn_wait_sleeps ++;
+        if( SYSTIMER_SUPPORT )
+          cmn_wait_idle_us += platform_timer_get_diff_crt( PLATFORM_TIMER_SYS_ID, tsleep );
+      }
+      CMN_TRACE( CMN_TRACE_IDLE_END, 0, 0 );
+    }
+    else
+      platform_cpu_set_global_interrupts( old_status );
+  }
+}
+
+// Return the number of waits that didn't end at the first check, the number
+// of times the CPU was put to sleep and the total time spent sleeping (us)
+void cmn_wait_get_stats( u32 *pwaits, u32 *psleeps, u64 *pidle_us, int reset )
+{
+  *pwaits = cmn_wait_waits;
+  *psleeps = cmn_wait_sleeps;
+  *pidle_us = cmn_wait_idle_us;
+  if( reset )
+  {
+    cmn_wait_waits = cmn_wait_sleeps = 0;
+    cmn_wait_idle_us = 0;
+  }
+}
+
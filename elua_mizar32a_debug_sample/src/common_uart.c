@@ -35,8 +35,15 @@ int platform_uart_exists( unsigned id )
   return 0;
 }
 
-// Helper function for buffers
-static int cmn_recv_helper( unsigned id, timer_data_type timeout )
+#ifdef BUF_ENABLE_UART
+// Wait condition for buffered receive: data in the UART buffer
+static int cmn_recv_cond( void *arg )
+{
+  return buf_get_count( BUF_ID_UART, *( unsigned* )arg ) > 0;
+}
+#endif // #ifdef BUF_ENABLE_UART
+
+int platform_uart_recv( unsigned id, unsigned timer_id, timer_data_type timeout )
 {
 #ifdef BUF_ENABLE_UART
   t_buf_data data;
@@ -45,52 +52,41 @@ static int cmn_recv_helper( unsigned id, timer_data_type timeout )
 #ifdef BUF_ENABLE_UART
   if( buf_is_enabled( BUF_ID_UART, id ) )
   {
-    if( timeout == 0 )
-    {
-      if ( ( buf_read( BUF_ID_UART, id, &data ) ) == PLATFORM_UNDERFLOW )
-        return -1;
-    }
-    else
-    {
-      while( ( buf_read( BUF_ID_UART, id, &data ) ) == PLATFORM_UNDERFLOW );
-    }
+    // The RX interrupt wakes the CPU up when a new char arrives
+    if( !cmn_wait_event( cmn_recv_cond, &id, timer_id, timeout ) )
+      return -1;
+    if ( ( buf_read( BUF_ID_UART, id, &data ) ) == PLATFORM_UNDERFLOW )
+      return -1;
     return ( int )data;
   }
   else
 #endif // #ifdef BUF_ENABLE_UART
   if( id < NUM_UART || id == CDC_UART_ID )
-    return platform_s_uart_recv( id, timeout );
-
-  return -1;
-}
-
-int platform_uart_recv( unsigned id, unsigned timer_id, timer_data_type timeout )
-{
-  timer_data_type tmr_start;
-  int res;
-  
-  if( timeout == 0 )
-    return cmn_recv_helper( id, timeout );
-  else if( timeout ==  PLATFORM_TIMER_INF_TIMEOUT )
-    return cmn_recv_helper( id, timeout );
-  else
   {
+    timer_data_type tmr_start;
+    int res;
+
+    if( timeout == 0 || timeout == PLATFORM_TIMER_INF_TIMEOUT )
+      return platform_s_uart_recv( id, timeout );
     // Receive char with the specified timeout
     tmr_start = platform_timer_start( timer_id );
     while( 1 )
     {
-      if( ( res = cmn_recv_helper( id, 0 ) ) >= 0 )
+      if( ( res = platform_s_uart_recv( id, 0 ) ) >= 0 )
         break;
       if( platform_timer_get_diff_crt( timer_id, tmr_start ) >= timeout )
         break;
     }
     return res;
   }
+
+  return -1;
 }
 
 #ifdef BUF_ENABLE_UART
 static void cmn_rx_handler( int usart_id, u8 data )
 {
+  CMN_TRACE( CMN_TRACE_UART_RX, usart_id, data );
 #ifdef BUILD_SERMUX
   if( usart_id == SERMUX_PHYS_ID )
   {
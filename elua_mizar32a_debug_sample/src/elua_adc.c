@@ -5,6 +5,7 @@
 #include "type.h"
 #include "elua_adc.h"
 #include "platform.h"
+#include "common.h"
 #include <stdlib.h>
 #include "utils.h"
 
@@ -13,6 +14,7 @@
 // Primary set of pointers to channel states
 elua_adc_ch_state adc_ch_state[ NUM_ADC ];
 elua_adc_dev_state  adc_dev_state;
+elua_adc_stream_state adc_stream_state;
 
 elua_adc_ch_state *adc_get_ch_state( unsigned id )
 {
@@ -24,6 +26,11 @@ elua_adc_dev_state *adc_get_dev_state( unsigned dev_id )
   return &adc_dev_state;
 }
 
+elua_adc_stream_state *adc_get_stream_state( void )
+{
+  return &adc_stream_state;
+}
+
 // Rewrite device sequence
 void adc_update_dev_sequence( unsigned dev_id  )
 {
@@ -233,39 +240,71 @@ void adc_smooth_data( unsigned id )
 //  return 0
 u16 adc_get_processed_sample( unsigned id )
 {
-  elua_adc_ch_state *s = adc_get_ch_state( id );
   u16 sample = 0;
 
-  if ( adc_samples_available( id ) > 0 )
+  adc_get_processed_samples( id, &sample, 1 );
+  return sample;
+}
+
+// Get up to 'count' samples in 'dest', processed like in
+// adc_get_processed_sample. The samples are copied from the buffer in blocks
+// and the smoothing filter runs over the whole block. If smoothing is enabled
+// but not warmed up yet, 'count' zeros are returned (and no samples used).
+// Returns the number of values stored in 'dest'.
+u16 adc_get_processed_samples( unsigned id, u16 *dest, u16 count )
+{
+  elua_adc_ch_state *s = adc_get_ch_state( id );
+  u16 got = 0, i, idx;
+  u32 sum;
+#if defined( BUF_ENABLE_ADC )
+  u16 n;
+#endif
+
+  if( ( s->logsmoothlen > 0 ) && ( s->smooth_ready == 0 ) )
+  {
+    for( i = 0; i < count; i ++ )
+      dest[ i ] = 0;
+    return count;
+  }
+
+  // Raw samples: the last converted value first if not buffered, then
+  // as many as possible from the buffer
+  while( got < count )
   {
-    if ( ( s->logsmoothlen > 0)  && ( s->smooth_ready == 1 ) )
+    if( s->value_fresh == 1 )
     {
-      adc_smooth_data( id );
-      
-      if ( s->reqsamples > 0)
-        s->reqsamples -- ;
-      
-      sample = (u16) ( s->smoothsum >> s->logsmoothlen );
+      dest[ got ++ ] = *( s->value_ptr );
+      s->value_fresh = 0;
+      continue;
     }
-    else if ( s->logsmoothlen == 0 )
-    {
 #if defined( BUF_ENABLE_ADC )
-      if( s->value_fresh == 1 )
-      {
-        sample = *( s->value_ptr );
-        s->value_fresh = 0;
-      }
-      else
-        buf_read( BUF_ID_ADC, id, ( t_buf_data* )&sample );
+    if( ( n = buf_read_block( BUF_ID_ADC, id, ( t_buf_data* )( dest + got ), count - got ) ) == 0 )
+      break;
+    got += n;
 #else
-      sample = *( s->value_ptr );
-      s->value_fresh = 0;
+    break;
 #endif
-      if ( s->reqsamples > 0)
-        s->reqsamples -- ;
+  }
+  s->reqsamples = s->reqsamples > got ? s->reqsamples - got : 0;
+
+  // Moving average over the block, same steps as adc_smooth_data
+  if( s->logsmoothlen > 0 )
+  {
+    idx = s->smoothidx;
+    sum = s->smoothsum;
+    for( i = 0; i < got; i ++ )
+    {
+      if( idx == SMOOTH_REALSIZE( s ) )
+        idx = 0;
+      sum -= s->smoothbuf[ idx ];
+      s->smoothbuf[ idx ++ ] = dest[ i ];
+      sum += dest[ i ];
+      dest[ i ] = ( u16 )( sum >> s->logsmoothlen );
     }
+    s->smoothidx = idx;
+    s->smoothsum = sum;
   }
-  return sample;
+  return got;
 }
 
 // Zero out and reset smoothing buffer
@@ -305,15 +344,127 @@ elua_adc_ch_state *s = adc_get_ch_state( id );
 // If blocking is enabled, wait until we have enough samples or the current
 //  sampling event has finished, returns number of available samples when
 //  function does exit
+// Wait condition for adc_wait_samples: the conversion stopped or enough
+// samples are available
+typedef struct
+{
+  unsigned id;
+  unsigned samples;
+} adc_wait_data;
+
+static int adc_wait_cond( void *arg )
+{
+  adc_wait_data *pw = ( adc_wait_data* )arg;
+
+  return adc_get_ch_state( pw->id )->op_pending == 0 || adc_samples_available( pw->id ) >= pw->samples;
+}
+
 u16 adc_wait_samples( unsigned id, unsigned samples )
 {
   elua_adc_ch_state *s = adc_get_ch_state( id );
+  adc_wait_data w;
   
   if( adc_samples_available( id ) < samples && s->blocking == 1 )
-    while( s->op_pending == 1 && adc_samples_available( id ) < samples );
+  {
+    // The ADC interrupt wakes the CPU up when new samples arrive
+    w.id = id;
+    w.samples = samples;
+    cmn_wait_event( adc_wait_cond, &w, PLATFORM_TIMER_SYS_ID, PLATFORM_TIMER_INF_TIMEOUT );
+  }
     
   return adc_samples_available( id );
 }
 
-#endif
+// ****************************************************************************
+// Continuous acquisition
+
+// Start converting the channels in 'chmask' at 'freq' sequences per second
+// (triggered by timer 'timer_id') into blocks of 'blocksize' samples (the
+// samples of a sequence are stored in increasing channel order). Returns the
+// actual frequency, 0 on error.
+u32 adc_stream_start( u32 chmask, unsigned timer_id, u32 freq, u16 blocksize )
+{
+  elua_adc_stream_state *st = &adc_stream_state;
+  u32 res;
+
+  if( st->running || blocksize == 0 )
+    return 0;
+  if( ( st->blocks[ 0 ] = ( u16* )malloc( 2 * blocksize * sizeof( u16 ) ) ) == NULL )
+    return 0;
+  st->blocks[ 1 ] = st->blocks[ 0 ] + blocksize;
+  st->blocksize = blocksize;
+  st->filling = st->ready = 0;
+  st->seq = st->overruns = 0;
+  st->running = 1;
+  if( ( res = platform_adc_stream_start( chmask, timer_id, freq, st->blocks[ 0 ], st->blocks[ 1 ], blocksize ) ) == 0 )
+  {
+    st->running = 0;
+    free( st->blocks[ 0 ] );
+  }
+  return res;
+}
+
+void adc_stream_stop( void )
+{
+  elua_adc_stream_state *st = &adc_stream_state;
+
+  if( !st->running )
+    return;
+  platform_adc_stream_stop();
+  st->running = st->ready = 0;
+  free( st->blocks[ 0 ] );
+}
 
+// Called by the platform (in interrupt context) when the block being filled
+// is complete. Returns the block to fill after the next one.
+u16 *adc_stream_block_done( void )
+{
+  elua_adc_stream_state *st = &adc_stream_state;
+  u8 done = st->filling;
+
+  // The other block is filled next, its samples are lost if still unread
+  if( st->ready )
+    st->overruns ++;
+  st->filling = !done;
+  st->ready = 1;
+  st->seq ++;
+  return st->blocks[ done ];
+}
+
+// Get the last complete block (NULL if none) without copying it. The
+// samples can be used until the next block is complete; call
+// adc_stream_release with the value returned in 'pseq' when done.
+u16 *adc_stream_peek( u32 *pseq )
+{
+  elua_adc_stream_state *st = &adc_stream_state;
+  u16 *p = NULL;
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  if( st->running && st->ready )
+  {
+    st->ready = 0;
+    p = st->blocks[ !st->filling ];
+    *pseq = st->seq;
+  }
+  platform_cpu_set_global_interrupts( old_status );
+  return p;
+}
+
+// Returns 1 if the block returned by adc_stream_peek was not overwritten
+// while it was used, 0 otherwise (the block is then counted as lost)
+int adc_stream_release( u32 seq )
+{
+  elua_adc_stream_state *st = &adc_stream_state;
+  int old_status;
+
+  if( st->seq == seq )
+    return 1;
+  // The interrupt handler counts overruns too
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  st->overruns ++;
+  platform_cpu_set_global_interrupts( old_status );
+  return 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+// Simulated CAN backend: NUM_CAN controllers on a virtual bus. A frame sent
+// by a controller is received by all the other controllers that were set up,
+// like on a real bus (a controller doesn't receive its own frames).
+// It has no hardware dependencies, so it can be used to run the CAN module
+// and the common receive queue on boards without CAN and on a PC.
+
+#include "platform_conf.h"
+#if defined( BUILD_CAN_SIM ) && NUM_CAN > 0
+#include "platform.h"
+#include "common.h"
+
+static u32 can_sim_clock[ NUM_CAN ];
+
+u32 platform_can_setup( unsigned id, u32 clock )
+{
+  can_sim_clock[ id ] = clock;
+  return clock;
+}
+
+int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data )
+{
+  unsigned i;
+  int old_status;
+
+  if( can_sim_clock[ id ] == 0 )
+    return PLATFORM_ERR;
+  // Deliver with interrupts disabled, like a real RX interrupt
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  for( i = 0; i < NUM_CAN; i ++ )
+    if( i != id && can_sim_clock[ i ] == can_sim_clock[ id ] )
+      cmn_can_rx_handler( i, canid, idtype, len, data );
+  platform_cpu_set_global_interrupts( old_status );
+  return PLATFORM_OK;
+}
+
+// Frames are delivered through cmn_can_rx_handler, there is nothing to poll
+int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+{
+  return PLATFORM_ERR;
+}
+
+#endif // #if defined( BUILD_CAN_SIM ) && NUM_CAN > 0
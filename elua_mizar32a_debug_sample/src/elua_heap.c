@@ -0,0 +1,221 @@
+// Region aware heap: every memory region returned by platform_get_first_free_ram()
+// becomes an independent dlmalloc mspace, and a placement policy decides which
+// region serves a request
+
+#include "platform_conf.h"
+#ifdef USE_HEAP_REGIONS
+
+#include "type.h"
+#include "platform.h"
+#include "elua_heap.h"
+#include <string.h>
+#include <stdint.h>
+
+typedef struct
+{
+  char *start, *end;
+  mspace msp;
+} elua_heap_region;
+
+static elua_heap_region heap_regions[ ELUA_HEAP_MAX_REGIONS ];
+static unsigned heap_num_regions;
+static u8 heap_initialized;
+static u8 heap_policy = ELUA_HEAP_DEFAULT_POLICY;
+static u32 heap_threshold = ELUA_HEAP_SPLIT_THRESHOLD;
+
+// ****************************************************************************
+// Helpers
+
+static void heaph_init( void )
+{
+  unsigned i;
+  char *pstart, *pend;
+  elua_heap_region *r;
+
+  for( i = 0; i < ELUA_HEAP_MAX_REGIONS; i ++ )
+  {
+    if( ( pstart = ( char* )platform_get_first_free_ram( i ) ) == NULL )
+      break;
+    pend = ( char* )platform_get_last_free_ram( i );
+    r = heap_regions + heap_num_regions;
+    if( ( r->msp = create_mspace_with_base( pstart, pend - pstart, 0 ) ) == NULL )
+      continue;
+    r->start = pstart;
+    r->end = pend;
+    heap_num_regions ++;
+  }
+  heap_initialized = 1;
+}
+
+// Return the region that owns the given block or NULL if not found
+static elua_heap_region* heaph_find_region( const void *ptr )
+{
+  unsigned i;
+
+  for( i = 0; i < heap_num_regions; i ++ )
+    if( ( const char* )ptr >= heap_regions[ i ].start && ( const char* )ptr < heap_regions[ i ].end )
+      return heap_regions + i;
+  return NULL;
+}
+
+// Returns 1 if the request should be served starting from the slow region
+static int heaph_slow_first( size_t size, int hint )
+{
+  switch( heap_policy )
+  {
+    case ELUA_HEAP_POLICY_SLOW_FIRST:
+      return 1;
+
+    case ELUA_HEAP_POLICY_SPLIT:
+      if( hint == ELUA_HEAP_HINT_FAST )
+        return 0;
+      if( hint == ELUA_HEAP_HINT_LARGE )
+        return 1;
+      return size > heap_threshold;
+
+    default:
+      return 0;
+  }
+}
+
+// Allocate a new block following the current policy, skipping region 'skip'
+static void* heaph_alloc( size_t size, int hint, const elua_heap_region *skip )
+{
+  unsigned i;
+  int slow = heaph_slow_first( size, hint );
+  elua_heap_region *r;
+  void *ptr;
+
+  for( i = 0; i < heap_num_regions; i ++ )
+  {
+    r = heap_regions + ( slow ? heap_num_regions - i - 1 : i );
+    if( r != skip && ( ptr = mspace_malloc( r->msp, size ) ) != NULL )
+      return ptr;
+  }
+  return NULL;
+}
+
+// ****************************************************************************
+// Public interface
+
+void* elua_heap_malloc( size_t size )
+{
+  return elua_heap_realloc_hint( NULL, size, ELUA_HEAP_HINT_ANY );
+}
+
+void* elua_heap_calloc( size_t nelem, size_t elem_size )
+{
+  void *ptr;
+
+  if( elem_size && nelem > SIZE_MAX / elem_size )
+    return NULL;
+  if( ( ptr = elua_heap_malloc( nelem * elem_size ) ) != NULL )
+    memset( ptr, 0, nelem * elem_size );
+  return ptr;
+}
+
+void elua_heap_free( void *ptr )
+{
+  elua_heap_region *r;
+
+  if( ptr && ( r = heaph_find_region( ptr ) ) != NULL )
+    mspace_free( r->msp, ptr );
+}
+
+void* elua_heap_realloc( void *ptr, size_t size )
+{
+  return elua_heap_realloc_hint( ptr, size, ELUA_HEAP_HINT_ANY );
+}
+
+// Allocate/reallocate with a placement hint. A reallocated block stays in its
+// region if possible and migrates to another region only when that fails
+void* elua_heap_realloc_hint( void *ptr, size_t size, int hint )
+{
+  elua_heap_region *r;
+  void *newptr;
+  size_t oldsize;
+
+  if( !heap_initialized )
+    heaph_init();
+  if( ptr == NULL )
+    return size == 0 ? NULL : heaph_alloc( size, hint, NULL );
+  if( size == 0 )
+  {
+    elua_heap_free( ptr );
+    return NULL;
+  }
+  if( ( r = heaph_find_region( ptr ) ) == NULL )
+    return NULL;
+  if( ( newptr = mspace_realloc( r->msp, ptr, size ) ) != NULL )
+    return newptr;
+  if( ( newptr = heaph_alloc( size, hint, r ) ) == NULL )
+    return NULL;
+  oldsize = mspace_usable_size( ptr );
+  memcpy( newptr, ptr, oldsize < size ? oldsize : size );
+  mspace_free( r->msp, ptr );
+  return newptr;
+}
+
+int elua_heap_set_policy( int policy, u32 threshold )
+{
+  if( policy < 0 || policy >= ELUA_HEAP_POLICY_LAST )
+    return 0;
+  heap_policy = ( u8 )policy;
+  if( threshold > 0 )
+    heap_threshold = threshold;
+  return 1;
+}
+
+int elua_heap_get_policy( u32 *pthreshold )
+{
+  if( pthreshold )
+    *pthreshold = heap_threshold;
+  return heap_policy;
+}
+
+unsigned elua_heap_get_num_regions( void )
+{
+  if( !heap_initialized )
+    heaph_init();
+  return heap_num_regions;
+}
+
+// Get the bounds and the mallinfo data of a single region
+// Returns 0 if the region doesn't exist, 1 otherwise
+int elua_heap_get_region_info( unsigned id, u32 *pstart, u32 *psize, struct mallinfo *pinfo )
+{
+  elua_heap_region *r;
+
+  if( id >= elua_heap_get_num_regions() )
+    return 0;
+  r = heap_regions + id;
+  if( pstart )
+    *pstart = ( u32 )r->start;
+  if( psize )
+    *psize = ( u32 )( r->end - r->start );
+  if( pinfo )
+    *pinfo = mspace_mallinfo( r->msp );
+  return 1;
+}
+
+// mallinfo() over all the regions
+struct mallinfo elua_heap_mallinfo( void )
+{
+  struct mallinfo total, m;
+  unsigned i;
+
+  memset( &total, 0, sizeof( total ) );
+  for( i = 0; i < elua_heap_get_num_regions(); i ++ )
+  {
+    m = mspace_mallinfo( heap_regions[ i ].msp );
+    total.arena += m.arena;
+    total.ordblks += m.ordblks;
+    total.usmblks += m.usmblks;
+    total.uordblks += m.uordblks;
+    total.fordblks += m.fordblks;
+    total.keepcost += m.keepcost;
+  }
+  return total;
+}
+
+#endif // #ifdef USE_HEAP_REGIONS
@@ -3,6 +3,7 @@
 #include "lua.h"
 #include "platform.h"
 #include "platform_conf.h"
+#include "common.h"
 #include "ldebug.h"
 #include <stdio.h>
 #include <string.h>
@@ -19,6 +20,10 @@ static elua_int_element elua_int_queue[ 1 << PLATFORM_INT_QUEUE_LOG_SIZE ];
 // Interrupt enabled/disabled flags
 static u32 elua_int_flags[ LUA_INT_MAX_SOURCES / 32 ];
 
+// Hook installed when the interrupt queue is empty (none by default)
+static elua_int_p_hook elua_int_idle_hook;
+static int elua_int_idle_mask, elua_int_idle_count;
+
 // Masking for read/write indexes
 #define INT_IDX_SHIFT                   ( PLATFORM_INT_QUEUE_LOG_SIZE )
 #define INT_IDX_MASK                    ( ( 1 << INT_IDX_SHIFT ) - 1 )
@@ -33,6 +38,7 @@ static void elua_int_hook( lua_State *L, lua_Debug *ar )
   crt = elua_int_queue[ elua_int_read_idx ];
   elua_int_queue[ elua_int_read_idx ].id = ELUA_INT_EMPTY_SLOT;
   elua_int_read_idx = ( elua_int_read_idx + 1 ) & INT_IDX_MASK;
+  CMN_TRACE( CMN_TRACE_INT_HOOK, crt.id, crt.resnum );
 
   if( elua_int_is_enabled( crt.id ) )
   {
@@ -51,8 +57,24 @@ static void elua_int_hook( lua_State *L, lua_Debug *ar )
   }
 
   old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
-  if( elua_int_queue[ elua_int_read_idx ].id == ELUA_INT_EMPTY_SLOT ) // no more interrupts in the queue, so clear the hook
-    lua_sethook( L, NULL, 0, 0 );
+  if( elua_int_queue[ elua_int_read_idx ].id == ELUA_INT_EMPTY_SLOT ) // no more interrupts in the queue, so restore the idle hook
+    lua_sethook( L, elua_int_idle_hook, elua_int_idle_mask, elua_int_idle_count );
+  platform_cpu_set_global_interrupts( old_status );
+}
+
+// Set the hook that runs while no interrupts are pending (NULL to remove it)
+// elua_int_hook takes over the Lua hook while interrupts are queued and
+// restores this one when the queue is empty
+void elua_int_set_idle_hook( elua_int_p_hook hook, int mask, int count )
+{
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  elua_int_idle_hook = hook;
+  elua_int_idle_mask = hook ? mask : 0;
+  elua_int_idle_count = hook ? count : 0;
+  if( lua_getstate() && elua_int_queue[ elua_int_read_idx ].id == ELUA_INT_EMPTY_SLOT )
+    lua_sethook( lua_getstate(), hook, elua_int_idle_mask, elua_int_idle_count );
   platform_cpu_set_global_interrupts( old_status );
 }
 
@@ -71,6 +93,7 @@ int elua_int_add( elua_int_id inttype, elua_int_resnum resnum )
   // If there's no more room in the queue, set the overflow flag and return
   if( elua_int_queue[ elua_int_write_idx ].id != ELUA_INT_EMPTY_SLOT )
   {
+    CMN_TRACE( CMN_TRACE_INT_DROP, inttype, resnum );
     printf( "ERROR in elua_int_add: buffer overflow, interrupt not queued\n" );
     return PLATFORM_ERR;
   }
@@ -79,6 +102,7 @@ int elua_int_add( elua_int_id inttype, elua_int_resnum resnum )
   elua_int_queue[ elua_int_write_idx ].id = inttype;
   elua_int_queue[ elua_int_write_idx ].resnum = resnum;
   elua_int_write_idx = ( elua_int_write_idx + 1 ) & INT_IDX_MASK;
+  CMN_TRACE( CMN_TRACE_INT_ADD, inttype, resnum );
 
   // Set the Lua hook (it's OK to set it even if it's already set)
   lua_sethook( lua_getstate(), elua_int_hook, LUA_MASKCOUNT, 2 ); 
@@ -124,6 +148,8 @@ void elua_int_cleanup()
   elua_int_disable_all();
   elua_int_read_idx = elua_int_write_idx = 0;
   memset( elua_int_queue, ELUA_INT_EMPTY_SLOT, sizeof( elua_int_queue ) );
+  elua_int_idle_hook = NULL;
+  elua_int_idle_mask = elua_int_idle_count = 0;
 }
 
 #else // #ifdef BUILD_LUA_INT_HANDLERS
@@ -151,6 +177,13 @@ int elua_int_add( elua_int_id inttype, elua_int_resnum resnum )
   return PLATFORM_ERR;
 }
 
+// Without Lua interrupts the idle hook is the only Lua hook user
+void elua_int_set_idle_hook( elua_int_p_hook hook, int mask, int count )
+{
+  if( lua_getstate() )
+    lua_sethook( lua_getstate(), hook, hook ? mask : 0, hook ? count : 0 );
+}
+
 #endif // #ifdef BUILD_LUA_INT_HANDLERS
 
 // ****************************************************************************
@@ -8,6 +8,7 @@
 #include "platform_conf.h"
 #if defined( BUILD_MMCFS ) && !defined( ELUA_SIMULATOR ) && !defined( XMC4500_F144x1024 ) && !defined( XMC4500_E144x1024 ) && !defined( XMC4700_F144x2048 )
 #include "platform.h"
+#include "common.h"
 #include "diskio.h"
 #include "mmcfs.h"
 
@@ -424,6 +425,7 @@ DRESULT disk_read (
 {
     if (!count) return RES_PARERR;
     if (Stat[drv] & STA_NOINIT) return RES_NOTRDY;
+    CMN_TRACE( CMN_TRACE_DISK_READ, sector, count );
 
     if (!(CardType[drv] & 4)) sector *= 512;    /* Convert to byte address if needed */
 
@@ -446,6 +448,7 @@ DRESULT disk_read (
 
     DESELECT(drv);            /* CS = H */
     rcvr_spi(drv);            /* Idle (Release DO) */
+    CMN_TRACE( CMN_TRACE_DISK_READ_END, drv, count );
 
     return count ? RES_ERROR : RES_OK;
 }
@@ -467,6 +470,7 @@ DRESULT disk_write (
     if (!count) return RES_PARERR;
     if (Stat[drv] & STA_NOINIT) return RES_NOTRDY;
     if (Stat[drv] & STA_PROTECT) return RES_WRPRT;
+    CMN_TRACE( CMN_TRACE_DISK_WRITE, sector, count );
 
     if (!(CardType[drv] & 4)) sector *= 512;    /* Convert to byte address if needed */
 
@@ -493,6 +497,7 @@ DRESULT disk_write (
 
     DESELECT(drv);            /* CS = H */
     rcvr_spi(drv);            /* Idle (Release DO) */
+    CMN_TRACE( CMN_TRACE_DISK_WRITE_END, drv, count );
 
     return count ? RES_ERROR : RES_OK;
 }
@@ -10,6 +10,7 @@
 #include "uip_arp.h"
 #include "platform.h"
 #include "utils.h"
+#include "common.h"
 #include "uip-split.h"
 #include "dhcpc.h"
 #include "resolv.h"
@@ -50,6 +51,7 @@ void elua_uip_mainloop()
 
   // Increment uIP timers
   temp = platform_eth_get_elapsed_time();
+  CMN_TRACE( CMN_TRACE_UIP_LOOP, temp, 0 );
   periodic_timer += temp;
   arp_timer += temp;
 
@@ -540,6 +542,18 @@ static void elua_prep_socket_state( volatile struct elua_uip_state *pstate, void
   pstate->state = state;
 }
 
+// Wait condition for the socket operations: the uIP state machine (run from
+// the Ethernet and timer interrupts) finished the request
+static int elua_net_idle_cond( void *arg )
+{
+  return ( ( volatile struct elua_uip_state* )arg )->state == ELUA_UIP_STATE_IDLE;
+}
+
+static void elua_net_wait_idle( volatile struct elua_uip_state *pstate )
+{
+  cmn_wait_event( elua_net_idle_cond, ( void* )pstate, PLATFORM_TIMER_SYS_ID, PLATFORM_TIMER_INF_TIMEOUT );
+}
+
 int elua_net_socket( int type )
 {
   int i;
@@ -577,7 +591,7 @@ elua_net_size elua_net_send( int s, const void* buf, elua_net_size len )
     return 0;
   elua_prep_socket_state( pstate, ( void* )buf, len, ELUA_NET_NO_LASTCHAR, ELUA_NET_ERR_OK, ELUA_UIP_STATE_SEND );
   platform_eth_force_interrupt();
-  while( pstate->state != ELUA_UIP_STATE_IDLE );
+  elua_net_wait_idle( pstate );
   return len - pstate->len;
 }
 
@@ -585,7 +599,6 @@ elua_net_size elua_net_send( int s, const void* buf, elua_net_size len )
 static elua_net_size elua_net_recv_internal( int s, void* buf, elua_net_size maxsize, s16 readto, unsigned timer_id, timer_data_type to_us, int with_buffer )
 {
   volatile struct elua_uip_state *pstate = ( volatile struct elua_uip_state* )&( uip_conns[ s ].appstate );
-  timer_data_type tmrstart = 0;
   int old_status;
 
   if( !ELUA_UIP_IS_SOCK_OK( s ) || !uip_conn_active( s ) )
@@ -593,23 +606,15 @@ static elua_net_size elua_net_recv_internal( int s, void* buf, elua_net_size max
   if( maxsize == 0 )
     return 0;
   elua_prep_socket_state( pstate, buf, maxsize, readto, with_buffer, ELUA_UIP_STATE_RECV );
-  if( to_us > 0 )
-    tmrstart = platform_timer_start( timer_id );
-  while( 1 )
+  if( !cmn_wait_event( elua_net_idle_cond, ( void* )pstate, timer_id, to_us > 0 ? to_us : PLATFORM_TIMER_INF_TIMEOUT ) )
   {
-    if( pstate->state == ELUA_UIP_STATE_IDLE )
-      break;
-    if( to_us > 0 && platform_timer_get_diff_crt( timer_id, tmrstart ) >= to_us )
+    old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+    if( pstate->state != ELUA_UIP_STATE_IDLE )
     {
-      old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
-      if( pstate->state != ELUA_UIP_STATE_IDLE )
-      {
-        pstate->res = ELUA_NET_ERR_TIMEDOUT;
-        pstate->state = ELUA_UIP_STATE_IDLE;
-      }
-      platform_cpu_set_global_interrupts( old_status );
-      break;
+      pstate->res = ELUA_NET_ERR_TIMEDOUT;
+      pstate->state = ELUA_UIP_STATE_IDLE;
     }
+    platform_cpu_set_global_interrupts( old_status );
   }
   return maxsize - pstate->len;
 }
@@ -649,7 +654,7 @@ int elua_net_close( int s )
     return -1;
   elua_prep_socket_state( pstate, NULL, 0, ELUA_NET_NO_LASTCHAR, ELUA_NET_ERR_OK, ELUA_UIP_STATE_CLOSE );
   platform_eth_force_interrupt();
-  while( pstate->state != ELUA_UIP_STATE_IDLE );
+  elua_net_wait_idle( pstate );
   return pstate->res == ELUA_NET_ERR_OK ? 0 : -1;
 }
 
@@ -703,6 +708,11 @@ int i;
   return -1;
 }
 
+static int elua_net_pending_cond( void *arg )
+{
+  return elua_net_find_pending( *( u16* )arg ) >= 0;
+}
+
 
 // Accept a connection on the given port, return its socket id (and the IP of the remote host by side effect)
 // TH: Changed behaviour: Does no own listen to the port, this has to be done before with a call to elua_listen
@@ -710,7 +720,6 @@ int i;
 // so it can also be called with a timeout of 0 and return in a polled loop
 int elua_accept( u16 port, unsigned timer_id, timer_data_type to_us, elua_net_ip* pfrom )
 {
-  timer_data_type tmrstart = 0;
   int old_status;
 
   int i;
@@ -719,24 +728,14 @@ int elua_accept( u16 port, unsigned timer_id, timer_data_type to_us, elua_net_ip
     return -1;
 
 
-  if( to_us > 0 )
-    tmrstart = platform_timer_start( timer_id );
-  while( 1 )
-  {
-    i=elua_net_find_pending( port );
-    if( i >= 0 ) {
-      *pfrom = elua_uip_accept_pending[i].remote;
-      old_status=platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
-      elua_uip_accept_pending[i].accept_request=0;
-      platform_cpu_set_global_interrupts( old_status );
-      return elua_uip_accept_pending[i].sock;
-    }
-
-    if( to_us == 0 || platform_timer_get_diff_crt( timer_id, tmrstart ) >= to_us )
-    {
-      return -1;
-    }
-  }
+  if( !cmn_wait_event( elua_net_pending_cond, &port, timer_id, to_us ) )
+    return -1;
+  i=elua_net_find_pending( port );
+  *pfrom = elua_uip_accept_pending[i].remote;
+  old_status=platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  elua_uip_accept_pending[i].accept_request=0;
+  platform_cpu_set_global_interrupts( old_status );
+  return elua_uip_accept_pending[i].sock;
 }
 
 
@@ -759,11 +758,18 @@ int elua_net_connect( int s, elua_net_ip addr, u16 port )
   if( elua_net_connecting == NULL )
     return -1;
   // And wait for it to finish
-  while( pstate->state != ELUA_UIP_STATE_IDLE );
+  elua_net_wait_idle( pstate );
   elua_net_connecting=NULL;
   return pstate->res == ELUA_NET_ERR_OK ? 0 : -1;
 }
 
+#ifdef BUILD_DNS
+static int elua_resolv_done_cond( void *arg )
+{
+  return elua_resolv_req_done != 0;
+}
+#endif
+
 // Hostname lookup (resolver)
 elua_net_ip elua_net_lookup( const char* hostname )
 {
@@ -785,7 +791,7 @@ elua_net_ip elua_net_lookup( const char* hostname )
     elua_resolv_req_done = 0;
     resolv_query( ( char* )hostname );
     platform_eth_force_interrupt();
-    while( elua_resolv_req_done == 0 );
+    cmn_wait_event( elua_resolv_done_cond, NULL, PLATFORM_TIMER_SYS_ID, PLATFORM_TIMER_INF_TIMEOUT );
     res = elua_resolv_ip;
   }
 #endif
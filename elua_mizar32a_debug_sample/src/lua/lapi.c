@@ -740,6 +740,60 @@ LUA_API void lua_rawseti (lua_State *L, int idx, int n) {
 }
 
 
+/*
+** t[first .. first+n-1] = the `n' values on the top of the stack (pops
+** them). The array part is grown once if the new values extend it.
+*/
+LUA_API void lua_rawsetarray (lua_State *L, int idx, int first, int n) {
+  StkId o;
+  Table *t;
+  int i;
+  lua_lock(L);
+  api_checknelems(L, n);
+  o = index2adr(L, idx);
+  api_check(L, ttistable(o));
+  t = hvalue(o);
+  fixedstack(L);
+  if (n > 0 && first >= 1 && first <= t->sizearray + 1 &&
+      first - 1 + n > t->sizearray)
+    luaH_resizearray(L, t, first - 1 + n);
+  for (i = 0; i < n; i++) {
+    StkId v = L->top - n + i;
+    setobj2t(L, luaH_setnum(L, t, first + i), v);
+    luaC_barriert(L, t, v);
+  }
+  unfixedstack(L);
+  L->top -= n;
+  lua_unlock(L);
+}
+
+
+/*
+** sort t[1..n] in place if they are all numbers or all strings stored in
+** the array part (see luaH_sortarray); returns 0 if it could not
+*/
+LUA_API int lua_sortarray (lua_State *L, int idx, int n, int stable) {
+  StkId o;
+  int res;
+  lua_lock(L);
+  o = index2adr(L, idx);
+  api_check(L, ttistable(o));
+  res = luaH_sortarray(L, hvalue(o), n, stable);
+  lua_unlock(L);
+  return res;
+}
+
+
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  StkId o;
+  lua_lock(L);
+  o = index2adr(L, idx);
+  api_check(L, ttistable(o));
+  luaH_clear(hvalue(o));
+  lua_unlock(L);
+}
+
+
 LUA_API int lua_setmetatable (lua_State *L, int objindex) {
   TValue *obj;
   Table *mt;
@@ -1022,6 +1076,29 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       res = cast_int(g->memlimit >> 10);
       break;
     }
+    case LUA_GCGETPEAK: {
+      /* peak heap footprint in Kbytes; a non-zero `data' restarts the tracking */
+      res = cast_int(g->peakbytes >> 10);
+      if (data)
+        g->peakbytes = gfootprint(g);
+      break;
+    }
+    case LUA_GCGETSLAB: {
+      /* bytes of the slab pages (`data' == 0) or of the blocks in them */
+#if LUAI_SLABMAXSIZE > 0
+      res = cast_int(data ? g->slabinuse : g->slabbytes);
+#else
+      res = 0;
+#endif
+      break;
+    }
+    case LUA_GCGETCYCLES: {
+      /* completed GC cycles; a non-zero `data' resets the counter */
+      res = cast_int(g->gccycles);
+      if (data)
+        g->gccycles = 0;
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   lua_unlock(L);
@@ -1096,6 +1173,32 @@ LUA_API void lua_setallocf (lua_State *L, lua_Alloc f, void *ud) {
 }
 
 
+/* inline cache hit/miss counters (see lvm.c) */
+LUA_API void lua_geticstats (lua_State *L, unsigned long *hits,
+                             unsigned long *misses, int reset) {
+  lua_lock(L);
+#if LUAI_MAXICACHE > 0
+  if (hits) *hits = G(L)->ichits;
+  if (misses) *misses = G(L)->icmisses;
+  if (reset) G(L)->ichits = G(L)->icmisses = 0;
+#else
+  if (hits) *hits = 0;
+  if (misses) *misses = 0;
+  UNUSED(reset);
+#endif
+  lua_unlock(L);
+}
+
+
+/* string table size, number of strings, longest chain and empty buckets */
+LUA_API void lua_getstrstats (lua_State *L, int *size, int *nuse,
+                              int *maxchain, int *empty) {
+  lua_lock(L);
+  luaS_stats(L, size, nuse, maxchain, empty);
+  lua_unlock(L);
+}
+
+
 LUA_API void *lua_newuserdata (lua_State *L, size_t size) {
   Udata *u;
   lua_lock(L);
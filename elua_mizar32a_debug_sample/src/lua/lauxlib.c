@@ -28,6 +28,9 @@
 #include "lgc.h"
 #include "ldo.h"
 #include "lobject.h"
+#if defined(USE_HEAP_REGIONS)
+#include "elua_heap.h"
+#endif
 #include "lstate.h"
 #include "legc.h"
 #ifndef LUA_CROSS_COMPILER
@@ -728,9 +731,36 @@ static int l_check_memlimit(lua_State *L, size_t needbytes) {
 }
 
 
+#if defined(USE_HEAP_REGIONS)
+/*
+** Placement hint for the region allocator. New thread states, stacks,
+** closures and upvalues are hot and stay in fast memory; bulk data (large
+** table parts, string buffers, file buffers) goes to slow memory;
+** everything else is placed according to its size.
+*/
+static int l_alloc_hint (void *ptr, size_t osize) {
+  if (ptr != NULL) return ELUA_HEAP_HINT_ANY;
+  switch (osize) {
+    case LUA_TTHREAD: case LUA_TFUNCTION: case LUA_TUPVAL: case LUA_TSLAB:
+      return ELUA_HEAP_HINT_FAST;
+    case LUA_TBULK:
+      return ELUA_HEAP_HINT_LARGE;
+    default:
+      return ELUA_HEAP_HINT_ANY;
+  }
+}
+
+#define l_realloc(ptr, osize, nsize) \
+  elua_heap_realloc_hint(ptr, nsize, l_alloc_hint(ptr, osize))
+#else
+#define l_realloc(ptr, osize, nsize)  realloc(ptr, nsize)
+#endif
+
+
 static void *l_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
   lua_State *L = (lua_State *)ud;
   int mode = L == NULL ? 0 : G(L)->egcmode;
+  size_t realosize = (ptr == NULL) ? 0 : osize;  /* osize is a tag for new objects */
   void *nptr;
 
   if (nsize == 0) {
@@ -739,17 +769,17 @@ static void *l_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
   }
   if (L != NULL && (mode & EGC_ALWAYS)) /* always collect memory if requested */
     luaC_fullgc(L);
-  if(nsize > osize && L != NULL) {
+  if(nsize > realosize && L != NULL) {
 #if defined(LUA_STRESS_EMERGENCY_GC)
     luaC_fullgc(L);
 #endif
-    if(G(L)->memlimit > 0 && (mode & EGC_ON_MEM_LIMIT) && l_check_memlimit(L, nsize - osize))
+    if(G(L)->memlimit > 0 && (mode & EGC_ON_MEM_LIMIT) && l_check_memlimit(L, nsize - realosize))
       return NULL;
   }
-  nptr = realloc(ptr, nsize);
+  nptr = l_realloc(ptr, osize, nsize);
   if (nptr == NULL && L != NULL && (mode & EGC_ON_ALLOC_FAILURE)) {
     luaC_fullgc(L); /* emergency full collection. */
-    nptr = realloc(ptr, nsize); /* try allocation again */
+    nptr = l_realloc(ptr, osize, nsize); /* try allocation again */
   }
   return nptr;
 }
@@ -23,6 +23,9 @@ LUALIB_API void (luaL_setn) (lua_State *L, int t, int n);
 #define luaL_setn(L,i,j)        ((void)0)  /* no op! */
 #endif
 
+/* number of values pushed by the libraries for each lua_rawsetarray call */
+#define LUAL_ARRAYCHUNK         16
+
 #if defined(LUA_COMPAT_OPENLIB)
 #define luaI_openlib	luaL_openlib
 #endif
@@ -194,10 +194,12 @@ static int luaB_gcinfo (lua_State *L) {
 
 static int luaB_collectgarbage (lua_State *L) {
   static const char *const opts[] = {"stop", "restart", "collect",
-    "count", "step", "setpause", "setstepmul","setmemlimit","getmemlimit", NULL};
+    "count", "step", "setpause", "setstepmul","setmemlimit","getmemlimit",
+    "peak", "cycles", "slab", NULL};
   static const int optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
     LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL,
-		LUA_GCSETMEMLIMIT,LUA_GCGETMEMLIMIT};
+		LUA_GCSETMEMLIMIT,LUA_GCGETMEMLIMIT,LUA_GCGETPEAK,LUA_GCGETCYCLES,
+		LUA_GCGETSLAB};
   int o = luaL_checkoption(L, 1, "collect", opts);
   int ex = luaL_optint(L, 2, 0);
   int res = lua_gc(L, optsnum[o], ex);
@@ -211,6 +213,12 @@ static int luaB_collectgarbage (lua_State *L) {
       lua_pushboolean(L, res);
       return 1;
     }
+    case LUA_GCGETSLAB: {  /* Kbytes of slab pages and of the blocks in them */
+      int b = lua_gc(L, LUA_GCGETSLAB, 1);
+      lua_pushnumber(L, (lua_Number)res/1024);
+      lua_pushnumber(L, (lua_Number)b/1024);
+      return 2;
+    }
     default: {
       lua_pushnumber(L, res);
       return 1;
@@ -16,12 +16,13 @@
 #include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 
 
 
 Closure *luaF_newCclosure (lua_State *L, int nelems, Table *e) {
-  Closure *c = cast(Closure *, luaM_malloc(L, sizeCclosure(nelems)));
+  Closure *c = cast(Closure *, luaM_newobject(L, LUA_TFUNCTION, sizeCclosure(nelems)));
   luaC_link(L, obj2gco(c), LUA_TFUNCTION);
   c->c.isC = 1;
   c->c.env = e;
@@ -31,7 +32,7 @@ Closure *luaF_newCclosure (lua_State *L, int nelems, Table *e) {
 
 
 Closure *luaF_newLclosure (lua_State *L, int nelems, Table *e) {
-  Closure *c = cast(Closure *, luaM_malloc(L, sizeLclosure(nelems)));
+  Closure *c = cast(Closure *, luaM_newobject(L, LUA_TFUNCTION, sizeLclosure(nelems)));
   luaC_link(L, obj2gco(c), LUA_TFUNCTION);
   c->l.isC = 0;
   c->l.env = e;
@@ -42,7 +43,7 @@ Closure *luaF_newLclosure (lua_State *L, int nelems, Table *e) {
 
 
 UpVal *luaF_newupval (lua_State *L) {
-  UpVal *uv = luaM_new(L, UpVal);
+  UpVal *uv = cast(UpVal *, luaM_newobject(L, LUA_TUPVAL, sizeof(UpVal)));
   luaC_link(L, obj2gco(uv), LUA_TUPVAL);
   uv->v = &uv->u.value;
   setnilvalue(uv->v);
@@ -64,7 +65,7 @@ UpVal *luaF_findupval (lua_State *L, StkId level) {
     }
     pp = &p->next;
   }
-  uv = luaM_new(L, UpVal);  /* not found: create a new one */
+  uv = cast(UpVal *, luaM_newobject(L, LUA_TUPVAL, sizeof(UpVal)));  /* not found: create a new one */
   uv->tt = LUA_TUPVAL;
   uv->v = level;  /* current value lives in the stack */
   uv->next = *pp;  /* chain it in the proper position */
@@ -113,7 +114,7 @@ void luaF_close (lua_State *L, StkId level) {
 
 
 Proto *luaF_newproto (lua_State *L) {
-  Proto *f = luaM_new(L, Proto);
+  Proto *f = cast(Proto *, luaM_newobject(L, LUA_TPROTO, sizeof(Proto)));
   luaC_link(L, obj2gco(f), LUA_TPROTO);
   f->k = NULL;
   f->sizek = 0;
@@ -134,6 +135,8 @@ Proto *luaF_newproto (lua_State *L) {
   f->linedefined = 0;
   f->lastlinedefined = 0;
   f->source = NULL;
+  f->ic = NULL;
+  f->sizeic = 0;
   return f;
 }
 
@@ -143,6 +146,7 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->k, f->sizek, TValue);
   luaM_freearray(L, f->locvars, f->sizelocvars, struct LocVar);
   luaM_freearray(L, f->upvalues, f->sizeupvalues, TString *);
+  luaM_freearray(L, f->ic, f->sizeic, ICEntry);
   if (!proto_is_readonly(f)) {
     luaM_freearray(L, f->code, f->sizecode, Instruction);
     luaM_freearray(L, f->lineinfo, f->sizelineinfo, int);
@@ -151,6 +155,43 @@ void luaF_freeproto (lua_State *L, Proto *f) {
 }
 
 
+/*
+** allocate the inline caches of a prototype: one entry per instruction
+** doing a lookup with a constant string key, rounded up to a power of 2
+** and limited to LUAI_MAXICACHE (instructions share entries past that)
+*/
+void luaF_initcache (lua_State *L, Proto *f) {
+#if LUAI_MAXICACHE > 0
+  int pc, n = 0, size = 1;
+  for (pc = 0; pc < f->sizecode; pc++) {
+    Instruction i = f->code[pc];
+    switch (GET_OPCODE(i)) {
+      case OP_GETGLOBAL:
+        n++;
+        break;
+      case OP_GETTABLE:
+      case OP_SELF:
+        if (ISK(GETARG_C(i)) && ttisstring(&f->k[INDEXK(GETARG_C(i))]))
+          n++;
+        break;
+      default:
+        break;
+    }
+  }
+  if (n == 0)
+    return;
+  while (size < n && size < LUAI_MAXICACHE)
+    size <<= 1;
+  f->ic = luaM_newvector(L, size, ICEntry);
+  f->sizeic = size;
+  for (pc = 0; pc < size; pc++)
+    f->ic[pc].pc = -1;
+#else
+  UNUSED(L); UNUSED(f);
+#endif
+}
+
+
 void luaF_freeclosure (lua_State *L, Closure *c) {
   int size = (c->c.isC) ? sizeCclosure(c->c.nupvalues) :
                           sizeLclosure(c->l.nupvalues);
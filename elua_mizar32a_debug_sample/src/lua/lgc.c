@@ -23,6 +23,13 @@
 #include "ltm.h"
 #include "lrotable.h"
 
+#ifndef LUA_CROSS_COMPILER
+#include "platform_conf.h"
+#include "common.h"
+#else
+#define CMN_TRACE( id, arg1, arg2 )
+#endif
+
 #define GCSTEPSIZE	1024u
 #define GCSWEEPMAX	40
 #define GCSWEEPCOST	10
@@ -607,6 +614,7 @@ static l_mem singlestep (lua_State *L) {
       else {
         g->gcstate = GCSpause;  /* end collection */
         g->gcdept = 0;
+        g->gccycles++;
         return 0;
       }
     }
@@ -644,19 +652,11 @@ void luaC_step (lua_State *L) {
   unset_block_gc(L);
 }
 
-int luaC_sweepstrgc (lua_State *L) {
-  global_State *g = G(L);
-  if (g->gcstate == GCSsweepstring) {
-    sweepstrstep(g, L);
-    return (g->gcstate == GCSsweepstring) ? 1 : 0;
-  }
-  return 0;
-}
-
 void luaC_fullgc (lua_State *L) {
   global_State *g = G(L);
   if(is_block_gc(L)) return;
   set_block_gc(L);
+  CMN_TRACE(CMN_TRACE_GC_FULL, g->totalbytes, 0);
   if (g->gcstate <= GCSpropagate) {
     /* reset sweep marks to sweep all elements (returning them to white) */
     g->sweepstrgc = 0;
@@ -678,6 +678,7 @@ void luaC_fullgc (lua_State *L) {
     singlestep(L);
   }
   setthreshold(g);
+  CMN_TRACE(CMN_TRACE_GC_FULL_END, g->totalbytes, 0);
   unset_block_gc(L);
 }
 
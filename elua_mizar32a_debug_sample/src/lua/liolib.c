@@ -89,17 +89,51 @@ static FILE *tofile (lua_State *L) {
 
 
 
+/*
+** A file handle is the FILE pointer followed by the stdio buffer of the
+** file, which is allocated through lua_Alloc as bulk data (LUA_TBULK)
+** instead of being malloc'ed by stdio.
+*/
+typedef struct LFile {
+  FILE *f;
+  char *buf;
+} LFile;
+
+
+static void setfilebuf (lua_State *L, FILE **pf) {
+  LFile *p = (LFile *)pf;
+  void *ud;
+  lua_Alloc allocf = lua_getallocf(L, &ud);
+  if (p->f == NULL) return;
+  p->buf = (char *)allocf(ud, NULL, LUA_TBULK, LUAL_BUFFERSIZE);
+  if (p->buf != NULL)
+    setvbuf(p->f, p->buf, _IOFBF, LUAL_BUFFERSIZE);
+}
+
+
+static void freefilebuf (lua_State *L, FILE **pf) {
+  LFile *p = (LFile *)pf;
+  void *ud;
+  lua_Alloc allocf = lua_getallocf(L, &ud);
+  if (p->buf != NULL) {
+    allocf(ud, p->buf, LUAL_BUFFERSIZE, 0);
+    p->buf = NULL;
+  }
+}
+
+
 /*
 ** When creating file handles, always creates a `closed' file handle
 ** before opening the actual file; so, if there is a memory error, the
 ** file is not left opened.
 */
 static FILE **newfile (lua_State *L) {
-  FILE **pf = (FILE **)lua_newuserdata(L, sizeof(FILE *));
-  *pf = NULL;  /* file handle is currently `closed' */
+  LFile *p = (LFile *)lua_newuserdata(L, sizeof(LFile));
+  p->f = NULL;  /* file handle is currently `closed' */
+  p->buf = NULL;
   luaL_getmetatable(L, LUA_FILEHANDLE);
   lua_setmetatable(L, -2);
-  return pf;
+  return &p->f;
 }
 
 
@@ -132,6 +166,7 @@ static int io_fclose (lua_State *L) {
   FILE **p = tofilep(L);
   int ok = (fclose(*p) == 0);
   *p = NULL;
+  freefilebuf(L, p);
   return pushresult(L, ok, NULL);
 }
 #endif
@@ -151,6 +186,7 @@ static int aux_close (lua_State *L) {
   }
   int ok = (fclose(*p) == 0);
   *p = NULL;
+  freefilebuf(L, p);
   return pushresult(L, ok, NULL);
 #endif 
 }
@@ -188,6 +224,7 @@ static int io_open (lua_State *L) {
   const char *mode = luaL_optstring(L, 2, "r");
   FILE **pf = newfile(L);
   *pf = fopen(filename, mode);
+  setfilebuf(L, pf);
   return (*pf == NULL) ? pushresult(L, 0, filename) : 1;
 }
 
@@ -208,6 +245,7 @@ static int io_popen (lua_State *L) {
 static int io_tmpfile (lua_State *L) {
   FILE **pf = newfile(L);
   *pf = tmpfile();
+  setfilebuf(L, pf);
   return (*pf == NULL) ? pushresult(L, 0, NULL) : 1;
 }
 
@@ -228,6 +266,7 @@ static int g_iofile (lua_State *L, int f, const char *mode) {
     if (filename) {
       FILE **pf = newfile(L);
       *pf = fopen(filename, mode);
+      setfilebuf(L, pf);
       if (*pf == NULL)
         fileerror(L, 1, filename);
     }
@@ -280,6 +319,7 @@ static int io_lines (lua_State *L) {
     const char *filename = luaL_checkstring(L, 1);
     FILE **pf = newfile(L);
     *pf = fopen(filename, "r");
+    setfilebuf(L, pf);
     if (*pf == NULL)
       fileerror(L, 1, filename);
     aux_lines(L, lua_gettop(L), 1);
@@ -6,6 +6,7 @@
 
 
 #include <stddef.h>
+#include <string.h>
 
 #define lmem_c
 #define LUA_CORE
@@ -14,6 +15,7 @@
 
 #include "ldebug.h"
 #include "ldo.h"
+#include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
@@ -25,7 +27,9 @@
 ** void * frealloc (void *ud, void *ptr, size_t osize, size_t nsize);
 ** (`osize' is the old size, `nsize' is the new size)
 **
-** Lua ensures that (ptr == NULL) iff (osize == 0).
+** When ptr == NULL, `osize' is either 0 or the kind of object being
+** created (LUA_TSTRING, LUA_TTABLE, ...), which the allocator can use
+** as a placement hint.
 **
 ** * frealloc(ud, NULL, 0, x) creates a new block of size `x'
 **
@@ -70,17 +74,255 @@ void *luaM_toobig (lua_State *L) {
 
 
 
+#if LUAI_SLABMAXSIZE > 0
+
+/*
+** {======================================================
+** Size-class slab allocator
+** =======================================================
+** Blocks up to LUAI_SLABMAXSIZE bytes are carved from LUAI_SLABPAGESIZE
+** pages, one set of pages per size class. Lua always frees a block with
+** its exact size, so the size class (and with it the owner page, found
+** by binary search) is known without any per-block header. A page that
+** becomes completely free is given back to lua_Alloc as soon as its
+** class has another page with free blocks.
+*/
+
+typedef struct SlabPage {
+  struct SlabPage *next, *prev;  /* list of pages with free blocks */
+  void *freelist;  /* free blocks of this page */
+  unsigned short nfree;  /* number of free blocks */
+} SlabPage;
+
+#define slabclass(s)	(((s) - 1) / LUAI_SLABALIGN)
+#define slabblocksize(c)	(((c) + 1) * LUAI_SLABALIGN)
+#define slabheadersize \
+	((sizeof(SlabPage) + LUAI_SLABALIGN - 1) & ~(LUAI_SLABALIGN - 1))
+#define slabnblocks(c) \
+	((LUAI_SLABPAGESIZE - slabheadersize) / slabblocksize(c))
+#define slabfirstblock(p)	(cast(char *, p) + slabheadersize)
+
+
+static void slab_unlink (SlabClass *sc, SlabPage *p) {
+  if (p->prev) p->prev->next = p->next;
+  else sc->partial = p->next;
+  if (p->next) p->next->prev = p->prev;
+}
+
+
+static void slab_link (SlabClass *sc, SlabPage *p) {
+  p->prev = NULL;
+  p->next = sc->partial;
+  if (sc->partial) sc->partial->prev = p;
+  sc->partial = p;
+}
+
+
+/* index of the page that holds `block' (or of the insert position) */
+static int slab_findpage (SlabClass *sc, const void *block) {
+  int lo = 0, hi = sc->npages;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (cast(const char *, sc->pages[mid]) + LUAI_SLABPAGESIZE <= cast(const char *, block))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+static void slab_newpage (lua_State *L, SlabClass *sc, int c) {
+  global_State *g = G(L);
+  SlabPage *p;
+  char *b;
+  int i, n = slabnblocks(c);
+  int block_status;
+  /* allocate with the GC unblocked, so that lua_Alloc can still run an
+     emergency collection; that collection may free (or take) slab blocks,
+     so the class is only looked at again once both allocations are done */
+  p = cast(SlabPage *, (*g->frealloc)(g->ud, NULL, LUA_TSLAB, LUAI_SLABPAGESIZE));
+  if (p == NULL) luaD_throw(L, LUA_ERRMEM);
+  g->slabbytes += LUAI_SLABPAGESIZE;
+  while (sc->npages >= sc->sizepages) {  /* grow the page index */
+    int newsize = (sc->sizepages < 4) ? 4 : sc->sizepages * 2;
+    SlabPage **np = cast(SlabPage **, (*g->frealloc)(g->ud, NULL, LUA_TSLAB,
+          newsize * sizeof(SlabPage *)));
+    if (np == NULL) {
+      (*g->frealloc)(g->ud, p, LUAI_SLABPAGESIZE, 0);
+      g->slabbytes -= LUAI_SLABPAGESIZE;
+      luaD_throw(L, LUA_ERRMEM);
+    }
+    if (sc->sizepages >= newsize) {  /* grown meanwhile by a collection */
+      (*g->frealloc)(g->ud, np, newsize * sizeof(SlabPage *), 0);
+      continue;
+    }
+    if (sc->npages > 0)
+      memcpy(np, sc->pages, sc->npages * sizeof(SlabPage *));
+    if (sc->pages)
+      (*g->frealloc)(g->ud, sc->pages, sc->sizepages * sizeof(SlabPage *), 0);
+    g->slabbytes += (newsize - sc->sizepages) * sizeof(SlabPage *);
+    sc->pages = np;
+    sc->sizepages = newsize;
+  }
+  /* the GC must not touch the slabs while the new page is linked in */
+  block_status = is_block_gc(L);
+  set_block_gc(L);
+  /* build the free list of the page */
+  b = slabfirstblock(p);
+  p->freelist = b;
+  for (i = 0; i < n - 1; i++, b += slabblocksize(c))
+    *cast(void **, b) = b + slabblocksize(c);
+  *cast(void **, b) = NULL;
+  p->nfree = cast(unsigned short, n);
+  /* insert it in the (sorted) page index */
+  i = slab_findpage(sc, p);
+  memmove(sc->pages + i + 1, sc->pages + i, (sc->npages - i) * sizeof(SlabPage *));
+  sc->pages[i] = p;
+  sc->npages++;
+  slab_link(sc, p);
+  if (!block_status) unset_block_gc(L);  /* honour the previous block status */
+}
+
+
+static void *slab_alloc (lua_State *L, size_t size) {
+  int c = slabclass(size);
+  SlabClass *sc = &G(L)->slabs[c];
+  SlabPage *p;
+  void *block;
+  if (sc->partial == NULL)
+    slab_newpage(L, sc, c);
+  p = sc->partial;
+  block = p->freelist;
+  p->freelist = *cast(void **, block);
+  if (--p->nfree == 0)
+    slab_unlink(sc, p);
+  return block;
+}
+
+
+static void slab_free (lua_State *L, void *block, size_t size) {
+  global_State *g = G(L);
+  int c = slabclass(size);
+  SlabClass *sc = &g->slabs[c];
+  int i = slab_findpage(sc, block);
+  SlabPage *p;
+  lua_assert(i < sc->npages);
+  p = sc->pages[i];
+  *cast(void **, block) = p->freelist;
+  p->freelist = block;
+  if (p->nfree++ == 0)
+    slab_link(sc, p);
+  else if (p->nfree == slabnblocks(c) && (p->next || p->prev)) {
+    /* empty and not the only page with free room: give it back */
+    slab_unlink(sc, p);
+    memmove(sc->pages + i, sc->pages + i + 1, (sc->npages - i - 1) * sizeof(SlabPage *));
+    sc->npages--;
+    (*g->frealloc)(g->ud, p, LUAI_SLABPAGESIZE, 0);
+    g->slabbytes -= LUAI_SLABPAGESIZE;
+  }
+}
+
+
+static void *slab_realloc (lua_State *L, void *block, size_t osize,
+                                                      size_t nsize) {
+  void *nblock = NULL;
+  if (block && nsize && slabclass(osize) == slabclass(nsize))
+    return block;  /* same size class: nothing to do */
+  if (nsize)
+    nblock = slab_alloc(L, nsize);
+  if (block) {
+    if (nblock) memcpy(nblock, block, (osize < nsize) ? osize : nsize);
+    slab_free(L, block, osize);
+  }
+  return nblock;
+}
+
+
+/*
+** give all the slab pages back to lua_Alloc (when closing the state)
+*/
+void luaM_freeslabs (lua_State *L) {
+  global_State *g = G(L);
+  int c, i;
+  for (c = 0; c < LUAI_SLABNCLASSES; c++) {
+    SlabClass *sc = &g->slabs[c];
+    for (i = 0; i < sc->npages; i++)
+      (*g->frealloc)(g->ud, sc->pages[i], LUAI_SLABPAGESIZE, 0);
+    (*g->frealloc)(g->ud, sc->pages, sc->sizepages * sizeof(SlabPage *), 0);
+    sc->pages = NULL;
+    sc->partial = NULL;
+    sc->npages = sc->sizepages = 0;
+  }
+  g->slabbytes = g->slabinuse = 0;
+}
+
+/* }====================================================== */
+
+#define isslabsize(s)	((s) <= LUAI_SLABMAXSIZE)
+
+#endif
+
+
 /*
 ** generic allocation routine.
 */
 void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
   global_State *g = G(L);
-  lua_assert((osize == 0) == (block == NULL));
+  size_t realosize = (block) ? osize : 0;
+  lua_assert((realosize == 0) == (block == NULL));
+#if LUAI_SLABMAXSIZE > 0
+  if (isslabsize(realosize) && isslabsize(nsize))
+    block = slab_realloc(L, block, realosize, nsize);
+  else if (isslabsize(realosize)) {  /* small block (or none) growing out of the slabs */
+    void *nblock = (*g->frealloc)(g->ud, NULL, block ? 0 : osize, nsize);
+    if (nblock == NULL)
+      luaD_throw(L, LUA_ERRMEM);
+    if (block) {
+      memcpy(nblock, block, realosize);
+      slab_free(L, block, realosize);
+    }
+    block = nblock;
+  }
+  else if (isslabsize(nsize) && nsize > 0) {  /* large block shrinking into the slabs */
+    void *nblock = slab_alloc(L, nsize);
+    memcpy(nblock, block, nsize);
+    (*g->frealloc)(g->ud, block, osize, 0);
+    block = nblock;
+  }
+  else
+#endif
   block = (*g->frealloc)(g->ud, block, osize, nsize);
   if (block == NULL && nsize > 0)
     luaD_throw(L, LUA_ERRMEM);
   lua_assert((nsize == 0) == (block == NULL));
-  g->totalbytes = (g->totalbytes - osize) + nsize;
+#if LUAI_SLABMAXSIZE > 0
+  if (isslabsize(realosize)) g->slabinuse -= realosize;
+  if (isslabsize(nsize)) g->slabinuse += nsize;
+#endif
+  g->totalbytes = (g->totalbytes - realosize) + nsize;
+  if (gfootprint(g) > g->peakbytes)
+    g->peakbytes = gfootprint(g);
   return block;
 }
 
+
+#if LUAI_BULKSIZE > 0
+/*
+** reallocation of bulk data (table parts, string buffers). A block that
+** grows to LUAI_BULKSIZE bytes or more is moved to a new block created with
+** the LUA_TBULK tag, so that the allocator can place it in slow memory;
+** after that it is reallocated in place like any other block.
+*/
+void *luaM_reallocbulk_ (lua_State *L, void *block, size_t osize, size_t nsize) {
+  void *nblock;
+  if (nsize < LUAI_BULKSIZE || (block != NULL && osize >= LUAI_BULKSIZE))
+    return luaM_realloc_(L, block, osize, nsize);
+  nblock = luaM_realloc_(L, NULL, LUA_TBULK, nsize);
+  if (block != NULL) {
+    memcpy(nblock, block, osize);
+    luaM_realloc_(L, block, osize, 0);
+  }
+  return nblock;
+}
+#endif
@@ -27,6 +27,8 @@
 
 #define luaM_malloc(L,t)	luaM_realloc_(L, NULL, 0, (t))
 #define luaM_new(L,t)		cast(t *, luaM_malloc(L, sizeof(t)))
+/* allocate an object of kind `tag' (passed to the allocator as `osize') */
+#define luaM_newobject(L,tag,s)	luaM_realloc_(L, NULL, (tag), (s))
 #define luaM_newvector(L,n,t) \
 		cast(t *, luaM_reallocv(L, NULL, 0, n, sizeof(t)))
 
@@ -37,10 +39,27 @@
 #define luaM_reallocvector(L, v,oldn,n,t) \
    ((v)=cast(t *, luaM_reallocv(L, v, oldn, n, sizeof(t))))
 
+#if LUAI_BULKSIZE > 0
+/* like luaM_reallocvector, for vectors that may hold bulk data */
+#define luaM_reallocbulkvector(L,v,oldn,n,t) \
+   ((v)=cast(t *, (cast(size_t, (n)+1) <= MAX_SIZET/sizeof(t)) ? \
+      luaM_reallocbulk_(L, (v), (oldn)*sizeof(t), (n)*sizeof(t)) : \
+      luaM_toobig(L)))
+#else
+#define luaM_reallocbulkvector	luaM_reallocvector
+#endif
+
 
 LUAI_FUNC void *luaM_realloc_ (lua_State *L, void *block, size_t oldsize,
                                                           size_t size);
 LUAI_FUNC void *luaM_toobig (lua_State *L);
+#if LUAI_BULKSIZE > 0
+LUAI_FUNC void *luaM_reallocbulk_ (lua_State *L, void *block, size_t oldsize,
+                                                              size_t size);
+#endif
+#if LUAI_SLABMAXSIZE > 0
+LUAI_FUNC void luaM_freeslabs (lua_State *L);
+#endif
 LUAI_FUNC void *luaM_growaux_ (lua_State *L, void *block, int *size,
                                size_t size_elem, int limit,
                                const char *errormsg);
@@ -32,6 +32,11 @@
 #define LUA_TUPVAL	(LAST_TAG+2)
 #define LUA_TDEADKEY	(LAST_TAG+3)
 
+/* allocation tag (never a value type) for the pages of the slab allocator */
+#define LUA_TSLAB	(LAST_TAG+4)
+
+/* LUA_TBULK (LAST_TAG+5) is defined in lua.h, as libraries use it too */
+
 
 /*
 ** Union of all collectable objects
@@ -390,6 +395,19 @@ typedef union Udata {
 
 
 
+/*
+** Inline cache entry for a lookup with a constant string key (see lvm.c)
+*/
+typedef struct ICEntry {
+  int pc;  /* instruction that filled the entry (-1 if unused) */
+  const void *t;  /* table or rotable the entry was filled from */
+  union {
+    int node;  /* index of the node holding the key (tables) */
+    const TValue *v;  /* value of the key (rotables are read-only) */
+  } u;
+} ICEntry;
+
+
 /*
 ** Function Prototypes
 */
@@ -402,6 +420,7 @@ typedef struct Proto {
   struct LocVar *locvars;  /* information about local variables */
   TString **upvalues;  /* upvalue names */
   TString  *source;
+  ICEntry *ic;  /* inline caches */
   int sizeupvalues;
   int sizek;  /* size of `k' */
   int sizecode;
@@ -410,6 +429,7 @@ typedef struct Proto {
   int sizelocvars;
   int linedefined;
   int lastlinedefined;
+  int sizeic;  /* size of `ic' (0 or a power of 2) */
   GCObject *gclist;
   lu_byte nups;  /* number of upvalues */
   lu_byte numparams;
@@ -6,6 +6,7 @@
 
 
 #include <stddef.h>
+#include <string.h>
 
 #define lstate_c
 #define LUA_CORE
@@ -47,13 +48,15 @@ typedef struct LG {
 
 
 static void stack_init (lua_State *L1, lua_State *L) {
-  /* initialize CallInfo array */
-  L1->base_ci = luaM_newvector(L, BASIC_CI_SIZE, CallInfo);
+  /* initialize CallInfo array (tagged as thread data, which is hot) */
+  L1->base_ci = cast(CallInfo *, luaM_newobject(L, LUA_TTHREAD,
+                                    BASIC_CI_SIZE * sizeof(CallInfo)));
   L1->ci = L1->base_ci;
   L1->size_ci = BASIC_CI_SIZE;
   L1->end_ci = L1->base_ci + L1->size_ci - 1;
   /* initialize stack array */
-  L1->stack = luaM_newvector(L, BASIC_STACK_SIZE + EXTRA_STACK, TValue);
+  L1->stack = cast(TValue *, luaM_newobject(L, LUA_TTHREAD,
+                      (BASIC_STACK_SIZE + EXTRA_STACK) * sizeof(TValue)));
   L1->stacksize = BASIC_STACK_SIZE + EXTRA_STACK;
   L1->top = L1->stack;
   L1->stack_last = L1->stack+(L1->stacksize - EXTRA_STACK)-1;
@@ -118,13 +121,16 @@ static void close_state (lua_State *L) {
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size, TString *);
   luaZ_freebuffer(L, &g->buff);
   freestack(L, L);
+#if LUAI_SLABMAXSIZE > 0
+  luaM_freeslabs(L);
+#endif
   lua_assert(g->totalbytes == sizeof(LG));
   (*g->frealloc)(g->ud, fromstate(L), state_size(LG), 0);
 }
 
 
 lua_State *luaE_newthread (lua_State *L) {
-  lua_State *L1 = tostate(luaM_malloc(L, state_size(lua_State)));
+  lua_State *L1 = tostate(luaM_newobject(L, LUA_TTHREAD, state_size(lua_State)));
   luaC_link(L, obj2gco(L1), LUA_TTHREAD);
   setthvalue(L, L->top, L1); /* put thread on stack */
   incr_top(L);
@@ -154,7 +160,7 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   int i;
   lua_State *L;
   global_State *g;
-  void *l = (*f)(ud, NULL, 0, state_size(LG));
+  void *l = (*f)(ud, NULL, LUA_TTHREAD, state_size(LG));
   if (l == NULL) return NULL;
   L = tostate(l);
   g = &((LG *)L)->g;
@@ -173,6 +179,8 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->estimate = 0;
   g->strt.size = 0;
   g->strt.nuse = 0;
+  g->strt.oldsize = g->strt.split = 0;
+  g->seed = luai_makeseed(L);
   g->strt.hash = NULL;
   setnilvalue(registry(L));
   luaZ_initbuffer(L, &g->buff);
@@ -186,11 +194,12 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->grayagain = NULL;
   g->weak = NULL;
   g->tmudata = NULL;
-  g->totalbytes = sizeof(LG);
+  g->totalbytes = g->peakbytes = sizeof(LG);
   g->memlimit = 0;
   g->gcpause = LUAI_GCPAUSE;
   g->gcstepmul = LUAI_GCMUL;
   g->gcdept = 0;
+  g->gccycles = 0;
 #ifdef EGC_INITIAL_MODE
   g->egcmode = EGC_INITIAL_MODE;
 #else
@@ -202,6 +211,13 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->memlimit = 0;
 #endif
   for (i=0; i<NUM_TAGS; i++) g->mt[i] = NULL;
+#if LUAI_SLABMAXSIZE > 0
+  memset(g->slabs, 0, sizeof(g->slabs));
+  g->slabbytes = g->slabinuse = 0;
+#endif
+#if LUAI_MAXICACHE > 0
+  g->ichits = g->icmisses = 0;
+#endif
   if (luaD_rawrunprotected(L, f_luaopen, NULL) != 0) {
     /* memory allocation error: free partial state */
     close_state(L);
@@ -39,6 +39,8 @@ typedef struct stringtable {
   GCObject **hash;
   lu_int32 nuse;  /* number of elements */
   int size;
+  int oldsize;  /* size before a growth in progress (0 if none) */
+  int split;  /* next bucket to split during a growth */
 } stringtable;
 
 
@@ -65,8 +67,28 @@ typedef struct CallInfo {
 /*
 ** `global state', shared by all threads of this state
 */
+#if LUAI_SLABMAXSIZE > 0
+/* size classes are LUAI_SLABALIGN bytes apart */
+#define LUAI_SLABALIGN		8
+#define LUAI_SLABNCLASSES	(LUAI_SLABMAXSIZE / LUAI_SLABALIGN)
+
+struct SlabPage;
+
+/*
+** `per size class' state of the slab allocator
+*/
+typedef struct SlabClass {
+  struct SlabPage **pages;  /* all pages of this class, sorted by address */
+  struct SlabPage *partial;  /* list of pages with free blocks */
+  int npages;
+  int sizepages;
+} SlabClass;
+#endif
+
+
 typedef struct global_State {
   stringtable strt;  /* hash table for strings */
+  unsigned int seed;  /* seed of the string hash function */
   lua_Alloc frealloc;  /* function to reallocate memory */
   void *ud;         /* auxiliary data to `frealloc' */
   lu_byte currentwhite;
@@ -82,9 +104,11 @@ typedef struct global_State {
   Mbuffer buff;  /* temporary buffer for string concatentation */
   lu_mem GCthreshold;
   lu_mem totalbytes;  /* number of bytes currently allocated */
+  lu_mem peakbytes;  /* maximum heap footprint (gfootprint) since the last reset */
   lu_mem memlimit;  /* maximum number of bytes that can be allocated, 0 = no limit. */
   lu_mem estimate;  /* an estimate of number of bytes actually in use */
   lu_mem gcdept;  /* how much GC is `behind schedule' */
+  lu_int32 gccycles;  /* number of completed collection cycles */
   int gcpause;  /* size of pause between successive GCs */
   int gcstepmul;  /* GC `granularity' */
   int egcmode;    /* emergency garbage collection operation mode */
@@ -94,9 +118,29 @@ typedef struct global_State {
   UpVal uvhead;  /* head of double-linked list of all open upvalues */
   struct Table *mt[NUM_TAGS];  /* metatables for basic types */
   TString *tmname[TM_N];  /* array with tag-method names */
+#if LUAI_SLABMAXSIZE > 0
+  SlabClass slabs[LUAI_SLABNCLASSES];  /* size-class allocator for small blocks */
+  lu_mem slabbytes;  /* bytes taken by the slab pages and page indexes */
+  lu_mem slabinuse;  /* bytes of the blocks served by the slabs */
+#endif
+#if LUAI_MAXICACHE > 0
+  lu_int32 ichits;  /* inline cache hits */
+  lu_int32 icmisses;  /* inline cache misses */
+#endif
 } global_State;
 
 
+/*
+** heap footprint of the state: the allocated bytes plus the room that is
+** free in the slab pages (which are allocated but not counted in `totalbytes')
+*/
+#if LUAI_SLABMAXSIZE > 0
+#define gfootprint(g)	((g)->totalbytes + (g)->slabbytes - (g)->slabinuse)
+#else
+#define gfootprint(g)	((g)->totalbytes)
+#endif
+
+
 /*
 ** `per thread' state
 */
@@ -20,12 +20,89 @@
 #define LUAS_READONLY_STRING      1
 #define LUAS_REGULAR_STRING       0
 
+/* number of buckets split by every string creation while the table grows */
+#define STRSPLITSTEP	4
+
+
+/*
+** The string table grows by doubling its size, but the strings are moved
+** to their new buckets a few buckets at a time (linear hashing): buckets
+** below `split' were already split between `i' and `i + oldsize', the
+** others still hold all the strings of both halves. Splitting is paused
+** while the collector sweeps the table, since it would move strings behind
+** the sweep position.
+*/
+#define strbucket(tb,h) \
+  (((tb)->oldsize && lmod(h, (tb)->oldsize) >= (tb)->split) ? \
+     lmod(h, (tb)->oldsize) : lmod(h, (tb)->size))
+
+#define cansplit(L)	(G(L)->gcstate != GCSsweepstring)
+
+
+unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
+  unsigned int h = seed ^ 2166136261u ^ cast(unsigned int, l);
+  size_t full = (l <= LUAI_HASHLIMIT) ? l : LUAI_HASHLIMIT/2;
+  size_t l1 = l;
+  /* FNV-1a on the last `full' chars (where long keys usually differ)... */
+  for (; l1 > l - full; l1--)
+    h = (h ^ cast(unsigned char, str[l1-1])) * 16777619u;
+  if (l1 > 0) {  /* ...and on a sample of the rest of a long string */
+    size_t step = (l1>>5)+1;
+    for (; l1 >= step; l1 -= step)
+      h = (h ^ cast(unsigned char, str[l1-1])) * 16777619u;
+    h = (h ^ cast(unsigned char, str[0])) * 16777619u;
+  }
+  return h ^ (h >> 16);  /* the table index only uses the low bits */
+}
+
+
+/* split `n' more buckets of a growing table */
+static void splitbuckets (stringtable *tb, int n) {
+  while (tb->oldsize && n-- > 0) {
+    int i = tb->split;
+    GCObject *p = tb->hash[i];
+    tb->hash[i] = NULL;
+    while (p) {
+      GCObject *next = p->gch.next;
+      int h1 = lmod(gco2ts(p)->hash, tb->size);  /* `i' or `i + oldsize' */
+      p->gch.next = tb->hash[h1];
+      tb->hash[h1] = p;
+      p = next;
+    }
+    if (++tb->split == tb->oldsize)
+      tb->oldsize = tb->split = 0;  /* growth complete */
+  }
+}
+
+
+/* start doubling the table, the strings are moved by `splitbuckets' */
+static void growstrtab (lua_State *L) {
+  stringtable *tb = &G(L)->strt;
+  int i, newsize = tb->size*2;
+  if (is_resizing_strings_gc(L) || tb->size > MAX_INT/2)
+    return;
+  if (tb->oldsize) {  /* previous growth not complete? */
+    if (!cansplit(L))
+      return;  /* defer, it will be completed after the sweep */
+    splitbuckets(tb, tb->oldsize);
+  }
+  set_resizing_strings_gc(L);
+  luaM_reallocvector(L, tb->hash, tb->size, newsize, GCObject *);
+  for (i=tb->size; i<newsize; i++) tb->hash[i] = NULL;
+  tb->oldsize = tb->size;
+  tb->split = 0;
+  tb->size = newsize;
+  unset_resizing_strings_gc(L);
+}
+
+
 void luaS_resize (lua_State *L, int newsize) {
   stringtable *tb;
   int i;
   tb = &G(L)->strt;
-  if (luaC_sweepstrgc(L) || newsize == tb->size || is_resizing_strings_gc(L))
+  if (!cansplit(L) || newsize == tb->size || is_resizing_strings_gc(L))
     return;  /* cannot resize during GC traverse or doesn't need to be resized */
+  splitbuckets(tb, tb->oldsize);  /* complete a growth in progress */
   set_resizing_strings_gc(L);
   if (newsize > tb->size) {
     luaM_reallocvector(L, tb->hash, tb->size, newsize, GCObject *);
@@ -51,6 +128,22 @@ void luaS_resize (lua_State *L, int newsize) {
   unset_resizing_strings_gc(L);
 }
 
+
+void luaS_stats (lua_State *L, int *size, int *nuse, int *maxchain, int *empty) {
+  stringtable *tb = &G(L)->strt;
+  int i;
+  *size = tb->size;
+  *nuse = cast_int(tb->nuse);
+  *maxchain = *empty = 0;
+  for (i=0; i<tb->size; i++) {
+    GCObject *p;
+    int n = 0;
+    for (p = tb->hash[i]; p != NULL; p = p->gch.next) n++;
+    if (n == 0) (*empty)++;
+    if (n > *maxchain) *maxchain = n;
+  }
+}
+
 static TString *newlstr (lua_State *L, const char *str, size_t l,
                                        unsigned int h, int readonly) {
   TString *ts;
@@ -58,9 +151,11 @@ static TString *newlstr (lua_State *L, const char *str, size_t l,
   if (l+1 > (MAX_SIZET - sizeof(TString))/sizeof(char))
     luaM_toobig(L);
   tb = &G(L)->strt;
-  if ((tb->nuse + 1) > cast(lu_int32, tb->size) && tb->size <= MAX_INT/2)
-    luaS_resize(L, tb->size*2);  /* too crowded */
-  ts = cast(TString *, luaM_malloc(L, readonly ? sizeof(char**)+sizeof(TString) : (l+1)*sizeof(char)+sizeof(TString)));
+  if (tb->oldsize && cansplit(L))
+    splitbuckets(tb, STRSPLITSTEP);
+  if ((tb->nuse + 1) > cast(lu_int32, tb->size) * LUAI_STRTLOAD)
+    growstrtab(L);  /* too crowded */
+  ts = cast(TString *, luaM_newobject(L, LUA_TSTRING, readonly ? sizeof(char**)+sizeof(TString) : (l+1)*sizeof(char)+sizeof(TString)));
   ts->tsv.len = l;
   ts->tsv.hash = h;
   ts->tsv.marked = luaC_white(G(L));
@@ -72,7 +167,7 @@ static TString *newlstr (lua_State *L, const char *str, size_t l,
     *(char **)(ts+1) = (char *)str;
     luaS_readonly(ts);
   }
-  h = lmod(h, tb->size);
+  h = strbucket(tb, h);
   ts->tsv.next = tb->hash[h];  /* chain new entry */
   tb->hash[h] = obj2gco(ts);
   tb->nuse++;
@@ -82,12 +177,8 @@ static TString *newlstr (lua_State *L, const char *str, size_t l,
 
 static TString *luaS_newlstr_helper (lua_State *L, const char *str, size_t l, int readonly) {
   GCObject *o;
-  unsigned int h = cast(unsigned int, l);  /* seed */
-  size_t step = (l>>5)+1;  /* if string is too long, don't hash all its chars */
-  size_t l1;
-  for (l1=l; l1>=step; l1-=step)  /* compute hash */
-    h = h ^ ((h<<5)+(h>>2)+cast(unsigned char, str[l1-1]));
-  for (o = G(L)->strt.hash[lmod(h, G(L)->strt.size)];
+  unsigned int h = luaS_hash(str, l, G(L)->seed);
+  for (o = G(L)->strt.hash[strbucket(&G(L)->strt, h)];
        o != NULL;
        o = o->gch.next) {
     TString *ts = rawgco2ts(o);
@@ -133,7 +224,7 @@ Udata *luaS_newudata (lua_State *L, size_t s, Table *e) {
   Udata *u;
   if (s > MAX_SIZET - sizeof(Udata))
     luaM_toobig(L);
-  u = cast(Udata *, luaM_malloc(L, s + sizeof(Udata)));
+  u = cast(Udata *, luaM_newobject(L, LUA_TUSERDATA, s + sizeof(Udata)));
   u->uv.marked = luaC_white(G(L));  /* is not finalized */
   u->uv.tt = LUA_TUSERDATA;
   u->uv.len = s;
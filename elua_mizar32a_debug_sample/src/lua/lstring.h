@@ -26,7 +26,10 @@
 #define luaS_readonly(s) l_setbit((s)->tsv.marked, READONLYBIT)
 #define luaS_isreadonly(s) testbit((s)->marked, READONLYBIT)
 
+LUAI_FUNC unsigned int luaS_hash (const char *str, size_t l, unsigned int seed);
 LUAI_FUNC void luaS_resize (lua_State *L, int newsize);
+LUAI_FUNC void luaS_stats (lua_State *L, int *size, int *nuse, int *maxchain,
+                           int *empty);
 LUAI_FUNC Udata *luaS_newudata (lua_State *L, size_t s, Table *e);
 LUAI_FUNC TString *luaS_newlstr (lua_State *L, const char *str, size_t l);
 LUAI_FUNC TString *luaS_newrolstr (lua_State *L, const char *str, size_t l);
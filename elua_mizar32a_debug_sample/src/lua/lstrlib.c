@@ -167,10 +167,45 @@ static int str_dump (lua_State *L) {
 #define CAP_UNFINISHED	(-1)
 #define CAP_POSITION	(-2)
 
+#if LUAI_PATCACHE > 0
+
+/* limits of a compiled pattern; larger patterns are interpreted */
+#define PAT_MAXOPS	24
+#define PAT_MAXSETS	6
+#define PAT_MAXPREFIX	8
+
+/* opcodes of a compiled pattern */
+enum { PO_END, PO_EOS, PO_OPENCAP, PO_POSCAP, PO_CLOSECAP, PO_BALANCE,
+       PO_FRONTIER, PO_BACKREF, PO_CHAR, PO_ANY, PO_SET };
+
+typedef struct PatOp {
+  unsigned char code;  /* PO_xxx */
+  unsigned char quant;  /* `?', `*', `+', `-' or 0 */
+  unsigned char a, b;  /* char, set index, capture digit or %b chars */
+} PatOp;
+
+typedef struct CPattern {
+  const char *key;  /* pattern text this was compiled from */
+  unsigned int stamp;  /* last use, for the LRU replacement */
+  unsigned char nops;  /* 0 if the pattern can't be compiled */
+  unsigned char nsets;
+  unsigned char plen;  /* length of the literal prefix */
+  char prefix[PAT_MAXPREFIX];  /* chars every match must start with */
+  PatOp ops[PAT_MAXOPS];
+  unsigned char sets[PAT_MAXSETS][32];  /* char classes as bitmaps */
+} CPattern;
+
+#define testset(set,c)	((set)[(c) >> 3] & (1 << ((c) & 7)))
+
+#endif
+
 typedef struct MatchState {
   const char *src_init;  /* init of source string */
   const char *src_end;  /* end (`\0') of source string */
   lua_State *L;
+#if LUAI_PATCACHE > 0
+  const CPattern *cp;  /* compiled pattern or NULL */
+#endif
   int level;  /* total number of captures (finished or unfinished) */
   struct {
     const char *init;
@@ -441,28 +476,504 @@ static const char *match (MatchState *ms, const char *s, const char *p) {
 
 
 
+/*
+** {======================================================
+** Substring search
+** Needles of up to 4 chars are found by sliding a window of the last
+** chars of `s1' packed in a word, one char at a time. Longer needles
+** use the two-way algorithm (Crochemore & Perrin), which is linear in
+** the worst case, with a Boyer-Moore-Horspool shift on the last char
+** of the window to skip ahead on the common mismatches.
+** =======================================================
+*/
+
+#define SHORTNEEDLE	4
+
+
+static const char *shortfind (const unsigned char *s1, size_t l1,
+                              const unsigned char *s2, size_t l2) {
+  unsigned long mask = (l2 == 4) ? 0xffffffffUL : (1UL << (8*l2)) - 1;
+  unsigned long w = 0, needle = 0;
+  size_t i;
+  for (i = 0; i < l2; i++)
+    needle = (needle << 8) | s2[i];
+  for (i = 0; i < l2-1; i++)
+    w = (w << 8) | s1[i];
+  for (; i < l1; i++) {
+    w = ((w << 8) | s1[i]) & mask;
+    if (w == needle)
+      return (const char *)s1 + i - (l2-1);
+  }
+  return NULL;
+}
+
+
+/*
+** start and period of the maximal suffix of `p' for the order given by
+** `rev' (0 for `<', 1 for `>')
+*/
+static size_t maxsuffix (const unsigned char *p, size_t l, int rev,
+                         size_t *period) {
+  size_t ms = (size_t)-1, j = 0, k = 1, per = 1;
+  while (j + k < l) {
+    unsigned char a = p[ms + k], b = p[j + k];
+    if (a == b) {
+      if (k == per) { j += per; k = 1; }
+      else k++;
+    }
+    else if ((a > b) != rev) {  /* suffix at `j' is larger */
+      j += k;
+      k = 1;
+      per = j - ms;
+    }
+    else {  /* restart at `j' */
+      ms = j++;
+      k = per = 1;
+    }
+  }
+  *period = per;
+  return ms;
+}
+
+
+static const char *twowayfind (const unsigned char *s1, size_t l1,
+                               const unsigned char *s2, size_t l2) {
+  unsigned char skip[256];  /* l2-1 - last position of each char (max 255) */
+  const unsigned char *end = s1 + l1;
+  size_t ms, p, p2, mem = 0, mem0, i, k;
+  /* critical factorization: the later of the two maximal suffixes */
+  ms = maxsuffix(s2, l2, 0, &p);
+  i = maxsuffix(s2, l2, 1, &p2);
+  if (i + 1 > ms + 1) { ms = i; p = p2; }
+  if (memcmp(s2, s2 + p, ms + 1) == 0)  /* periodic needle? */
+    mem0 = l2 - p;  /* remember the matched prefix after a shift */
+  else {
+    mem0 = 0;
+    p = ((ms + 1 > l2 - ms - 1) ? ms + 1 : l2 - ms - 1) + 1;
+  }
+  memset(skip, (l2 > 255) ? 255 : (int)l2, sizeof(skip));
+  for (i = 0; i < l2; i++)
+    skip[s2[i]] = (l2 - 1 - i > 255) ? 255 : (unsigned char)(l2 - 1 - i);
+  while ((size_t)(end - s1) >= l2) {
+    k = skip[s1[l2 - 1]];
+    if (k != 0) {  /* last char of the window is not the needle's last one */
+      s1 += (k < mem) ? mem : k;
+      mem = 0;
+      continue;
+    }
+    /* compare the right part, then the left part */
+    for (k = (ms + 1 > mem) ? ms + 1 : mem; k < l2 && s2[k] == s1[k]; k++) ;
+    if (k < l2) {
+      s1 += k - ms;
+      mem = 0;
+      continue;
+    }
+    for (k = ms + 1; k > mem && s2[k - 1] == s1[k - 1]; k--) ;
+    if (k <= mem)
+      return (const char *)s1;
+    s1 += p;
+    mem = mem0;
+  }
+  return NULL;
+}
+
+
 static const char *lmemfind (const char *s1, size_t l1,
                                const char *s2, size_t l2) {
   if (l2 == 0) return s1;  /* empty strings are everywhere */
   else if (l2 > l1) return NULL;  /* avoids a negative `l1' */
+  else if (l2 == 1) return (const char *)memchr(s1, *s2, l1);
+  else if (l2 <= SHORTNEEDLE)
+    return shortfind((const unsigned char *)s1, l1,
+                     (const unsigned char *)s2, l2);
+  else
+    return twowayfind((const unsigned char *)s1, l1,
+                      (const unsigned char *)s2, l2);
+}
+
+/* }====================================================== */
+
+
+#if LUAI_PATCACHE > 0
+
+/*
+** {======================================================
+** Compiled patterns
+** A pattern is compiled on its first use into a list of PatOp, with
+** each char class turned into a 256-bit set, and kept in a small LRU
+** cache (a userdata in the registry) keyed by the address of the
+** pattern text; the cache keeps the pattern strings alive so that the
+** addresses stay valid. `cmatch' follows `match' step by step and gives
+** the same results. Malformed or too large patterns are not compiled
+** and are left to `match' (which also raises their errors).
+** =======================================================
+*/
+
+typedef struct PatCache {
+  unsigned int clock;
+  CPattern e[LUAI_PATCACHE];
+} PatCache;
+
+static int patcache_key;  /* its address is the registry key of the cache */
+
+
+/* like `classend', but returns NULL for a malformed item */
+static const char *pclassend (const char *p) {
+  switch (*p++) {
+    case L_ESC: {
+      return (*p == '\0') ? NULL : p+1;
+    }
+    case '[': {
+      if (*p == '^') p++;
+      do {  /* look for a `]' */
+        if (*p == '\0') return NULL;
+        if (*(p++) == L_ESC && *p != '\0')
+          p++;  /* skip escapes (e.g. `%]') */
+      } while (*p != ']');
+      return p+1;
+    }
+    default: {
+      return p;
+    }
+  }
+}
+
+
+/* index of the set of the chars matched by item `p', -1 if no room */
+static int addset (CPattern *cp, const char *p, const char *ep) {
+  unsigned char set[32];
+  int c, i;
+  memset(set, 0, sizeof(set));
+  for (c = 0; c < 256; c++)
+    if (singlematch(c, p, ep))
+      set[c >> 3] |= 1 << (c & 7);
+  for (i = 0; i < cp->nsets; i++)  /* share equal sets */
+    if (memcmp(cp->sets[i], set, sizeof(set)) == 0) return i;
+  if (cp->nsets == PAT_MAXSETS) return -1;
+  memcpy(cp->sets[cp->nsets], set, sizeof(set));
+  return cp->nsets++;
+}
+
+
+/* chars that every match must start with */
+static void findprefix (CPattern *cp) {
+  const PatOp *op = cp->ops;
+  /* leading captures can be skipped while they can't fail */
+  while ((op->code == PO_OPENCAP || op->code == PO_POSCAP) &&
+         op - cp->ops < LUA_MAXCAPTURES)
+    op++;
+  while (op->code == PO_CHAR && cp->plen < PAT_MAXPREFIX) {
+    if (op->quant != 0 && op->quant != '+') break;
+    cp->prefix[cp->plen++] = (char)op->a;
+    if (op->quant == '+') break;
+    op++;
+  }
+}
+
+
+/* compiles `p' into `cp'; leaves `cp->nops' 0 if it can't be compiled */
+static void compile (CPattern *cp, const char *p) {
+  int n = 0;
+  cp->nops = cp->nsets = cp->plen = 0;
+  for (;;) {
+    PatOp *op;
+    const char *ep;
+    if (n == PAT_MAXOPS) return;  /* too large */
+    op = &cp->ops[n++];
+    op->quant = op->a = op->b = 0;
+    switch (*p) {
+      case '(': {
+        if (*(p+1) == ')') {
+          op->code = PO_POSCAP; p += 2;
+        }
+        else {
+          op->code = PO_OPENCAP; p++;
+        }
+        continue;
+      }
+      case ')': {
+        op->code = PO_CLOSECAP; p++;
+        continue;
+      }
+      case '\0': {
+        op->code = PO_END;
+        break;
+      }
+      case '$': {
+        if (*(p+1) == '\0') {
+          op->code = PO_EOS;
+          break;
+        }
+        goto item;
+      }
+      case L_ESC: {
+        if (*(p+1) == 'b') {
+          if (*(p+2) == '\0' || *(p+3) == '\0') return;
+          op->code = PO_BALANCE;
+          op->a = uchar(*(p+2));
+          op->b = uchar(*(p+3));
+          p += 4;
+          continue;
+        }
+        else if (*(p+1) == 'f') {
+          int set;
+          p += 2;
+          if (*p != '[' || (ep = pclassend(p)) == NULL ||
+              (set = addset(cp, p, ep)) < 0) return;
+          op->code = PO_FRONTIER;
+          op->a = (unsigned char)set;
+          p = ep;
+          continue;
+        }
+        else if (isdigit(uchar(*(p+1)))) {
+          op->code = PO_BACKREF;
+          op->a = uchar(*(p+1));
+          p += 2;
+          continue;
+        }
+        goto item;
+      }
+      default: item: {  /* single char item and its quantifier */
+        if ((ep = pclassend(p)) == NULL) return;
+        if (*p == '.')
+          op->code = PO_ANY;
+        else if (*p != L_ESC && *p != '[') {
+          op->code = PO_CHAR;
+          op->a = uchar(*p);
+        }
+        else {
+          int set = addset(cp, p, ep);
+          if (set < 0) return;
+          op->code = PO_SET;
+          op->a = (unsigned char)set;
+        }
+        if (*ep == '?' || *ep == '*' || *ep == '+' || *ep == '-')
+          op->quant = uchar(*ep++);
+        p = ep;
+        continue;
+      }
+    }
+    break;  /* end of pattern */
+  }
+  cp->nops = (unsigned char)n;
+  findprefix(cp);
+}
+
+
+#define csingle(ms,op,c) \
+  ((op)->code == PO_ANY || ((op)->code == PO_CHAR ? (c) == (op)->a : \
+                            testset((ms)->cp->sets[(op)->a], c)))
+
+/* true if `op' surely fails at `s' (saves a call for the usual case) */
+#define cfails(ms,s,op) \
+  ((op)->code == PO_CHAR && (op)->quant == 0 && \
+   ((s) >= (ms)->src_end || uchar(*(s)) != (op)->a))
+
+
+static const char *cmatch (MatchState *ms, const char *s, const PatOp *op);
+
+
+static const char *cmax_expand (MatchState *ms, const char *s,
+                                  const PatOp *op) {
+  ptrdiff_t i = 0;  /* counts maximum expand for item */
+  if (op->code == PO_ANY)
+    i = ms->src_end - s;
   else {
-    const char *init;  /* to search for a `*s2' inside `s1' */
-    l2--;  /* 1st char will be checked by `memchr' */
-    l1 = l1-l2;  /* `s2' cannot be found after that */
-    while (l1 > 0 && (init = (const char *)memchr(s1, *s2, l1)) != NULL) {
-      init++;   /* 1st char is already checked */
-      if (memcmp(init, s2+1, l2) == 0)
-        return init-1;
-      else {  /* correct `l1' and `s1' to try again */
-        l1 -= init-s1;
-        s1 = init;
+    while ((s+i)<ms->src_end && csingle(ms, op, uchar(*(s+i))))
+      i++;
+  }
+  /* keeps trying to match with the maximum repetitions */
+  while (i>=0) {
+    if (!cfails(ms, s+i, op+1)) {
+      const char *res = cmatch(ms, (s+i), op+1);
+      if (res) return res;
+    }
+    i--;  /* else didn't match; reduce 1 repetition to try again */
+  }
+  return NULL;
+}
+
+
+static const char *cmin_expand (MatchState *ms, const char *s,
+                                  const PatOp *op) {
+  for (;;) {
+    if (!cfails(ms, s, op+1)) {
+      const char *res = cmatch(ms, s, op+1);
+      if (res != NULL)
+        return res;
+    }
+    if (s<ms->src_end && csingle(ms, op, uchar(*s)))
+      s++;  /* try with one more repetition */
+    else return NULL;
+  }
+}
+
+
+static const char *cstart_capture (MatchState *ms, const char *s,
+                                     const PatOp *op, int what) {
+  const char *res;
+  int level = ms->level;
+  if (level >= LUA_MAXCAPTURES) luaL_error(ms->L, "too many captures");
+  ms->capture[level].init = s;
+  ms->capture[level].len = what;
+  ms->level = level+1;
+  if ((res=cmatch(ms, s, op)) == NULL)  /* match failed? */
+    ms->level--;  /* undo capture */
+  return res;
+}
+
+
+static const char *cend_capture (MatchState *ms, const char *s,
+                                   const PatOp *op) {
+  int l = capture_to_close(ms);
+  const char *res;
+  ms->capture[l].len = s - ms->capture[l].init;  /* close capture */
+  if ((res = cmatch(ms, s, op)) == NULL)  /* match failed? */
+    ms->capture[l].len = CAP_UNFINISHED;  /* undo capture */
+  return res;
+}
+
+
+static const char *cmatch (MatchState *ms, const char *s, const PatOp *op) {
+  init: /* using goto's to optimize tail recursion */
+  switch (op->code) {
+    case PO_END: {  /* end of pattern */
+      return s;  /* match succeeded */
+    }
+    case PO_EOS: {  /* final `$' */
+      return (s == ms->src_end) ? s : NULL;
+    }
+    case PO_OPENCAP: {
+      return cstart_capture(ms, s, op+1, CAP_UNFINISHED);
+    }
+    case PO_POSCAP: {
+      return cstart_capture(ms, s, op+1, CAP_POSITION);
+    }
+    case PO_CLOSECAP: {
+      return cend_capture(ms, s, op+1);
+    }
+    case PO_BALANCE: {
+      char bal[2];
+      bal[0] = (char)op->a;
+      bal[1] = (char)op->b;
+      s = matchbalance(ms, s, bal);
+      if (s == NULL) return NULL;
+      op++; goto init;
+    }
+    case PO_FRONTIER: {
+      const unsigned char *set = ms->cp->sets[op->a];
+      int previous = (s == ms->src_init) ? '\0' : uchar(*(s-1));
+      if (testset(set, previous) || !testset(set, uchar(*s))) return NULL;
+      op++; goto init;
+    }
+    case PO_BACKREF: {
+      s = match_capture(ms, s, op->a);
+      if (s == NULL) return NULL;
+      op++; goto init;
+    }
+    default: {  /* PO_CHAR, PO_ANY or PO_SET */
+      int m = s<ms->src_end && csingle(ms, op, uchar(*s));
+      switch (op->quant) {
+        case '?': {  /* optional */
+          const char *res;
+          if (m && ((res=cmatch(ms, s+1, op+1)) != NULL))
+            return res;
+          op++; goto init;
+        }
+        case '*': {  /* 0 or more repetitions */
+          return cmax_expand(ms, s, op);
+        }
+        case '+': {  /* 1 or more repetitions */
+          return (m ? cmax_expand(ms, s+1, op) : NULL);
+        }
+        case '-': {  /* 0 or more repetitions (minimum) */
+          return cmin_expand(ms, s, op);
+        }
+        default: {
+          if (!m) return NULL;
+          s++; op++; goto init;
+        }
       }
     }
-    return NULL;  /* not found */
   }
 }
 
 
+/*
+** compiled form of the pattern `p' (the string at index `pidx' or a
+** suffix of it), NULL if it must be interpreted
+*/
+static const CPattern *getpattern (lua_State *L, int pidx, const char *p) {
+  PatCache *pc;
+  CPattern *cp;
+  int i;
+  lua_pushlightuserdata(L, &patcache_key);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  pc = (PatCache *)lua_touserdata(L, -1);
+  if (pc == NULL) {  /* first use in this state? */
+    lua_pop(L, 1);
+    pc = (PatCache *)lua_newuserdata(L, sizeof(PatCache));
+    memset(pc, 0, sizeof(PatCache));
+    lua_createtable(L, LUAI_PATCACHE, 0);  /* anchors the patterns */
+    lua_setfenv(L, -2);
+    lua_pushlightuserdata(L, &patcache_key);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+  }
+  cp = &pc->e[0];
+  for (i = 0; i < LUAI_PATCACHE; i++) {
+    if (pc->e[i].key == p) {
+      cp = &pc->e[i];
+      goto found;
+    }
+    if (pc->e[i].stamp < cp->stamp) cp = &pc->e[i];
+  }
+  compile(cp, p);  /* replace the least recently used entry */
+  cp->key = p;
+  lua_getfenv(L, -1);
+  lua_pushvalue(L, pidx);
+  lua_rawseti(L, -2, (int)(cp - pc->e) + 1);
+  lua_pop(L, 1);
+ found:
+  cp->stamp = ++pc->clock;
+  lua_pop(L, 1);  /* cache */
+  return (cp->nops > 0) ? cp : NULL;
+}
+
+
+/* first position from `s' where a match can start, NULL if none */
+static const char *candidate (MatchState *ms, const char *s) {
+  const CPattern *cp = ms->cp;
+  if (cp == NULL || cp->plen == 0) return s;
+  return lmemfind(s, ms->src_end-s, cp->prefix, cp->plen);
+}
+
+
+/*
+** after a call to Lua, which may have replaced the pattern in the
+** cache, compiles it again if needed
+*/
+static void checkpattern (MatchState *ms, int pidx, const char *p) {
+  if (ms->cp != NULL && ms->cp->key != p)
+    ms->cp = getpattern(ms->L, pidx, p);
+}
+
+#define setpattern(ms,pidx,p)	((ms)->cp = getpattern((ms)->L, pidx, p))
+#define domatch(ms,s,p)	\
+  ((ms)->cp ? cmatch(ms, s, (ms)->cp->ops) : match(ms, s, p))
+
+/* }====================================================== */
+
+#else
+
+#define setpattern(ms,pidx,p)	((void)0)
+#define checkpattern(ms,pidx,p)	((void)0)
+#define domatch(ms,s,p)		match(ms, s, p)
+#define candidate(ms,s)		(s)
+
+#endif
+
+
 static void push_onecapture (MatchState *ms, int i, const char *s,
                                                     const char *e) {
   if (i >= ms->level) {
@@ -499,6 +1010,7 @@ static int str_find_aux (lua_State *L, int find) {
   ptrdiff_t init = posrelat(luaL_optinteger(L, 3, 1), l1) - 1;
   if (init < 0) init = 0;
   else if ((size_t)(init) > l1) init = (ptrdiff_t)l1;
+  /* as in standard Lua, a `)' alone doesn't stop the plain search here */
   if (find && (lua_toboolean(L, 4) ||  /* explicit request? */
       strpbrk(p, SPECIALS) == NULL)) {  /* or no special characters? */
     /* do a plain search */
@@ -516,10 +1028,13 @@ static int str_find_aux (lua_State *L, int find) {
     ms.L = L;
     ms.src_init = s;
     ms.src_end = s+l1;
+    setpattern(&ms, 2, p);
     do {
       const char *res;
+      if (!anchor && (s1 = candidate(&ms, s1)) == NULL)
+        break;  /* no position left where a match can start */
       ms.level = 0;
-      if ((res=match(&ms, s1, p)) != NULL) {
+      if ((res=domatch(&ms, s1, p)) != NULL) {
         if (find) {
           lua_pushinteger(L, s1-s+1);  /* start */
           lua_pushinteger(L, res-s);   /* end */
@@ -554,12 +1069,15 @@ static int gmatch_aux (lua_State *L) {
   ms.L = L;
   ms.src_init = s;
   ms.src_end = s+ls;
+  setpattern(&ms, lua_upvalueindex(2), p);
   for (src = s + (size_t)lua_tointeger(L, lua_upvalueindex(3));
        src <= ms.src_end;
        src++) {
     const char *e;
+    if ((src = candidate(&ms, src)) == NULL)
+      break;  /* no position left where a match can start */
     ms.level = 0;
-    if ((e = match(&ms, src, p)) != NULL) {
+    if ((e = domatch(&ms, src, p)) != NULL) {
       lua_Integer newstart = e-s;
       if (e == src) newstart++;  /* empty match? go at least one position */
       lua_pushinteger(L, newstart);
@@ -660,20 +1178,43 @@ static int str_gsub (lua_State *L) {
   ms.L = L;
   ms.src_init = src;
   ms.src_end = src+srcl;
-  while (n < max_s) {
+  if (!anchor && *p != '\0' && strpbrk(p, SPECIALS ")") == NULL) {
+    /* plain pattern: jump from one occurrence to the next (a `)' is left
+       to the matcher, which rejects it as an invalid capture) */
+    size_t l = strlen(p);
     const char *e;
     ms.level = 0;
-    e = match(&ms, src, p);
-    if (e) {
+    while (n < max_s &&
+           (e = lmemfind(src, ms.src_end-src, p, l)) != NULL) {
+      luaL_addlstring(&b, src, e-src);
       n++;
-      add_value(&ms, &b, src, e);
+      add_value(&ms, &b, e, e+l);
+      src = e+l;
+    }
+  }
+  else {
+    setpattern(&ms, 2, p);
+    while (n < max_s) {
+      const char *e;
+      if (!anchor) {  /* copy the text where no match can start */
+        if ((e = candidate(&ms, src)) == NULL) break;
+        luaL_addlstring(&b, src, e-src);
+        src = e;
+      }
+      ms.level = 0;
+      e = domatch(&ms, src, p);
+      if (e) {
+        n++;
+        add_value(&ms, &b, src, e);
+        checkpattern(&ms, 2, p);  /* add_value may have used other patterns */
+      }
+      if (e && e>src) /* non empty match? */
+        src = e;  /* skip it */
+      else if (src < ms.src_end)
+        luaL_addchar(&b, *src++);
+      else break;
+      if (anchor) break;
     }
-    if (e && e>src) /* non empty match? */
-      src = e;  /* skip it */
-    else if (src < ms.src_end)
-      luaL_addchar(&b, *src++);
-    else break;
-    if (anchor) break;
   }
   luaL_addlstring(&b, src, ms.src_end-src);
   luaL_pushresult(&b);
@@ -684,6 +1225,39 @@ static int str_gsub (lua_State *L) {
 /* }====================================================== */
 
 
+/*
+** string.split(s [, sep [, max]]): table with the fields of `s' separated
+** by the plain string `sep' (default ","); at most `max' fields are
+** returned, the last one holding the rest of `s'
+*/
+static int str_split (lua_State *L) {
+  size_t ls, lsep;
+  const char *s = luaL_checklstring(L, 1, &ls);
+  const char *sep = luaL_optlstring(L, 2, ",", &lsep);
+  int max = luaL_optint(L, 3, 0);
+  const char *e = s + ls, *f;
+  int n = 0, pending = 0;
+  luaL_argcheck(L, lsep > 0, 2, "empty separator");
+  luaL_checkstack(L, LUAL_ARRAYCHUNK + 2, "too many fields");
+  lua_settop(L, 3);
+  lua_newtable(L);
+  while (max <= 0 || n + pending < max - 1) {
+    if ((f = lmemfind(s, e-s, sep, lsep)) == NULL)
+      break;
+    lua_pushlstring(L, s, f-s);
+    s = f + lsep;
+    if (++pending == LUAL_ARRAYCHUNK) {  /* move the fields to the table */
+      lua_rawsetarray(L, 4, n+1, pending);
+      n += pending;
+      pending = 0;
+    }
+  }
+  lua_pushlstring(L, s, e-s);  /* last field */
+  lua_rawsetarray(L, 4, n+1, pending+1);
+  return 1;
+}
+
+
 /* maximum size of each formatted item (> len(format('%99.99f', -1e308))) */
 /* was 512, modified to 128 for eLua */
 #define MAX_ITEM	128
@@ -848,6 +1422,7 @@ const LUA_REG_TYPE strlib[] = {
   {LSTRKEY("match"), LFUNCVAL(str_match)},
   {LSTRKEY("rep"), LFUNCVAL(str_rep)},
   {LSTRKEY("reverse"), LFUNCVAL(str_reverse)},
+  {LSTRKEY("split"), LFUNCVAL(str_split)},
   {LSTRKEY("sub"), LFUNCVAL(str_sub)},
   {LSTRKEY("upper"), LFUNCVAL(str_upper)},
 #if LUA_OPTIMIZE_MEMORY > 0
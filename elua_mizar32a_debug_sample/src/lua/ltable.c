@@ -34,6 +34,7 @@
 #include "lstate.h"
 #include "ltable.h"
 #include "lrotable.h"
+#include "lvm.h"
 
 /*
 ** max size of array part is 2^MAXBITS
@@ -270,7 +271,7 @@ static int numusehash (const Table *t, int *nums, int *pnasize) {
 
 static void setarrayvector (lua_State *L, Table *t, int size) {
   int i;
-  luaM_reallocvector(L, t->array, t->sizearray, size, TValue);
+  luaM_reallocbulkvector(L, t->array, t->sizearray, size, TValue);
   for (i=t->sizearray; i<size; i++)
      setnilvalue(&t->array[i]);
   t->sizearray = size;
@@ -303,7 +304,7 @@ static void resizenodevector (lua_State *L, Table *t, int oldsize, int newsize)
       oldsize = 0;
       node = NULL; /* don't try to realloc `dummynode' pointer. */
     }
-    luaM_reallocvector(L, node, oldsize, newsize, Node);
+    luaM_reallocbulkvector(L, node, oldsize, newsize, Node);
     t->node = node;
     for (i=oldsize; i<newsize; i++) {
       Node *n = gnode(t, i);
@@ -490,7 +491,7 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
 
 
 Table *luaH_new (lua_State *L, int narray, int nhash) {
-  Table *t = luaM_new(L, Table);
+  Table *t = cast(Table *, luaM_newobject(L, LUA_TTABLE, sizeof(Table)));
   luaC_link(L, obj2gco(t), LUA_TTABLE);
   sethvalue2s(L, L->top, t); /* put table on stack */
   incr_top(L);
@@ -508,6 +509,25 @@ Table *luaH_new (lua_State *L, int narray, int nhash) {
 }
 
 
+/*
+** remove all the entries of `t', keeping the size of both its parts
+*/
+void luaH_clear (Table *t) {
+  int i;
+  for (i=0; i<t->sizearray; i++)
+    setnilvalue(&t->array[i]);
+  if (t->node != dummynode) {
+    for (i=0; i<sizenode(t); i++) {
+      Node *n = gnode(t, i);
+      gnext(n) = NULL;
+      setnilvalue(gkey(n));
+      setnilvalue(gval(n));
+    }
+    t->lastfree = gnode(t, sizenode(t));  /* all positions are free again */
+  }
+}
+
+
 void luaH_free (lua_State *L, Table *t) {
   if (t->node != dummynode)
     luaM_freearray(L, t->node, sizenode(t), Node);
@@ -748,6 +768,184 @@ int luaH_getn_ro (void *t) {
   return len;
 }
 
+
+
+/*
+** {=============================================================
+** Sorting of the array part
+** Arrays made only of numbers or only of strings are sorted here, on
+** their TValues, without going through the API. The introsort keeps
+** its pending ranges in a fixed size stack (the larger half is pushed,
+** so it never holds more than log2(n) ranges), each with its own depth
+** budget, and switches to heapsort for a range whose partitions got too
+** unbalanced. The stable mode is a
+** bottom-up merge sort which needs a temporary vector of `n' TValues.
+** =============================================================
+*/
+
+#define SORTNUM		0
+#define SORTSTR		1
+
+/* ranges shorter than this are sorted by insertion */
+#define SORTMINPART	12
+
+#define sortlt(k,a,b) \
+  ((k) == SORTNUM ? luai_numlt(nvalue(a), nvalue(b)) : \
+                    luaV_strcmp(rawtsvalue(a), rawtsvalue(b)) < 0)
+
+#define sortswap(a,i,j) { TValue temp_ = (a)[i]; (a)[i] = (a)[j]; (a)[j] = temp_; }
+
+
+static void insertionsort (TValue *a, int lo, int up, int k) {
+  int i, j;
+  for (i = lo + 1; i <= up; i++) {
+    TValue v = a[i];
+    for (j = i - 1; j >= lo && sortlt(k, &v, &a[j]); j--)
+      a[j + 1] = a[j];
+    a[j + 1] = v;
+  }
+}
+
+
+static void heapsort (TValue *a, int lo, int up, int k) {
+  int n = up - lo + 1, i;
+  a += lo;  /* work with a[0 .. n-1] */
+  for (i = n / 2 - 1; n > 1; ) {
+    int root, child;
+    TValue v;
+    if (i >= 0)  /* building the heap? */
+      root = i--;
+    else {  /* move the maximum to the end */
+      n--;
+      sortswap(a, 0, n);
+      root = 0;
+    }
+    v = a[root];
+    while ((child = 2 * root + 1) < n) {  /* sift `v' down */
+      if (child + 1 < n && sortlt(k, &a[child], &a[child + 1]))
+        child++;
+      if (!sortlt(k, &v, &a[child]))
+        break;
+      a[root] = a[child];
+      root = child;
+    }
+    a[root] = v;
+  }
+}
+
+
+/* partition a[lo..up] around a median of three, returns the pivot position */
+static int partition (TValue *a, int lo, int up, int k) {
+  int i, j, m = lo + (up - lo) / 2;
+  TValue p;
+  if (sortlt(k, &a[up], &a[lo])) sortswap(a, lo, up);
+  if (sortlt(k, &a[m], &a[lo])) sortswap(a, m, lo)
+  else if (sortlt(k, &a[up], &a[m])) sortswap(a, m, up);
+  /* a[lo] <= a[m] <= a[up]: use a[m] as pivot, keep it in a[up-1] */
+  p = a[m];
+  sortswap(a, m, up - 1);
+  i = lo; j = up - 1;
+  for (;;) {
+    /* the bounds checks only matter for numbers that don't compare (NaN) */
+    while (i < up - 1 && (i++, sortlt(k, &a[i], &p))) ;
+    while (j > lo && (j--, sortlt(k, &p, &a[j]))) ;
+    if (j < i)
+      break;
+    sortswap(a, i, j);
+  }
+  sortswap(a, up - 1, i);  /* put the pivot in its final place */
+  return i;
+}
+
+
+static void introsort (TValue *a, int n, int k) {
+  int stack[3 * (MAXBITS + 1)];  /* pending (lo, up, depth) ranges */
+  int top = 0, lo = 0, up = n - 1, depth, i;
+  for (i = n, depth = 0; i > 0; i >>= 1)
+    depth += 2;  /* 2*log2(n) levels before switching to heapsort */
+  for (;;) {
+    while (up - lo >= SORTMINPART) {
+      int p;
+      if (depth == 0) {  /* this range got too many unbalanced partitions */
+        heapsort(a, lo, up, k);
+        lo = up;  /* done with this range */
+        break;
+      }
+      depth--;  /* both halves are one level deeper */
+      p = partition(a, lo, up, k);
+      /* push the larger half, go on with the smaller one */
+      if (p - lo > up - p) {
+        stack[top++] = lo; stack[top++] = p - 1; stack[top++] = depth;
+        lo = p + 1;
+      }
+      else {
+        stack[top++] = p + 1; stack[top++] = up; stack[top++] = depth;
+        up = p - 1;
+      }
+    }
+    insertionsort(a, lo, up, k);
+    if (top == 0)
+      break;
+    depth = stack[--top];
+    up = stack[--top];
+    lo = stack[--top];
+  }
+}
+
+
+static void mergesort (TValue *a, TValue *buf, int n, int k) {
+  TValue *src = a, *dst = buf;
+  int w, lo;
+  for (lo = 0; lo < n; lo += SORTMINPART)  /* sort short runs first */
+    insertionsort(a, lo, (lo + SORTMINPART < n ? lo + SORTMINPART : n) - 1, k);
+  for (w = SORTMINPART; w < n; w *= 2) {
+    for (lo = 0; lo < n; lo += 2 * w) {
+      int mid = (lo + w < n) ? lo + w : n;
+      int hi = (lo + 2 * w < n) ? lo + 2 * w : n;
+      int i = lo, j = mid, d = lo;
+      while (i < mid && j < hi)  /* take the left element on ties */
+        dst[d++] = sortlt(k, &src[j], &src[i]) ? src[j++] : src[i++];
+      while (i < mid) dst[d++] = src[i++];
+      while (j < hi) dst[d++] = src[j++];
+    }
+    { TValue *temp = src; src = dst; dst = temp; }
+  }
+  if (src != a)
+    memcpy(a, src, n * sizeof(TValue));
+}
+
+
+/*
+** sort t[1..n] if all these values are in the array part and are all
+** numbers or all strings; returns 0 (leaving `t' untouched) otherwise.
+** Only values are moved inside the array, so no GC barrier is needed.
+*/
+int luaH_sortarray (lua_State *L, Table *t, int n, int stable) {
+  TValue *a = t->array;
+  int i, k;
+  if (n > t->sizearray)
+    return 0;
+  if (n < 2)
+    return 1;
+  if (ttisnumber(&a[0])) k = SORTNUM;
+  else if (ttisstring(&a[0])) k = SORTSTR;
+  else return 0;
+  for (i = 1; i < n; i++)
+    if (ttype(&a[i]) != ttype(&a[0]))
+      return 0;
+  if (stable) {
+    TValue *buf = luaM_newvector(L, n, TValue);
+    mergesort(t->array, buf, n, k);  /* `t->array' can't move, no GC here */
+    luaM_freearray(L, buf, n, TValue);
+  }
+  else
+    introsort(a, n, k);
+  return 1;
+}
+
+/* }============================================================= */
+
+
 #if defined(LUA_DEBUG)
 
 Node *luaH_mainposition (const Table *t, const TValue *key) {
@@ -5,6 +5,7 @@
 */
 
 
+#include <limits.h>
 #include <stddef.h>
 
 #define ltablib_c
@@ -133,6 +134,59 @@ static int tremove (lua_State *L) {
 }
 
 
+static int tcreate (lua_State *L) {
+  int narray = luaL_optint(L, 1, 0);
+  int nhash = luaL_optint(L, 2, 0);
+  luaL_argcheck(L, narray >= 0, 1, "invalid size");
+  luaL_argcheck(L, nhash >= 0, 2, "invalid size");
+  lua_createtable(L, narray, nhash);
+  return 1;
+}
+
+
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_cleartable(L, 1);
+  return 0;
+}
+
+
+/* table.move(a1, f, e, t [,a2]): a2[t..] = a1[f..e], returns a2 */
+static int tmove (lua_State *L) {
+  int f = luaL_checkint(L, 2);
+  int e = luaL_checkint(L, 3);
+  int t = luaL_checkint(L, 4);
+  int tt = !lua_isnoneornil(L, 5) ? 5 : 1;  /* destination table */
+  luaL_checktype(L, 1, LUA_TTABLE);
+  luaL_checktype(L, tt, LUA_TTABLE);
+  if (e >= f) {
+    int i, n, chunk;
+    luaL_argcheck(L, f > 0 || e < INT_MAX + f, 3, "too many elements to move");
+    n = e - f + 1;
+    luaL_argcheck(L, t <= INT_MAX - n + 1, 4, "destination wrap around");
+    if (t > e || t <= f || (tt != 1 && !lua_rawequal(L, 1, tt))) {
+      /* copy forward in chunks, each chunk is read before it is written */
+      luaL_checkstack(L, LUAL_ARRAYCHUNK, "too many elements to move");
+      for (i = 0; i < n; i += chunk) {
+        int j;
+        chunk = (n - i < LUAL_ARRAYCHUNK) ? n - i : LUAL_ARRAYCHUNK;
+        for (j = 0; j < chunk; j++)
+          lua_rawgeti(L, 1, f + i + j);
+        lua_rawsetarray(L, tt, t + i, chunk);
+      }
+    }
+    else {  /* overlapping with t > f: copy backwards */
+      for (i = n - 1; i >= 0; i--) {
+        lua_rawgeti(L, 1, f + i);
+        lua_rawseti(L, tt, t + i);
+      }
+    }
+  }
+  lua_pushvalue(L, tt);
+  return 1;
+}
+
+
 static void addfield (lua_State *L, luaL_Buffer *b, int i) {
   lua_rawgeti(L, 1, i);
   if (!lua_isstring(L, -1))
@@ -165,12 +219,23 @@ static int tconcat (lua_State *L) {
 
 /*
 ** {======================================================
-** Quicksort
-** (based on `Algorithms in MODULA-3', Robert Sedgewick;
-**  Addison-Wesley, 1993.)
+** Sorting
+** Arrays of numbers or strings without a comparison function are sorted
+** by the core (lua_sortarray). The generic versions below work through
+** the stack: an introsort based on the quicksort from `Algorithms in
+** MODULA-3' (Robert Sedgewick; Addison-Wesley, 1993), with an explicit
+** stack of pending ranges and a heapsort fallback, and a bottom-up merge
+** sort for the stable mode, which uses a temporary table.
 */
 
 
+/* ranges shorter than this are sorted by insertion */
+#define SORT_MINPART    12
+
+/* maximum number of pending ranges (the larger part is always pushed) */
+#define SORT_MAXSTACK   32
+
+
 static void set2 (lua_State *L, int i, int j) {
   lua_rawseti(L, 1, i);
   lua_rawseti(L, 1, j);
@@ -191,76 +256,199 @@ static int sort_comp (lua_State *L, int a, int b) {
     return lua_lessthan(L, a, b);
 }
 
-static void auxsort (lua_State *L, int l, int u) {
-  while (l < u) {  /* for tail recursion */
-    int i, j;
-    /* sort elements a[l], a[(l+u)/2] and a[u] */
-    lua_rawgeti(L, 1, l);
+/* a[i] < a[j]? */
+static int sort_lessi (lua_State *L, int i, int j) {
+  int res;
+  lua_rawgeti(L, 1, i);
+  lua_rawgeti(L, 1, j);
+  res = sort_comp(L, -2, -1);
+  lua_pop(L, 2);
+  return res;
+}
+
+static void sort_swap (lua_State *L, int i, int j) {
+  lua_rawgeti(L, 1, i);
+  lua_rawgeti(L, 1, j);
+  set2(L, i, j);
+}
+
+static void insertionsort (lua_State *L, int l, int u) {
+  int i, j;
+  for (i = l+1; i <= u; i++) {
+    lua_rawgeti(L, 1, i);  /* v = a[i] */
+    for (j = i-1; j >= l; j--) {
+      lua_rawgeti(L, 1, j);
+      if (!sort_comp(L, -2, -1)) {  /* a[j] <= v? */
+        lua_pop(L, 1);
+        break;
+      }
+      lua_rawseti(L, 1, j+1);  /* a[j+1] = a[j] */
+    }
+    lua_rawseti(L, 1, j+1);  /* a[j+1] = v */
+  }
+}
+
+static void heapsort (lua_State *L, int l, int u) {
+  int n = u-l+1, i = n/2-1;
+  while (n > 1) {
+    int root, child;
+    if (i >= 0)  /* building the heap? */
+      root = i--;
+    else {  /* move the maximum to the end */
+      n--;
+      sort_swap(L, l, l+n);
+      root = 0;
+    }
+    while ((child = 2*root+1) < n) {  /* sift a[root] down */
+      if (child+1 < n && sort_lessi(L, l+child, l+child+1))
+        child++;
+      if (!sort_lessi(L, l+root, l+child))
+        break;
+      sort_swap(L, l+root, l+child);
+      root = child;
+    }
+  }
+}
+
+/* partition a[l..u] around a median of three, returns the pivot position */
+static int partition (lua_State *L, int l, int u) {
+  int i, j;
+  /* sort elements a[l], a[(l+u)/2] and a[u] */
+  lua_rawgeti(L, 1, l);
+  lua_rawgeti(L, 1, u);
+  if (sort_comp(L, -1, -2))  /* a[u] < a[l]? */
+    set2(L, l, u);  /* swap a[l] - a[u] */
+  else
+    lua_pop(L, 2);
+  i = (l+u)/2;
+  lua_rawgeti(L, 1, i);
+  lua_rawgeti(L, 1, l);
+  if (sort_comp(L, -2, -1))  /* a[i]<a[l]? */
+    set2(L, i, l);
+  else {
+    lua_pop(L, 1);  /* remove a[l] */
     lua_rawgeti(L, 1, u);
-    if (sort_comp(L, -1, -2))  /* a[u] < a[l]? */
-      set2(L, l, u);  /* swap a[l] - a[u] */
+    if (sort_comp(L, -1, -2))  /* a[u]<a[i]? */
+      set2(L, i, u);
     else
       lua_pop(L, 2);
-    if (u-l == 1) break;  /* only 2 elements */
-    i = (l+u)/2;
-    lua_rawgeti(L, 1, i);
-    lua_rawgeti(L, 1, l);
-    if (sort_comp(L, -2, -1))  /* a[i]<a[l]? */
-      set2(L, i, l);
-    else {
-      lua_pop(L, 1);  /* remove a[l] */
-      lua_rawgeti(L, 1, u);
-      if (sort_comp(L, -1, -2))  /* a[u]<a[i]? */
-        set2(L, i, u);
-      else
-        lua_pop(L, 2);
+  }
+  lua_rawgeti(L, 1, i);  /* Pivot */
+  lua_pushvalue(L, -1);
+  lua_rawgeti(L, 1, u-1);
+  set2(L, i, u-1);
+  /* a[l] <= P == a[u-1] <= a[u], only need to sort from l+1 to u-2 */
+  i = l; j = u-1;
+  for (;;) {  /* invariant: a[l..i] <= P <= a[j..u] */
+    /* repeat ++i until a[i] >= P */
+    while (lua_rawgeti(L, 1, ++i), sort_comp(L, -1, -2)) {
+      if (i>u) luaL_error(L, "invalid order function for sorting");
+      lua_pop(L, 1);  /* remove a[i] */
+    }
+    /* repeat --j until a[j] <= P */
+    while (lua_rawgeti(L, 1, --j), sort_comp(L, -3, -1)) {
+      if (j<l) luaL_error(L, "invalid order function for sorting");
+      lua_pop(L, 1);  /* remove a[j] */
+    }
+    if (j<i) {
+      lua_pop(L, 3);  /* pop pivot, a[i], a[j] */
+      break;
     }
-    if (u-l == 2) break;  /* only 3 elements */
-    lua_rawgeti(L, 1, i);  /* Pivot */
-    lua_pushvalue(L, -1);
-    lua_rawgeti(L, 1, u-1);
-    set2(L, i, u-1);
-    /* a[l] <= P == a[u-1] <= a[u], only need to sort from l+1 to u-2 */
-    i = l; j = u-1;
-    for (;;) {  /* invariant: a[l..i] <= P <= a[j..u] */
-      /* repeat ++i until a[i] >= P */
-      while (lua_rawgeti(L, 1, ++i), sort_comp(L, -1, -2)) {
-        if (i>u) luaL_error(L, "invalid order function for sorting");
-        lua_pop(L, 1);  /* remove a[i] */
+    set2(L, i, j);
+  }
+  lua_rawgeti(L, 1, u-1);
+  lua_rawgeti(L, 1, i);
+  set2(L, u-1, i);  /* swap pivot (a[u-1]) with a[i] */
+  /* a[l..i-1] <= a[i] == P <= a[i+1..u] */
+  return i;
+}
+
+static void auxsort (lua_State *L, int l, int u) {
+  int stack[3*SORT_MAXSTACK];  /* pending (l, u, depth) ranges */
+  int top = 0, depth = 0, n;
+  for (n = u-l+1; n > 0; n >>= 1)
+    depth += 2;  /* 2*log2(n) levels before switching to heapsort */
+  for (;;) {
+    while (u-l >= SORT_MINPART) {
+      int p;
+      if (depth == 0) {  /* too many unbalanced partitions for this range */
+        heapsort(L, l, u);
+        l = u;
+        break;
       }
-      /* repeat --j until a[j] <= P */
-      while (lua_rawgeti(L, 1, --j), sort_comp(L, -3, -1)) {
-        if (j<l) luaL_error(L, "invalid order function for sorting");
-        lua_pop(L, 1);  /* remove a[j] */
+      depth--;  /* both parts are one level deeper */
+      p = partition(L, l, u);
+      /* push the larger part, go on with the smaller one */
+      if (p-l > u-p) {
+        stack[top++] = l; stack[top++] = p-1; stack[top++] = depth;
+        l = p+1;
       }
-      if (j<i) {
-        lua_pop(L, 3);  /* pop pivot, a[i], a[j] */
-        break;
+      else {
+        stack[top++] = p+1; stack[top++] = u; stack[top++] = depth;
+        u = p-1;
       }
-      set2(L, i, j);
     }
-    lua_rawgeti(L, 1, u-1);
-    lua_rawgeti(L, 1, i);
-    set2(L, u-1, i);  /* swap pivot (a[u-1]) with a[i] */
-    /* a[l..i-1] <= a[i] == P <= a[i+1..u] */
-    /* adjust so that smaller half is in [j..i] and larger one in [l..u] */
-    if (i-l < u-i) {
-      j=l; i=i-1; l=i+2;
+    insertionsort(L, l, u);
+    if (top == 0) break;
+    depth = stack[--top];
+    u = stack[--top];
+    l = stack[--top];
+  }
+}
+
+/* merge src[l..m-1] and src[m..u-1] into dst[l..u-1] */
+static void merge (lua_State *L, int src, int dst, int l, int m, int u) {
+  int i = l, j = m, d = l;
+  while (i < m && j < u) {
+    lua_rawgeti(L, src, j);
+    lua_rawgeti(L, src, i);
+    if (sort_comp(L, -2, -1)) {  /* src[j] < src[i]? (ties keep the left one) */
+      lua_pop(L, 1);
+      j++;
     }
     else {
-      j=i+1; i=u; u=j-2;
+      lua_remove(L, -2);
+      i++;
     }
-    auxsort(L, j, i);  /* call recursively the smaller one */
-  }  /* repeat the routine for the larger one */
+    lua_rawseti(L, dst, d++);
+  }
+  for (; i < m; i++) { lua_rawgeti(L, src, i); lua_rawseti(L, dst, d++); }
+  for (; j < u; j++) { lua_rawgeti(L, src, j); lua_rawseti(L, dst, d++); }
+}
+
+static void auxmergesort (lua_State *L, int n) {
+  int src = 1, dst, w, l;
+  lua_createtable(L, n, 0);  /* temporary table */
+  dst = lua_gettop(L);
+  for (l = 1; l <= n; l += SORT_MINPART)  /* sort short runs first */
+    insertionsort(L, l, (l+SORT_MINPART-1 < n) ? l+SORT_MINPART-1 : n);
+  for (w = SORT_MINPART; w < n; w *= 2) {
+    for (l = 1; l <= n; l += 2*w) {
+      int m = (l+w <= n) ? l+w : n+1;
+      int u = (l+2*w <= n) ? l+2*w : n+1;
+      merge(L, src, dst, l, m, u);
+    }
+    { int temp = src; src = dst; dst = temp; }
+  }
+  if (src != 1)
+    for (l = 1; l <= n; l++) { lua_rawgeti(L, src, l); lua_rawseti(L, 1, l); }
+  lua_pop(L, 1);  /* remove temporary table */
 }
 
+/* table.sort(t [, comp [, stable]]) */
 static int sort (lua_State *L) {
   int n = aux_getn(L, 1);
-  luaL_checkstack(L, 40, "");  /* assume array is smaller than 2^40 */
+  int stable = lua_toboolean(L, 3);
+  luaL_checkstack(L, 40, "");
   if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
     luaL_checktype(L, 2, LUA_TFUNCTION);
+  else if (lua_sortarray(L, 1, n, stable))  /* numbers or strings only? */
+    return 0;
   lua_settop(L, 2);  /* make sure there is two arguments */
-  auxsort(L, 1, n);
+  if (stable)
+    auxmergesort(L, n);
+  else if (n > 1)
+    auxsort(L, 1, n);
   return 0;
 }
 
@@ -270,11 +458,14 @@ static int sort (lua_State *L) {
 #define MIN_OPT_LEVEL 1
 #include "lrodefs.h"
 const LUA_REG_TYPE tab_funcs[] = {
+  {LSTRKEY("clear"), LFUNCVAL(tclear)},
   {LSTRKEY("concat"), LFUNCVAL(tconcat)},
+  {LSTRKEY("create"), LFUNCVAL(tcreate)},
   {LSTRKEY("foreach"), LFUNCVAL(foreach)},
   {LSTRKEY("foreachi"), LFUNCVAL(foreachi)},
   {LSTRKEY("getn"), LFUNCVAL(getn)},
   {LSTRKEY("maxn"), LFUNCVAL(maxn)},
+  {LSTRKEY("move"), LFUNCVAL(tmove)},
   {LSTRKEY("insert"), LFUNCVAL(tinsert)},
   {LSTRKEY("remove"), LFUNCVAL(tremove)},
   {LSTRKEY("setn"), LFUNCVAL(setn)},
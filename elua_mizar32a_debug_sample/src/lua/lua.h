@@ -62,9 +62,13 @@ typedef int (*lua_Writer) (lua_State *L, const void* p, size_t sz, void* ud);
 
 /*
 ** prototype for memory-allocation functions
+** (when `ptr' is NULL, `osize' is 0 or the type of the object being created)
 */
 typedef void * (*lua_Alloc) (void *ud, void *ptr, size_t osize, size_t nsize);
 
+/* `osize' of new bulk data blocks (large table parts, buffers) */
+#define LUA_TBULK	(LUA_TTHREAD+5)
+
 
 /*
 ** basic types
@@ -194,6 +198,9 @@ LUA_API void  (lua_settable) (lua_State *L, int idx);
 LUA_API void  (lua_setfield) (lua_State *L, int idx, const char *k);
 LUA_API void  (lua_rawset) (lua_State *L, int idx);
 LUA_API void  (lua_rawseti) (lua_State *L, int idx, int n);
+LUA_API void  (lua_rawsetarray) (lua_State *L, int idx, int first, int n);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
+LUA_API int   (lua_sortarray) (lua_State *L, int idx, int n, int stable);
 LUA_API int   (lua_setmetatable) (lua_State *L, int objindex);
 LUA_API int   (lua_setfenv) (lua_State *L, int idx);
 
@@ -231,6 +238,9 @@ LUA_API int  (lua_status) (lua_State *L);
 #define LUA_GCSETSTEPMUL	7
 #define LUA_GCSETMEMLIMIT	8
 #define LUA_GCGETMEMLIMIT	9
+#define LUA_GCGETPEAK		10
+#define LUA_GCGETCYCLES		11
+#define LUA_GCGETSLAB		12
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
@@ -248,6 +258,11 @@ LUA_API void  (lua_concat) (lua_State *L, int n);
 LUA_API lua_Alloc (lua_getallocf) (lua_State *L, void **ud);
 LUA_API void lua_setallocf (lua_State *L, lua_Alloc f, void *ud);
 
+LUA_API void (lua_geticstats) (lua_State *L, unsigned long *hits,
+                               unsigned long *misses, int reset);
+LUA_API void (lua_getstrstats) (lua_State *L, int *size, int *nuse,
+                                int *maxchain, int *empty);
+
 
 
 /* 
@@ -362,6 +362,81 @@
 #define LUAI_GCMUL	200 /* GC runs 'twice the speed' of memory allocation */
 
 
+/*
+@@ LUAI_SLABMAXSIZE is the largest block served by the size-class slab
+@* allocator in lmem.c. Blocks up to this size (strings, tables, closures,
+@* upvalues, small node vectors) are carved from pages instead of getting
+@* a heap chunk each.
+@@ LUAI_SLABPAGESIZE is the size of the pages requested from lua_Alloc.
+** The slabs are off (0) by default: on the desktop build they are slower
+** and raise the peak heap, so enable them (64 is a good start) only after
+** measuring a gain on the target.
+*/
+#ifndef LUAI_SLABMAXSIZE
+#define LUAI_SLABMAXSIZE	0
+#endif
+#define LUAI_SLABPAGESIZE	512
+
+
+/*
+@@ LUAI_BULKSIZE is the size from which table parts and string buffers
+@* are allocated with the LUA_TBULK tag, which tells the allocator that
+@* they are bulk data that doesn't need fast memory.
+** CHANGE it to 0 to allocate them like any other block.
+*/
+#define LUAI_BULKSIZE	1024
+
+
+/*
+@@ LUA_USE_JUMPTABLE makes luaV_execute dispatch opcodes through a table
+@* of label addresses (GCC "labels as values") instead of a switch.
+** CHANGE it (define it) if your compiler supports computed gotos. Each
+** opcode then ends with its own indirect branch, which avoids the range
+** check of the switch and helps branch prediction, at the cost of some
+** code size. Ignored by compilers other than GCC.
+*/
+/* #define LUA_USE_JUMPTABLE */
+
+
+/*
+@@ LUAI_MAXICACHE is the maximum number of inline cache entries per
+@* function. Every GETGLOBAL, and every GETTABLE/SELF with a constant
+@* string key, remembers where it found its key in the last table or
+@* rotable it looked at, and reuses that position when it runs again.
+** CHANGE it to 0 to disable the inline caches (saves some RAM per
+** function).
+*/
+#ifndef LUAI_MAXICACHE
+#define LUAI_MAXICACHE	8
+#endif
+
+
+/*
+@@ LUAI_HASHLIMIT is the length up to which all the chars of a string are
+@* hashed. Longer strings hash their last LUAI_HASHLIMIT/2 chars and a
+@* sample of the others.
+@@ LUAI_STRTLOAD is the average number of strings per bucket of the string
+@* table above which the table grows.
+** CHANGE them if your strings are typically long and share long prefixes
+** or suffixes (raise LUAI_HASHLIMIT), or to trade lookup speed for RAM
+** (raise LUAI_STRTLOAD).
+*/
+#define LUAI_HASHLIMIT	64
+#define LUAI_STRTLOAD	1
+
+
+/*
+@@ luai_makeseed returns the seed of the string hash function.
+** CHANGE it to return a value that differs on every boot (a free running
+** timer, the noise of an unconnected ADC input, ...) to make the bucket of
+** a given string unpredictable. The default gives the same hashes on every
+** run.
+*/
+#ifndef luai_makeseed
+#define luai_makeseed(L)	((unsigned int)0)
+#endif
+
+
 
 /*
 @@ LUA_COMPAT_GETN controls compatibility with old getn behavior.
@@ -748,6 +823,16 @@ union luai_Cast { double l_d; long l_l; };
 #define LUA_MAXCAPTURES		10
 
 
+/*
+@@ LUAI_PATCACHE is the number of compiled patterns kept (per state) by
+@* the pattern-matching functions of the string library.
+** CHANGE it if your programs use many different patterns in a loop, or
+** define it as 0 to always interpret the patterns (saves about 300 bytes
+** of RAM per entry).
+*/
+#define LUAI_PATCACHE		4
+
+
 /*
 @@ lua_tmpnam is the function that the OS library uses to create a
 @* temporary name.
@@ -278,6 +278,7 @@ static Proto* LoadFunction(LoadState* S, TString* p)
  LoadConstants(S,f);
  LoadDebug(S,f);
  IF (!luaG_checkcode(f), "bad code");
+ luaF_initcache(S->L,f);
  S->L->top--;
  S->L->nCcalls--;
  return f;
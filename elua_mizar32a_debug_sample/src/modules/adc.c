@@ -9,9 +9,22 @@
 #include "lrotable.h"
 #include "platform_conf.h"
 #include "elua_adc.h"
+#include "utils.h"
+#include <string.h>
+#include <math.h>
 
 #ifdef BUILD_ADC
 
+#define SAMPLES_META_NAME         "eLua.adc.samples"
+
+// Packed sample buffer (see adc.newbuf)
+typedef struct
+{
+  u32 size;
+  u32 count;
+  u16 values[ 1 ];
+} adc_samples_t;
+
 // Lua: data = maxval( id )
 static int adc_maxval( lua_State* L )
 {
@@ -104,6 +117,8 @@ static int adc_sample( lua_State* L )
   count = luaL_checkinteger( L, 2 );
   if  ( ( count == 0 ) || count & ( count - 1 ) )
     return luaL_error( L, "count must be power of 2 and > 0" );
+  if ( adc_get_stream_state()->running )
+    return luaL_error( L, "ADC busy with a stream" );
   
   // If first parameter is a table, extract channel list
   if ( lua_istable( L, 1 ) == 1 )
@@ -164,8 +179,9 @@ static int adc_getsample( lua_State* L )
 // Lua: table_of_vals = getsamples( id, [count] )
 static int adc_getsamples( lua_State* L )
 {
-  unsigned id, i;
+  unsigned id, i, j, n;
   u16 bcnt, count = 0;
+  u16 chunk[ LUAL_ARRAYCHUNK ];
   
   id = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( adc, id );
@@ -184,10 +200,13 @@ static int adc_getsamples( lua_State* L )
     count = bcnt;
   
   lua_createtable( L, count, 0 );
-  for( i = 1; i <= count; i ++ )
+  for( i = 1; i <= count; i += n )
   {
-    lua_pushinteger( L, adc_get_processed_sample( id ) );
-    lua_rawseti( L, -2, i );
+    if( ( n = adc_get_processed_samples( id, chunk, UMIN( count - i + 1, LUAL_ARRAYCHUNK ) ) ) == 0 )
+      break;
+    for( j = 0; j < n; j ++ )
+      lua_pushinteger( L, chunk[ j ] );
+    lua_rawsetarray( L, -1 - ( int )n, i, n );
   }
   return 1;
 }
@@ -196,8 +215,9 @@ static int adc_getsamples( lua_State* L )
 // Lua: insertsamples(id, table, idx, count)
 static int adc_insertsamples( lua_State* L )
 {
-  unsigned id, i, startidx;
+  unsigned id, i, j, n, got, startidx;
   u16 bcnt, count;
+  u16 chunk[ LUAL_ARRAYCHUNK ];
   
   id = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( adc, id );
@@ -214,19 +234,263 @@ static int adc_insertsamples( lua_State* L )
   
   bcnt = adc_wait_samples( id, count );
   
-  for( i = startidx; i < ( count + startidx ); i ++ )
+  for( i = startidx; i < ( count + startidx ); i += n )
   {
+    n = UMIN( count + startidx - i, LUAL_ARRAYCHUNK );
+    got = 0;
     if ( i < bcnt + startidx )
-      lua_pushinteger( L, adc_get_processed_sample( id ) );
-    else
-      lua_pushnil( L ); // nil-out values where we don't have enough samples
-
-    lua_rawseti( L, 2, i );
+      got = adc_get_processed_samples( id, chunk, UMIN( n, bcnt + startidx - i ) );
+    for( j = 0; j < n; j ++ )
+    {
+      if ( j < got )
+        lua_pushinteger( L, chunk[ j ] );
+      else
+        lua_pushnil( L ); // nil-out values where we don't have enough samples
+    }
+    lua_rawsetarray( L, 2, i, n );
   }
   
   return 0;
 }
+
+// Lua: buf = getpacked( id, [count], buf ), or
+//      str = getpacked( id, [count] )
+// Like getsamples, but the samples are stored in a buffer created with
+// newbuf (overwriting its previous contents, at most its size) or returned
+// as a string of native 16-bit values (2 bytes per sample).
+static int adc_getpacked( lua_State* L )
+{
+  unsigned id, n;
+  u16 bcnt, count = 0;
+  adc_samples_t *pb = NULL;
+  u16 chunk[ LUAL_ARRAYCHUNK ];
+  luaL_Buffer b;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( adc, id );
+  if ( lua_isnumber( L, 2 ) == 1 )
+    count = ( u16 )lua_tointeger( L, 2 );
+  if ( !lua_isnoneornil( L, 3 ) )
+  {
+    pb = ( adc_samples_t* )luaL_checkudata( L, 3, SAMPLES_META_NAME );
+    if ( count == 0 || count > pb->size )
+      count = ( u16 )UMIN( pb->size, 0xFFFF );
+  }
+
+  bcnt = adc_wait_samples( id, count );
+  if ( count == 0 || count > bcnt )
+    count = bcnt;
+
+  if ( pb )
+  {
+    pb->count = adc_get_processed_samples( id, pb->values, count );
+    lua_settop( L, 3 );
+    return 1;
+  }
+  luaL_buffinit( L, &b );
+  while( count > 0 )
+  {
+    if( ( n = adc_get_processed_samples( id, chunk, UMIN( count, LUAL_ARRAYCHUNK ) ) ) == 0 )
+      break;
+    luaL_addlstring( &b, ( const char* )chunk, n * sizeof( u16 ) );
+    count -= n;
+  }
+  luaL_pushresult( &b );
+  return 1;
+}
+#endif
+
+// Lua: buf = newbuf( size )
+// Creates a buffer for 'size' packed samples, to be filled by getpacked
+static int adc_newbuf( lua_State* L )
+{
+  s32 size = luaL_checkinteger( L, 1 );
+  adc_samples_t *pb;
+
+  if( size <= 0 )
+    return luaL_error( L, "size must be > 0" );
+  pb = ( adc_samples_t* )lua_newuserdata( L, sizeof( adc_samples_t ) + ( size - 1 ) * sizeof( u16 ) );
+  pb->size = ( u32 )size;
+  pb->count = 0;
+  luaL_getmetatable( L, SAMPLES_META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Lua: realfreq = stream( id, freq, timer_id, blocksize ), or
+//      realfreq = stream( { id1, id2, ... }, freq, timer_id, blocksize )
+// Starts converting the channel(s) continuously, 'freq' times per second
+// (triggered by timer 'timer_id') into blocks of 'blocksize' samples. The
+// samples of the channels are interleaved, in increasing channel order.
+// INT_ADC_BLOCK is signaled for every complete block.
+static int adc_stream( lua_State* L )
+{
+  unsigned id, timer_id, nchans = 0, i;
+  u32 chmask = 0, freq, res;
+  s32 blocksize;
+
+  if ( lua_istable( L, 1 ) )
+  {
+    for( i = 1; i <= lua_objlen( L, 1 ); i ++ )
+    {
+      lua_rawgeti( L, 1, i );
+      id = luaL_checkinteger( L, -1 );
+      MOD_CHECK_ID( adc, id );
+      lua_pop( L, 1 );
+      chmask |= ( u32 )1 << id;
+    }
+  }
+  else
+  {
+    id = luaL_checkinteger( L, 1 );
+    MOD_CHECK_ID( adc, id );
+    chmask = ( u32 )1 << id;
+  }
+  for( i = 0; i < NUM_ADC; i ++ )
+    if ( chmask & ( ( u32 )1 << i ) )
+      nchans ++;
+  freq = luaL_checkinteger( L, 2 );
+  timer_id = luaL_checkinteger( L, 3 );
+  MOD_CHECK_ID( timer, timer_id );
+  // Only the hardware timers can trigger the ADC, not the virtual ones
+  if( timer_id >= NUM_TIMER )
+    return luaL_error( L, "timer %d cannot trigger the ADC", timer_id );
+  blocksize = luaL_checkinteger( L, 4 );
+  if ( nchans == 0 || blocksize <= 0 || blocksize > 0xFFFF || blocksize % nchans )
+    return luaL_error( L, "blocksize must be a multiple of the number of channels" );
+  if ( adc_get_stream_state()->running )
+    return luaL_error( L, "stream already running" );
+  if ( ( res = adc_stream_start( chmask, timer_id, freq, ( u16 )blocksize ) ) == 0 )
+    return luaL_error( L, "unable to start the stream" );
+  lua_pushinteger( L, res );
+  return 1;
+}
+
+// Lua: buf = getblock( buf ), or
+//      str = getblock()
+// Gets the last complete block of a stream in a buffer created with newbuf
+// or as a string of native 16-bit values. Returns nil if there is no new
+// block since the last call.
+static int adc_getblock( lua_State* L )
+{
+  elua_adc_stream_state *st = adc_get_stream_state();
+  adc_samples_t *pb = NULL;
+  u16 *pblock;
+  u32 seq;
+
+  if ( !lua_isnoneornil( L, 1 ) )
+  {
+    pb = ( adc_samples_t* )luaL_checkudata( L, 1, SAMPLES_META_NAME );
+    if ( pb->size < st->blocksize )
+      return luaL_error( L, "buffer too small" );
+  }
+  // Retry if the block was overwritten while it was copied
+  while( ( pblock = adc_stream_peek( &seq ) ) != NULL )
+  {
+    if ( pb )
+    {
+      memcpy( pb->values, pblock, st->blocksize * sizeof( u16 ) );
+      pb->count = st->blocksize;
+      lua_pushvalue( L, 1 );
+    }
+    else
+      lua_pushlstring( L, ( const char* )pblock, st->blocksize * sizeof( u16 ) );
+    if ( adc_stream_release( seq ) )
+      return 1;
+    lua_pop( L, 1 );
+  }
+  if ( pb )
+    pb->count = 0;
+  lua_pushnil( L );
+  return 1;
+}
+
+// Lua: blocks, lost = stopstream()
+// Stops the stream, returns the number of complete blocks and the number
+// of blocks that were not read in time
+static int adc_stopstream( lua_State* L )
+{
+  elua_adc_stream_state *st = adc_get_stream_state();
+
+  adc_stream_stop();
+  lua_pushinteger( L, st->seq );
+  lua_pushinteger( L, st->overruns );
+  return 2;
+}
+
+// Lua: min, max, mean, rms = stats( data, [first], [last] )
+// Statistics over the samples first .. last (all by default) of a buffer
+// created with newbuf or of a string with packed samples
+static int adc_stats( lua_State* L )
+{
+  const char *pdata;
+  size_t len;
+  s32 first, last, i;
+  u16 v, vmin = 0xFFFF, vmax = 0;
+  u64 sum = 0, sumsq = 0;
+  lua_Number mean, rms;
+
+  if( lua_type( L, 1 ) == LUA_TSTRING )
+  {
+    // The string data has no alignment guarantee, the samples are copied out
+    pdata = lua_tolstring( L, 1, &len );
+    len /= sizeof( u16 );
+  }
+  else
+  {
+    adc_samples_t *pb = ( adc_samples_t* )luaL_checkudata( L, 1, SAMPLES_META_NAME );
+    pdata = ( const char* )pb->values;
+    len = pb->count;
+  }
+  first = luaL_optinteger( L, 2, 1 );
+  last = luaL_optinteger( L, 3, len );
+  if( first < 1 || last > ( s32 )len )
+    return luaL_error( L, "invalid range" );
+  if( last < first )
+    return 0;
+  for( i = first - 1; i < last; i ++ )
+  {
+    memcpy( &v, pdata + i * sizeof( u16 ), sizeof( u16 ) );
+    vmin = UMIN( vmin, v );
+    vmax = UMAX( vmax, v );
+    sum += v;
+    sumsq += ( u32 )v * v;
+  }
+  mean = ( lua_Number )sum / ( last - first + 1 );
+#ifndef LUA_NUMBER_INTEGRAL
+  rms = sqrt( ( lua_Number )sumsq / ( last - first + 1 ) );
+#else
+  // Integer square root
+  sumsq /= ( u32 )( last - first + 1 );
+  for( rms = 0; ( u64 )( rms + 1 ) * ( rms + 1 ) <= sumsq; rms ++ );
 #endif
+  lua_pushinteger( L, vmin );
+  lua_pushinteger( L, vmax );
+  lua_pushnumber( L, mean );
+  lua_pushnumber( L, rms );
+  return 4;
+}
+
+// Lua: value = buf[ idx ] (nil if idx > number of samples in the buffer)
+static int adc_samples_get( lua_State* L )
+{
+  adc_samples_t *pb = ( adc_samples_t* )luaL_checkudata( L, 1, SAMPLES_META_NAME );
+  s32 idx = luaL_checkinteger( L, 2 );
+
+  if( idx <= 0 || ( u32 )idx > pb->count )
+    return 0;
+  lua_pushinteger( L, pb->values[ idx - 1 ] );
+  return 1;
+}
+
+// Lua: count = #buf
+static int adc_samples_len( lua_State* L )
+{
+  adc_samples_t *pb = ( adc_samples_t* )luaL_checkudata( L, 1, SAMPLES_META_NAME );
+
+  lua_pushinteger( L, pb->count );
+  return 1;
+}
 
 // Module function map
 #define MIN_OPT_LEVEL 2
@@ -243,13 +507,33 @@ const LUA_REG_TYPE adc_map[] =
 #if defined( BUF_ENABLE_ADC )
   { LSTRKEY( "getsamples" ), LFUNCVAL( adc_getsamples ) },
   { LSTRKEY( "insertsamples" ), LFUNCVAL( adc_insertsamples ) },
+  { LSTRKEY( "getpacked" ), LFUNCVAL( adc_getpacked ) },
 #endif
+  { LSTRKEY( "newbuf" ), LFUNCVAL( adc_newbuf ) },
+  { LSTRKEY( "stream" ), LFUNCVAL( adc_stream ) },
+  { LSTRKEY( "getblock" ), LFUNCVAL( adc_getblock ) },
+  { LSTRKEY( "stopstream" ), LFUNCVAL( adc_stopstream ) },
+  { LSTRKEY( "stats" ), LFUNCVAL( adc_stats ) },
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE adc_samples_mt_map[] =
+{
+  { LSTRKEY( "__index" ), LFUNCVAL( adc_samples_get ) },
+  { LSTRKEY( "__len" ), LFUNCVAL( adc_samples_len ) },
   { LNILKEY, LNILVAL }
 };
 
 LUALIB_API int luaopen_adc( lua_State *L )
 {
+#if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, SAMPLES_META_NAME, ( void* )adc_samples_mt_map );
+  return 0;
+#else // #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_newmetatable( L, SAMPLES_META_NAME );
+  luaL_register( L, NULL, adc_samples_mt_map );
   LREGISTER( L, AUXLIB_ADC, adc_map );
+#endif // #if LUA_OPTIMIZE_MEMORY > 0
 }
 
 #endif
@@ -61,6 +61,15 @@ LUALIB_API int ( luaopen_i2c )( lua_State *L );
 #define AUXLIB_FS "fs"
 LUALIB_API int ( luaopen_fs )( lua_State *L );
 
+#define AUXLIB_PROFILER "profiler"
+LUALIB_API int ( luaopen_profiler )( lua_State *L );
+
+#define AUXLIB_REGEX    "regex"
+LUALIB_API int ( luaopen_regex )( lua_State *L );
+
+#define AUXLIB_WAVE     "wave"
+LUALIB_API int ( luaopen_wave )( lua_State *L );
+
 // Helper macros
 #define MOD_CHECK_ID( mod, id )\
   if( !platform_ ## mod ## _exists( id ) )\
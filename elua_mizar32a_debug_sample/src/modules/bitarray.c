@@ -6,11 +6,13 @@
 #include "type.h"
 #include "auxmods.h"
 #include "lrotable.h"
+#include "utils.h"
 #include <string.h>
 
 #define META_NAME                 "eLua.bitarray"
 #define bitarray_check( L )      ( bitarray_t* )luaL_checkudata( L, 1, META_NAME )
 #define ROUND_SIZE(s)            ( ( ( s ) >> 3 ) + ( ( s ) & 7 ? 1 : 0 ) )
+#define ROUND_WORDS(s)           ( ( ( s ) + 3 ) >> 2 )
 
 // Unpack modes
 enum
@@ -20,10 +22,12 @@ enum
 };
  
 // Structure that describes our array
+// 'values' is word aligned and its size rounded up to a whole number of
+// words for the bulk operations; the bits after the last element are 0
 typedef struct
 {
   u32 capacity;
-  u8 elsize;
+  u32 elsize;
   u8 values[ 1 ];
 } bitarray_t;
 
@@ -31,6 +35,16 @@ typedef struct
 static const u8 bitarray_index_shift[] = { 0, 3, 2, 0, 1 };
 static const u8 bitarray_index_mask[] = { 0, 0x01, 0x03, 0, 0x0F };
 
+// Helper: clear the bits after the last element (sub-byte elements are
+// stored from the most significant bit of each byte)
+static void bitarray_clear_tail( bitarray_t *pa )
+{
+  u32 bits = pa->capacity * pa->elsize;
+
+  if( bits & 7 )
+    pa->values[ bits >> 3 ] &= 0xFF << ( 8 - ( bits & 7 ) );
+}
+
 // Lua: array = bitarray.new( capacity, [element_size_bits], [fill] ), or
 //      array = bitarray.new( "string", [element_size_bits] ), or
 //      array = bitarray.new( lua_array, [element_size_bits] )
@@ -81,9 +95,10 @@ static int bitarray_new( lua_State *L )
   total = ROUND_SIZE( capacity * elsize );
   if( total <= 0 )
     return luaL_error( L, "invalid arguments.");
-  pa = ( bitarray_t* )lua_newuserdata( L, sizeof( bitarray_t ) + total - 1 );
+  pa = ( bitarray_t* )lua_newuserdata( L, sizeof( bitarray_t ) + ROUND_WORDS( total ) * 4 - 1 );
   pa->capacity = capacity;
   pa->elsize = elsize;
+  memset( pa->values + total, 0, ROUND_WORDS( total ) * 4 - total );
   
   if( buf )
     memcpy( pa->values, buf, temp );
@@ -97,7 +112,10 @@ static int bitarray_new( lua_State *L )
     }
   }
   else
+  {
     memset( pa->values, fill, total );
+    bitarray_clear_tail( pa );
+  }
   luaL_getmetatable( L, META_NAME );
   lua_setmetatable( L, -2 );
   return 1;
@@ -150,18 +168,12 @@ static int bitarray_get( lua_State *L )
   return 1;
 }
 
-// Lua: array[ key ] = value
-static int bitarray_set( lua_State *L )
+// Helper: set the value at the given index
+static void bitarray_setval( bitarray_t *pa, u32 idx, u32 newval )
 {
-  bitarray_t *pa;
-  u32 idx, shift, newval, val = 0;
+  u32 shift, val = 0;
   u8 rest, mask;
-   
-  pa = bitarray_check( L );
-  idx = ( u32 )luaL_checkinteger( L, 2 );
-  newval = ( u32 )luaL_checkinteger( L, 3 );
-  if( ( idx <= 0 ) || ( idx > pa->capacity ) )
-    return luaL_error( L, "invalid index." );
+
   idx --;
   if( pa->elsize < 8 )        // sub-byte elements
   {
@@ -170,7 +182,7 @@ static int bitarray_set( lua_State *L )
     rest = idx & ( mask - 1 );
     val = pa->values[ shift ];
     val &= ~( bitarray_index_mask[ pa->elsize ] << ( ( mask - 1 - rest ) * pa->elsize ) );
-    val |= newval << ( ( mask - 1 - rest ) * pa->elsize );
+    val |= ( newval & bitarray_index_mask[ pa->elsize ] ) << ( ( mask - 1 - rest ) * pa->elsize );
     pa->values[ shift ] = val; 
   }
   else      // one byte or more elements
@@ -188,6 +200,19 @@ static int bitarray_set( lua_State *L )
         *( ( u32* )pa->values + idx ) = ( u32 )newval;
         break;  
     }    
+}
+
+// Lua: array[ key ] = value
+static int bitarray_set( lua_State *L )
+{
+  bitarray_t *pa;
+  u32 idx;
+   
+  pa = bitarray_check( L );
+  idx = ( u32 )luaL_checkinteger( L, 2 );
+  if( ( idx <= 0 ) || ( idx > pa->capacity ) )
+    return luaL_error( L, "invalid index." );
+  bitarray_setval( pa, idx, ( u32 )luaL_checkinteger( L, 3 ) );
   return 0;
 }
 
@@ -268,7 +293,7 @@ static int bitarray_tostring( lua_State *L )
 static int bitarray_totable( lua_State *L )
 {
   bitarray_t *pa;
-  u32 idx;
+  u32 idx, total, n, i;
   u8 mode = BITARRAY_UNPACK_SEQ;
   const char *ptextmode;
    
@@ -285,22 +310,414 @@ static int bitarray_totable( lua_State *L )
   }
   if( ( mode == BITARRAY_UNPACK_SEQ ) && ( pa->elsize > 8 ) )
     return luaL_error( L, "element size too large." );
-  lua_newtable( L );    
-  if( mode == BITARRAY_UNPACK_SEQ )
-    for( idx = 1; idx <= pa->capacity; idx ++ )
-    {
-      lua_pushinteger( L, bitarray_getval( pa, idx ) );
-      lua_rawseti( L, -2, idx );
-    }      
-  else
-    for( idx = 0; idx < ROUND_SIZE( pa->capacity * pa->elsize ); idx ++ )
-    {
-      lua_pushinteger( L, pa->values[ idx ] );
-      lua_rawseti( L, -2, idx + 1 );
-    }
+  total = mode == BITARRAY_UNPACK_SEQ ? pa->capacity : ROUND_SIZE( pa->capacity * pa->elsize );
+  lua_createtable( L, total, 0 );
+  for( idx = 1; idx <= total; idx += n )
+  {
+    n = UMIN( total - idx + 1, LUAL_ARRAYCHUNK );
+    for( i = idx; i < idx + n; i ++ )
+      lua_pushinteger( L, mode == BITARRAY_UNPACK_SEQ ? bitarray_getval( pa, i ) : pa->values[ i - 1 ] );
+    lua_rawsetarray( L, -1 - ( int )n, idx, n );
+  }
   return 1;  
 }
 
+// ****************************************************************************
+// Bulk operations
+// These work on whole words where possible. An element never crosses a word
+// boundary and element 'i' (0 based) is in word i * elsize / 32 for both
+// byte orders, so the word loops only need masks that are repeated with the
+// period of the element size: 'lo' has the least significant bit of every
+// element set, 'lo << ( elsize - 1 )' the most significant one.
+
+#define BITARRAY_LO_1             0xFFFFFFFFU
+#define BITARRAY_LO_2             0x55555555U
+#define BITARRAY_LO_4             0x11111111U
+#define BITARRAY_LO_8             0x01010101U
+#define BITARRAY_LO_16            0x00010001U
+#define BITARRAY_LO_32            0x00000001U
+
+// Or all the bits of each element into its least significant bit
+#define BITARRAY_FOLD_1( x )
+#define BITARRAY_FOLD_2( x )      x |= x >> 1
+#define BITARRAY_FOLD_4( x )      BITARRAY_FOLD_2( x ); x |= x >> 2
+#define BITARRAY_FOLD_8( x )      BITARRAY_FOLD_4( x ); x |= x >> 4
+#define BITARRAY_FOLD_16( x )     BITARRAY_FOLD_8( x ); x |= x >> 8
+#define BITARRAY_FOLD_32( x )     BITARRAY_FOLD_16( x ); x |= x >> 16
+
+static u32 bitarray_popcount32( u32 x )
+{
+  x = x - ( ( x >> 1 ) & 0x55555555 );
+  x = ( x & 0x33333333 ) + ( ( x >> 2 ) & 0x33333333 );
+  x = ( x + ( x >> 4 ) ) & 0x0F0F0F0F;
+  return ( x * 0x01010101 ) >> 24;
+}
+
+// Word kernels specialised for each element size:
+//   count: number of non-zero elements in 'n' words
+//   skip: number of words before the first one with a non-zero element
+//         ('set' = 1) or with a zero element ('set' = 0)
+#define BITARRAY_KERNELS( e )\
+static u32 bitarray_count_##e( const u32 *p, u32 n )\
+{\
+  u32 res = 0, x;\
+  while( n -- )\
+  {\
+    x = *p ++;\
+    BITARRAY_FOLD_##e( x );\
+    res += bitarray_popcount32( x & BITARRAY_LO_##e );\
+  }\
+  return res;\
+}\
+static u32 bitarray_skip_##e( const u32 *p, u32 n, int set )\
+{\
+  u32 i;\
+  for( i = 0; i < n; i ++ )\
+    if( set ? p[ i ] != 0 : ( ( p[ i ] - BITARRAY_LO_##e ) & ~p[ i ] & ( BITARRAY_LO_##e << ( e - 1 ) ) ) != 0 )\
+      break;\
+  return i;\
+}
+
+BITARRAY_KERNELS( 1 )
+BITARRAY_KERNELS( 2 )
+BITARRAY_KERNELS( 4 )
+BITARRAY_KERNELS( 8 )
+BITARRAY_KERNELS( 16 )
+BITARRAY_KERNELS( 32 )
+
+static u32 bitarray_count_words( u32 elsize, const u32 *p, u32 n )
+{
+  switch( elsize )
+  {
+    case 1: return bitarray_count_1( p, n );
+    case 2: return bitarray_count_2( p, n );
+    case 4: return bitarray_count_4( p, n );
+    case 8: return bitarray_count_8( p, n );
+    case 16: return bitarray_count_16( p, n );
+    default: return bitarray_count_32( p, n );
+  }
+}
+
+static u32 bitarray_skip_words( u32 elsize, const u32 *p, u32 n, int set )
+{
+  switch( elsize )
+  {
+    case 1: return bitarray_skip_1( p, n, set );
+    case 2: return bitarray_skip_2( p, n, set );
+    case 4: return bitarray_skip_4( p, n, set );
+    case 8: return bitarray_skip_8( p, n, set );
+    case 16: return bitarray_skip_16( p, n, set );
+    default: return bitarray_skip_32( p, n, set );
+  }
+}
+
+// Helper: get an optional [ first, last ] range of elements (1 based) from
+// the arguments at 'idx' and 'idx' + 1 (the whole array by default)
+static void bitarray_range( lua_State *L, bitarray_t *pa, int idx, u32 *pfirst, u32 *plast )
+{
+  lua_Integer first = luaL_optinteger( L, idx, 1 );
+  lua_Integer last = luaL_optinteger( L, idx + 1, pa->capacity );
+
+  if( first < 1 || last > ( lua_Integer )pa->capacity || last < first - 1 )
+    luaL_error( L, "invalid range." );
+  *pfirst = ( u32 )first;
+  *plast = ( u32 )last;
+}
+
+// Helper: copy 'nbits' bits from 'src' (starting with bit 'sbit') to 'dst'
+// (starting with bit 'dbit'); bits are numbered from the most significant
+// bit of the first byte. The areas can overlap. 'srclen' is the size of 'src'.
+static u8 bitarray_get8( const u8 *src, u32 srclen, u32 bit )
+{
+  u32 pos = bit >> 3, r = bit & 7;
+  u8 val = src[ pos ] << r;
+
+  if( r && pos + 1 < srclen )
+    val |= src[ pos + 1 ] >> ( 8 - r );
+  return val;
+}
+
+static void bitarray_put( u8 *dst, u32 bit, u32 n, u8 val )
+{
+  u8 mask = ( u8 )( 0xFF00 >> n ) >> ( bit & 7 );
+
+  dst[ bit >> 3 ] = ( dst[ bit >> 3 ] & ~mask ) | ( ( val >> ( bit & 7 ) ) & mask );
+}
+
+static void bitarray_copybits( u8 *dst, u32 dbit, const u8 *src, u32 srclen, u32 sbit, u32 nbits )
+{
+  u32 head, nbytes, i;
+
+  if( nbits == 0 )
+    return;
+  if( ( ( dbit | sbit ) & 7 ) == 0 )
+  {
+    // Keep the order of the partial last byte and the move safe for overlaps
+    if( ( nbits & 7 ) && dbit > sbit )
+      bitarray_put( dst, dbit + ( nbits & ~7 ), nbits & 7, src[ ( sbit + nbits ) >> 3 ] );
+    memmove( dst + ( dbit >> 3 ), src + ( sbit >> 3 ), nbits >> 3 );
+    if( ( nbits & 7 ) && dbit <= sbit )
+      bitarray_put( dst, dbit + ( nbits & ~7 ), nbits & 7, src[ ( sbit + nbits ) >> 3 ] );
+    return;
+  }
+  // Partial first byte of 'dst', whole bytes, partial last byte
+  head = UMIN( ( 8 - ( dbit & 7 ) ) & 7, nbits );
+  nbytes = ( nbits - head ) >> 3;
+  if( dst != src || dbit < sbit )
+  {
+    if( head )
+      bitarray_put( dst, dbit, head, bitarray_get8( src, srclen, sbit ) );
+    for( i = 0; i < nbytes; i ++ )
+      dst[ ( ( dbit + head ) >> 3 ) + i ] = bitarray_get8( src, srclen, sbit + head + ( i << 3 ) );
+    if( ( nbits - head ) & 7 )
+      bitarray_put( dst, dbit + head + ( nbytes << 3 ), ( nbits - head ) & 7, bitarray_get8( src, srclen, sbit + head + ( nbytes << 3 ) ) );
+  }
+  else
+  {
+    // Overlapping move towards the end: copy backwards
+    if( ( nbits - head ) & 7 )
+      bitarray_put( dst, dbit + head + ( nbytes << 3 ), ( nbits - head ) & 7, bitarray_get8( src, srclen, sbit + head + ( nbytes << 3 ) ) );
+    for( i = nbytes; i > 0; i -- )
+      dst[ ( ( dbit + head ) >> 3 ) + i - 1 ] = bitarray_get8( src, srclen, sbit + head + ( ( i - 1 ) << 3 ) );
+    if( head )
+      bitarray_put( dst, dbit, head, bitarray_get8( src, srclen, sbit ) );
+  }
+}
+
+// Lua: array = bitarray.fill( array, value, [first], [last] )
+static int bitarray_fill( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L );
+  u32 val = ( u32 )luaL_checkinteger( L, 2 );
+  u32 first, last, epw, pattern, w;
+
+  bitarray_range( L, pa, 3, &first, &last );
+  epw = 32 / pa->elsize;
+  // Word pattern with the value repeated in every element
+  if( pa->elsize < 8 )
+  {
+    val &= bitarray_index_mask[ pa->elsize ];
+    for( pattern = val, w = pa->elsize; w < 8; w <<= 1 )
+      pattern |= pattern << w;
+    pattern *= 0x01010101;
+  }
+  else if( pa->elsize == 8 )
+    pattern = ( val & 0xFF ) * 0x01010101;
+  else if( pa->elsize == 16 )
+    pattern = ( val & 0xFFFF ) * 0x00010001;
+  else
+    pattern = val;
+  for( ; first <= last && ( first - 1 ) % epw; first ++ )
+    bitarray_setval( pa, first, val );
+  for( w = ( first - 1 ) / epw; first + epw - 1 <= last; first += epw )
+    ( ( u32* )pa->values )[ w ++ ] = pattern;
+  for( ; first <= last; first ++ )
+    bitarray_setval( pa, first, val );
+  lua_settop( L, 1 );
+  return 1;
+}
+
+// Helper: combine the values of two arrays of the same shape
+static int bitarray_combine( lua_State *L, int op )
+{
+  bitarray_t *pa = bitarray_check( L ), *pb = NULL;
+  u32 *pd, i, n;
+  const u32 *ps = NULL;
+
+  if( op != '~' )
+  {
+    pb = ( bitarray_t* )luaL_checkudata( L, 2, META_NAME );
+    if( pb->capacity != pa->capacity || pb->elsize != pa->elsize )
+      return luaL_error( L, "arrays differ in size." );
+    ps = ( const u32* )pb->values;
+  }
+  pd = ( u32* )pa->values;
+  n = ROUND_WORDS( ROUND_SIZE( pa->capacity * pa->elsize ) );
+  switch( op )
+  {
+    case '&':
+      for( i = 0; i < n; i ++ )
+        pd[ i ] &= ps[ i ];
+      break;
+
+    case '|':
+      for( i = 0; i < n; i ++ )
+        pd[ i ] |= ps[ i ];
+      break;
+
+    case '^':
+      for( i = 0; i < n; i ++ )
+        pd[ i ] ^= ps[ i ];
+      break;
+
+    default:
+      for( i = 0; i < n; i ++ )
+        pd[ i ] = ~pd[ i ];
+      // Keep the bits after the last element cleared
+      memset( pa->values + ROUND_SIZE( pa->capacity * pa->elsize ), 0, n * 4 - ROUND_SIZE( pa->capacity * pa->elsize ) );
+      bitarray_clear_tail( pa );
+      break;
+  }
+  lua_settop( L, 1 );
+  return 1;
+}
+
+// Lua: a = bitarray.band( a, b ) (a = a AND b, also bor, bxor)
+static int bitarray_band( lua_State *L )
+{
+  return bitarray_combine( L, '&' );
+}
+
+static int bitarray_bor( lua_State *L )
+{
+  return bitarray_combine( L, '|' );
+}
+
+static int bitarray_bxor( lua_State *L )
+{
+  return bitarray_combine( L, '^' );
+}
+
+// Lua: a = bitarray.bnot( a )
+static int bitarray_bnot( lua_State *L )
+{
+  return bitarray_combine( L, '~' );
+}
+
+// Lua: count = bitarray.popcount( array, [first], [last] )
+// Number of non-zero elements (of set bits for a 1 bit array)
+static int bitarray_popcount( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L );
+  u32 first, last, epw, count = 0, nw;
+
+  bitarray_range( L, pa, 2, &first, &last );
+  epw = 32 / pa->elsize;
+  for( ; first <= last && ( first - 1 ) % epw; first ++ )
+    count += bitarray_getval( pa, first ) != 0;
+  nw = ( last + 1 - first ) / epw;
+  count += bitarray_count_words( pa->elsize, ( const u32* )pa->values + ( first - 1 ) / epw, nw );
+  for( first += nw * epw; first <= last; first ++ )
+    count += bitarray_getval( pa, first ) != 0;
+  lua_pushinteger( L, count );
+  return 1;
+}
+
+// Helper: index of the first non-zero ('set' = 1) or zero element from
+// 'first' on, 0 if none
+static u32 bitarray_find( bitarray_t *pa, u32 first, int set )
+{
+  u32 epw = 32 / pa->elsize, nw;
+
+  for( ; first <= pa->capacity && ( first - 1 ) % epw; first ++ )
+    if( ( bitarray_getval( pa, first ) != 0 ) == set )
+      return first;
+  if( first > pa->capacity )
+    return 0;
+  // Skip the words that can't hold the element, then search in the word
+  nw = ROUND_WORDS( ROUND_SIZE( pa->capacity * pa->elsize ) ) - ( first - 1 ) / epw;
+  first += bitarray_skip_words( pa->elsize, ( const u32* )pa->values + ( first - 1 ) / epw, nw, set ) * epw;
+  for( ; first <= pa->capacity; first ++ )
+    if( ( bitarray_getval( pa, first ) != 0 ) == set )
+      return first;
+  return 0;
+}
+
+// Lua: idx = bitarray.find_first_set( array, [first] ) (nil if none)
+static int bitarray_find_first_set( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L );
+  lua_Integer first = luaL_optinteger( L, 2, 1 );
+  u32 res = first < 1 ? 0 : bitarray_find( pa, ( u32 )first, 1 );
+
+  if( res == 0 )
+    lua_pushnil( L );
+  else
+    lua_pushinteger( L, res );
+  return 1;
+}
+
+// Lua: idx = bitarray.find_first_clear( array, [first] ) (nil if none)
+static int bitarray_find_first_clear( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L );
+  lua_Integer first = luaL_optinteger( L, 2, 1 );
+  u32 res = first < 1 ? 0 : bitarray_find( pa, ( u32 )first, 0 );
+
+  if( res == 0 )
+    lua_pushnil( L );
+  else
+    lua_pushinteger( L, res );
+  return 1;
+}
+
+// Lua: array = bitarray.shift( array, n )
+// Moves every element n positions towards the end (towards the start if
+// n is negative), the vacated elements are set to 0
+static int bitarray_shift( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L );
+  lua_Integer n = luaL_checkinteger( L, 2 );
+  u32 size = ROUND_SIZE( pa->capacity * pa->elsize ), k;
+
+  k = ( u32 )( n < 0 ? -n : n );
+  if( k >= pa->capacity )
+    memset( pa->values, 0, size );
+  else if( n > 0 )
+  {
+    bitarray_copybits( pa->values, k * pa->elsize, pa->values, size, 0, ( pa->capacity - k ) * pa->elsize );
+    for( ; k > 0; k -- )
+      bitarray_setval( pa, k, 0 );
+  }
+  else if( n < 0 )
+  {
+    bitarray_copybits( pa->values, 0, pa->values, size, k * pa->elsize, ( pa->capacity - k ) * pa->elsize );
+    for( ; k > 0; k -- )
+      bitarray_setval( pa, pa->capacity - k + 1, 0 );
+  }
+  lua_settop( L, 1 );
+  return 1;
+}
+
+// Lua: newarray = bitarray.slice( array, [first], [last] )
+static int bitarray_slice( lua_State *L )
+{
+  bitarray_t *pa = bitarray_check( L ), *pn;
+  u32 first, last, total;
+
+  bitarray_range( L, pa, 2, &first, &last );
+  if( last < first )
+    return luaL_error( L, "invalid range." );
+  total = ROUND_SIZE( ( last - first + 1 ) * pa->elsize );
+  pn = ( bitarray_t* )lua_newuserdata( L, sizeof( bitarray_t ) + ROUND_WORDS( total ) * 4 - 1 );
+  pn->capacity = last - first + 1;
+  pn->elsize = pa->elsize;
+  memset( pn->values, 0, ROUND_WORDS( total ) * 4 );
+  bitarray_copybits( pn->values, 0, pa->values, ROUND_SIZE( pa->capacity * pa->elsize ), ( first - 1 ) * pa->elsize, pn->capacity * pa->elsize );
+  luaL_getmetatable( L, META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Lua: dst = bitarray.blit( dst, pos, src, [first], [last] )
+// Copies the elements first .. last of src to dst, starting at pos
+static int bitarray_blit( lua_State *L )
+{
+  bitarray_t *pd = bitarray_check( L ), *ps;
+  lua_Integer pos = luaL_checkinteger( L, 2 );
+  u32 first, last;
+
+  ps = ( bitarray_t* )luaL_checkudata( L, 3, META_NAME );
+  if( ps->elsize != pd->elsize )
+    return luaL_error( L, "arrays have different element sizes." );
+  bitarray_range( L, ps, 4, &first, &last );
+  if( pos < 1 || ( u32 )pos - 1 + ( last + 1 - first ) > pd->capacity )
+    return luaL_error( L, "invalid index." );
+  bitarray_copybits( pd->values, ( ( u32 )pos - 1 ) * pd->elsize, ps->values, ROUND_SIZE( ps->capacity * ps->elsize ), ( first - 1 ) * ps->elsize, ( last + 1 - first ) * ps->elsize );
+  lua_settop( L, 1 );
+  return 1;
+}
+
 // Module function map
 #define MIN_OPT_LEVEL 2
 #include "lrodefs.h"
@@ -310,6 +727,17 @@ const LUA_REG_TYPE bitarray_map[] =
   { LSTRKEY( "pairs" ), LFUNCVAL( bitarray_pairs ) },
   { LSTRKEY( "tostring" ), LFUNCVAL( bitarray_tostring ) },
   { LSTRKEY( "totable" ), LFUNCVAL( bitarray_totable ) },
+  { LSTRKEY( "fill" ), LFUNCVAL( bitarray_fill ) },
+  { LSTRKEY( "band" ), LFUNCVAL( bitarray_band ) },
+  { LSTRKEY( "bor" ), LFUNCVAL( bitarray_bor ) },
+  { LSTRKEY( "bxor" ), LFUNCVAL( bitarray_bxor ) },
+  { LSTRKEY( "bnot" ), LFUNCVAL( bitarray_bnot ) },
+  { LSTRKEY( "popcount" ), LFUNCVAL( bitarray_popcount ) },
+  { LSTRKEY( "find_first_set" ), LFUNCVAL( bitarray_find_first_set ) },
+  { LSTRKEY( "find_first_clear" ), LFUNCVAL( bitarray_find_first_clear ) },
+  { LSTRKEY( "shift" ), LFUNCVAL( bitarray_shift ) },
+  { LSTRKEY( "slice" ), LFUNCVAL( bitarray_slice ) },
+  { LSTRKEY( "blit" ), LFUNCVAL( bitarray_blit ) },
   { LNILKEY, LNILVAL } 
 };
 
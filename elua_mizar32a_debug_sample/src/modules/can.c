@@ -6,6 +6,11 @@
 #include "platform.h"
 #include "auxmods.h"
 #include "lrotable.h"
+#include "platform_conf.h"
+#include "common.h"
+#include <string.h>
+
+#define CAN_FRAMES_META_NAME  "eLua.can.frames"
 
 // Lua: result = setup( id, clock )
 static int can_setup( lua_State* L )
@@ -44,38 +49,186 @@ static int can_send( lua_State* L )
   return 1;
 }
 
-// Lua: canid, canidtype, message = recv( id )
+// Lua: canid, canidtype, message, timestamp = recv( id )
+// 'timestamp' is the reception time (system timer, us, lower 32 bits)
 static int can_recv( lua_State* L )
 {
-  u8 len;
   int id;
-  u32 canid;
-  u8  idtype, data[ PLATFORM_CAN_MAXLEN ];
+  cmn_can_frame frame;
   
   id = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( can, id );
   
-  if( platform_can_recv( id, &canid, &idtype, &len, data ) == PLATFORM_OK )
+  if( cmn_can_recv( id, &frame, 1 ) == 1 )
   {
-    lua_pushinteger( L, canid );
-    lua_pushinteger( L, idtype );
-    lua_pushlstring( L, ( const char * )data, ( size_t )len );
+    lua_pushinteger( L, frame.id );
+    lua_pushinteger( L, frame.idtype );
+    lua_pushlstring( L, ( const char * )frame.data, ( size_t )frame.len );
+    lua_pushnumber( L, ( lua_Number )frame.timestamp );
   
-    return 3;
+    return 4;
   }
   else
     return 0;
 }
 
+// Lua: filter( id, [ { canid, mask, [canidtype] }, ... ] )
+// Only the frames that match one of the filters are queued, all frames if
+// there are no filters. A frame matches if ( frameid & mask ) == ( canid & mask )
+// and the ID types are the same (default can.ID_STD).
+static int can_filter( lua_State* L )
+{
+  cmn_can_filter filters[ CAN_MAX_FILTERS ], *pf;
+  unsigned id, n = 0, i;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( can, id );
+  if( !lua_isnoneornil( L, 2 ) )
+  {
+    luaL_checktype( L, 2, LUA_TTABLE );
+    if( ( n = lua_objlen( L, 2 ) ) > CAN_MAX_FILTERS )
+      return luaL_error( L, "too many filters" );
+    for( i = 0, pf = filters; i < n; i ++, pf ++ )
+    {
+      lua_rawgeti( L, 2, i + 1 );
+      if( !lua_istable( L, -1 ) )
+        return luaL_error( L, "invalid filter %d", i + 1 );
+      lua_rawgeti( L, -1, 1 );
+      lua_rawgeti( L, -2, 2 );
+      lua_rawgeti( L, -3, 3 );
+      pf->id = ( u32 )luaL_checknumber( L, -3 );
+      pf->mask = ( u32 )luaL_checknumber( L, -2 );
+      pf->idtype = ( u8 )luaL_optinteger( L, -1, ELUA_CAN_ID_STD );
+      lua_pop( L, 4 );
+    }
+  }
+  if( cmn_can_set_filters( id, filters, n ) != PLATFORM_OK )
+    return luaL_error( L, "too many filters" );
+  return 0;
+}
+
+// Lua: received, filtered, dropped = stats( id, [reset] )
+// 'dropped' counts the frames lost because the receive queue was full
+static int can_stats( lua_State* L )
+{
+  unsigned id;
+  u32 received, filtered, dropped;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( can, id );
+  cmn_can_get_stats( id, &received, &filtered, &dropped, lua_toboolean( L, 2 ) );
+  lua_pushnumber( L, ( lua_Number )received );
+  lua_pushnumber( L, ( lua_Number )filtered );
+  lua_pushnumber( L, ( lua_Number )dropped );
+  return 3;
+}
+
+// ****************************************************************************
+// Frame buffers: packed arrays of frames filled by recvframes
+
+typedef struct
+{
+  unsigned size;
+  unsigned count;
+  cmn_can_frame frames[ 1 ];
+} can_frames_t;
+
+static can_frames_t *can_frames_check( lua_State *L, int idx )
+{
+  return ( can_frames_t* )luaL_checkudata( L, idx, CAN_FRAMES_META_NAME );
+}
+
+// Lua: frames = frames( size )
+static int can_frames( lua_State* L )
+{
+  s32 size = ( s32 )luaL_checkinteger( L, 1 );
+  can_frames_t *pb;
+
+  if( size <= 0 || size > 0xFFFF )
+    return luaL_error( L, "invalid size" );
+  pb = ( can_frames_t* )lua_newuserdata( L, sizeof( can_frames_t ) + ( size - 1 ) * sizeof( cmn_can_frame ) );
+  pb->size = size;
+  pb->count = 0;
+  luaL_getmetatable( L, CAN_FRAMES_META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Wait condition for recvframes: frames in the receive queue
+static int can_recv_cond( void *arg )
+{
+  return cmn_can_get_count( *( unsigned* )arg ) > 0;
+}
+
+// Lua: count = recvframes( id, frames, [timer_id], [timeout] )
+// Moves as many frames as fit from the receive queue to 'frames', waiting
+// up to 'timeout' (us, default 0) for the first one
+static int can_recvframes( lua_State* L )
+{
+  unsigned id, tmr_id;
+  can_frames_t *pb;
+  timer_data_type timeout;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( can, id );
+  pb = can_frames_check( L, 2 );
+  cmn_get_timeout_data( L, 3, &tmr_id, &timeout );
+  if( lua_isnoneornil( L, 4 ) )
+    timeout = 0;
+  pb->count = 0;
+  if( cmn_wait_event( can_recv_cond, &id, tmr_id, timeout ) )
+    pb->count = cmn_can_recv( id, pb->frames, pb->size );
+  lua_pushinteger( L, pb->count );
+  return 1;
+}
+
+// Lua: canid, canidtype, message, timestamp = frames:get( i )
+static int can_frames_get( lua_State* L )
+{
+  can_frames_t *pb = can_frames_check( L, 1 );
+  s32 i = ( s32 )luaL_checkinteger( L, 2 );
+  cmn_can_frame *pf;
+
+  if( i < 1 || i > ( s32 )pb->count )
+    return 0;
+  pf = pb->frames + i - 1;
+  lua_pushinteger( L, pf->id );
+  lua_pushinteger( L, pf->idtype );
+  lua_pushlstring( L, ( const char * )pf->data, ( size_t )pf->len );
+  lua_pushnumber( L, ( lua_Number )pf->timestamp );
+  return 4;
+}
+
+// Lua: n = #frames (number of frames received by the last recvframes)
+static int can_frames_len( lua_State* L )
+{
+  lua_pushinteger( L, can_frames_check( L, 1 )->count );
+  return 1;
+}
+
 
 // Module function map
 #define MIN_OPT_LEVEL 2
 #include "lrodefs.h"
+static const LUA_REG_TYPE can_frames_mt_map[] =
+{
+  { LSTRKEY( "get" ), LFUNCVAL( can_frames_get ) },
+  { LSTRKEY( "__len" ), LFUNCVAL( can_frames_len ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( can_frames_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
 const LUA_REG_TYPE can_map[] = 
 {
   { LSTRKEY( "setup" ),  LFUNCVAL( can_setup ) },
   { LSTRKEY( "send" ),  LFUNCVAL( can_send ) },  
   { LSTRKEY( "recv" ),  LFUNCVAL( can_recv ) },
+  { LSTRKEY( "filter" ),  LFUNCVAL( can_filter ) },
+  { LSTRKEY( "stats" ),  LFUNCVAL( can_stats ) },
+  { LSTRKEY( "frames" ),  LFUNCVAL( can_frames ) },
+  { LSTRKEY( "recvframes" ),  LFUNCVAL( can_recvframes ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "ID_STD" ), LNUMVAL( ELUA_CAN_ID_STD ) },
   { LSTRKEY( "ID_EXT" ), LNUMVAL( ELUA_CAN_ID_EXT ) },
@@ -86,8 +239,16 @@ const LUA_REG_TYPE can_map[] =
 LUALIB_API int luaopen_can( lua_State *L )
 {
 #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, CAN_FRAMES_META_NAME, ( void* )can_frames_mt_map );
   return 0;
 #else // #if LUA_OPTIMIZE_MEMORY > 0
+  // Metatable for the frame buffers
+  luaL_newmetatable( L, CAN_FRAMES_META_NAME );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, can_frames_mt_map );
+  lua_pop( L, 1 );
+
   luaL_register( L, AUXLIB_CAN, can_map );
   
   // Module constants  
@@ -6,6 +6,7 @@
 #include "platform.h"
 #include "auxmods.h"
 #include "lrotable.h"
+#include "common.h"
 #include <string.h>
 
 #define _C( x ) { #x, x }
@@ -163,6 +164,22 @@ static int cpu_clock( lua_State *L )
   return 1;
 }
 
+// Lua: waits, sleeps, idle_us = idlestats( [reset] )
+// Returns the number of blocking waits for an event, the number of times the
+// CPU slept while waiting and the total sleep time in microseconds. The
+// counters are cleared if 'reset' is true.
+static int cpu_idlestats( lua_State *L )
+{
+  u32 waits, sleeps;
+  u64 idle_us;
+
+  cmn_wait_get_stats( &waits, &sleeps, &idle_us, lua_toboolean( L, 1 ) );
+  lua_pushinteger( L, waits );
+  lua_pushinteger( L, sleeps );
+  lua_pushnumber( L, ( lua_Number )idle_us );
+  return 3;
+}
+
 // CPU constants list
 typedef struct
 {
@@ -282,6 +299,7 @@ const LUA_REG_TYPE cpu_map[] =
   { LSTRKEY( "cli" ), LFUNCVAL( cpu_cli ) },
   { LSTRKEY( "sei" ), LFUNCVAL( cpu_sei ) },
   { LSTRKEY( "clock" ), LFUNCVAL( cpu_clock ) },
+  { LSTRKEY( "idlestats" ), LFUNCVAL( cpu_idlestats ) },
 #ifdef BUILD_LUA_INT_HANDLERS
   { LSTRKEY( "set_int_handler" ), LFUNCVAL( cpu_set_int_handler ) },
   { LSTRKEY( "get_int_handler" ), LFUNCVAL( cpu_get_int_handler ) },
@@ -15,6 +15,7 @@
 
 #if defined( USE_MULTIPLE_ALLOCATOR )
 #include "dlmalloc.h"
+#include "elua_heap.h"
 #else
 #include <malloc.h>
 #endif
@@ -38,10 +39,26 @@ static int elua_egc_setup( lua_State *L )
 }
 
 // Lua: heap, inuse = elua.heapstats()
+// Lua: heap, inuse, size, start = elua.heapstats( region ) (only with USE_HEAP_REGIONS)
 static int elua_heapstats( lua_State *L )
 {
 #ifndef USE_SIMPLE_ALLOCATOR // the simple allocator doesn't offer memory usage data
-#ifdef USE_MULTIPLE_ALLOCATOR
+#if defined( USE_HEAP_REGIONS )
+  struct mallinfo m;
+  u32 start, size;
+
+  if( lua_gettop( L ) >= 1 )
+  {
+    if( !elua_heap_get_region_info( luaL_checkinteger( L, 1 ), &start, &size, &m ) )
+      return 0;
+    lua_pushinteger( L, m.arena );
+    lua_pushinteger( L, m.uordblks );
+    lua_pushinteger( L, size );
+    lua_pushinteger( L, start );
+    return 4;
+  }
+  m = elua_heap_mallinfo();
+#elif defined( USE_MULTIPLE_ALLOCATOR )
   struct mallinfo m = dlmallinfo();
 #else
   struct mallinfo m = mallinfo();
@@ -55,6 +72,73 @@ static int elua_heapstats( lua_State *L )
 #endif // #ifndef USE_SIMPLE_ALLOCATOR
 }
 
+#ifdef USE_HEAP_REGIONS
+// Lua: policy, threshold, nregions = elua.heappolicy( [ policy ], [ threshold ] )
+static int elua_heappolicy( lua_State *L )
+{
+  u32 threshold;
+  int policy;
+
+  if( lua_gettop( L ) >= 1 )
+  {
+    policy = luaL_checkinteger( L, 1 );
+    threshold = ( u32 )luaL_optinteger( L, 2, 0 );
+    if( !elua_heap_set_policy( policy, threshold ) )
+      return luaL_error( L, "invalid heap policy" );
+  }
+  policy = elua_heap_get_policy( &threshold );
+  lua_pushinteger( L, policy );
+  lua_pushinteger( L, threshold );
+  lua_pushinteger( L, elua_heap_get_num_regions() );
+  return 3;
+}
+#endif // #ifdef USE_HEAP_REGIONS
+
+// Lua: hits, misses = elua.icstats( [ reset ] )
+// Returns the hit/miss counters of the VM inline caches, optionally resetting them
+static int elua_icstats( lua_State *L )
+{
+  unsigned long hits, misses;
+
+  lua_geticstats( L, &hits, &misses, lua_toboolean( L, 1 ) );
+  lua_pushnumber( L, ( lua_Number )hits );
+  lua_pushnumber( L, ( lua_Number )misses );
+  return 2;
+}
+
+// Lua: size, nuse, maxchain, empty = elua.strstats()
+// Returns the number of buckets and strings of the string table, the length
+// of its longest chain and the number of empty buckets
+static int elua_strstats( lua_State *L )
+{
+  int size, nuse, maxchain, empty;
+
+  lua_getstrstats( L, &size, &nuse, &maxchain, &empty );
+  lua_pushinteger( L, size );
+  lua_pushinteger( L, nuse );
+  lua_pushinteger( L, maxchain );
+  lua_pushinteger( L, empty );
+  return 4;
+}
+
+#if ( defined( BUILD_WOFS ) || defined( BUILD_NIFFS ) ) && !defined( ELUA_CPU_LINUX )
+// Lua: writes, bytes, programs, programmed = elua.flashstats( [ reset ] )
+// Returns the number of internal flash writes and bytes requested by the
+// file systems, and the number of flash program operations and bytes they
+// turned into, optionally resetting the counters
+static int elua_flashstats( lua_State *L )
+{
+  u32 writes, bytes, programs, programmed;
+
+  platform_flash_get_stats( &writes, &bytes, &programs, &programmed, lua_toboolean( L, 1 ) );
+  lua_pushinteger( L, writes );
+  lua_pushinteger( L, bytes );
+  lua_pushinteger( L, programs );
+  lua_pushinteger( L, programmed );
+  return 4;
+}
+#endif
+
 // Lua: elua.version()
 static int elua_version( lua_State *L )
 {
@@ -113,6 +197,14 @@ const LUA_REG_TYPE elua_map[] =
   { LSTRKEY( "egc_setup" ), LFUNCVAL( elua_egc_setup ) },
   { LSTRKEY( "heapstats" ), LFUNCVAL( elua_heapstats ) },
   { LSTRKEY( "version" ), LFUNCVAL( elua_version ) },
+#ifdef USE_HEAP_REGIONS
+  { LSTRKEY( "heappolicy" ), LFUNCVAL( elua_heappolicy ) },
+#endif
+  { LSTRKEY( "icstats" ), LFUNCVAL( elua_icstats ) },
+  { LSTRKEY( "strstats" ), LFUNCVAL( elua_strstats ) },
+#if ( defined( BUILD_WOFS ) || defined( BUILD_NIFFS ) ) && !defined( ELUA_CPU_LINUX )
+  { LSTRKEY( "flashstats" ), LFUNCVAL( elua_flashstats ) },
+#endif
   { LSTRKEY( "save_history" ), LFUNCVAL( elua_save_history ) },
 #ifdef BUILD_SHELL
   { LSTRKEY( "shell" ), LFUNCVAL( elua_shell ) },
@@ -122,6 +214,11 @@ const LUA_REG_TYPE elua_map[] =
   { LSTRKEY( "EGC_ON_ALLOC_FAILURE" ), LNUMVAL( EGC_ON_ALLOC_FAILURE ) },
   { LSTRKEY( "EGC_ON_MEM_LIMIT" ), LNUMVAL( EGC_ON_MEM_LIMIT ) },
   { LSTRKEY( "EGC_ALWAYS" ), LNUMVAL( EGC_ALWAYS ) },
+#ifdef USE_HEAP_REGIONS
+  { LSTRKEY( "HEAP_FAST_FIRST" ), LNUMVAL( ELUA_HEAP_POLICY_FAST_FIRST ) },
+  { LSTRKEY( "HEAP_SPLIT" ), LNUMVAL( ELUA_HEAP_POLICY_SPLIT ) },
+  { LSTRKEY( "HEAP_SLOW_FIRST" ), LNUMVAL( ELUA_HEAP_POLICY_SLOW_FIRST ) },
+#endif
 #endif
   { LNILKEY, LNILVAL }
 };
@@ -136,6 +233,11 @@ LUALIB_API int luaopen_elua( lua_State *L )
   MOD_REG_NUMBER( L, "EGC_ON_ALLOC_FAILURE", EGC_ON_ALLOC_FAILURE );
   MOD_REG_NUMBER( L, "EGC_ON_MEM_LIMIT", EGC_ON_MEM_LIMIT );
   MOD_REG_NUMBER( L, "EGC_ALWAYS", EGC_ALWAYS );
+#ifdef USE_HEAP_REGIONS
+  MOD_REG_NUMBER( L, "HEAP_FAST_FIRST", ELUA_HEAP_POLICY_FAST_FIRST );
+  MOD_REG_NUMBER( L, "HEAP_SPLIT", ELUA_HEAP_POLICY_SPLIT );
+  MOD_REG_NUMBER( L, "HEAP_SLOW_FIRST", ELUA_HEAP_POLICY_SLOW_FIRST );
+#endif
   return 1;
 #endif
 }
@@ -6,9 +6,12 @@
 #include "platform.h"
 #include "auxmods.h"
 #include "lrotable.h"
+#include "utils.h"
 #include <string.h>
 #include <ctype.h>
 
+#define I2C_POLLIST_META_NAME "eLua.i2c.pollist"
+
 // Lua: speed = i2c.setup( id, speed )
 static int i2c_setup( lua_State *L )
 {
@@ -136,9 +139,261 @@ static int i2c_read( lua_State *L )
   return 1;
 }
 
+// Helper: converts the data argument at 'idx' (an 8-bit number, a table of
+// 8-bit numbers or a string) to a string in place and returns it
+static const u8* i2ch_check_wdata( lua_State *L, int idx, size_t *plen )
+{
+  luaL_Buffer b;
+  size_t datalen, i;
+  int numdata;
+
+  if( idx < 0 )
+    idx = lua_gettop( L ) + idx + 1;
+  if( lua_isnoneornil( L, idx ) )
+  {
+    *plen = 0;
+    return NULL;
+  }
+  if( lua_type( L, idx ) == LUA_TNUMBER || lua_istable( L, idx ) )
+  {
+    luaL_buffinit( L, &b );
+    datalen = lua_istable( L, idx ) ? lua_objlen( L, idx ) : 1;
+    for( i = 0; i < datalen; i ++ )
+    {
+      if( lua_istable( L, idx ) )
+      {
+        lua_rawgeti( L, idx, i + 1 );
+        numdata = ( int )luaL_checkinteger( L, -1 );
+        lua_pop( L, 1 );
+      }
+      else
+        numdata = ( int )luaL_checkinteger( L, idx );
+      if( numdata < 0 || numdata > 255 )
+        luaL_error( L, "numeric data must be from 0 to 255" );
+      luaL_addchar( &b, ( char )numdata );
+    }
+    luaL_pushresult( &b );
+    lua_replace( L, idx );
+  }
+  return ( const u8* )luaL_checklstring( L, idx, plen );
+}
+
+// Helper: check a 7-bit slave address
+static u16 i2ch_check_address( lua_State *L, int address )
+{
+  if( address < 0 || address > 127 )
+    luaL_error( L, "slave address must be from 0 to 127" );
+  return ( u16 )address;
+}
+
+// Lua: data = i2c.transfer( id, address, [wdata], [rlen] )
+// Writes 'wdata' (an 8-bit number such as a register address, a table or a
+// string) to the slave, then reads 'rlen' bytes after a repeated start, all
+// in a single transaction. Returns the data read as a string ("" if 'rlen'
+// is 0) or nil if the slave didn't acknowledge.
+static int i2c_transfer( lua_State *L )
+{
+  unsigned id = luaL_checkinteger( L, 1 );
+  u16 address = i2ch_check_address( L, luaL_checkinteger( L, 2 ) );
+  s32 rlen = ( s32 )luaL_optinteger( L, 4, 0 );
+  const u8 *wdata;
+  size_t wlen;
+  u8 *rdata;
+  luaL_Buffer b;
+
+  MOD_CHECK_ID( i2c, id );
+  if( rlen < 0 )
+    return luaL_error( L, "invalid read size" );
+  wdata = i2ch_check_wdata( L, 3, &wlen );
+  // Small reads go straight into a Lua buffer, larger ones into a userdata
+  luaL_buffinit( L, &b );
+  if( rlen <= LUAL_BUFFERSIZE )
+    rdata = ( u8* )luaL_prepbuffer( &b );
+  else
+    rdata = ( u8* )lua_newuserdata( L, rlen );
+  if( platform_i2c_transfer( id, address, wdata, wlen, rdata, rlen ) < 0 )
+  {
+    lua_pushnil( L );
+    return 1;
+  }
+  if( rlen <= LUAL_BUFFERSIZE )
+  {
+    luaL_addsize( &b, rlen );
+    luaL_pushresult( &b );
+  }
+  else
+    lua_pushlstring( L, ( const char* )rdata, rlen );
+  return 1;
+}
+
+// ****************************************************************************
+// Poll lists: a set of sensor reads prepared once and run from C
+
+typedef struct
+{
+  u16 address;
+  u16 every;                  // poll every 'every' runs
+  u16 countdown;              // runs left until the next poll
+  u16 wlen, rlen;
+  u16 woffs;                  // offset of the write data in 'data'
+} i2c_poll_entry;
+
+typedef struct
+{
+  unsigned id;
+  unsigned nentries;
+  u32 runs, errors;
+  u8 *data;                   // write data of all the entries
+  u8 *rbuf;                   // read buffer, after the write data
+  i2c_poll_entry entries[ 1 ];
+} i2c_pollist_t;
+
+// Lua: plist = i2c.pollist( id, { { address, [wdata], rlen, [every] }, ... } )
+// Each entry is a read of 'rlen' bytes after writing 'wdata' (usually the
+// register address, see i2c.transfer), done once every 'every' runs
+// (default 1)
+static int i2c_pollist( lua_State *L )
+{
+  unsigned id = luaL_checkinteger( L, 1 );
+  unsigned n, i, wtotal = 0, maxrlen = 0;
+  i2c_pollist_t *pl;
+  i2c_poll_entry *pe;
+  const u8 *wdata;
+  size_t wlen;
+  s32 rlen, every;
+
+  MOD_CHECK_ID( i2c, id );
+  luaL_checktype( L, 2, LUA_TTABLE );
+  if( ( n = lua_objlen( L, 2 ) ) == 0 )
+    return luaL_error( L, "empty poll list" );
+  // First pass: validate the entries and size the object
+  for( i = 1; i <= n; i ++ )
+  {
+    lua_rawgeti( L, 2, i );
+    if( !lua_istable( L, -1 ) )
+      return luaL_error( L, "invalid entry %d", i );
+    lua_rawgeti( L, -1, 1 );
+    i2ch_check_address( L, luaL_checkinteger( L, -1 ) );
+    lua_rawgeti( L, -2, 2 );
+    i2ch_check_wdata( L, -1, &wlen );
+    lua_rawgeti( L, -3, 3 );
+    rlen = ( s32 )luaL_checkinteger( L, -1 );
+    lua_rawgeti( L, -4, 4 );
+    every = ( s32 )luaL_optinteger( L, -1, 1 );
+    if( wlen > 0xFFFF || rlen <= 0 || rlen > 0xFFFF || every <= 0 || every > 0xFFFF )
+      return luaL_error( L, "invalid entry %d", i );
+    // The write data offsets are kept in 16 bits
+    if( ( wtotal += wlen ) > 0xFFFF )
+      return luaL_error( L, "too much write data" );
+    maxrlen = UMAX( maxrlen, ( unsigned )rlen );
+    lua_pop( L, 5 );
+  }
+  pl = ( i2c_pollist_t* )lua_newuserdata( L, sizeof( i2c_pollist_t ) + ( n - 1 ) * sizeof( i2c_poll_entry ) + wtotal + maxrlen );
+  pl->id = id;
+  pl->nentries = n;
+  pl->runs = pl->errors = 0;
+  pl->data = ( u8* )( pl->entries + n );
+  for( i = 0, wtotal = 0, pe = pl->entries; i < n; i ++, pe ++ )
+  {
+    lua_rawgeti( L, 2, i + 1 );
+    lua_rawgeti( L, -1, 1 );
+    pe->address = ( u16 )lua_tointeger( L, -1 );
+    lua_rawgeti( L, -2, 2 );
+    wdata = i2ch_check_wdata( L, -1, &wlen );
+    lua_rawgeti( L, -3, 3 );
+    pe->rlen = ( u16 )lua_tointeger( L, -1 );
+    lua_rawgeti( L, -4, 4 );
+    pe->every = ( u16 )luaL_optinteger( L, -1, 1 );
+    lua_pop( L, 5 );
+    pe->countdown = 0;
+    pe->wlen = ( u16 )wlen;
+    pe->woffs = ( u16 )wtotal;
+    if( wlen > 0 )
+      memcpy( pl->data + wtotal, wdata, wlen );
+    wtotal += wlen;
+  }
+  pl->rbuf = pl->data + wtotal;
+  luaL_getmetatable( L, I2C_POLLIST_META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Lua: results, npolled = plist:run( [results] )
+// Polls the entries that are due in this run and stores the data read
+// from entry i in results[ i ] ('false' if the slave didn't acknowledge).
+// The results of the entries that are not due are left as they are.
+// 'results' is reused if given so repeated runs don't create new tables.
+static int i2c_pollist_run( lua_State *L )
+{
+  i2c_pollist_t *pl = ( i2c_pollist_t* )luaL_checkudata( L, 1, I2C_POLLIST_META_NAME );
+  i2c_poll_entry *pe;
+  unsigned i, npolled = 0;
+
+  if( lua_istable( L, 2 ) )
+    lua_settop( L, 2 );
+  else
+  {
+    lua_settop( L, 1 );
+    lua_createtable( L, pl->nentries, 0 );
+  }
+  for( i = 0, pe = pl->entries; i < pl->nentries; i ++, pe ++ )
+  {
+    if( pe->countdown > 0 )
+    {
+      pe->countdown --;
+      continue;
+    }
+    pe->countdown = pe->every - 1;
+    npolled ++;
+    if( platform_i2c_transfer( pl->id, pe->address, pl->data + pe->woffs, pe->wlen, pl->rbuf, pe->rlen ) < 0 )
+    {
+      pl->errors ++;
+      lua_pushboolean( L, 0 );
+    }
+    else
+      lua_pushlstring( L, ( const char* )pl->rbuf, pe->rlen );
+    lua_rawseti( L, 2, i + 1 );
+  }
+  pl->runs ++;
+  lua_pushinteger( L, npolled );
+  return 2;
+}
+
+// Lua: runs, errors = plist:stats( [reset] )
+static int i2c_pollist_stats( lua_State *L )
+{
+  i2c_pollist_t *pl = ( i2c_pollist_t* )luaL_checkudata( L, 1, I2C_POLLIST_META_NAME );
+
+  lua_pushinteger( L, pl->runs );
+  lua_pushinteger( L, pl->errors );
+  if( lua_toboolean( L, 2 ) )
+    pl->runs = pl->errors = 0;
+  return 2;
+}
+
+// Lua: n = #plist
+static int i2c_pollist_len( lua_State *L )
+{
+  i2c_pollist_t *pl = ( i2c_pollist_t* )luaL_checkudata( L, 1, I2C_POLLIST_META_NAME );
+
+  lua_pushinteger( L, pl->nentries );
+  return 1;
+}
+
 // Module function map
 #define MIN_OPT_LEVEL   2
 #include "lrodefs.h"
+static const LUA_REG_TYPE i2c_pollist_mt_map[] =
+{
+  { LSTRKEY( "run" ), LFUNCVAL( i2c_pollist_run ) },
+  { LSTRKEY( "stats" ), LFUNCVAL( i2c_pollist_stats ) },
+  { LSTRKEY( "__len" ), LFUNCVAL( i2c_pollist_len ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( i2c_pollist_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
 const LUA_REG_TYPE i2c_map[] = 
 {
   { LSTRKEY( "setup" ),  LFUNCVAL( i2c_setup ) },
@@ -147,6 +402,8 @@ const LUA_REG_TYPE i2c_map[] =
   { LSTRKEY( "address" ), LFUNCVAL( i2c_address ) },
   { LSTRKEY( "write" ), LFUNCVAL( i2c_write ) },
   { LSTRKEY( "read" ), LFUNCVAL( i2c_read ) },
+  { LSTRKEY( "transfer" ), LFUNCVAL( i2c_transfer ) },
+  { LSTRKEY( "pollist" ), LFUNCVAL( i2c_pollist ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "FAST" ), LNUMVAL( PLATFORM_I2C_SPEED_FAST ) },
   { LSTRKEY( "SLOW" ), LNUMVAL( PLATFORM_I2C_SPEED_SLOW ) },
@@ -159,8 +416,16 @@ const LUA_REG_TYPE i2c_map[] =
 LUALIB_API int luaopen_i2c( lua_State *L )
 {
 #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, I2C_POLLIST_META_NAME, ( void* )i2c_pollist_mt_map );
   return 0;
 #else // #if LUA_OPTIMIZE_MEMORY > 0
+  // Metatable for the poll list objects
+  luaL_newmetatable( L, I2C_POLLIST_META_NAME );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, i2c_pollist_mt_map );
+  lua_pop( L, 1 );
+
   luaL_register( L, AUXLIB_I2C, i2c_map );
   
   // Add the stop bits and parity constants (for i2c.setup)
@@ -31,6 +31,7 @@
 #define OP_NATIVE       '='             /* native endian */
 
 #include <ctype.h>
+#include <limits.h>
 #include <string.h>
 
 #include "lualib.h"
@@ -45,6 +46,29 @@ static void badcode(lua_State *L, int c)
  luaL_argerror(L,1,s);
 }
 
+static void toolarge(lua_State *L)
+{
+ luaL_error(L,"format too large");
+}
+
+static int getcount(lua_State *L, const char **pf) /* repeat count, 1 if none */
+{
+ const char *f=*pf;
+ int N=1;
+ if (isdigit((unsigned char)(*f)))
+ {
+  N=0;
+  while (isdigit((unsigned char)(*f)))
+  {
+   int d=(*f++)-'0';
+   if (N>(INT_MAX-d)/10) toolarge(L);
+   N=10*N+d;
+  }
+ }
+ *pf=f;
+ return N;
+}
+
 static int doendian(int c)
 {
  int x=1;
@@ -90,7 +114,7 @@ static void doswap(int swap, void *p, size_t n)
     if (((unsigned long)i+m)>len) goto done;    \
     memcpy(&l,s+i,m);                           \
     doswap(swap,&l,m);                          \
-    if (((unsigned long)i+m+l)>len) goto done;  \
+    if (l>len-(unsigned long)i-m) goto done;    \
     i+=m;                                       \
     lua_pushlstring(L,s+i,l);                   \
     i+=l;                                       \
@@ -110,13 +134,8 @@ static int l_unpack(lua_State *L)               /** unpack(s,f,[init]) */
  while (*f)
  {
   int c=*f++;
-  int N=1;
-  if (isdigit((unsigned char)(*f)))
-  {
-   N=0;
-   while (isdigit((unsigned char)(*f))) N=10*N+(*f++)-'0';
-   if (N==0 && c==OP_STRING) { lua_pushliteral(L,""); ++n; }
-  }
+  int N=getcount(L,&f);
+  if (N==0 && c==OP_STRING) { lua_pushliteral(L,""); ++n; }
   while (N--) switch (c)
   {
    case OP_LITTLEENDIAN:
@@ -207,12 +226,7 @@ static int l_pack(lua_State *L)                 /** pack(f,...) */
  while (*f)
  {
   int c=*f++;
-  int N=1;
-  if (isdigit((unsigned char)(*f)))
-  {
-   N=0;
-   while (isdigit((unsigned char)(*f))) N=10*N+(*f++)-'0';
-  }
+  int N=getcount(L,&f);
   while (N--) switch (c)
   {
    case OP_LITTLEENDIAN:
@@ -258,16 +272,503 @@ static int l_pack(lua_State *L)                 /** pack(f,...) */
  return 1;
 }
 
+
+/*
+* Codecs: a format compiled once by pack.compile and used for many records.
+* The fields are parsed in advance and the size of a record is known when
+* the format has no variable length strings. In a codec `An' is a string
+* field of exactly n bytes (padded with zeros or truncated when packing).
+*/
+
+#define CODEC_META      "eLua.pack.codec"
+#define BUFFER_META     "eLua.pack.buffer"
+#define CODEC_MAXSIZE   (~(size_t)0)            /* largest record size */
+
+typedef struct
+{
+ char op;
+ char swap;
+ int n;                                 /* count, or length of an `A' field */
+} codec_field;
+
+typedef struct
+{
+ size_t size;                           /* size of a record (if fixed) */
+ int fixed;                             /* no variable length fields? */
+ int nvalues;                           /* values in a record */
+ int nfields;
+ codec_field f[1];
+} codec_t;
+
+typedef struct
+{
+ size_t size;
+ char data[1];
+} pbuffer_t;
+
+static size_t opsize(int c)             /* size of a number field, 0 if not a number */
+{
+ switch (c)
+ {
+  case OP_NUMBER: return sizeof(lua_Number);
+#ifndef LUA_NUMBER_INTEGRAL
+  case OP_DOUBLE: return sizeof(double);
+  case OP_FLOAT: return sizeof(float);
+#endif
+  case OP_CHAR: return sizeof(char);
+  case OP_BYTE: return sizeof(unsigned char);
+  case OP_SHORT: return sizeof(short);
+  case OP_USHORT: return sizeof(unsigned short);
+  case OP_INT: return sizeof(int);
+  case OP_UINT: return sizeof(unsigned int);
+  case OP_LONG: return sizeof(long);
+  case OP_ULONG: return sizeof(unsigned long);
+  default: return 0;
+ }
+}
+
+#define GETNUMBER(OP,T)                         \
+   case OP:                                     \
+   {                                            \
+    T a;                                        \
+    memcpy(&a,p,sizeof(a));                     \
+    doswap(swap,&a,sizeof(a));                  \
+    return (lua_Number)a;                       \
+   }
+
+static lua_Number getnumber(int op, int swap, const char *p)
+{
+ switch (op)
+ {
+  GETNUMBER(OP_NUMBER, lua_Number)
+#ifndef LUA_NUMBER_INTEGRAL
+  GETNUMBER(OP_DOUBLE, double)
+  GETNUMBER(OP_FLOAT, float)
+#endif
+  GETNUMBER(OP_CHAR, char)
+  GETNUMBER(OP_BYTE, unsigned char)
+  GETNUMBER(OP_SHORT, short)
+  GETNUMBER(OP_USHORT, unsigned short)
+  GETNUMBER(OP_INT, int)
+  GETNUMBER(OP_UINT, unsigned int)
+  GETNUMBER(OP_LONG, long)
+  GETNUMBER(OP_ULONG, unsigned long)
+ }
+ return 0;
+}
+
+#define PUTNUMBER(OP,T)                         \
+   case OP:                                     \
+   {                                            \
+    T a=(T)v;                                   \
+    doswap(swap,&a,sizeof(a));                  \
+    memcpy(p,&a,sizeof(a));                     \
+    break;                                      \
+   }
+
+static void putnumber(int op, int swap, lua_Number v, char *p)
+{
+ switch (op)
+ {
+  PUTNUMBER(OP_NUMBER, lua_Number)
+#ifndef LUA_NUMBER_INTEGRAL
+  PUTNUMBER(OP_DOUBLE, double)
+  PUTNUMBER(OP_FLOAT, float)
+#endif
+  PUTNUMBER(OP_CHAR, char)
+  PUTNUMBER(OP_BYTE, unsigned char)
+  PUTNUMBER(OP_SHORT, short)
+  PUTNUMBER(OP_USHORT, unsigned short)
+  PUTNUMBER(OP_INT, int)
+  PUTNUMBER(OP_UINT, unsigned int)
+  PUTNUMBER(OP_LONG, long)
+  PUTNUMBER(OP_ULONG, unsigned long)
+ }
+}
+
+static int l_compile(lua_State *L)              /** compile(f) */
+{
+ const char *f=luaL_checkstring(L,1);
+ const char *p;
+ int nf=0, swap=0;
+ codec_t *k;
+ for (p=f; *p; )                                /* validate and count the fields */
+ {
+  int c=*p++;
+  while (isdigit((unsigned char)(*p))) p++;
+  switch (c)
+  {
+   case OP_LITTLEENDIAN: case OP_BIGENDIAN: case OP_NATIVE:
+   case ' ': case ',':
+    break;
+   case OP_STRING: case OP_ZSTRING: case OP_BSTRING: case OP_WSTRING: case OP_SSTRING:
+    nf++;
+    break;
+   default:
+    if (opsize(c)==0) badcode(L,c);
+    nf++;
+    break;
+  }
+ }
+ k=(codec_t*)lua_newuserdata(L,sizeof(codec_t)+(nf>1 ? nf-1 : 0)*sizeof(codec_field));
+ k->size=0;
+ k->fixed=1;
+ k->nvalues=0;
+ k->nfields=0;
+ for (p=f; *p; )
+ {
+  int c=*p++;
+  int N=getcount(L,&p);
+  codec_field *fl;
+  if (c==OP_LITTLEENDIAN || c==OP_BIGENDIAN || c==OP_NATIVE)
+  {
+   swap=doendian(c);
+   continue;
+  }
+  if (c==' ' || c==',') continue;
+  fl=&k->f[k->nfields++];
+  fl->op=c;
+  fl->swap=swap;
+  fl->n=N;
+  if (c==OP_STRING)
+  {
+   if ((size_t)N>CODEC_MAXSIZE-k->size || k->nvalues==INT_MAX) toolarge(L);
+   k->size+=N;
+   k->nvalues++;
+  }
+  else
+  {
+   if ((opsize(c)>0 && (size_t)N>(CODEC_MAXSIZE-k->size)/opsize(c)) || N>INT_MAX-k->nvalues) toolarge(L);
+   k->size+=N*opsize(c);
+   k->nvalues+=N;
+   if (opsize(c)==0) k->fixed=0;
+  }
+ }
+ luaL_getmetatable(L,CODEC_META);
+ lua_setmetatable(L,-2);
+ return 1;
+}
+
+#define codec_check(L)  ((codec_t*)luaL_checkudata(L,1,CODEC_META))
+
+static const char *getsource(lua_State *L, int idx, size_t *len)
+{
+ if (lua_type(L,idx)==LUA_TUSERDATA)
+ {
+  pbuffer_t *b=(pbuffer_t*)luaL_checkudata(L,idx,BUFFER_META);
+  *len=b->size;
+  return b->data;
+ }
+ return luaL_checklstring(L,idx,len);
+}
+
+/* offset of the init argument at idx, counting from the end if negative like string.sub */
+static size_t getinit(lua_State *L, int idx, size_t len)
+{
+ lua_Integer i=luaL_optinteger(L,idx,1);
+ if (i<0) i+=(lua_Integer)len+1;
+ if (i<1) return 0;
+ return (size_t)i-1>len ? len : (size_t)i-1;
+}
+
+#define UNPACKSTRFIELD(OP,T)                    \
+    case OP:                                    \
+     for (r=0; r<fl->n; r++)                    \
+     {                                          \
+      T l;                                      \
+      if (i+sizeof(l)>len) goto fail;           \
+      memcpy(&l,s+i,sizeof(l));                 \
+      doswap(fl->swap,&l,sizeof(l));            \
+      if (l>len-i-sizeof(l)) goto fail;         \
+      i+=sizeof(l);                             \
+      lua_pushlstring(L,s+i,l);                 \
+      i+=l;                                     \
+      n++;                                      \
+     }                                          \
+     break;
+
+/* pushes the values of the record at s+*pi; pushes nothing and returns 0 if s is too short */
+static int unpackrecord(lua_State *L, const codec_t *k, const char *s, size_t len, size_t *pi)
+{
+ size_t i=*pi, m;
+ int j, r, n=0;
+ if (k->fixed && k->size>len-i) return 0;
+ luaL_checkstack(L,k->nvalues,"too many values");
+ for (j=0; j<k->nfields; j++)
+ {
+  const codec_field *fl=&k->f[j];
+  if ((m=opsize(fl->op))!=0)
+  {
+   for (r=0; r<fl->n; r++, i+=m)
+   {
+    if (i+m>len) goto fail;
+    lua_pushnumber(L,getnumber(fl->op,fl->swap,s+i));
+   }
+   n+=fl->n;
+  }
+  else switch (fl->op)
+  {
+   case OP_STRING:
+    if (i+fl->n>len) goto fail;
+    lua_pushlstring(L,s+i,fl->n);
+    i+=fl->n;
+    n++;
+    break;
+   case OP_ZSTRING:
+    for (r=0; r<fl->n; r++)
+    {
+     const char *e;
+     if (i>=len) goto fail;
+     e=(const char*)memchr(s+i,0,len-i);
+     m=e ? (size_t)(e-(s+i)) : len-i;
+     lua_pushlstring(L,s+i,m);
+     i+=m+1;
+     n++;
+    }
+    break;
+   UNPACKSTRFIELD(OP_BSTRING, unsigned char)
+   UNPACKSTRFIELD(OP_WSTRING, unsigned short)
+   UNPACKSTRFIELD(OP_SSTRING, size_t)
+  }
+ }
+ *pi=i;
+ return n;
+fail:
+ lua_pop(L,n);
+ return 0;
+}
+
+static char *emit(luaL_Buffer *b, char *d, const void *p, size_t n)
+{
+ if (d==NULL)
+ {
+  luaL_addlstring(b,(const char*)p,n);
+  return NULL;
+ }
+ memcpy(d,p,n);
+ return d+n;
+}
+
+#define PACKSTRFIELD(OP,T)                      \
+    case OP:                                    \
+     for (r=0; r<fl->n; r++)                    \
+     {                                          \
+      size_t l;                                 \
+      const char *a=luaL_checklstring(L,arg++,&l); \
+      T ll=(T)l;                                \
+      doswap(fl->swap,&ll,sizeof(ll));          \
+      d=emit(b,d,&ll,sizeof(ll));               \
+      d=emit(b,d,a,l);                          \
+     }                                          \
+     break;
+
+/* packs the values from stack index `arg' on to `b' or, if not NULL, to `d' */
+static void packrecord(lua_State *L, const codec_t *k, int arg, luaL_Buffer *b, char *d)
+{
+ union { lua_Number n; double d; long l; } num;  /* aligned room for any number */
+ int j, r;
+ size_t m;
+ for (j=0; j<k->nfields; j++)
+ {
+  const codec_field *fl=&k->f[j];
+  if ((m=opsize(fl->op))!=0)
+  {
+   for (r=0; r<fl->n; r++)
+   {
+    putnumber(fl->op,fl->swap,luaL_checknumber(L,arg++),(char*)&num);
+    d=emit(b,d,&num,m);
+   }
+  }
+  else switch (fl->op)
+  {
+   case OP_STRING:
+   {
+    size_t l;
+    const char *a=luaL_checklstring(L,arg++,&l);
+    if (l>(size_t)fl->n) l=fl->n;
+    d=emit(b,d,a,l);
+    for (; l<(size_t)fl->n; l++) d=emit(b,d,"",1);
+    break;
+   }
+   case OP_ZSTRING:
+    for (r=0; r<fl->n; r++)
+    {
+     size_t l;
+     const char *a=luaL_checklstring(L,arg++,&l);
+     d=emit(b,d,a,l+1);
+    }
+    break;
+   PACKSTRFIELD(OP_BSTRING, unsigned char)
+   PACKSTRFIELD(OP_WSTRING, unsigned short)
+   PACKSTRFIELD(OP_SSTRING, size_t)
+  }
+ }
+}
+
+static int c_pack(lua_State *L)                 /** codec:pack(...) */
+{
+ codec_t *k=codec_check(L);
+ luaL_Buffer b;
+ luaL_buffinit(L,&b);
+ packrecord(L,k,2,&b,NULL);
+ luaL_pushresult(&b);
+ return 1;
+}
+
+static int c_packinto(lua_State *L)             /** codec:packinto(buf,pos,...) */
+{
+ codec_t *k=codec_check(L);
+ pbuffer_t *b=(pbuffer_t*)luaL_checkudata(L,2,BUFFER_META);
+ lua_Integer pos=luaL_checkinteger(L,3);
+ if (!k->fixed) luaL_argerror(L,1,"codec has a variable size");
+ if (pos<1 || k->size>b->size || (size_t)pos-1>b->size-k->size) luaL_argerror(L,3,"out of buffer");
+ packrecord(L,k,4,NULL,b->data+pos-1);
+ lua_pushinteger(L,pos+k->size);
+ return 1;
+}
+
+static int c_unpack(lua_State *L)               /** codec:unpack(s,[init]) like unpack */
+{
+ codec_t *k=codec_check(L);
+ size_t len, i;
+ const char *s=getsource(L,2,&len);
+ int n;
+ i=getinit(L,3,len);
+ lua_pushnil(L);                                /* room for the next position */
+ n=unpackrecord(L,k,s,len,&i);
+ if (n==0 && k->nvalues>0) return 1;            /* nil: too short */
+ lua_pushinteger(L,i+1);
+ lua_replace(L,-n-2);
+ return n+1;
+}
+
+static int c_unpackall(lua_State *L)            /** codec:unpackall(s,[init],[max],[t]) */
+{
+ codec_t *k=codec_check(L);
+ size_t len, i;
+ const char *s=getsource(L,2,&len);
+ int max, nrec;
+ i=getinit(L,3,len);
+ max=luaL_optint(L,4,INT_MAX);
+ if (k->fixed && k->size>0 && (size_t)max>(len-i)/k->size) max=(int)((len-i)/k->size);
+ if (k->nvalues==0 || (k->fixed && k->size==0)) max=0;
+ if (lua_istable(L,5))
+ {
+  lua_settop(L,5);
+  lua_cleartable(L,5);                          /* reuse the table, keeping its storage */
+ }
+ else
+ {
+  lua_settop(L,4);
+  lua_createtable(L,k->fixed ? max*k->nvalues : 0,0);
+ }
+ for (nrec=0; nrec<max; )
+ {
+  size_t start=i;
+  if (unpackrecord(L,k,s,len,&i)==0) break;
+  lua_rawsetarray(L,5,nrec*k->nvalues+1,k->nvalues);
+  nrec++;
+  if (i==start) break;                          /* empty record, would loop forever */
+ }
+ lua_pushinteger(L,nrec);
+ lua_pushinteger(L,i+1);
+ return 3;
+}
+
+static int c_size(lua_State *L)                 /** codec:size() */
+{
+ codec_t *k=codec_check(L);
+ if (k->fixed)
+  lua_pushinteger(L,k->size);
+ else
+  lua_pushnil(L);
+ lua_pushinteger(L,k->nvalues);
+ return 2;
+}
+
+static int l_buffer(lua_State *L)               /** buffer(size,[fill]) */
+{
+ lua_Integer size=luaL_checkinteger(L,1);
+ int fill=luaL_optint(L,2,0);
+ pbuffer_t *b;
+ if (size<0) luaL_argerror(L,1,"invalid size");
+ b=(pbuffer_t*)lua_newuserdata(L,sizeof(pbuffer_t)+(size_t)size);
+ b->size=(size_t)size;
+ memset(b->data,fill,b->size);
+ luaL_getmetatable(L,BUFFER_META);
+ lua_setmetatable(L,-2);
+ return 1;
+}
+
+static int b_tostring(lua_State *L)             /** buf:tostring([i],[j]) */
+{
+ pbuffer_t *b=(pbuffer_t*)luaL_checkudata(L,1,BUFFER_META);
+ size_t i=getinit(L,2,b->size);
+ lua_Integer j=luaL_optinteger(L,3,b->size);
+ if (j<0) j+=(lua_Integer)b->size+1;
+ if (j<0) j=0;
+ else if ((size_t)j>b->size) j=b->size;
+ lua_pushlstring(L,b->data+i,j>(lua_Integer)i ? (size_t)j-i : 0);
+ return 1;
+}
+
+static int b_len(lua_State *L)
+{
+ pbuffer_t *b=(pbuffer_t*)luaL_checkudata(L,1,BUFFER_META);
+ lua_pushinteger(L,b->size);
+ return 1;
+}
+
 #define MIN_OPT_LEVEL 2
 #include "lrodefs.h"
 const LUA_REG_TYPE pack_map[] =
 {
   { LSTRKEY( "pack" ),  LFUNCVAL( l_pack ) },
   { LSTRKEY( "unpack" ), LFUNCVAL( l_unpack ) },
+  { LSTRKEY( "compile" ), LFUNCVAL( l_compile ) },
+  { LSTRKEY( "buffer" ), LFUNCVAL( l_buffer ) },
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE codec_mt_map[] =
+{
+  { LSTRKEY( "pack" ), LFUNCVAL( c_pack ) },
+  { LSTRKEY( "packinto" ), LFUNCVAL( c_packinto ) },
+  { LSTRKEY( "unpack" ), LFUNCVAL( c_unpack ) },
+  { LSTRKEY( "unpackall" ), LFUNCVAL( c_unpackall ) },
+  { LSTRKEY( "size" ), LFUNCVAL( c_size ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( codec_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE buffer_mt_map[] =
+{
+  { LSTRKEY( "tostring" ), LFUNCVAL( b_tostring ) },
+  { LSTRKEY( "__len" ), LFUNCVAL( b_len ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( buffer_mt_map ) },
+#endif
   { LNILKEY, LNILVAL }
 };
 
 int luaopen_pack( lua_State *L )
 {
+#if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, CODEC_META, ( void* )codec_mt_map );
+  luaL_rometatable( L, BUFFER_META, ( void* )buffer_mt_map );
+  return 0;
+#else // #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_newmetatable( L, CODEC_META );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, codec_mt_map );
+  luaL_newmetatable( L, BUFFER_META );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, buffer_mt_map );
+  lua_pop( L, 2 );
   LREGISTER( L, AUXLIB_PACK, pack_map );
+#endif // #if LUA_OPTIMIZE_MEMORY > 0
 }
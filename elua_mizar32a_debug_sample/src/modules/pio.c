@@ -6,6 +6,7 @@
 #include "auxmods.h"
 #include "lrotable.h"
 #include "platform_conf.h"
+#include "utils.h"
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -20,6 +21,11 @@
 #define PIO_PORT_OP         0
 #define PIO_PIN_OP          1
 
+#define PIO_GROUP_META_NAME     "eLua.pio.group"
+#define PIO_SEQ_META_NAME       "eLua.pio.sequence"
+#define PIO_GROUP_MAX_PINS      32
+#define pio_group_check( L, i ) ( pio_group_t* )luaL_checkudata( L, i, PIO_GROUP_META_NAME )
+
 // Local operation masks for all the ports
 static pio_type pio_masks[ PLATFORM_IO_PORTS ];
 
@@ -274,6 +280,248 @@ static int pio_port_getval( lua_State *L )
   return total;
 }
 
+// ****************************************************************************
+// Pin groups and sequences
+// A group ( pio.group ) is a set of pins validated once, with the pin masks
+// already computed for every port it uses. Bit i of a group value is the i-th
+// pin given to pio.group. A sequence ( pio.sequence ) is a list of group values
+// converted to port set/clear masks, replayed with the given timing from C.
+
+// Group data: the ports used by the group and the group pins in each of them,
+// then every pin as ( index in 'port' << PLATFORM_IO_PINS_BITS ) | pin
+typedef struct
+{
+  u8 nports, npins;
+  u8 port[ NUM_PIO ];
+  pio_type mask[ NUM_PIO ];
+  u8 pins[ PIO_GROUP_MAX_PINS ];
+} pio_group_t;
+
+// Sequence data: 'nsteps' steps of 'PIO_SEQ_STRIDE' words each: the delay
+// after the step (us), then the set masks and the clear masks of the ports
+typedef struct
+{
+  u8 nports;
+  u8 port[ NUM_PIO ];
+  u16 nsteps;
+  u32 maxdelay;
+  u32 data[ 1 ];
+} pio_seq_t;
+
+#define PIO_SEQ_STRIDE( ps )  ( 1 + 2 * ( ps )->nports )
+
+// Helper function: compute the pins of group 'pg' to set for 'value' in each
+// group port (the other group pins must be cleared)
+static void pioh_group_value( const pio_group_t *pg, u32 value, pio_type *pset )
+{
+  unsigned i;
+
+  for( i = 0; i < pg->nports; i ++ )
+    pset[ i ] = 0;
+  for( i = 0; i < pg->npins; i ++, value >>= 1 )
+    if( value & 1 )
+      pset[ pg->pins[ i ] >> PLATFORM_IO_PINS_BITS ] |= 1UL << ( pg->pins[ i ] & ( PLATFORM_IO_PINS - 1 ) );
+}
+
+// Helper function: execute 'op' on all the pins of group 'pg'
+static int pioh_group_op( lua_State *L, const pio_group_t *pg, int op )
+{
+  unsigned i;
+
+  for( i = 0; i < pg->nports; i ++ )
+    if( !platform_pio_op( pg->port[ i ], pg->mask[ i ], op ) )
+      return luaL_error( L, "invalid PIO operation" );
+  return 0;
+}
+
+// Lua: group = pio.group( pin1, pin2, ..., pinn )
+static int pio_group( lua_State *L )
+{
+  int total = lua_gettop( L );
+  int i, j, v, port, pin;
+  pio_group_t *pg;
+
+  if( total < 1 || total > PIO_GROUP_MAX_PINS )
+    return luaL_error( L, "a group must have 1 to %d pins", PIO_GROUP_MAX_PINS );
+  pg = ( pio_group_t* )lua_newuserdata( L, sizeof( pio_group_t ) );
+  memset( pg, 0, sizeof( pio_group_t ) );
+  for( i = 1; i <= total; i ++ )
+  {
+    v = luaL_checkinteger( L, i );
+    port = PLATFORM_IO_GET_PORT( v );
+    pin = PLATFORM_IO_GET_PIN( v );
+    if( PLATFORM_IO_IS_PORT( v ) || !platform_pio_has_port( port ) || !platform_pio_has_pin( port, pin ) )
+      return luaL_error( L, "invalid pin" );
+    for( j = 0; j < pg->nports && pg->port[ j ] != port; j ++ );
+    if( j == pg->nports )
+      pg->port[ pg->nports ++ ] = port;
+    if( pg->mask[ j ] & ( 1UL << pin ) )
+      return luaL_error( L, "duplicate pin" );
+    pg->mask[ j ] |= 1UL << pin;
+    pg->pins[ pg->npins ++ ] = ( j << PLATFORM_IO_PINS_BITS ) | pin;
+  }
+  luaL_getmetatable( L, PIO_GROUP_META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Lua: group:set()
+static int pio_group_set( lua_State *L )
+{
+  return pioh_group_op( L, pio_group_check( L, 1 ), PLATFORM_IO_PIN_SET );
+}
+
+// Lua: group:clear()
+static int pio_group_clear( lua_State *L )
+{
+  return pioh_group_op( L, pio_group_check( L, 1 ), PLATFORM_IO_PIN_CLEAR );
+}
+
+// Lua: group:toggle()
+static int pio_group_toggle( lua_State *L )
+{
+  return pioh_group_op( L, pio_group_check( L, 1 ), PLATFORM_IO_PIN_TOGGLE );
+}
+
+// Lua: group:write( value )
+static int pio_group_write( lua_State *L )
+{
+  pio_group_t *pg = pio_group_check( L, 1 );
+  pio_type set[ NUM_PIO ];
+  unsigned i;
+
+  pioh_group_value( pg, ( u32 )luaL_checknumber( L, 2 ), set );
+  for( i = 0; i < pg->nports; i ++ )
+  {
+    if( set[ i ] )
+      platform_pio_op( pg->port[ i ], set[ i ], PLATFORM_IO_PIN_SET );
+    if( set[ i ] != pg->mask[ i ] )
+      platform_pio_op( pg->port[ i ], pg->mask[ i ] & ~set[ i ], PLATFORM_IO_PIN_CLEAR );
+  }
+  return 0;
+}
+
+// Lua: value = group:read()
+static int pio_group_read( lua_State *L )
+{
+  pio_group_t *pg = pio_group_check( L, 1 );
+  pio_type pval[ NUM_PIO ];
+  u32 value = 0;
+  unsigned i;
+
+  for( i = 0; i < pg->nports; i ++ )
+    pval[ i ] = platform_pio_op( pg->port[ i ], PLATFORM_IO_ALL_PINS, PLATFORM_IO_PORT_GET_VALUE );
+  for( i = pg->npins; i > 0; i -- )
+    value = ( value << 1 ) | ( ( pval[ pg->pins[ i - 1 ] >> PLATFORM_IO_PINS_BITS ] >> ( pg->pins[ i - 1 ] & ( PLATFORM_IO_PINS - 1 ) ) ) & 1 );
+  lua_pushnumber( L, ( lua_Number )value );
+  return 1;
+}
+
+// Lua: seq = pio.sequence( group, { value1, value2, ..., valuen }, [delay] )
+// 'delay' is the time (us) between two values, either a number (default 0)
+// or a table with a delay for every value
+static int pio_sequence( lua_State *L )
+{
+  pio_group_t *pg = pio_group_check( L, 1 );
+  pio_seq_t *ps;
+  unsigned nsteps, i, j, stride;
+  u32 *p;
+  lua_Number delay = 0;
+
+  luaL_checktype( L, 2, LUA_TTABLE );
+  nsteps = lua_objlen( L, 2 );
+  if( nsteps == 0 || nsteps > 0xFFFF )
+    return luaL_error( L, "invalid number of values" );
+  if( lua_istable( L, 3 ) )
+  {
+    if( lua_objlen( L, 3 ) != nsteps )
+      return luaL_error( L, "the delay and value tables must have the same size" );
+  }
+  else
+    delay = luaL_optnumber( L, 3, 0 );
+  stride = 1 + 2 * pg->nports;
+  ps = ( pio_seq_t* )lua_newuserdata( L, sizeof( pio_seq_t ) + ( nsteps * stride - 1 ) * sizeof( u32 ) );
+  ps->nports = pg->nports;
+  memcpy( ps->port, pg->port, sizeof( ps->port ) );
+  ps->nsteps = nsteps;
+  ps->maxdelay = 0;
+  for( i = 0, p = ps->data; i < nsteps; i ++, p += stride )
+  {
+    lua_rawgeti( L, 2, i + 1 );
+    if( !lua_isnumber( L, -1 ) )
+      return luaL_error( L, "invalid value at index %d", i + 1 );
+    pioh_group_value( pg, ( u32 )lua_tonumber( L, -1 ), p + 1 );
+    lua_pop( L, 1 );
+    if( lua_istable( L, 3 ) )
+    {
+      lua_rawgeti( L, 3, i + 1 );
+      if( !lua_isnumber( L, -1 ) )
+        return luaL_error( L, "invalid delay at index %d", i + 1 );
+      delay = lua_tonumber( L, -1 );
+      lua_pop( L, 1 );
+    }
+    if( delay < 0 )
+      return luaL_error( L, "invalid delay at index %d", i + 1 );
+    p[ 0 ] = ( u32 )delay;
+    ps->maxdelay = UMAX( ps->maxdelay, p[ 0 ] );
+    for( j = 0; j < pg->nports; j ++ )
+      p[ 1 + pg->nports + j ] = pg->mask[ j ] & ~p[ 1 + j ];
+  }
+  luaL_getmetatable( L, PIO_SEQ_META_NAME );
+  lua_setmetatable( L, -2 );
+  return 1;
+}
+
+// Lua: seq:run( [count], [timer_id] )
+// Replays the sequence 'count' times (default 1), timing the delays with
+// timer 'timer_id' (default the system timer). The time spent late on a step
+// is taken from the delay of the next one, so errors don't add up.
+static int pio_seq_run( lua_State *L )
+{
+  pio_seq_t *ps = ( pio_seq_t* )luaL_checkudata( L, 1, PIO_SEQ_META_NAME );
+  u32 count = ( u32 )luaL_optinteger( L, 2, 1 );
+  unsigned id = ( unsigned )luaL_optinteger( L, 3, PLATFORM_TIMER_SYS_ID );
+  unsigned i, j, stride = PIO_SEQ_STRIDE( ps );
+  timer_data_type tstart = 0, tnow, elapsed, target, late = 0;
+  const u32 *p;
+
+  if( ps->maxdelay > 0 )
+  {
+    if( !platform_timer_exists( id ) )
+      return luaL_error( L, "timer %d does not exist", ( int )id );
+    if( ps->maxdelay > platform_timer_op( id, PLATFORM_TIMER_OP_GET_MAX_DELAY, 0 ) )
+      return luaL_error( L, "delay too large for timer %d", ( int )id );
+    tstart = platform_timer_start( id );
+  }
+  while( count -- > 0 )
+    for( i = 0, p = ps->data; i < ps->nsteps; i ++, p += stride )
+    {
+      for( j = 0; j < ps->nports; j ++ )
+      {
+        if( p[ 1 + j ] )
+          platform_pio_op( ps->port[ j ], p[ 1 + j ], PLATFORM_IO_PIN_SET );
+        if( p[ 1 + ps->nports + j ] )
+          platform_pio_op( ps->port[ j ], p[ 1 + ps->nports + j ], PLATFORM_IO_PIN_CLEAR );
+      }
+      if( p[ 0 ] == 0 )
+        continue;
+      target = p[ 0 ] > late ? p[ 0 ] - late : 0;
+      while( ( elapsed = platform_timer_get_diff_us( id, tstart, tnow = platform_timer_read( id ) ) ) < target );
+      late = late + elapsed - p[ 0 ];
+      tstart = tnow;
+    }
+  return 0;
+}
+
+// Lua: n = #seq
+static int pio_seq_len( lua_State *L )
+{
+  pio_seq_t *ps = ( pio_seq_t* )luaL_checkudata( L, 1, PIO_SEQ_META_NAME );
+
+  lua_pushinteger( L, ps->nsteps );
+  return 1;
+}
+
 // ****************************************************************************
 // The __index metamethod will return pin/port numeric identifiers
 
@@ -451,9 +699,34 @@ static const LUA_REG_TYPE pio_port_map[] =
   { LNILKEY, LNILVAL }
 };
 
+static const LUA_REG_TYPE pio_group_mt_map[] =
+{
+  { LSTRKEY( "set" ), LFUNCVAL( pio_group_set ) },
+  { LSTRKEY( "clear" ), LFUNCVAL( pio_group_clear ) },
+  { LSTRKEY( "toggle" ), LFUNCVAL( pio_group_toggle ) },
+  { LSTRKEY( "write" ), LFUNCVAL( pio_group_write ) },
+  { LSTRKEY( "read" ), LFUNCVAL( pio_group_read ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( pio_group_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE pio_seq_mt_map[] =
+{
+  { LSTRKEY( "run" ), LFUNCVAL( pio_seq_run ) },
+  { LSTRKEY( "__len" ), LFUNCVAL( pio_seq_len ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( pio_seq_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
 const LUA_REG_TYPE pio_map[] =
 {
   { LSTRKEY( "decode" ), LFUNCVAL( pio_decode ) },  
+  { LSTRKEY( "group" ), LFUNCVAL( pio_group ) },
+  { LSTRKEY( "sequence" ), LFUNCVAL( pio_sequence ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "pin" ), LROVAL( pio_pin_map ) },
   { LSTRKEY( "port" ), LROVAL( pio_port_map ) },
@@ -471,8 +744,21 @@ const LUA_REG_TYPE pio_map[] =
 LUALIB_API int luaopen_pio( lua_State *L )
 {
 #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, PIO_GROUP_META_NAME, ( void* )pio_group_mt_map );
+  luaL_rometatable( L, PIO_SEQ_META_NAME, ( void* )pio_seq_mt_map );
   return 0;
 #else // #if LUA_OPTIMIZE_MEMORY > 0
+  // Metatables for the group and sequence objects
+  luaL_newmetatable( L, PIO_GROUP_META_NAME );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, pio_group_mt_map );
+  luaL_newmetatable( L, PIO_SEQ_META_NAME );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, pio_seq_mt_map );
+  lua_pop( L, 2 );
+
   luaL_register( L, AUXLIB_PIO, pio_map );
 
   // Set it as its own metatable
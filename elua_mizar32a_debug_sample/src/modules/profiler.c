@@ -0,0 +1,305 @@
+// Sampling profiler for Lua code
+// A count hook checks the system timer and, once every sampling period,
+// records the current Lua call stack in a fixed size hash table. The result
+// is dumped in "collapsed stack" format (one "f1;f2;...;fn count" line per
+// distinct stack), ready to be turned into a flame graph on the PC.
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "platform.h"
+#include "platform_conf.h"
+#include "auxmods.h"
+#include "lrotable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BUILD_PROFILER
+
+// Maximum number of distinct functions and stacks that can be recorded
+#ifndef PROFILER_MAX_FUNCS
+#define PROFILER_MAX_FUNCS              64
+#endif
+#ifndef PROFILER_HASH_SIZE
+#define PROFILER_HASH_SIZE              256   // must be a power of 2
+#endif
+// Maximum recorded stack depth (the outermost frames are dropped)
+#ifndef PROFILER_MAX_DEPTH
+#define PROFILER_MAX_DEPTH              12
+#endif
+// Maximum length of a function description
+#ifndef PROFILER_NAME_LEN
+#define PROFILER_NAME_LEN               40
+#endif
+// Room for the source name in a Lua function description (the name and the
+// line number share the rest)
+#define PROFILER_SRC_LEN                ( PROFILER_NAME_LEN / 2 )
+
+// Default sampling period (us) and number of VM instructions between hooks
+#define PROFILER_DEFAULT_PERIOD         1000
+#define PROFILER_DEFAULT_COUNT          100
+
+// A function seen by the profiler. It is identified by the contents of its
+// source, name and linedefined (as returned by lua_getinfo), never by their
+// addresses: the strings can be collected and their memory reused by another
+// chunk. 'hash' covers the full strings, 'text' is the (truncated) description
+typedef struct
+{
+  u32 hash;
+  char text[ PROFILER_NAME_LEN ];
+} prof_func;
+
+// A recorded stack: function indexes (leaf first) and current line of the leaf
+typedef struct
+{
+  u32 count;
+  u16 line;
+  u8 depth;
+  u8 funcs[ PROFILER_MAX_DEPTH ];
+} prof_stack;
+
+typedef struct
+{
+  prof_func funcs[ PROFILER_MAX_FUNCS ];
+  prof_stack stacks[ PROFILER_HASH_SIZE ];
+  unsigned nfuncs, nstacks;
+  u32 samples, dropped;
+} prof_data;
+
+static prof_data *prof_data_p;
+static u8 prof_running;
+static u32 prof_period;
+static timer_data_type prof_last;
+
+// ****************************************************************************
+// Helpers
+
+// FNV-1a hash of the string 's' (NULL allowed), continuing from 'hash'
+static u32 profh_hash_str( u32 hash, const char *s )
+{
+  if( s == NULL )
+    return ( hash ^ 0xFF ) * 16777619UL;
+  while( *s )
+    hash = ( hash ^ ( u8 )*s ++ ) * 16777619UL;
+  return ( hash ^ 0 ) * 16777619UL;
+}
+
+// Find or add the function described by 'ar', returns -1 if the table is full
+static int profh_func_index( lua_Debug *ar )
+{
+  prof_data *pd = prof_data_p;
+  prof_func *pf;
+  char text[ PROFILER_NAME_LEN ];
+  unsigned i;
+  u32 hash;
+  char *p;
+
+  if( *ar->what == 'C' )
+    snprintf( text, PROFILER_NAME_LEN, "%s [C]", ar->name ? ar->name : "?" );
+  else if( *ar->what == 'm' )
+    snprintf( text, PROFILER_NAME_LEN, "main %.*s", PROFILER_NAME_LEN - 6, ar->short_src );
+  else
+    snprintf( text, PROFILER_NAME_LEN, "%s %.*s:%d", ar->name ? ar->name : "?", PROFILER_SRC_LEN, ar->short_src, ar->linedefined );
+  // ';' separates the frames in the collapsed stack format
+  for( p = text; *p; p ++ )
+    if( *p == ';' )
+      *p = '_';
+  hash = profh_hash_str( 2166136261UL, ar->what );
+  hash = profh_hash_str( hash, ar->source );
+  hash = profh_hash_str( hash, ar->name );
+  hash = ( hash ^ ( u32 )ar->linedefined ) * 16777619UL;
+  for( i = 0; i < pd->nfuncs; i ++ )
+  {
+    pf = pd->funcs + i;
+    if( pf->hash == hash && !strcmp( pf->text, text ) )
+      return ( int )i;
+  }
+  if( pd->nfuncs == PROFILER_MAX_FUNCS )
+    return -1;
+  pf = pd->funcs + pd->nfuncs;
+  pf->hash = hash;
+  strcpy( pf->text, text );
+  return ( int )pd->nfuncs ++;
+}
+
+// Record the current call stack of 'L'
+static void profh_sample( lua_State *L )
+{
+  prof_data *pd = prof_data_p;
+  prof_stack crt, *ps;
+  lua_Debug ar;
+  u32 hash = 2166136261UL;
+  unsigned i;
+  int idx;
+
+  pd->samples ++;
+  memset( &crt, 0, sizeof( crt ) );
+  while( crt.depth < PROFILER_MAX_DEPTH && lua_getstack( L, crt.depth, &ar ) )
+  {
+    lua_getinfo( L, "Snl", &ar );
+    if( ( idx = profh_func_index( &ar ) ) == -1 )
+    {
+      pd->dropped ++;
+      return;
+    }
+    if( crt.depth == 0 )
+      crt.line = ( u16 )( ar.currentline > 0 ? ar.currentline : 0 );
+    crt.funcs[ crt.depth ++ ] = ( u8 )idx;
+    hash = ( hash ^ ( u32 )idx ) * 16777619UL;
+  }
+  if( crt.depth == 0 )
+    return;
+  hash = ( hash ^ crt.line ) * 16777619UL;
+  // Open addressing with linear probing
+  for( i = 0; i < PROFILER_HASH_SIZE; i ++ )
+  {
+    ps = pd->stacks + ( ( hash + i ) & ( PROFILER_HASH_SIZE - 1 ) );
+    if( ps->count == 0 )
+    {
+      *ps = crt;
+      ps->count = 1;
+      pd->nstacks ++;
+      return;
+    }
+    if( ps->depth == crt.depth && ps->line == crt.line && !memcmp( ps->funcs, crt.funcs, crt.depth ) )
+    {
+      ps->count ++;
+      return;
+    }
+  }
+  pd->dropped ++;
+}
+
+// The count hook: take a sample if the sampling period expired
+static void profh_hook( lua_State *L, lua_Debug *ar )
+{
+  timer_data_type now;
+
+  if( prof_period > 0 )
+  {
+    now = platform_timer_read_sys();
+    if( platform_timer_get_diff_us( PLATFORM_TIMER_SYS_ID, prof_last, now ) < prof_period )
+      return;
+    prof_last = now;
+  }
+  profh_sample( L );
+}
+
+static void profh_stop()
+{
+  if( prof_running )
+  {
+    elua_int_set_idle_hook( NULL, 0, 0 );
+    prof_running = 0;
+  }
+}
+
+// ****************************************************************************
+// Lua interface
+
+// Lua: profiler.start( [ period_us ], [ count ] )
+// 'period_us' is the sampling period (0 takes a sample every 'count' instructions)
+static int profiler_start( lua_State *L )
+{
+  u32 period = ( u32 )luaL_optinteger( L, 1, PROFILER_DEFAULT_PERIOD );
+  int count = luaL_optinteger( L, 2, PROFILER_DEFAULT_COUNT );
+
+  if( count <= 0 )
+    return luaL_error( L, "invalid instruction count" );
+  if( period > 0 && !platform_timer_sys_available() )
+    return luaL_error( L, "the system timer is not available" );
+  if( prof_data_p == NULL )
+  {
+    if( ( prof_data_p = ( prof_data* )malloc( sizeof( prof_data ) ) ) == NULL )
+      return luaL_error( L, "not enough memory" );
+    memset( prof_data_p, 0, sizeof( prof_data ) );
+  }
+  prof_period = period;
+  if( period > 0 )
+    prof_last = platform_timer_read_sys();
+  prof_running = 1;
+  elua_int_set_idle_hook( profh_hook, LUA_MASKCOUNT, count );
+  return 0;
+}
+
+// Lua: profiler.stop()
+static int profiler_stop( lua_State *L )
+{
+  profh_stop();
+  return 0;
+}
+
+// Lua: profiler.reset()
+// Stops the profiler and releases the recorded data
+static int profiler_reset( lua_State *L )
+{
+  profh_stop();
+  free( prof_data_p );
+  prof_data_p = NULL;
+  return 0;
+}
+
+// Lua: samples, dropped, stacks, funcs = profiler.stats()
+static int profiler_stats( lua_State *L )
+{
+  prof_data *pd = prof_data_p;
+
+  lua_pushinteger( L, pd ? pd->samples : 0 );
+  lua_pushinteger( L, pd ? pd->dropped : 0 );
+  lua_pushinteger( L, pd ? pd->nstacks : 0 );
+  lua_pushinteger( L, pd ? pd->nfuncs : 0 );
+  return 4;
+}
+
+// Lua: nstacks = profiler.dump( [ filename ] )
+// Writes the collapsed stacks to the given file (for example on /mmc) or to
+// the console if no file name is given
+static int profiler_dump( lua_State *L )
+{
+  const char *fname = luaL_optstring( L, 1, NULL );
+  prof_data *pd = prof_data_p;
+  prof_stack *ps;
+  FILE *fp = stdout;
+  unsigned i, nstacks = 0;
+  int j;
+
+  if( pd == NULL )
+    return luaL_error( L, "no profile data" );
+  if( fname && ( fp = fopen( fname, "w" ) ) == NULL )
+    return luaL_error( L, "unable to open %s", fname );
+  for( i = 0; i < PROFILER_HASH_SIZE; i ++ )
+  {
+    ps = pd->stacks + i;
+    if( ps->count == 0 )
+      continue;
+    // Outermost frame first, the leaf gets its current line
+    for( j = ps->depth - 1; j > 0; j -- )
+      fprintf( fp, "%s;", pd->funcs[ ps->funcs[ j ] ].text );
+    fprintf( fp, "%s:%u %lu\n", pd->funcs[ ps->funcs[ 0 ] ].text, ( unsigned )ps->line, ( unsigned long )ps->count );
+    nstacks ++;
+  }
+  if( fname )
+    fclose( fp );
+  lua_pushinteger( L, nstacks );
+  return 1;
+}
+
+// Module function map
+#define MIN_OPT_LEVEL 2
+#include "lrodefs.h"
+const LUA_REG_TYPE profiler_map[] =
+{
+  { LSTRKEY( "start" ), LFUNCVAL( profiler_start ) },
+  { LSTRKEY( "stop" ), LFUNCVAL( profiler_stop ) },
+  { LSTRKEY( "reset" ), LFUNCVAL( profiler_reset ) },
+  { LSTRKEY( "stats" ), LFUNCVAL( profiler_stats ) },
+  { LSTRKEY( "dump" ), LFUNCVAL( profiler_dump ) },
+  { LNILKEY, LNILVAL }
+};
+
+LUALIB_API int luaopen_profiler( lua_State *L )
+{
+  LREGISTER( L, AUXLIB_PROFILER, profiler_map );
+}
+
+#endif // #ifdef BUILD_PROFILER
@@ -0,0 +1,407 @@
+// Module for POSIX extended regular expressions (Henry Spencer's library)
+// A pattern is compiled once by regex.compile and the returned object is
+// reused for all the matches. All the searches work on (start, end) offsets
+// in the subject string (REG_STARTEND), so large buffers are never copied,
+// and ask the engine only for what they return: 'test' runs the DFA alone,
+// 'find' also locates the start of the match and only the methods that
+// return captures pay for the subexpression matching.
+
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+#include "platform_conf.h"
+#include "auxmods.h"
+#include "lrotable.h"
+#include "regex.h"
+#include <string.h>
+#include <ctype.h>
+
+#ifdef BUILD_REGEX
+
+#define META_NAME                 "eLua.regex"
+#define regex_check( L )          ( regex_ud* )luaL_checkudata( L, 1, META_NAME )
+
+// Captures are limited like in Lua patterns (%1-%9 in gsub replacements)
+#define REGEX_MAX_MATCH           ( LUA_MAXCAPTURES + 1 )
+
+typedef struct
+{
+  regex_t re;
+  int compiled;
+  int newline;
+} regex_ud;
+
+// Helper: translate a position as used by string.find (negative values
+// count from the end) to the range 0 .. len
+static size_t regex_pos( lua_Integer pos, size_t len )
+{
+  if( pos < 0 )
+    pos += ( lua_Integer )len + 1;
+  if( pos < 0 )
+    return 0;
+  return ( size_t )pos > len ? len : ( size_t )pos;
+}
+
+// Helper: get the [ so, eo ) range from the optional 'init' and 'last'
+// arguments at 'idx' and 'idx + 1'
+static void regex_range( lua_State *L, int idx, size_t len, size_t *pso, size_t *peo )
+{
+  size_t so = regex_pos( luaL_optinteger( L, idx, 1 ), len );
+
+  *pso = so > 0 ? so - 1 : 0;
+  *peo = regex_pos( luaL_optinteger( L, idx + 1, -1 ), len );
+}
+
+// Helper: run the regex on s[ so .. eo ), asking for 'nmatch' results
+// Returns 1 on match, 0 if there's no match
+static int regex_run( lua_State *L, regex_ud *pr, const char *s, size_t len, size_t so, size_t eo, size_t nmatch, regmatch_t *pm )
+{
+  int flags = REG_STARTEND, res;
+  char msg[ 64 ];
+
+  // With the 'n' flag a range that starts after a '\n' (or ends before
+  // one) is at the start (end) of a line, so '^' ('$') can match there
+  if( so > 0 && !( pr->newline && s[ so - 1 ] == '\n' ) )
+    flags |= REG_NOTBOL;
+  if( eo < len && !( pr->newline && s[ eo ] == '\n' ) )
+    flags |= REG_NOTEOL;
+  pm[ 0 ].rm_so = ( regoff_t )so;
+  pm[ 0 ].rm_eo = ( regoff_t )eo;
+  res = regexec( &pr->re, s, nmatch, pm, flags );
+  if( res == REG_NOMATCH )
+    return 0;
+  if( res != REG_OKAY )
+  {
+    regerror( res, &pr->re, msg, sizeof( msg ) );
+    return luaL_error( L, "regex: %s", msg );
+  }
+  return 1;
+}
+
+// Helper: number of results needed for the captures of the pattern
+static size_t regex_nmatch( regex_ud *pr )
+{
+  return pr->re.re_nsub + 1;
+}
+
+// Helper: push one capture (false if the subexpression didn't take part)
+static void regex_push_one( lua_State *L, const char *s, const regmatch_t *pm )
+{
+  if( pm->rm_so < 0 )
+    lua_pushboolean( L, 0 );
+  else
+    lua_pushlstring( L, s + pm->rm_so, ( size_t )( pm->rm_eo - pm->rm_so ) );
+}
+
+// Helper: push the captures or the whole match if the pattern has none
+static int regex_push_captures( lua_State *L, regex_ud *pr, const char *s, const regmatch_t *pm )
+{
+  size_t i;
+
+  if( pr->re.re_nsub == 0 )
+  {
+    regex_push_one( L, s, pm );
+    return 1;
+  }
+  luaL_checkstack( L, pr->re.re_nsub, "too many captures" );
+  for( i = 1; i <= pr->re.re_nsub; i ++ )
+    regex_push_one( L, s, pm + i );
+  return ( int )pr->re.re_nsub;
+}
+
+// Lua: re = regex.compile( pattern, [flags] )
+// 'flags' is a string: 'i' ignores case, 'n' makes '.' and bracket
+// expressions stop at newlines (which also match '^' and '$'), 'b' uses
+// the basic (obsolete) syntax instead of the extended one
+static int regex_compile( lua_State *L )
+{
+  size_t len;
+  const char *pat = luaL_checklstring( L, 1, &len );
+  const char *flags = luaL_optstring( L, 2, "" );
+  int cflags = REG_EXTENDED | REG_PEND, res;
+  regex_ud *pr;
+  char msg[ 64 ];
+
+  for( ; *flags; flags ++ )
+    switch( *flags )
+    {
+      case 'i':
+        cflags |= REG_ICASE;
+        break;
+
+      case 'n':
+        cflags |= REG_NEWLINE;
+        break;
+
+      case 'b':
+        cflags &= ~REG_EXTENDED;
+        break;
+
+      default:
+        return luaL_error( L, "invalid flag '%c'", *flags );
+    }
+  pr = ( regex_ud* )lua_newuserdata( L, sizeof( regex_ud ) );
+  pr->compiled = 0;
+  pr->newline = ( cflags & REG_NEWLINE ) != 0;
+  luaL_getmetatable( L, META_NAME );
+  lua_setmetatable( L, -2 );
+  pr->re.re_endp = pat + len;
+  if( ( res = regcomp( &pr->re, pat, cflags ) ) != REG_OKAY )
+  {
+    regerror( res, &pr->re, msg, sizeof( msg ) );
+    return luaL_error( L, "regex: %s", msg );
+  }
+  pr->compiled = 1;
+  if( pr->re.re_nsub >= REGEX_MAX_MATCH )
+    return luaL_error( L, "too many captures" );
+  return 1;
+}
+
+// Lua: matched = re:test( s, [init], [last] )
+static int regex_test( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+  size_t len;
+  const char *s = luaL_checklstring( L, 2, &len );
+  size_t so, eo;
+  regmatch_t pm[ 1 ];
+
+  regex_range( L, 3, len, &so, &eo );
+  lua_pushboolean( L, so <= eo && regex_run( L, pr, s, len, so, eo, 0, pm ) );
+  return 1;
+}
+
+// Lua: start, end = re:find( s, [init], [last] )
+static int regex_find( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+  size_t len;
+  const char *s = luaL_checklstring( L, 2, &len );
+  size_t so, eo;
+  regmatch_t pm[ 1 ];
+
+  regex_range( L, 3, len, &so, &eo );
+  if( so > eo || !regex_run( L, pr, s, len, so, eo, 1, pm ) )
+  {
+    lua_pushnil( L );
+    return 1;
+  }
+  lua_pushinteger( L, pm[ 0 ].rm_so + 1 );
+  lua_pushinteger( L, pm[ 0 ].rm_eo );
+  return 2;
+}
+
+// Lua: captures = re:match( s, [init], [last] )
+static int regex_match( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+  size_t len;
+  const char *s = luaL_checklstring( L, 2, &len );
+  size_t so, eo;
+  regmatch_t pm[ REGEX_MAX_MATCH ];
+
+  regex_range( L, 3, len, &so, &eo );
+  if( so > eo || !regex_run( L, pr, s, len, so, eo, regex_nmatch( pr ), pm ) )
+  {
+    lua_pushnil( L );
+    return 1;
+  }
+  return regex_push_captures( L, pr, s, pm );
+}
+
+static int regex_gmatch_aux( lua_State *L )
+{
+  regex_ud *pr = ( regex_ud* )lua_touserdata( L, lua_upvalueindex( 1 ) );
+  size_t len;
+  const char *s = lua_tolstring( L, lua_upvalueindex( 2 ), &len );
+  size_t so = ( size_t )lua_tointeger( L, lua_upvalueindex( 3 ) );
+  regmatch_t pm[ REGEX_MAX_MATCH ];
+
+  if( so > len || !regex_run( L, pr, s, len, so, len, regex_nmatch( pr ), pm ) )
+    return 0;
+  // An empty match moves the next search at least one char ahead
+  so = ( size_t )pm[ 0 ].rm_eo;
+  lua_pushinteger( L, pm[ 0 ].rm_eo == pm[ 0 ].rm_so ? so + 1 : so );
+  lua_replace( L, lua_upvalueindex( 3 ) );
+  return regex_push_captures( L, pr, s, pm );
+}
+
+// Lua: iterator = re:gmatch( s, [init] )
+static int regex_gmatch( lua_State *L )
+{
+  size_t len, so, eo;
+
+  regex_check( L );
+  luaL_checklstring( L, 2, &len );
+  regex_range( L, 3, len, &so, &eo );
+  lua_settop( L, 2 );
+  lua_pushinteger( L, so );
+  lua_pushcclosure( L, regex_gmatch_aux, 3 );
+  return 1;
+}
+
+// Helper: append the replacement string with %0-%9 expanded
+static void regex_add_s( lua_State *L, luaL_Buffer *b, const char *s, const regmatch_t *pm, size_t nsub )
+{
+  size_t l, i, n;
+  const char *news = lua_tolstring( L, 3, &l );
+
+  for( i = 0; i < l; i ++ )
+  {
+    if( news[ i ] != '%' || i + 1 == l )
+      luaL_addchar( b, news[ i ] );
+    else if( !isdigit( ( unsigned char )news[ ++ i ] ) )
+      luaL_addchar( b, news[ i ] );
+    else
+    {
+      n = news[ i ] - '0';
+      if( n == 1 && nsub == 0 )
+        n = 0;  // %1 is the whole match when there are no captures
+      else if( n > nsub )
+        luaL_error( L, "invalid capture index" );
+      if( pm[ n ].rm_so >= 0 )
+        luaL_addlstring( b, s + pm[ n ].rm_so, ( size_t )( pm[ n ].rm_eo - pm[ n ].rm_so ) );
+    }
+  }
+}
+
+// Helper: append the replacement of one match
+static void regex_add_value( lua_State *L, luaL_Buffer *b, regex_ud *pr, const char *s, const regmatch_t *pm )
+{
+  switch( lua_type( L, 3 ) )
+  {
+    case LUA_TNUMBER:
+    case LUA_TSTRING:
+      regex_add_s( L, b, s, pm, pr->re.re_nsub );
+      return;
+
+    case LUA_TTABLE:
+      regex_push_one( L, s, pr->re.re_nsub ? pm + 1 : pm );
+      lua_gettable( L, 3 );
+      break;
+
+    default:
+      lua_pushvalue( L, 3 );
+      lua_call( L, regex_push_captures( L, pr, s, pm ), 1 );
+      break;
+  }
+  if( !lua_toboolean( L, -1 ) )
+  {
+    // nil or false: keep the original text
+    lua_pop( L, 1 );
+    lua_pushlstring( L, s + pm[ 0 ].rm_so, ( size_t )( pm[ 0 ].rm_eo - pm[ 0 ].rm_so ) );
+  }
+  else if( !lua_isstring( L, -1 ) )
+    luaL_error( L, "invalid replacement value (a %s)", luaL_typename( L, -1 ) );
+  luaL_addvalue( b );
+}
+
+// Lua: news, count = re:gsub( s, repl, [max] )
+// 'repl' is a string (%0-%9 are the captures), a table indexed by the first
+// capture or a function called with the captures, like in string.gsub
+static int regex_gsub( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+  size_t len, pos = 0;
+  const char *s = luaL_checklstring( L, 2, &len );
+  int tr = lua_type( L, 3 );
+  int max_s = luaL_optint( L, 4, len + 1 );
+  int n = 0;
+  regmatch_t pm[ REGEX_MAX_MATCH ];
+  luaL_Buffer b;
+
+  luaL_argcheck( L, tr == LUA_TNUMBER || tr == LUA_TSTRING ||
+                    tr == LUA_TFUNCTION || tr == LUA_TTABLE ||
+                    tr == LUA_TLIGHTFUNCTION, 3,
+                    "string/function/table/lightfunction expected" );
+  luaL_buffinit( L, &b );
+  while( n < max_s && pos <= len && regex_run( L, pr, s, len, pos, len, regex_nmatch( pr ), pm ) )
+  {
+    // Copy the text up to the match in one go
+    luaL_addlstring( &b, s + pos, ( size_t )pm[ 0 ].rm_so - pos );
+    n ++;
+    regex_add_value( L, &b, pr, s, pm );
+    pos = ( size_t )pm[ 0 ].rm_eo;
+    if( pm[ 0 ].rm_eo == pm[ 0 ].rm_so )
+    {
+      // Empty match: keep the next char and search after it
+      if( pos < len )
+        luaL_addchar( &b, s[ pos ] );
+      pos ++;
+    }
+  }
+  if( pos < len )
+    luaL_addlstring( &b, s + pos, len - pos );
+  luaL_pushresult( &b );
+  lua_pushinteger( L, n );
+  return 2;
+}
+
+// Lua: n = re:nsub() (number of parenthesized subexpressions)
+static int regex_nsub( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+
+  lua_pushinteger( L, pr->re.re_nsub );
+  return 1;
+}
+
+static int regex_gc( lua_State *L )
+{
+  regex_ud *pr = regex_check( L );
+
+  if( pr->compiled )
+  {
+    regfree( &pr->re );
+    pr->compiled = 0;
+  }
+  return 0;
+}
+
+static int regex_tostring( lua_State *L )
+{
+  lua_pushfstring( L, "regex (%p)", regex_check( L ) );
+  return 1;
+}
+
+// Module function map
+#define MIN_OPT_LEVEL 2
+#include "lrodefs.h"
+const LUA_REG_TYPE regex_map[] =
+{
+  { LSTRKEY( "compile" ), LFUNCVAL( regex_compile ) },
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE regex_mt_map[] =
+{
+  { LSTRKEY( "test" ), LFUNCVAL( regex_test ) },
+  { LSTRKEY( "find" ), LFUNCVAL( regex_find ) },
+  { LSTRKEY( "match" ), LFUNCVAL( regex_match ) },
+  { LSTRKEY( "gmatch" ), LFUNCVAL( regex_gmatch ) },
+  { LSTRKEY( "gsub" ), LFUNCVAL( regex_gsub ) },
+  { LSTRKEY( "nsub" ), LFUNCVAL( regex_nsub ) },
+  { LSTRKEY( "__gc" ), LFUNCVAL( regex_gc ) },
+  { LSTRKEY( "__tostring" ), LFUNCVAL( regex_tostring ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "__index" ), LROVAL( regex_mt_map ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
+LUALIB_API int luaopen_regex( lua_State *L )
+{
+#if LUA_OPTIMIZE_MEMORY > 0
+  luaL_rometatable( L, META_NAME, ( void* )regex_mt_map );
+  return 0;
+#else // #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_newmetatable( L, META_NAME );
+  lua_pushvalue( L, -1 );
+  lua_setfield( L, -2, "__index" );
+  luaL_register( L, NULL, regex_mt_map );
+  luaL_register( L, AUXLIB_REGEX, regex_map );
+  return 1;
+#endif // #if LUA_OPTIMIZE_MEMORY > 0
+}
+
+#endif // #ifdef BUILD_REGEX
@@ -53,28 +53,47 @@ static int spi_setup( lua_State* L )
   return 1;
 }
 
+// Helper: push a received value, the values are moved to the result table
+// (at index 'tidx') in chunks
+static void spih_push_value( lua_State *L, int tidx, spi_data_type value, int *pending, int *residx )
+{
+  lua_pushnumber( L, value );
+  if( ++ *pending == LUAL_ARRAYCHUNK )
+  {
+    lua_rawsetarray( L, tidx, *residx, *pending );
+    *residx += *pending;
+    *pending = 0;
+  }
+}
+
 // Helper function: generic write/readwrite
 static int spi_rw_helper( lua_State *L, int withread )
 {
   spi_data_type value;
   const char *sval; 
   int total = lua_gettop( L ), i, j, id;
-  size_t len, residx = 1;
+  int residx = 1, pending = 0, count = 0;
+  size_t len;
   
   id = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( spi, id );
   if( withread )
-    lua_newtable( L );
+  {
+    // Size the result table for all the values that will be received
+    for( i = 2; i <= total; i ++ )
+      if( lua_isnumber( L, i ) )
+        count ++;
+      else if( lua_isstring( L, i ) )
+        count += lua_objlen( L, i );
+    lua_createtable( L, count, 0 );
+  }
   for( i = 2; i <= total; i ++ )
   {
     if( lua_isnumber( L, i ) )
     {
       value = platform_spi_send_recv( id, lua_tointeger( L, i ) );
       if( withread )
-      {
-        lua_pushnumber( L, value );
-        lua_rawseti( L, -2, residx ++ );
-      }
+        spih_push_value( L, total + 1, value, &pending, &residx );
     }
     else if( lua_isstring( L, i ) )
     {
@@ -83,13 +102,12 @@ static int spi_rw_helper( lua_State *L, int withread )
       {
         value = platform_spi_send_recv( id, sval[ j ] );
         if( withread )
-        {
-          lua_pushnumber( L, value );
-          lua_rawseti( L, -2, residx ++ );
-        }
+          spih_push_value( L, total + 1, value, &pending, &residx );
       }
     }
   }
+  if( pending > 0 )
+    lua_rawsetarray( L, total + 1, residx, pending );
   return withread ? 1 : 0;
 }
 
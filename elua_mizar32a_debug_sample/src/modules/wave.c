@@ -0,0 +1,370 @@
+// Module for playing waveforms on PWM channels and GPIO ports
+// The samples are output from the match interrupt of a timer (set with
+// platform_timer_set_match_int), one sample per interrupt. Each engine has
+// two buffers: the one being played and the next one, queued by wave.play
+// while the first one plays, so a stream can be refilled without gaps. The
+// interrupt is only enabled while there is something to play.
+
+#include "lualib.h"
+#include "lauxlib.h"
+#include "platform.h"
+#include "auxmods.h"
+#include "lrotable.h"
+#include "platform_conf.h"
+#include "common.h"
+#include "elua_int.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( BUILD_WAVE )
+
+#if !defined( BUILD_C_INT_HANDLERS )
+#error The wave module needs BUILD_C_INT_HANDLERS
+#endif
+
+// Number of waveforms that can play at the same time (one per timer)
+#ifndef WAVE_NUM_ENGINES
+#define WAVE_NUM_ENGINES          2
+#endif
+
+// Output types
+#define WAVE_OUT_NONE             0
+#define WAVE_OUT_PWM              1
+#define WAVE_OUT_PIO              2
+
+// A sample buffer: PWM duty cycles (in PWM clock ticks) or port values
+typedef struct
+{
+  u32 *data;
+  u32 count;
+  u8 loop;
+} wave_buf;
+
+typedef struct
+{
+  unsigned timer_id;
+  u8 output;                // WAVE_OUT_xxx
+  u8 resnum;                // PWM channel or port
+  volatile u8 running;      // the timer interrupt is enabled (not idle)
+  volatile u8 idle;         // no buffer is playing
+  volatile u8 cur;          // buffer being played
+  volatile u8 next_ready;   // buffer 'cur ^ 1' is queued
+  volatile u8 streaming;    // buffer 'cur' was queued behind another one
+  pio_type mask;            // (PIO) pins of the port driven by the engine
+  u32 maxval;               // (PWM) sample value for a 100% duty cycle
+  u32 period;               // (PWM) channel period in ticks
+  volatile u32 pos;         // next sample in the current buffer
+  volatile u32 underruns;   // times the output ran out of data
+  volatile u32 played;      // buffers played to the end
+  wave_buf buf[ 2 ];
+} wave_state;
+
+static wave_state wave_engines[ WAVE_NUM_ENGINES ];
+static elua_int_c_handler prev_tmr_handler;
+
+// ****************************************************************************
+// Engine
+
+// Output one sample, called from the timer interrupt
+static void wave_step( wave_state *ws )
+{
+  wave_buf *pb = ws->buf + ws->cur;
+  u32 v;
+
+  if( ws->idle || ws->pos >= pb->count )
+  {
+    if( !ws->idle )
+      ws->played ++;
+    if( ws->next_ready )
+    {
+      // Switch to the queued buffer (the old one is freed by wave.play)
+      ws->cur ^= 1;
+      ws->next_ready = 0;
+      ws->streaming = !ws->idle;
+      ws->idle = 0;
+      pb = ws->buf + ws->cur;
+    }
+    else if( ws->idle || !pb->loop )
+    {
+      // Out of data: hold the last value and stop the interrupt until
+      // wave.play queues another buffer. That's an underrun only for a
+      // stream, the end of a buffer played on its own is a normal stop.
+      if( !ws->idle && ws->streaming )
+        ws->underruns ++;
+      ws->streaming = 0;
+      ws->idle = 1;
+      ws->running = 0;
+      platform_cpu_set_interrupt( INT_TMR_MATCH, ws->timer_id, PLATFORM_CPU_DISABLE );
+      return;
+    }
+    ws->pos = 0;
+  }
+  v = pb->data[ ws->pos ++ ];
+  if( ws->output == WAVE_OUT_PWM )
+    platform_pwm_set_duty_ticks( ws->resnum, v );
+  else
+  {
+    if( v & ws->mask )
+      platform_pio_op( ws->resnum, v & ws->mask, PLATFORM_IO_PIN_SET );
+    if( ~v & ws->mask )
+      platform_pio_op( ws->resnum, ~v & ws->mask, PLATFORM_IO_PIN_CLEAR );
+  }
+}
+
+static void wave_tmr_handler( elua_int_resnum resnum )
+{
+  unsigned i;
+
+  for( i = 0; i < WAVE_NUM_ENGINES; i ++ )
+    if( wave_engines[ i ].running && wave_engines[ i ].timer_id == resnum )
+      wave_step( wave_engines + i );
+
+  // Chain to previous handler
+  if( prev_tmr_handler != NULL )
+    prev_tmr_handler( resnum );
+}
+
+// Stop the engine and free its buffers
+static void wave_stop_engine( wave_state *ws )
+{
+  if( ws->output != WAVE_OUT_NONE )
+  {
+    platform_cpu_set_interrupt( INT_TMR_MATCH, ws->timer_id, PLATFORM_CPU_DISABLE );
+    platform_timer_set_match_int( ws->timer_id, 0, PLATFORM_TIMER_INT_CYCLIC );
+    ws->running = 0;
+  }
+  free( ws->buf[ 0 ].data );
+  free( ws->buf[ 1 ].data );
+  memset( ws, 0, sizeof( wave_state ) );
+}
+
+// Return the engine using timer 'id', or a free one if 'alloc' is true
+static wave_state* wave_find( unsigned id, int alloc )
+{
+  unsigned i;
+
+  for( i = 0; i < WAVE_NUM_ENGINES; i ++ )
+    if( wave_engines[ i ].output != WAVE_OUT_NONE && wave_engines[ i ].timer_id == id )
+      return wave_engines + i;
+  if( alloc )
+    for( i = 0; i < WAVE_NUM_ENGINES; i ++ )
+      if( wave_engines[ i ].output == WAVE_OUT_NONE )
+        return wave_engines + i;
+  return NULL;
+}
+
+static wave_state* wave_check( lua_State *L, int stackidx )
+{
+  unsigned id = ( unsigned )luaL_checkinteger( L, stackidx );
+  wave_state *ws;
+
+  if( ( ws = wave_find( id, 0 ) ) == NULL )
+    luaL_error( L, "timer %d has no waveform setup", ( unsigned )id );
+  return ws;
+}
+
+// Wait condition for wave.play: the second buffer is free
+static int wave_slot_free_cond( void *arg )
+{
+  return !( ( wave_state* )arg )->next_ready;
+}
+
+// ****************************************************************************
+// Lua functions
+
+// Lua: realrate = setup( timer_id, rate, wave.PWM, pwm_id, [maxval] ), or
+//      realrate = setup( timer_id, rate, wave.PIO, port, [mask] )
+// Prepare timer 'timer_id' to output 'rate' samples per second. For PWM the
+// channel must be already set up (pwm.setup) and the samples are duty cycles
+// from 0 to 'maxval' (default 255). For PIO the samples are written to the
+// pins of 'port' selected by 'mask' (default all pins). Only hardware timers
+// can drive the engine, not the virtual ones.
+static int wave_setup( lua_State *L )
+{
+  unsigned id = ( unsigned )luaL_checkinteger( L, 1 );
+  lua_Number rate = luaL_checknumber( L, 2 );
+  int output = luaL_checkinteger( L, 3 );
+  int resnum = luaL_checkinteger( L, 4 );
+  wave_state *ws;
+  timer_data_type period_us;
+  int res;
+
+  MOD_CHECK_TIMER( id );
+  // The virtual timers only post Lua interrupts, they never call the C
+  // handlers, so they can't drive the engine
+  if( TIMER_IS_VIRTUAL( id ) )
+    return luaL_error( L, "virtual timer %d cannot play a waveform", ( unsigned )id );
+  if( rate <= 0 || rate > 1000000 )
+    return luaL_error( L, "invalid rate" );
+  period_us = ( timer_data_type )( 1000000 / rate + 0.5 );
+  if( ( ws = wave_find( id, 1 ) ) == NULL )
+    return luaL_error( L, "too many waveforms" );
+  wave_stop_engine( ws );
+  ws->timer_id = id;
+  if( output == WAVE_OUT_PWM )
+  {
+    MOD_CHECK_ID( pwm, resnum );
+    if( ( ws->period = platform_pwm_get_period( resnum ) ) == 0 )
+      return luaL_error( L, "PWM %d is not set up", resnum );
+    if( ( ws->maxval = ( u32 )luaL_optinteger( L, 5, 255 ) ) == 0 )
+      return luaL_error( L, "invalid maximum value" );
+    platform_pwm_prepare_duty_ticks( resnum );
+  }
+  else if( output == WAVE_OUT_PIO )
+  {
+    if( !PLATFORM_IO_IS_PORT( resnum ) || !platform_pio_has_port( PLATFORM_IO_GET_PORT( resnum ) ) )
+      return luaL_error( L, "invalid port" );
+    resnum = PLATFORM_IO_GET_PORT( resnum );
+    ws->mask = ( pio_type )luaL_optnumber( L, 5, PLATFORM_IO_ALL_PINS );
+  }
+  else
+    return luaL_error( L, "invalid output type" );
+  ws->output = output;
+  ws->resnum = resnum;
+  if( ( res = platform_timer_set_match_int( id, period_us, PLATFORM_TIMER_INT_CYCLIC ) ) != PLATFORM_TIMER_INT_OK )
+  {
+    wave_stop_engine( ws );
+    if( res == PLATFORM_TIMER_INT_TOO_SHORT )
+      return luaL_error( L, "timer interval too small" );
+    else if( res == PLATFORM_TIMER_INT_TOO_LONG )
+      return luaL_error( L, "timer interval too long" );
+    return luaL_error( L, "match interrupt cannot be set on this timer" );
+  }
+  // Nothing to play yet: the engine holds the output and the interrupt
+  // stays off until wave.play
+  ws->idle = 1;
+  if( elua_int_get_c_handler( INT_TMR_MATCH ) != wave_tmr_handler )
+    prev_tmr_handler = elua_int_set_c_handler( INT_TMR_MATCH, wave_tmr_handler );
+  if( platform_cpu_set_interrupt( INT_TMR_MATCH, id, PLATFORM_CPU_DISABLE ) != PLATFORM_INT_OK )
+  {
+    wave_stop_engine( ws );
+    return luaL_error( L, "the timer interrupt is not available" );
+  }
+  lua_pushnumber( L, ( lua_Number )1000000 / period_us );
+  return 1;
+}
+
+// Lua: ok = play( timer_id, data, [loop], [wait_timer_id], [timeout] )
+// Queue 'data' (a string of 8-bit samples or a table of samples) after the
+// buffer that is playing. If a buffer is already queued, wait until it starts
+// playing (default: wait forever). A looping buffer plays until the next one
+// is queued. Returns false on timeout.
+static int wave_play( lua_State *L )
+{
+  wave_state *ws = wave_check( L, 1 );
+  size_t count, i;
+  const char *pstr = NULL;
+  u32 *pdata, v;
+  int loop = lua_toboolean( L, 3 );
+  unsigned wait_id;
+  timer_data_type timeout;
+  int old_status;
+  wave_buf *pb;
+
+  if( lua_type( L, 2 ) == LUA_TSTRING )
+    pstr = lua_tolstring( L, 2, &count );
+  else
+  {
+    luaL_checktype( L, 2, LUA_TTABLE );
+    count = lua_objlen( L, 2 );
+  }
+  if( count == 0 )
+    return luaL_error( L, "no samples" );
+  cmn_get_timeout_data( L, 4, &wait_id, &timeout );
+  if( ( pdata = ( u32* )malloc( count * sizeof( u32 ) ) ) == NULL )
+    return luaL_error( L, "not enough memory" );
+  for( i = 0; i < count; i ++ )
+  {
+    if( pstr )
+      v = ( u8 )pstr[ i ];
+    else
+    {
+      lua_rawgeti( L, 2, i + 1 );
+      v = ( u32 )lua_tonumber( L, -1 );
+      lua_pop( L, 1 );
+    }
+    if( ws->output == WAVE_OUT_PWM )
+      v = ( u32 )( ( u64 )UMIN( v, ws->maxval ) * ws->period / ws->maxval );
+    pdata[ i ] = v;
+  }
+  if( !cmn_wait_event( wave_slot_free_cond, ws, wait_id, timeout ) )
+  {
+    free( pdata );
+    lua_pushboolean( L, 0 );
+    return 1;
+  }
+  // With 'next_ready' clear the interrupt handler doesn't use the other
+  // buffer, and it switches to it at the end of the current one (or at the
+  // next sample if nothing is playing, the interrupt is then restarted)
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  pb = ws->buf + ( ws->cur ^ 1 );
+  free( pb->data );
+  pb->data = pdata;
+  pb->count = count;
+  pb->loop = loop;
+  ws->next_ready = 1;
+  if( !ws->running )
+  {
+    ws->running = 1;
+    platform_cpu_set_interrupt( INT_TMR_MATCH, ws->timer_id, PLATFORM_CPU_ENABLE );
+  }
+  platform_cpu_set_global_interrupts( old_status );
+  lua_pushboolean( L, 1 );
+  return 1;
+}
+
+// Lua: stop( timer_id )
+static int wave_stop( lua_State *L )
+{
+  wave_stop_engine( wave_check( L, 1 ) );
+  return 0;
+}
+
+// Lua: playing, queued, underruns, played = status( timer_id )
+// 'playing' is true while there are samples to output, 'queued' if a buffer
+// is waiting to be played, 'underruns' the number of times a stream ran out
+// of data (a buffer that was queued behind another one ended with nothing
+// queued after it; a single buffer played to its end doesn't count) and
+// 'played' the number of buffers (or loops of a looping buffer) played to
+// the end
+static int wave_status( lua_State *L )
+{
+  wave_state *ws = wave_check( L, 1 );
+
+  lua_pushboolean( L, !ws->idle || ws->next_ready );
+  lua_pushboolean( L, ws->next_ready );
+  lua_pushinteger( L, ws->underruns );
+  lua_pushinteger( L, ws->played );
+  return 4;
+}
+
+// Module function map
+#define MIN_OPT_LEVEL 2
+#include "lrodefs.h"
+const LUA_REG_TYPE wave_map[] =
+{
+  { LSTRKEY( "setup" ), LFUNCVAL( wave_setup ) },
+  { LSTRKEY( "play" ), LFUNCVAL( wave_play ) },
+  { LSTRKEY( "stop" ), LFUNCVAL( wave_stop ) },
+  { LSTRKEY( "status" ), LFUNCVAL( wave_status ) },
+#if LUA_OPTIMIZE_MEMORY > 0
+  { LSTRKEY( "PWM" ), LNUMVAL( WAVE_OUT_PWM ) },
+  { LSTRKEY( "PIO" ), LNUMVAL( WAVE_OUT_PIO ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
+LUALIB_API int luaopen_wave( lua_State *L )
+{
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else // #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_register( L, AUXLIB_WAVE, wave_map );
+  MOD_REG_NUMBER( L, "PWM", WAVE_OUT_PWM );
+  MOD_REG_NUMBER( L, "PIO", WAVE_OUT_PIO );
+  return 1;
+#endif // #if LUA_OPTIMIZE_MEMORY > 0
+}
+
+#endif // #if defined( BUILD_WAVE )
@@ -18,6 +18,7 @@
 
 #ifdef USE_MULTIPLE_ALLOCATOR
 #include "dlmalloc.h"
+#include "elua_heap.h"
 #else
 #include <malloc.h>
 #endif
@@ -475,7 +476,9 @@ void* _sbrk_r( struct _reent* r, ptrdiff_t incr )
 // mallinfo()
 struct mallinfo mallinfo( void )
 {
-#ifdef USE_MULTIPLE_ALLOCATOR
+#if defined( USE_HEAP_REGIONS )
+  return elua_heap_mallinfo();
+#elif defined( USE_MULTIPLE_ALLOCATOR )
   return dlmallinfo();
 #else
   return _mallinfo_r( _REENT );
@@ -485,7 +488,9 @@ struct mallinfo mallinfo( void )
 #if defined( USE_MULTIPLE_ALLOCATOR ) || defined( USE_SIMPLE_ALLOCATOR )
 // Redirect all allocator calls to our dlmalloc/salloc 
 
-#ifdef USE_MULTIPLE_ALLOCATOR
+#if defined( USE_HEAP_REGIONS )
+#define CNAME( func ) elua_heap_##func
+#elif defined( USE_MULTIPLE_ALLOCATOR )
 #define CNAME( func ) dl##func
 #else
 #define CNAME( func ) s##func
@@ -71,7 +71,7 @@ static int nffs_open_r( struct _reent *r, const char *path, int flags, int mode,
   }
 
   // If file name starts with autorun or lin_, then put it on the linear filesystem
-  if ((strncmp("lin_", path, 7) == 0) || (strncmp("autorun", path, 7) == 0)) {
+  if ((strncmp("lin_", path, 4) == 0) || (strncmp("autorun", path, 7) == 0)) {
     lflags |= NIFFS_O_LINEAR;
     //printf("-L\n");
   }
@@ -127,11 +127,17 @@ static off_t nffs_lseek_r( struct _reent *r, int fd, off_t off, int whence, void
 }
 
 // getaddr
+// Only linear files are contiguous in flash, paged files can't be mapped
 static const char* nffs_getaddr_r( struct _reent *r, int fd, void *pdata )
 {
   u8_t * ptrptr;
   u32_t len;
-  NIFFS_read_ptr(&fs, fd, &ptrptr, &len);
+  niffs_stat s;
+
+  if( NIFFS_fstat(&fs, fd, &s) < 0 || s.type != _NIFFS_FTYPE_LINFILE )
+    return NULL;
+  if( NIFFS_read_ptr(&fs, fd, &ptrptr, &len) < 0 )
+    return NULL;
   //printf("getaddr %p\n", (u32_t *)ptrptr);
   return (char*)ptrptr;
 }
@@ -258,6 +264,17 @@ static int nffs_unlink_r( struct _reent *r, const char *path, void *pdata )
   return NIFFS_remove(&fs, (char *)path);
 }
 
+// rename (only changes the name in the file header, no data is copied)
+static int nffs_rename_r( struct _reent *r, const char *oldname, const char *newname, void *pdata )
+{
+  if( NIFFS_rename(&fs, oldname, newname) < 0 )
+  {
+    r->_errno = EACCES;
+    return -1;
+  }
+  return 0;
+}
+
 static const DM_DEVICE niffs_device = 
 {
   nffs_open_r,         // open
@@ -272,7 +289,7 @@ static const DM_DEVICE niffs_device =
   NULL,                // mkdir
   nffs_unlink_r,       // unlink
   NULL,                // rmdir
-  NULL                 // rename // TODO peter, this exists in niffs also if you want it
+  nffs_rename_r        // rename
 };
 
 static int platform_hal_erase_f(u8_t *addr, u32_t len) {
@@ -286,7 +303,7 @@ static int platform_hal_erase_f(u8_t *addr, u32_t len) {
   if (addr+len > &_flash[0] + EMUL_SECTORS * EMUL_SECTOR_SIZE) return ERR_NIFFS_TEST_BAD_ADDR;
   if ((addr - &_flash[0]) % EMUL_SECTOR_SIZE) return ERR_NIFFS_TEST_BAD_ADDR;
   if (len != EMUL_SECTOR_SIZE) return ERR_NIFFS_TEST_BAD_ADDR;*/
-  platform_flash_erase_sector(((u32_t)addr)/INTERNAL_FLASH_SECTOR_SIZE); // == PLATFORM_OK;
+  platform_flash_erase_sector(platform_flash_get_sector_of_address((u32_t)addr)); // == PLATFORM_OK;
   NFFS_DBG("N_E:%li,%li\n", (u32_t)addr, len);
   return NIFFS_OK;
 }
@@ -301,6 +318,9 @@ static int platform_hal_write_f(u8_t *addr, const u8_t *src, u32_t len) {
   //  toaddr += ( u32 )pfsdata->pbase;
   //platform_flash_write( const void *from, u32 toaddr, u32 size )
   platform_flash_write( src, (u32_t)addr, len );
+  // NIFFS reads its page headers straight from flash between writes, so
+  // nothing may stay in the write buffer of platform_flash_write
+  platform_flash_sync();
   NFFS_DBG("N_W:%li,%li,%li\n", (u32_t)addr, (u32_t)src, len);
   return NIFFS_OK;
 }
@@ -1537,7 +1537,7 @@ static int niffs_gc_find_candidate_sector(niffs *fs, niffs_gc_sector_cand *cand,
   return res;
 }
 
-int niffs_gc(niffs *fs, u32_t *freed_pages, u8_t allow_full_sector) {
+static int niffs_gc_sector(niffs *fs, u32_t *freed_pages, u8_t allow_full_sector) {
   niffs_gc_sector_cand cand;
   int res = niffs_gc_find_candidate_sector(fs, &cand, allow_full_sector);
   check(res);
@@ -1581,6 +1581,15 @@ int niffs_gc(niffs *fs, u32_t *freed_pages, u8_t allow_full_sector) {
   return res;
 }
 
+int niffs_gc(niffs *fs, u32_t *freed_pages, u8_t allow_full_sector) {
+  int res;
+  CMN_TRACE(CMN_TRACE_NIFFS_GC, fs->free_pages, fs->dele_pages);
+  *freed_pages = 0;
+  res = niffs_gc_sector(fs, freed_pages, allow_full_sector);
+  CMN_TRACE(CMN_TRACE_NIFFS_GC_END, res, *freed_pages);
+  return res;
+}
+
 /////////////////////////////////// CHECK ////////////////////////////////////
 
 static int niffs_map_obj_hdr_ids_v(niffs *fs, niffs_page_ix pix, niffs_page_hdr *phdr, void *v_arg) {
@@ -59,6 +59,31 @@
 #define PLATFORM_INT_QUEUE_LOG_SIZE      5
 #define BUILD_LUA_INT_HANDLERS
 
+// Configuration for element 'profiler'
+#define BUILD_PROFILER
+
+// Configuration for element 'regex'
+#define BUILD_REGEX
+
+// Configuration for element 'wave' (needs 'cints')
+#define WAVE_NUM_ENGINES                 2
+#define BUILD_WAVE
+
+// Configuration for element 'can_sim' (define BUILD_CAN_SIM to enable)
+// The AT32UC3A has no CAN controller: this adds simulated controllers on a
+// virtual bus (src/elua_can_sim.c) to run the 'can' module without hardware
+#define CAN_SIM_NUM                      2
+#define CAN_RX_QUEUE_SIZE                16
+//#define BUILD_CAN_SIM
+#ifdef BUILD_CAN_SIM
+#undef NUM_CAN
+#define NUM_CAN                          CAN_SIM_NUM
+#endif
+
+// Configuration for element 'trace' (define BUILD_TRACE to enable)
+#define CMN_TRACE_LOG_SIZE               8
+//#define BUILD_TRACE
+
 // Configuration for element 'avr32_lcd'
 #define BUILD_LCD
 
@@ -93,6 +118,7 @@
   { "cp", shell_cp },\
   { "mv", shell_adv_mv },\
   { "recv", shell_recv },\
+  { "trace", shell_trace },\
   { NULL, NULL }
 #define BUILD_ADVANCED_SHELL
 #define BUILD_SHELL
@@ -223,6 +249,12 @@
 #warning Unable to include generic module 'i2c' in the image
 #endif
 
+#if ( NUM_CAN > 0 )
+#define MODULE_CAN_LINE                  _ROM( AUXLIB_CAN, luaopen_can, can_map )
+#else
+#define MODULE_CAN_LINE
+#endif
+
 #if defined( BUILD_UIP )
 #define MODULE_NET_LINE                  _ROM( AUXLIB_NET, luaopen_net, net_map )
 #else
@@ -265,6 +297,24 @@
 
 #define MODULE_PD_LINE                   _ROM( AUXLIB_PD, luaopen_pd, pd_map )
 
+#if defined( BUILD_PROFILER )
+#define MODULE_PROFILER_LINE             _ROM( AUXLIB_PROFILER, luaopen_profiler, profiler_map )
+#else
+#define MODULE_PROFILER_LINE
+#endif
+
+#if defined( BUILD_REGEX )
+#define MODULE_REGEX_LINE                _ROM( AUXLIB_REGEX, luaopen_regex, regex_map )
+#else
+#define MODULE_REGEX_LINE
+#endif
+
+#if defined( BUILD_WAVE )
+#define MODULE_WAVE_LINE                 _ROM( AUXLIB_WAVE, luaopen_wave, wave_map )
+#else
+#define MODULE_WAVE_LINE
+#endif
+
 #define LUA_PLATFORM_LIBS_ROM\
   PLATFORM_MODULES_LINE\
   MODULE_ADC_LINE\
@@ -277,6 +327,7 @@
   MODULE_ELUA_LINE\
   MODULE_PACK_LINE\
   MODULE_I2C_LINE\
+  MODULE_CAN_LINE\
   MODULE_NET_LINE\
   MODULE_SPI_LINE\
   MODULE_UART_LINE\
@@ -286,7 +337,10 @@
   MODULE_CPU_LINE\
   MODULE_PWM_LINE\
   MODULE_PIO_LINE\
-  MODULE_PD_LINE
+  MODULE_PD_LINE\
+  MODULE_PROFILER_LINE\
+  MODULE_REGEX_LINE\
+  MODULE_WAVE_LINE
 
 #if defined( BUILD_LCD )
 #define PL_MODULE_LCD_LINE               _ROM( "lcd", luaopen_dummy, lcd_map )
@@ -32,6 +32,14 @@
 #define AVR32_NUM_GPIO        110 // actually 109, but consider also PA31
 
 #define RAM_SIZE 0x8000
+
+// Internal flash (used by WOFS and NIFFS). A sector is a FLASHC page, which
+// is also programmed in a single cycle
+#define INTERNAL_FLASH_SIZE             ( 128 * 1024 )
+#define INTERNAL_FLASH_SECTOR_SIZE      512
+#define INTERNAL_FLASH_PAGE_SIZE        512
+#define INTERNAL_FLASH_START_ADDRESS    0x80000000
+
 #define INTERNAL_RAM1_FIRST_FREE  end
 #define INTERNAL_RAM1_LAST_FREE   ( RAM_SIZE - STACK_SIZE_TOTAL - 1 )
 
@@ -39,7 +47,8 @@
  _C( INT_UART_RX ),\
  _C( INT_TMR_MATCH ),\
  _C( INT_GPIO_POSEDGE ),\
- _C( INT_GPIO_NEGEDGE ),
+ _C( INT_GPIO_NEGEDGE ),\
+ _C( INT_ADC_BLOCK ),
 
 #endif // #ifndef __CPU_AT32UC3A0128_H__
 
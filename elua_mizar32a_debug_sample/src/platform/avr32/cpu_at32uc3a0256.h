@@ -9,5 +9,8 @@
 #undef RAM_SIZE
 #define RAM_SIZE 0x10000
 
+#undef INTERNAL_FLASH_SIZE
+#define INTERNAL_FLASH_SIZE             ( 256 * 1024 )
+
 #endif // #ifndef __CPU_AT32UC3A0256_H__
 
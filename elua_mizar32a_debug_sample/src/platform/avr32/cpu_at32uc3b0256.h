@@ -39,7 +39,8 @@
  _C( INT_UART_RX ),\
  _C( INT_TMR_MATCH ),\
  _C( INT_GPIO_POSEDGE ),\
- _C( INT_GPIO_NEGEDGE ),
+ _C( INT_GPIO_NEGEDGE ),\
+ _C( INT_ADC_BLOCK ),
 
 #endif // #ifndef __CPU_AT32UC3B0256_H__
 
@@ -124,6 +124,7 @@ static u32 platform_timer_set_clock( unsigned id, u32 clock );
 
 #ifdef BUILD_ADC
 __attribute__((__interrupt__)) static void adc_int_handler();
+__attribute__((__interrupt__)) static void adc_pdca_int_handler();
 #endif
 
 const u32 uart_base_addr[ ] = {
@@ -210,6 +211,7 @@ int platform_init()
 #ifdef BUILD_ADC
   (&AVR32_ADC)->ier = AVR32_ADC_DRDY_MASK;
   INTC_register_interrupt( &adc_int_handler, AVR32_ADC_IRQ, AVR32_INTC_INT0);
+  INTC_register_interrupt( &adc_pdca_int_handler, AVR32_PDCA_IRQ_0 + ADC_PDCA_CH, AVR32_INTC_INT0 );
 
   for( i = 0; i < NUM_ADC; i++ )
     adc_init_ch_state( i );
@@ -279,6 +281,10 @@ pio_type platform_pio_op( unsigned port, pio_type pinmask, int op )
       gpio_regs->ovrc = pinmask;
       break;
 
+    case PLATFORM_IO_PIN_TOGGLE:
+      gpio_regs->ovrt = pinmask;
+      break;
+
     case PLATFORM_IO_PORT_DIR_INPUT:
       pinmask = 0xFFFFFFFF;
     case PLATFORM_IO_PIN_DIR_INPUT:
@@ -783,6 +789,27 @@ int platform_cpu_get_global_interrupts()
   return Is_global_interrupt_enabled();
 }
 
+// Parts whose header defines the GM clear bit enable the interrupts and go
+// to sleep atomically, so an interrupt arriving after the caller checked its
+// wait condition (with the interrupts disabled) still wakes the CPU up. The
+// UC3A0 can't: the interrupts are enabled just before 'sleep', and an
+// interrupt taken in between only wakes the CPU at the next interrupt, so it
+// only sleeps when the caller has a periodic interrupt ('bounded').
+int platform_cpu_idle( int bounded )
+{
+#ifdef AVR32_PM_SMODE_GMCLEAR_MASK
+  SLEEP( AVR32_PM_SMODE_GMCLEAR_MASK | AVR32_PM_SMODE_IDLE );
+  Enable_global_interrupt();
+  return 1;
+#else
+  Enable_global_interrupt();
+  if( !bounded )
+    return 0;
+  SLEEP( AVR32_PM_SMODE_IDLE );
+  return 1;
+#endif
+}
+
 // ****************************************************************************
 // ADC functions
 
@@ -894,6 +921,10 @@ int platform_adc_start_sequence( )
 {
   elua_adc_dev_state *d = adc_get_dev_state( 0 );
 
+  // The ADC is busy with a continuous acquisition
+  if ( adc_get_stream_state()->running )
+    return PLATFORM_ERR;
+
   // Only force update and initiate if we weren't already running
   // changes will get picked up during next interrupt cycle
   if ( d->running != 1 )
@@ -910,6 +941,107 @@ int platform_adc_start_sequence( )
   return PLATFORM_OK;
 }
 
+// Continuous acquisition: a timer output (TIOA) triggers the conversion of
+// all the enabled channels and the PDCA copies every result to memory. The
+// PDCA reload registers are used to switch between the two blocks without
+// losing samples; the interrupt comes when a block is complete and sets up
+// the block to be filled after the current one.
+
+static unsigned adc_stream_timer_id;
+
+__attribute__((__interrupt__)) static void adc_pdca_int_handler()
+{
+  volatile avr32_pdca_channel_t *pdca = &AVR32_PDCA.channel[ ADC_PDCA_CH ];
+
+  // Writing TCRR also clears the interrupt
+  pdca->marr = ( u32 )adc_stream_block_done();
+  pdca->tcrr = adc_get_stream_state()->blocksize;
+#ifdef BUILD_INT_HANDLERS
+  if( adc_get_stream_state()->notify )
+    cmn_int_handler( INT_ADC_BLOCK, 0 );
+#endif
+}
+
+u32 platform_adc_stream_start( u32 chmask, unsigned timer_id, u32 freq, u16 *first, u16 *second, u16 count )
+{
+  volatile avr32_pdca_channel_t *pdca = &AVR32_PDCA.channel[ ADC_PDCA_CH ];
+  volatile avr32_tc_t *tc = &AVR32_TC;
+  elua_adc_dev_state *d = adc_get_dev_state( 0 );
+  u32 clock = 0, rc = 0;
+  unsigned i;
+
+  // Interrupt driven sampling still in progress
+  if( d->running || freq == 0 )
+    return 0;
+
+  // Fastest timer clock for which the period fits in 16 bits
+  for( i = 1; i < sizeof( clkdivs ) / sizeof( u16 ); i ++ )
+  {
+    clock = REQ_PBA_FREQ / clkdivs[ i ];
+    if( ( rc = ( clock + freq / 2 ) / freq ) <= 0xFFFF )
+      break;
+  }
+  if( rc < 2 || rc > 0xFFFF )
+    return 0;
+
+  // ADC: hardware trigger, no interrupts
+  adc->cr = AVR32_ADC_SWRST_MASK;
+  adc->idr = AVR32_ADC_DRDY_MASK;
+  adc_configure( adc );
+  adc->MR.trgsel = timer_id;
+  adc->MR.trgen = 1;
+  for( i = 0; i < NUM_ADC; i ++ )
+    if( chmask & ( ( u32 )1 << i ) )
+    {
+      adc_enable( adc, i );
+      gpio_enable_module( adc_pins + i, 1 );
+    }
+  ( void )adc->lcdr;
+
+  // PDCA: first block now, second one on reload
+  pdca->cr = AVR32_PDCA_TDIS_MASK;
+  pdca->psr = AVR32_PDCA_PID_ADC_RX;
+  pdca->mr = AVR32_PDCA_HALF_WORD << AVR32_PDCA_SIZE_OFFSET;
+  pdca->mar = ( u32 )first;
+  pdca->tcr = count;
+  pdca->marr = ( u32 )second;
+  pdca->tcrr = count;
+  pdca->ier = AVR32_PDCA_RCZ_MASK;
+  pdca->cr = AVR32_PDCA_TEN_MASK | AVR32_PDCA_ECLR_MASK;
+
+  // Timer: TIOA goes high in the middle of each period
+  platform_timer_set_clock( timer_id, clock );
+  tc_stop( tc, timer_id );
+  tc->channel[ timer_id ].CMR.waveform.acpa = TC_EVT_EFFECT_SET;
+  tc->channel[ timer_id ].CMR.waveform.acpc = TC_EVT_EFFECT_CLEAR;
+  tc->channel[ timer_id ].CMR.waveform.wavsel = TC_WAVEFORM_SEL_UP_MODE_RC_TRIGGER;
+  tc->channel[ timer_id ].ra = rc >> 1;
+  tc->channel[ timer_id ].rc = rc;
+  tc_start( tc, timer_id );
+  adc_stream_timer_id = timer_id;
+
+  return clock / rc;
+}
+
+void platform_adc_stream_stop()
+{
+  volatile avr32_pdca_channel_t *pdca = &AVR32_PDCA.channel[ ADC_PDCA_CH ];
+  volatile avr32_tc_t *tc = &AVR32_TC;
+
+  tc_stop( tc, adc_stream_timer_id );
+  tc->channel[ adc_stream_timer_id ].CMR.waveform.acpa = TC_EVT_EFFECT_NOOP;
+  tc->channel[ adc_stream_timer_id ].CMR.waveform.acpc = TC_EVT_EFFECT_NOOP;
+  tc->channel[ adc_stream_timer_id ].CMR.waveform.wavsel = TC_WAVEFORM_SEL_UP_MODE;
+
+  pdca->idr = AVR32_PDCA_RCZ_MASK;
+  pdca->cr = AVR32_PDCA_TDIS_MASK;
+
+  // Back to software triggers and interrupts for the other ADC functions
+  adc->cr = AVR32_ADC_SWRST_MASK;
+  adc->ier = AVR32_ADC_DRDY_MASK;
+  adc_configure( adc );
+}
+
 #endif
 
 // ****************************************************************************
@@ -1064,6 +1196,27 @@ void platform_pwm_stop( unsigned id )
   pwm_channel_stop( id );
 }
 
+u32 platform_pwm_get_period( unsigned id )
+{
+  return AVR32_PWM.channel[ id ].cprd;
+}
+
+void platform_pwm_prepare_duty_ticks( unsigned id )
+{
+  pwm_channel_select_duty_update( id );
+}
+
+// The channel is running, so the new duty cycle goes through the update
+// register (CUPD, routed to CDTY by platform_pwm_prepare_duty_ticks) and is
+// applied at the end of the current period. It is inverted like in
+// platform_pwm_setup
+void platform_pwm_set_duty_ticks( unsigned id, u32 ticks )
+{
+  u32 period = AVR32_PWM.channel[ id ].cprd;
+
+  pwm_channel_update_duty_cycle( id, period - UMIN( ticks, period ) );
+}
+
 #endif // #if NUM_PWM > 0
 
 // ****************************************************************************
@@ -1108,6 +1261,47 @@ int platform_i2c_recv_byte( unsigned id, int ack )
   return i2c_read_byte( !ack );
 }
 
+// Uses the message level interface of the bit-banger, so the whole
+// transaction runs without going back to Lua
+int platform_i2c_transfer( unsigned id, u16 address, const u8 *wdata, unsigned wlen, u8 *rdata, unsigned rlen )
+{
+  // Write phase; with nothing to read either this just probes the address
+  if( wlen > 0 || rlen == 0 )
+  {
+    if( i2c_send( address, wdata, wlen, rlen == 0 ) != ( int )wlen )
+    {
+      if( rlen > 0 )
+        i2c_stop_cond();
+      return -1;
+    }
+    if( rlen == 0 )
+      return 0;
+  }
+  // Read phase, after a repeated start if something was written
+  return i2c_recv( address, rdata, rlen, true );
+}
+
+
+// ****************************************************************************
+// Internal flash support (WOFS and NIFFS)
+
+#if defined( BUILD_WOFS ) || defined( BUILD_NIFFS )
+
+// flashc_memcpy fills the page buffer with the current contents of every page
+// it touches and programs it (one cycle per page). The small writes to a page
+// are gathered by platform_flash_write in common.c.
+u32 platform_s_flash_write( const void *from, u32 toaddr, u32 size )
+{
+  flashc_memcpy( ( volatile void* )toaddr, from, size, FALSE );
+  return flashc_is_lock_error() || flashc_is_programming_error() ? 0 : size;
+}
+
+int platform_flash_erase_sector( u32 sector_id )
+{
+  return flashc_erase_page( sector_id, TRUE ) ? PLATFORM_OK : PLATFORM_ERR;
+}
+
+#endif // #if defined( BUILD_WOFS ) || defined( BUILD_NIFFS )
 
 // ****************************************************************************
 // Network support
@@ -4,6 +4,7 @@
 #define __PLATFORM_GENERIC_H__
 
 #define VTMR_CH               2    // Which hardware timer to use for VTMR
+#define ADC_PDCA_CH           0    // Which PDCA channel to use for continuous ADC acquisition
 
 // If virtual timers are enabled, the last timer will be used only for them
 #if VTMR_NUM_TIMERS > 0
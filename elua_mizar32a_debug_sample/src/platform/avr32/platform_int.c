@@ -7,6 +7,7 @@
 #include "platform.h"
 #include "elua_int.h"
 #include "common.h"
+#include "elua_adc.h"
 
 // Platform includes
 #include <avr32/io.h>
@@ -307,6 +308,40 @@ static int int_gpio_negedge_get_flag( elua_int_resnum resnum, int clear )
   return status;
 }
 
+// ****************************************************************************
+// Interrupt: INT_ADC_BLOCK
+// The PDCA interrupt is always enabled during a continuous acquisition (it
+// switches the blocks), this only controls whether it's signaled to eLua
+
+static int int_adc_block_get_status( elua_int_resnum resnum )
+{
+#ifdef BUILD_ADC
+  return adc_get_stream_state()->notify;
+#else
+  return 0;
+#endif
+}
+
+static int int_adc_block_set_status( elua_int_resnum resnum, int status )
+{
+  int prev = int_adc_block_get_status( resnum );
+
+#ifdef BUILD_ADC
+  adc_get_stream_state()->notify = status == PLATFORM_CPU_ENABLE;
+#endif
+  return prev;
+}
+
+static int int_adc_block_get_flag( elua_int_resnum resnum, int clear )
+{
+  ( void )clear; // the flag is cleared when the block is read
+#ifdef BUILD_ADC
+  return adc_get_stream_state()->ready;
+#else
+  return 0;
+#endif
+}
+
 // ****************************************************************************
 // Interrupt initialization
 
@@ -343,7 +378,8 @@ const elua_int_descriptor elua_int_table[ INT_ELUA_LAST ] =
   { int_uart_rx_set_status, int_uart_rx_get_status, int_uart_rx_get_flag },
   { int_tmr_match_set_status, int_tmr_match_get_status, int_tmr_match_get_flag },
   { int_gpio_posedge_set_status, int_gpio_posedge_get_status, int_gpio_posedge_get_flag },
-  { int_gpio_negedge_set_status, int_gpio_negedge_get_status, int_gpio_negedge_get_flag }
+  { int_gpio_negedge_set_status, int_gpio_negedge_get_status, int_gpio_negedge_get_flag },
+  { int_adc_block_set_status, int_adc_block_get_status, int_adc_block_get_flag }
 };
 
 #endif // #if defined( BUILD_C_INT_HANDLERS ) || defined( BUILD_LUA_INT_HANDLERS )
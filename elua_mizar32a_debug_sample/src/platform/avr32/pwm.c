@@ -254,6 +254,21 @@ static void pwm_channel_set_duty_cycle( unsigned id, u32 duty )
 }
 #endif
 
+// Duty cycle updates on a running channel, one per PWM period (used to
+// play waveforms): the update register is routed to CDTY once, then each
+// new duty cycle written to CUPD is applied at the start of the next period,
+// without glitches. The asynchronous period update above would route it to
+// CPRD, so call pwm_channel_select_duty_update again after it.
+void pwm_channel_select_duty_update( unsigned id )
+{
+  AVR32_PWM.channel[id].CMR.cpd = AVR32_PWM_CMR_CPD_UPDATE_CDTY;
+}
+
+void pwm_channel_update_duty_cycle( unsigned id, u32 duty )
+{
+  AVR32_PWM.channel[id].cupd = duty;
+}
+
 // Enable a PWM channel (set it running)
 void pwm_channel_start( int id )
 {
@@ -18,6 +18,11 @@ u32 pwm_get_clock_freq( void );
 // Set the parameters determining period and duty cycle for a channel
 void pwm_channel_set_period_and_duty_cycle( unsigned id, u32 period, u32 duty );
 
+// Route the update register of a channel to the duty cycle, then write
+// duty cycles to it (applied at the next period of the running channel)
+void pwm_channel_select_duty_update( unsigned id );
+void pwm_channel_update_duty_cycle( unsigned id, u32 duty );
+
 // Enable a PWM channel (set it running)
 void pwm_channel_start( int id );
 
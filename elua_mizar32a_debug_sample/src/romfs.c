@@ -35,6 +35,14 @@ static int wofs_sim_fd;
 // Length of the 'file size' field for both ROMFS/WOFS
 #define ROMFS_SIZE_LEN        4
 
+// platform_flash_write gathers small writes to a flash page, the page is
+// programmed when the file is closed or before WOFS reads from the flash
+#if defined( BUILD_WOFS ) && !defined( ELUA_CPU_LINUX )
+#define WOFS_SYNC()           platform_flash_sync()
+#else
+#define WOFS_SYNC()
+#endif
+
 static int romfs_find_empty_fd(void)
 {
   int i;
@@ -146,6 +154,7 @@ static int romfs_open_r( struct _reent *r, const char *path, int flags, int mode
     r->_errno = ENFILE;
     return -1;
   }
+  WOFS_SYNC();
   // Does the file exist?
   exists = romfs_open_file( path, &tempfs, pfsdata, &firstfree, &nameaddr ) == FS_FILE_OK;
   // Now interpret "flags" to set file flags and to check if we should create the file
@@ -265,6 +274,7 @@ static int romfs_close_r( struct _reent *r, int fd, void *pdata )
     temp[ 2 ] = ( pfd->size >> 16 ) & 0xFF;
     temp[ 3 ] = ( pfd->size >> 24 ) & 0xFF;
     pfsdata->writef( temp, pfd->baseaddr - ROMFS_SIZE_LEN, ROMFS_SIZE_LEN, pfsdata );
+    WOFS_SYNC();
     // Clear the "writing" flag on the FS instance to allow other files to be opened
     // in write mode
     romfs_fs_clear_flag( pfsdata, ROMFS_FS_FLAG_WRITING );
@@ -312,6 +322,8 @@ static _ssize_t romfs_read_r( struct _reent *r, int fd, void* ptr, size_t len, v
     r->_errno = EBADF;
     return -1;
   }
+  if( pfd->flags & ROMFS_FILE_FLAG_WRITE )
+    WOFS_SYNC();
   if( pfsdata->flags & ROMFS_FS_FLAG_DIRECT )
     memcpy( ptr, pfsdata->pbase + pfd->offset + pfd->baseaddr, actlen );
   else
@@ -357,6 +369,7 @@ static void* romfs_opendir_r( struct _reent *r, const char* dname, void *pdata )
 {
   if( !dname || strlen( dname ) == 0 || ( strlen( dname ) == 1 && !strcmp( dname, "/" ) ) )
   {
+    WOFS_SYNC();
     romfs_dir_data = 0;
     return &romfs_dir_data;
   }
@@ -447,6 +460,7 @@ static const DM_DEVICE romfs_device =
 // ****************************************************************************
 // ROMFS instance descriptor
 
+#ifdef BUILD_ROMFS
 static const FSDATA romfs_fsdata =
 {
   ( u8* )romfiles_fs,
@@ -455,6 +469,7 @@ static const FSDATA romfs_fsdata =
   NULL,
   sizeof( romfiles_fs )
 };
+#endif // #ifdef BUILD_ROMFS
 
 // ****************************************************************************
 // WOFS functions and instance descriptor for the simulator (testing)
@@ -526,6 +541,7 @@ int wofs_format( void )
   u32 sect_first, sect_last;
   FD tempfd;
 
+  WOFS_SYNC();
   platform_flash_get_first_free_block_address( &sect_first );
   // Get the first free address in WOFS. We use this address to compute the last block that we need to
   // erase, instead of simply erasing everything from sect_first to the last Flash page. 
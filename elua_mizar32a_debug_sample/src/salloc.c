@@ -1,5 +1,9 @@
-// A very simple, quite inneficient, yet very small memory allocator
-// It can do both fixed block and variable block allocation
+// A simple, small memory allocator
+// Segregated free lists with boundary tags: every block has a header with its
+// size and the size of the previous block (valid only when the previous block
+// is free), so neighbours are found and merged in constant time. Free blocks
+// live in 32 bins (exact-size bins for small blocks, power of two ranges for
+// larger ones) and a bitmap of the non-empty bins makes the search O(1).
 
 #ifdef USE_SIMPLE_ALLOCATOR
 
@@ -8,204 +12,214 @@
 #include "platform.h"
 #include "platform_conf.h"
 
-// Macros for the dynamic size allocator
-// Dynamic structure: pointer to next, pointer to prev
-// First bit of pointer is 0 if block free, 1 if block taken
-// Pointer must be multiplied by DYN_SIZE_MULT to get actual address
-// There are two 'guards' (at the beginning and at the end) 
-#define DYN_SIZE_MULT           8
-#define DYN_SIZE_MULT_SHIFT     3
-#define DYN_HEADER_SIZE         8
-#define DYN_MIN_SPLIT_SIZE      16
-
+// Block header. 'prev_size' is the boundary tag (footer) of the previous block
+// and is valid only if the previous block is free. The low bits of 'head' hold
+// the block flags, the rest is the block size (header included)
+typedef struct s_block
+{
+  size_t prev_size;
+  size_t head;
+  // The rest is only valid for free blocks
+  struct s_block *next_free;
+  struct s_block *prev_free;
+} s_block;
+
+#define S_ALIGN                 8
+#define S_ALIGN_MASK            ( S_ALIGN - 1 )
+#define S_INUSE                 1
+#define S_PREV_INUSE            2
+#define S_FLAGS                 ( S_INUSE | S_PREV_INUSE )
+#define S_HEADER_SIZE           offsetof( s_block, next_free )
+#define S_MIN_BLOCK             ( ( sizeof( s_block ) + S_ALIGN_MASK ) & ~S_ALIGN_MASK )
+
+// Bins: S_NUM_SMALL_BINS bins S_ALIGN bytes apart starting at S_MIN_BLOCK, then
+// power of two ranges
+#define S_NUM_BINS              32
+#define S_NUM_SMALL_BINS        16
+#define S_SMALL_LIMIT           ( S_MIN_BLOCK + S_NUM_SMALL_BINS * S_ALIGN )
+
+#define S_SIZE( b )             ( ( b )->head & ~( size_t )S_FLAGS )
+#define S_IS_INUSE( b )         ( ( b )->head & S_INUSE )
+#define S_IS_PREV_INUSE( b )    ( ( b )->head & S_PREV_INUSE )
+#define S_NEXT( b )             ( ( s_block* )( ( char* )( b ) + S_SIZE( b ) ) )
+#define S_PREV( b )             ( ( s_block* )( ( char* )( b ) - ( b )->prev_size ) )
+#define S_MEM2BLOCK( p )        ( ( s_block* )( ( char* )( p ) - S_HEADER_SIZE ) )
+#define S_BLOCK2MEM( b )        ( ( void* )( ( char* )( b ) + S_HEADER_SIZE ) )
+
+static s_block *s_bins[ S_NUM_BINS ];
+static u32 s_binmap;
 static u8 s_initialized;
 
 // ****************************************************************************
 // Utility functions for the dynamic memory allocator
 
-// Get actual size
+// Get actual block size (header included) for the requested size
 static size_t s_act_size( size_t size )
 {
-  if( size & ( DYN_SIZE_MULT - 1 ) )
-    size = ( ( size >> DYN_SIZE_MULT_SHIFT ) + 1 ) << DYN_SIZE_MULT_SHIFT;
-  return size;
+  size = ( size + S_HEADER_SIZE + S_ALIGN_MASK ) & ~( size_t )S_ALIGN_MASK;
+  return size < S_MIN_BLOCK ? S_MIN_BLOCK : size;
 }
 
-// Get next block
-static char* s_get_next_block( char* ptr )
+static unsigned s_log2( size_t v )
 {
-  return ( char* )( ( *( u32* )ptr & 0x7FFFFFFF ) << DYN_SIZE_MULT_SHIFT );
+#ifdef __GNUC__
+  return sizeof( unsigned long ) * 8 - 1 - __builtin_clzl( ( unsigned long )v );
+#else
+  unsigned r = 0;
+
+  while( v >>= 1 )
+    r ++;
+  return r;
+#endif
 }
 
-// Set next block
-static void s_set_next_block( char* ptr, char* next )
+// Return the bin for the given block size
+static unsigned s_bin_index( size_t size )
 {
-  u32 *temp = ( u32* )ptr;
-  
-  *temp = ( *temp & 0x80000000 ) | ( ( u32 )next >> DYN_SIZE_MULT_SHIFT );
-}
+  unsigned idx;
 
-// Get prev block
-static char* s_get_prev_block( char* ptr )
-{
-  return ( char* )( ( *( ( u32* )ptr + 1 ) & 0x7FFFFFFF ) << DYN_SIZE_MULT_SHIFT );
+  if( size < S_SMALL_LIMIT )
+    return ( unsigned )( ( size - S_MIN_BLOCK ) / S_ALIGN );
+  idx = S_NUM_SMALL_BINS + s_log2( size ) - s_log2( S_SMALL_LIMIT );
+  return idx >= S_NUM_BINS ? S_NUM_BINS - 1 : idx;
 }
 
-// Set prev block
-static void s_set_prev_block( char* ptr, char* prev )
+// Index of the lowest bit set in a non-zero bitmap
+static unsigned s_lowest_bit( u32 v )
 {
-  u32 *temp = ( u32* )ptr + 1;
-   
-  *temp = ( *temp & 0x80000000 ) | ( ( u32 )prev >> DYN_SIZE_MULT_SHIFT );
+#ifdef __GNUC__
+  return ( unsigned )__builtin_ctz( v );
+#else
+  return s_log2( v & -v );
+#endif
 }
 
-// Get block size
-static size_t s_get_block_size( char* ptr )
+static void s_bin_insert( s_block *b )
 {
-  char* next = s_get_next_block( ptr );
-  
-  return next != NULL ? ( size_t )( next - ptr ) : 0;
+  unsigned idx = s_bin_index( S_SIZE( b ) );
+
+  b->prev_free = NULL;
+  b->next_free = s_bins[ idx ];
+  if( s_bins[ idx ] )
+    s_bins[ idx ]->prev_free = b;
+  s_bins[ idx ] = b;
+  s_binmap |= ( u32 )1 << idx;
 }
 
-// Mark block as taken
-static void s_mark_block_taken( char* where )
+static void s_bin_remove( s_block *b )
 {
-  *( u32* )where |= 0x80000000;
-}
+  unsigned idx;
 
-// Mark block as free
-static void s_mark_block_free( char* where )
-{
-  *( u32* )where &= 0x7FFFFFFF;
+  if( b->prev_free )
+    b->prev_free->next_free = b->next_free;
+  else
+  {
+    idx = s_bin_index( S_SIZE( b ) );
+    if( ( s_bins[ idx ] = b->next_free ) == NULL )
+      s_binmap &= ~( ( u32 )1 << idx );
+  }
+  if( b->next_free )
+    b->next_free->prev_free = b->prev_free;
 }
 
-// Is the block free?
-static int s_is_block_free( char* where )
+// Make 'b' (not in any bin) a free block of the given size and bin it
+static void s_make_free( s_block *b, size_t size )
 {
-  return ( *( u32* )where & 0x80000000 ) == 0;
-}
+  s_block *next;
 
-// Create a new block with the given neighbours
-static void s_create_new_block( char* where, char* next, char* prev )
-{
-  u32* temp = ( u32* )where;
-  
-  *temp ++ = ( u32 )next >> DYN_SIZE_MULT_SHIFT;
-  *temp = ( u32 )prev >> DYN_SIZE_MULT_SHIFT;
+  b->head = size | ( b->head & S_PREV_INUSE );
+  next = S_NEXT( b );
+  next->prev_size = size;
+  next->head &= ~( size_t )S_PREV_INUSE;
+  s_bin_insert( b );
 }
 
-// Tries to compact free blocks
-static void s_compact_free( char* ptr )
+// Merge a (not binned) free block with its free neighbours and bin the result
+static void s_coalesce( s_block *b )
 {
-  char *temp1, *temp2;
-  
-  s_mark_block_free( ptr );  
-  // Look for free blocks before and after, concatenate if possible
-  temp1 = temp2 = ptr;
-  while( s_is_block_free( temp1 ) )
-    temp1 = s_get_prev_block( temp1 );
-  temp1 = s_get_next_block( temp1 );      
-  while( s_is_block_free( temp2 ) )
-    temp2 = s_get_next_block( temp2 );    
-  if( temp1 != ptr || s_get_prev_block( temp2 ) != ptr )
-  {
-    s_set_next_block( temp1, temp2 );
-    s_set_prev_block( temp2, temp1 );
-  }
-}
+  size_t size = S_SIZE( b );
+  s_block *next = S_NEXT( b );
 
-// Utility function: find a free block in the dynamic memory part
-// Returns pointer to block for success, NULL for error
-static void* s_get_free_block( size_t size, void* pstart )
-{
-  char *temp, *pblock = NULL, *next;
-  size_t minsize = ( size_t )~0, bsize;
-  
-  if( !size )
-    return NULL;
-  size = s_act_size( size + DYN_HEADER_SIZE );  
-  temp = s_get_next_block( pstart );
-  // Best-fit only for now
-  while( temp )
+  if( !S_IS_INUSE( next ) )
   {
-    if( s_is_block_free( temp ) )
-    {
-      bsize = s_get_block_size( temp );      
-      if( ( size <= bsize ) && ( bsize < minsize ) )
-      {
-        minsize = bsize;
-        pblock = temp;
-      }
-    }
-    temp = s_get_next_block( temp );
+    s_bin_remove( next );
+    size += S_SIZE( next );
   }
-  if( pblock == NULL )
-    return NULL;
-  s_mark_block_taken( pblock );
-  if( minsize > size && ( minsize - size ) >= DYN_MIN_SPLIT_SIZE )
+  if( !S_IS_PREV_INUSE( b ) )
   {
-    temp = pblock + size;
-    next = s_get_next_block( pblock );
-    s_set_prev_block( temp, pblock );
-    s_set_next_block( temp, next );
-    s_set_prev_block( next, temp );
-    s_set_next_block( pblock, temp );
-    s_compact_free( temp );
+    b = S_PREV( b );
+    s_bin_remove( b );
+    size += S_SIZE( b );
   }
-  return pblock + DYN_HEADER_SIZE;
+  s_make_free( b, size );
 }
 
-// Utility function: free a memory block
-static void s_free_block( char* ptr )
+// Trim an in-use block to 'size' bytes, giving the tail back to the bins
+static void s_split( s_block *b, size_t size )
 {
-  ptr -= DYN_HEADER_SIZE;
-  s_compact_free( ptr );
+  size_t total = S_SIZE( b );
+  s_block *rest;
+
+  if( total - size < S_MIN_BLOCK )
+    return;
+  b->head = size | ( b->head & S_FLAGS );
+  rest = S_NEXT( b );
+  rest->head = ( total - size ) | S_PREV_INUSE;
+  s_coalesce( rest );
 }
 
-// Get 'real' block size
-static size_t s_get_actual_block_size( char* ptr )
+// Find a free block of at least 'size' bytes and remove it from its bin
+static s_block* s_get_free_block( size_t size )
 {
-  return s_get_block_size( ptr - DYN_HEADER_SIZE ) - DYN_HEADER_SIZE;
+  unsigned idx = s_bin_index( size );
+  u32 map;
+  s_block *b;
+
+  // The first large bin may hold blocks smaller than 'size', so look at it
+  if( idx >= S_NUM_SMALL_BINS )
+  {
+    for( b = s_bins[ idx ]; b; b = b->next_free )
+      if( S_SIZE( b ) >= size )
+      {
+        s_bin_remove( b );
+        return b;
+      }
+    idx ++;
+  }
+  // Any block from the first non-empty bin from here on is large enough
+  if( idx >= S_NUM_BINS || ( map = s_binmap & ~( ( ( u32 )1 << idx ) - 1 ) ) == 0 )
+    return NULL;
+  b = s_bins[ s_lowest_bit( map ) ];
+  s_bin_remove( b );
+  return b;
 }
 
-// Shrinks the given block to its new size
-static void s_shrink_block( char* pblock, size_t size )
+static void s_mark_inuse( s_block *b )
 {
-  char *temp, *next;
-  
-  pblock -= DYN_HEADER_SIZE;
-  size = s_act_size( size + DYN_HEADER_SIZE );  
-  if( size >= s_get_block_size( pblock ) || ( s_get_block_size( pblock ) - size ) < DYN_MIN_SPLIT_SIZE )
-    return;
-  temp = pblock + size;
-  next = s_get_next_block( pblock );
-  s_set_prev_block( temp, pblock );
-  s_set_next_block( temp, next );
-  s_set_prev_block( next, temp );
-  s_set_next_block( pblock, temp );    
-  s_compact_free( temp );
+  b->head |= S_INUSE;
+  S_NEXT( b )->head |= S_PREV_INUSE;
 }
 
 static void s_init()
 {
   unsigned i = 0;
-  size_t memspace;
-  char *crt, *g1, *g2, *pstart;
+  char *pstart, *pend;
+  s_block *b, *sentinel;
 
   while( ( pstart = platform_get_first_free_ram( i ) ) != NULL )
   {
-    memspace = ( u32 )platform_get_last_free_ram( i ) - ( u32 )pstart;
-    g1 = ( char* )pstart;
-    crt = g1 + DYN_SIZE_MULT;
-    g2 = g1 + memspace - DYN_SIZE_MULT;
-    s_create_new_block( g1, crt, NULL );
-    s_create_new_block( crt, g2, g1 );
-    s_create_new_block( g2, NULL, crt );
-    s_mark_block_taken( g1 );
-    s_mark_block_taken( g2 );    
-    s_mark_block_free( crt );
+    pend = ( char* )platform_get_last_free_ram( i );
+    // An in-use sentinel header at the end keeps blocks from merging across regions
+    sentinel = ( s_block* )( ( ( size_t )pend - S_HEADER_SIZE ) & ~( size_t )S_ALIGN_MASK );
+    b = ( s_block* )pstart;
+    if( ( char* )sentinel > ( char* )b + S_MIN_BLOCK )
+    {
+      sentinel->head = S_INUSE;
+      b->head = S_PREV_INUSE;
+      s_make_free( b, ( char* )sentinel - ( char* )b );
+    }
     i ++;
-  }   
+  }
   s_initialized = 1;
 }
 
@@ -213,30 +227,36 @@ static void s_init()
 
 void* smalloc( size_t size )
 {
-  unsigned i = 0;
-  void *ptr = NULL, *pstart;
+  s_block *b;
+  size_t asize;
 
   if( !s_initialized )
     s_init();
-  while( ( pstart = platform_get_first_free_ram( i ++ ) ) != NULL )
-    if( ( ptr = s_get_free_block( size, pstart ) ) != NULL )
-      break;
-  return ptr;
+  if( !size )
+    return NULL;
+  asize = s_act_size( size );
+  if( ( b = s_get_free_block( asize ) ) == NULL )
+    return NULL;
+  s_mark_inuse( b );
+  s_split( b, asize );
+  return S_BLOCK2MEM( b );
 }
 
 void sfree( void* ptr )
 {
+  s_block *b;
+
   if( !ptr || !s_initialized )
     return;
-  s_free_block( ptr );
+  b = S_MEM2BLOCK( ptr );
+  b->head &= ~( size_t )S_INUSE;
+  s_coalesce( b );
 }
 
 void* scalloc( size_t nmemb, size_t size )
 {
   void* ptr;
 
-  if( !s_initialized )
-    s_init();
   if( ( ptr = smalloc( nmemb * size ) ) != NULL )
     memset( ptr, 0, nmemb * size );
   return ptr;
@@ -245,6 +265,8 @@ void* scalloc( size_t nmemb, size_t size )
 void* srealloc( void* ptr, size_t size )
 {
   void* newptr = NULL;
+  s_block *b, *next;
+  size_t asize, total;
 
   if( !s_initialized )
     s_init();
@@ -259,23 +281,30 @@ void* srealloc( void* ptr, size_t size )
     return NULL;
   }
 
-  // Test new size versus the old size
-  if( s_get_actual_block_size( ptr ) == size )
-    return ptr;
-  else if( size < s_get_actual_block_size( ptr ) )
+  b = S_MEM2BLOCK( ptr );
+  asize = s_act_size( size );
+  if( asize <= S_SIZE( b ) )
   {
-    s_shrink_block( ptr, size );
+    // Shrink in place
+    s_split( b, asize );
     return ptr;
   }
-  else
+  // Try to grow in place by absorbing the next block if it's free
+  next = S_NEXT( b );
+  if( !S_IS_INUSE( next ) && ( total = S_SIZE( b ) + S_SIZE( next ) ) >= asize )
   {
-    if( ( newptr = smalloc( size ) ) == NULL )
-      return NULL;
-    memmove( newptr, ptr, s_get_actual_block_size( ptr ) );
-    sfree( ptr );
+    s_bin_remove( next );
+    b->head = total | ( b->head & S_FLAGS );
+    S_NEXT( b )->head |= S_PREV_INUSE;
+    s_split( b, asize );
+    return ptr;
   }
+  // Move the data to a new block
+  if( ( newptr = smalloc( size ) ) == NULL )
+    return NULL;
+  memcpy( newptr, ptr, S_SIZE( b ) - S_HEADER_SIZE );
+  sfree( ptr );
   return newptr;
 }
 
 #endif // #ifdef USE_SIMPLE_ALLOCATOR
-
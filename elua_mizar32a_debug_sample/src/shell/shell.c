@@ -13,6 +13,8 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include "common.h"
+#include "devman.h"
+#include "utils.h"
 
 #include "platform_conf.h"
 #ifdef BUILD_SHELL
@@ -65,12 +67,26 @@ int shellh_ask_yes_no( const char *prompt )
   return 0;
 }
 
+// Copy buffer: the copy tries to allocate SHELL_COPY_MAX_BUFSIZE bytes and
+// halves the size until the allocation succeeds or SHELL_COPY_BUFSIZE is
+// reached. Large buffers that are a multiple of the sector size let FatFs
+// transfer whole sectors directly to/from the buffer, and they end up in
+// external RAM when the heap has such a region.
 #ifdef BUILD_RFS
 #define SHELL_COPY_BUFSIZE    ( ( 1 << RFS_BUFFER_SIZE ) - ELUARPC_WRITE_REQUEST_EXTRA )
 #else
 #define SHELL_COPY_BUFSIZE    256
 #endif
 
+#ifndef SHELL_COPY_MAX_BUFSIZE
+#define SHELL_COPY_MAX_BUFSIZE    8192
+#endif
+
+// A progress mark is printed after each SHELL_COPY_PROGRESS_STEP bytes
+#ifndef SHELL_COPY_PROGRESS_STEP
+#define SHELL_COPY_PROGRESS_STEP  ( 32 * 1024 )
+#endif
+
 // Dummy log function
 #ifdef __GNUC__
 static int shellh_dummy_printf( const char *fmt, ... ) __attribute__ ((format (printf, 1, 2)));
@@ -87,15 +103,55 @@ typedef int ( *p_logf )( const char *fmt, ... ) __attribute__ ((format (printf,
 typedef int ( *p_logf )( const char *fmt, ... );
 #endif
 
+// Helper: allocate the copy buffer, return its size in '*psize'
+static char* shellh_cp_alloc( u32 *psize )
+{
+  u32 size;
+  char *buf;
+
+  for( size = SHELL_COPY_MAX_BUFSIZE; size > SHELL_COPY_BUFSIZE; size >>= 1 )
+    if( ( buf = ( char* )malloc( size ) ) != NULL )
+    {
+      *psize = size;
+      return buf;
+    }
+  *psize = SHELL_COPY_BUFSIZE;
+  return ( char* )malloc( SHELL_COPY_BUFSIZE );
+}
+
+// Helper: write a block to the destination file
+// Return 1 for success, 0 for error
+static int shellh_cp_write( int fdd, const char *pdestname, const char *pdata, ssize_t datalen, p_logf plog )
+{
+  ssize_t datawrote;
+
+  if( ( datawrote = write( fdd, pdata, datalen ) ) == -1 )
+  {
+    plog( "Error writing destination file '%s'.\n", pdestname );
+    return 0;
+  }
+  if( datawrote < datalen )
+  {
+    plog( "Copy error (no space left on target?)\n" );
+    return 0;
+  }
+  return 1;
+}
+
 // Helper: copy one file to another file
+// If the source is directly addressable (ROMFS/WOFS and NIFFS linear files),
+// its data is written straight from flash, otherwise it goes through a
+// buffer as large as the heap allows.
 // Return 1 for success, 0 for error
 int shellh_cp_file( const char *psrcname, const char *pdestname, int flags )
 {
   int fds = -1, fdd = -1;
   int res = 0;
   char *buf = NULL;
-  ssize_t datalen, datawrote;
-  u32 total = 0;
+  const char *psrc;
+  ssize_t datalen;
+  u32 total = 0, bufsize = 0, srcsize = 0, nextmark = SHELL_COPY_PROGRESS_STEP;
+  timer_data_type tstart, dt;
   p_logf plog = ( flags & SHELL_F_SILENT ) ? shellh_dummy_printf : printf;
 
   if( !strcasecmp( psrcname, pdestname ) )
@@ -128,8 +184,14 @@ int shellh_cp_file( const char *psrcname, const char *pdestname, int flags )
         goto done;
     }
   }
-  // Allocate buffer
-  if( ( buf = ( char* )malloc( SHELL_COPY_BUFSIZE ) ) == NULL )
+  // Map the source if possible, allocate a buffer otherwise
+  if( ( psrc = dm_getaddr( fds ) ) != NULL )
+  {
+    if( ( srcsize = ( u32 )lseek( fds, 0, SEEK_END ) ) == ( u32 )-1 )
+      psrc = NULL;
+    lseek( fds, 0, SEEK_SET );
+  }
+  if( psrc == NULL && ( buf = shellh_cp_alloc( &bufsize ) ) == NULL )
   {
     plog( "ERROR: unable to allocate buffer for copy operation.\n" );
     goto done;
@@ -144,29 +206,44 @@ int shellh_cp_file( const char *psrcname, const char *pdestname, int flags )
       goto done;
     }
     // Do the actual copy
+    tstart = platform_timer_read_sys();
     while( 1 )
     {
-      if( ( datalen = read( fds, buf, SHELL_COPY_BUFSIZE ) ) == -1 )
+      if( psrc )
       {
-        plog( "Error reading source file '%s'.\n", psrcname );
-        goto done;
+        // Write the mapped source in SHELL_COPY_PROGRESS_STEP chunks
+        if( ( datalen = UMIN( srcsize - total, SHELL_COPY_PROGRESS_STEP ) ) == 0 )
+          break;
+        if( !shellh_cp_write( fdd, pdestname, psrc + total, datalen, plog ) )
+          goto done;
       }
-      if( ( datawrote = write( fdd, buf, datalen ) ) == -1 )
+      else
       {
-        plog( "Error writing destination file '%s'.\n", pdestname );
-        goto done;
+        if( ( datalen = read( fds, buf, bufsize ) ) == -1 )
+        {
+          plog( "Error reading source file '%s'.\n", psrcname );
+          goto done;
+        }
+        if( !shellh_cp_write( fdd, pdestname, buf, datalen, plog ) )
+          goto done;
       }
-      if( datawrote < datalen )
+      total += datalen;
+      if( total >= nextmark )
       {
-        plog( "Copy error (no space left on target?)\n" );
-        goto done;
+        plog( "." );
+        nextmark += SHELL_COPY_PROGRESS_STEP;
       }
-      total += datalen;
-      if( datalen < SHELL_COPY_BUFSIZE )
+      if( psrc == NULL && ( u32 )datalen < bufsize )
         break;
     }
+    dt = platform_timer_get_diff_us( PLATFORM_TIMER_SYS_ID, tstart, platform_timer_read_sys() );
+    plog( " done (%u bytes", ( unsigned )total );
+    if( dt > 0 )
+      plog( ", %u KB/s", ( unsigned )( ( ( u64 )total * 1000000 / dt ) >> 10 ) );
+    plog( ").\n" );
   }
-  plog( "done (%u bytes).\n", ( unsigned )total );
+  else
+    plog( "done (0 bytes).\n" );
   res = 1;
 done:
   if( fds != -1 )
@@ -36,6 +36,7 @@ SHELL_HELP( mkdir );
 SHELL_HELP( wofmt );
 SHELL_HELP( ed );
 SHELL_HELP( clear );
+SHELL_HELP( trace );
 // 'mv' is special, as it uses the main help text from 'cp'
 extern const char shell_help_summary_mv[];
 
@@ -69,6 +70,7 @@ static const SHELL_HELP_DATA shell_help_data[] =
   SHELL_INFO( exit ),
   SHELL_INFO( ed ),
   SHELL_INFO( clear ),
+  SHELL_INFO( trace ),
   { NULL, NULL, NULL }
 };
 
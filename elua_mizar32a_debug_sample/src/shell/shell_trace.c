@@ -0,0 +1,109 @@
+// Shell: 'trace' implementation
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "common.h"
+#include "type.h"
+#include "platform_conf.h"
+
+#ifdef BUILD_TRACE
+
+const char shell_help_trace[] = "[on|off|clear|<file>]\n"
+  "  [on|off] - enable or disable tracing.\n"
+  "  [clear] - remove all the records from the trace buffer.\n"
+  "  [<file>] - save the trace buffer in binary format to <file>.\n"
+  "Without arguments it prints the trace buffer on the console.\n"
+  "Binary files can be decoded on the PC with tools/trace_decode.py.\n";
+const char shell_help_summary_trace[] = "event trace";
+
+// Binary file header (followed by the records in native byte order)
+#define SHELL_TRACE_MAGIC       "ELTR"
+#define SHELL_TRACE_BOM         0x01020304UL
+#define SHELL_TRACE_VERSION     1
+
+static void shellh_trace_print( void )
+{
+  cmn_trace_record rec;
+  unsigned i;
+  u32 prev = 0;
+
+  printf( "%10s %8s  %-15s %10s %10s\n", "time(us)", "delta", "event", "arg1", "arg2" );
+  for( i = 0; cmn_trace_get( i, &rec ); i ++ )
+  {
+    printf( "%10lu %8lu  %-15s %10lu %10lu\n", ( unsigned long )rec.timestamp,
+            ( unsigned long )( i > 0 ? rec.timestamp - prev : 0 ),
+            cmn_trace_event_name( rec.id ), ( unsigned long )rec.arg1, ( unsigned long )rec.arg2 );
+    prev = rec.timestamp;
+  }
+  printf( "%u record(s)\n", i );
+}
+
+static void shellh_trace_save( const char *fname )
+{
+  FILE *fp;
+  cmn_trace_record rec;
+  u32 hdr[ 3 ];
+  unsigned i, count = cmn_trace_count();
+
+  if( ( fp = fopen( fname, "wb" ) ) == NULL )
+  {
+    printf( "Unable to open %s\n", fname );
+    return;
+  }
+  hdr[ 0 ] = SHELL_TRACE_BOM;
+  hdr[ 1 ] = ( SHELL_TRACE_VERSION << 16 ) | sizeof( cmn_trace_record );
+  hdr[ 2 ] = count;
+  if( fwrite( SHELL_TRACE_MAGIC, 1, 4, fp ) != 4 || fwrite( hdr, sizeof( hdr ), 1, fp ) != 1 )
+    goto write_error;
+  for( i = 0; i < count && cmn_trace_get( i, &rec ); i ++ )
+    if( fwrite( &rec, sizeof( rec ), 1, fp ) != 1 )
+      goto write_error;
+  fclose( fp );
+  printf( "%u record(s) written to %s\n", i, fname );
+  return;
+write_error:
+  fclose( fp );
+  printf( "Error writing %s\n", fname );
+}
+
+void shell_trace( int argc, char **argv )
+{
+  int prev;
+
+  if( argc > 2 )
+  {
+    SHELL_SHOW_HELP( trace );
+    return;
+  }
+  if( argc == 1 )
+  {
+    // Don't let new records overwrite the ones being printed
+    prev = cmn_trace_enable( 0 );
+    shellh_trace_print();
+    cmn_trace_enable( prev );
+  }
+  else if( !strcmp( argv[ 1 ], "on" ) || !strcmp( argv[ 1 ], "off" ) )
+    cmn_trace_enable( argv[ 1 ][ 1 ] == 'n' );
+  else if( !strcmp( argv[ 1 ], "clear" ) )
+    cmn_trace_clear();
+  else
+  {
+    prev = cmn_trace_enable( 0 );
+    shellh_trace_save( argv[ 1 ] );
+    cmn_trace_enable( prev );
+  }
+}
+
+#else // #ifdef BUILD_TRACE
+
+const char shell_help_trace[] = "";
+const char shell_help_summary_trace[] = "";
+
+void shell_trace( int argc, char **argv )
+{
+  shellh_not_implemented_handler( argc, argv );
+}
+
+#endif // #ifdef BUILD_TRACE
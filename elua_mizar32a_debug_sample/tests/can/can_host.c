@@ -0,0 +1,80 @@
+// Host build of the CAN module: the platform and timer functions used by
+// src/modules/can.c, src/common_can.c and src/elua_can_sim.c, and a Lua
+// interpreter with the base libraries and 'can'. The system timer is a
+// counter set from Lua with settime( us ), so the timestamps are known.
+
+#include "platform_conf.h"
+#include "platform.h"
+#include "common.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "auxmods.h"
+
+const luaR_table lua_rotable[] = { { NULL, NULL } };
+
+static timer_data_type host_time;
+
+int platform_cpu_set_global_interrupts( int status )
+{
+  return PLATFORM_CPU_ENABLE;
+}
+
+timer_data_type platform_timer_read_sys(void)
+{
+  return host_time;
+}
+
+int platform_can_exists( unsigned id )
+{
+  return id < NUM_CAN;
+}
+
+// Nothing can arrive while waiting: the frames are sent by the script
+int cmn_wait_event( p_cmn_wait_cond cond, void *arg, unsigned timer_id, timer_data_type timeout )
+{
+  return cond( arg );
+}
+
+void cmn_get_timeout_data( lua_State *L, int pidx, unsigned *pid, timer_data_type *ptimeout )
+{
+  *pid = ( unsigned )luaL_optinteger( L, pidx, PLATFORM_TIMER_SYS_ID );
+  *ptimeout = ( timer_data_type )luaL_optnumber( L, pidx + 1, PLATFORM_TIMER_INF_TIMEOUT );
+}
+
+// Lua: settime( us )
+static int host_settime( lua_State *L )
+{
+  host_time = ( timer_data_type )luaL_checknumber( L, 1 );
+  return 0;
+}
+
+static const luaL_Reg host_libs[] =
+{
+  { "", luaopen_base },
+  { LUA_TABLIBNAME, luaopen_table },
+  { LUA_STRLIBNAME, luaopen_string },
+  { LUA_MATHLIBNAME, luaopen_math },
+  { AUXLIB_CAN, luaopen_can },
+  { NULL, NULL }
+};
+
+void luaL_openlibs( lua_State *L )
+{
+  const luaL_Reg *lib;
+
+  for( lib = host_libs; lib->func; lib ++ )
+  {
+    lua_pushcfunction( L, lib->func );
+    lua_pushstring( L, lib->name );
+    lua_call( L, 1, 0 );
+  }
+  lua_register( L, "settime", host_settime );
+}
+
+int lua_main( int argc, char **argv );
+
+int main( int argc, char **argv )
+{
+  return lua_main( argc, argv );
+}
@@ -0,0 +1,86 @@
+-- CAN module tests on the simulated backend (src/elua_can_sim.c): delivery
+-- between two controllers, acceptance filters, frames dropped when the
+-- receive queue (4 frames in this build) is full, recvframes into a frame
+-- buffer and the reception timestamps.
+-- Runs with the host build from run.sh, settime( us ) sets the system timer.
+-- Usage: can_test.lua
+
+local function check_error( msg, f, ... )
+  local ok, err = pcall( f, ... )
+  assert( not ok, "no error, expected '" .. msg .. "'" )
+  assert( tostring( err ):find( msg, 1, true ), "got '" .. tostring( err ) .. "', expected '" .. msg .. "'" )
+end
+
+local function stats( id )
+  return table.concat( { can.stats( id ) }, "," )
+end
+
+local qsize = 4
+assert( can.setup( 0, 500000 ) == 500000 and can.setup( 1, 500000 ) == 500000 )
+
+-- A frame goes to the other controller only, with its timestamp
+settime( 1000 )
+assert( can.send( 0, 0x123, can.ID_STD, "hello" ) )
+local canid, idtype, msg, ts = can.recv( 1 )
+assert( canid == 0x123 and idtype == can.ID_STD and msg == "hello" and ts == 1000 )
+assert( can.recv( 1 ) == nil and can.recv( 0 ) == nil )
+check_error( "message exceeds max length", can.send, 0, 1, can.ID_STD, "123456789" )
+
+-- Drop on full: the first frames stay, the later ones are counted as dropped
+can.stats( 1, true )
+for i = 1, qsize + 2 do
+  settime( 2000 + i )
+  can.send( 0, 0x100 + i, can.ID_STD, "m" .. i )
+end
+assert( stats( 1 ) == "4,0,2", stats( 1 ) )
+for i = 1, qsize do
+  canid, idtype, msg, ts = can.recv( 1 )
+  assert( canid == 0x100 + i and msg == "m" .. i and ts == 2000 + i, "frame " .. i )
+end
+assert( can.recv( 1 ) == nil )
+
+-- Filters: ID and mask, and the ID type must match too
+can.stats( 1, true )
+can.filter( 1, { { 0x200, 0x700 }, { 0x1ABCDE00, 0x1FFFFF00, can.ID_EXT } } )
+can.send( 0, 0x123, can.ID_STD, "a" )
+can.send( 0, 0x234, can.ID_STD, "b" )
+can.send( 0, 0x234, can.ID_EXT, "c" )
+can.send( 0, 0x1ABCDE42, can.ID_EXT, "d" )
+can.send( 0, 0x1ABCDF42, can.ID_EXT, "e" )
+assert( stats( 1 ) == "2,3,0", stats( 1 ) )
+assert( select( 3, can.recv( 1 ) ) == "b" and select( 3, can.recv( 1 ) ) == "d" )
+can.filter( 1 )
+can.send( 0, 0x7FF, can.ID_STD, "f" )
+assert( select( 3, can.recv( 1 ) ) == "f" )
+check_error( "too many filters", can.filter, 1, { {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1}, {1,1} } )
+check_error( "invalid filter 2", can.filter, 1, { { 1, 1 }, 2 } )
+
+-- recvframes: moves what fits, keeps the rest in the queue
+local f = can.frames( 3 )
+assert( can.recvframes( 1, f ) == 0 and #f == 0 )
+for i = 1, qsize do
+  settime( 3000 + i )
+  can.send( 0, i, can.ID_EXT, string.rep( "x", i ) )
+end
+assert( can.recvframes( 1, f ) == 3 and #f == 3 )
+for i = 1, 3 do
+  canid, idtype, msg, ts = f:get( i )
+  assert( canid == i and idtype == can.ID_EXT and msg == string.rep( "x", i ) and ts == 3000 + i, "frames " .. i )
+end
+assert( f:get( 0 ) == nil and f:get( 4 ) == nil )
+assert( can.recvframes( 1, f, nil, 1000 ) == 1 and #f == 1 and f:get( 1 ) == 4 )
+assert( can.recvframes( 1, f, nil, 1000 ) == 0 and #f == 0 and f:get( 1 ) == nil )
+check_error( "invalid size", can.frames, 0 )
+
+-- The timestamps are the lower 32 bits of the system timer
+settime( 2 ^ 32 + 5 )
+can.send( 1, 0x42, can.ID_STD, "" )
+canid, idtype, msg, ts = can.recv( 0 )
+assert( canid == 0x42 and msg == "" and ts == 5 )
+
+-- Controllers on another bit rate don't see the frames
+can.setup( 1, 250000 )
+can.send( 0, 1, can.ID_STD, "z" )
+assert( can.recv( 1 ) == nil )
+
+print( "can: OK" )
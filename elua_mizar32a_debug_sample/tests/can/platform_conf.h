@@ -0,0 +1,14 @@
+// Host stand-in for the eLua platform_conf.h: two simulated CAN controllers
+// with a small receive queue, so that filling it is quick
+
+#ifndef __PLATFORM_CONF_H__
+#define __PLATFORM_CONF_H__
+
+#include "type.h"
+
+#define BUILD_CAN_SIM
+#define NUM_CAN                   2
+#define CAN_RX_QUEUE_SIZE         4
+#define PLATFORM_TIMER_SYS_ID     0x100
+
+#endif
@@ -0,0 +1,12 @@
+// Host stand-in for the newlib reent.h, just the types devman.h needs
+
+#ifndef __REENT_H__
+#define __REENT_H__
+
+#include <sys/types.h>
+
+struct _reent;
+typedef ssize_t _ssize_t;
+typedef off_t _off_t;
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Host tests for the CAN module, the receive queue (src/common_can.c) and
+# the simulated backend (src/elua_can_sim.c).
+# Usage: tests/can/run.sh
+# Builds a desktop Lua with the 'can' module (can_host.c provides the
+# platform functions) and runs can_test.lua with it.
+set -e
+cd "$(dirname "$0")"
+ROOT=../..
+OUT=${OUT:-/tmp/can_tests}
+CC=${CC:-gcc}
+CFLAGS="-O1 -g -Wall -fsanitize=address,undefined -DLUA_CROSS_COMPILER -DLUA_USE_POSIX -DLUA_OPTIMIZE_MEMORY=0"
+CFLAGS="$CFLAGS -I. -I$ROOT/inc -I$ROOT/inc/desktop -I$ROOT/inc/newlib -I$ROOT/src/lua -I$ROOT/src/modules"
+LUA_SRC="lapi lcode ldebug ldo ldump lfunc lgc llex lmem lobject lopcodes lparser lstate lstring ltable ltm lundump lvm lzio lrotable legc lauxlib lbaselib ltablib lstrlib lmathlib lua"
+mkdir -p $OUT
+
+for f in $LUA_SRC; do
+  $CC $CFLAGS -c -o $OUT/$f.o $ROOT/src/lua/$f.c
+done
+$CC $CFLAGS -c -o $OUT/can.o $ROOT/src/modules/can.c
+$CC $CFLAGS -c -o $OUT/common_can.o $ROOT/src/common_can.c
+$CC $CFLAGS -c -o $OUT/elua_can_sim.o $ROOT/src/elua_can_sim.c
+$CC $CFLAGS -c -o $OUT/can_host.o can_host.c
+$CC $CFLAGS -o $OUT/lua_can $OUT/*.o -lm
+$OUT/lua_can can_test.lua
@@ -0,0 +1,340 @@
+// Host benchmark of the shell copy (shellh_cp_file in src/shell/shell.c):
+// files on FatFs (src/mmcfs.c), WOFS (src/romfs.c) and NIFFS (paged and
+// linear files) are copied to the FAT volume. The FAT file is 1 MB; the
+// flash ones are as large as the 512 KB flash allows: NIFFS, with its
+// 128 byte work buffer, can only have up to 256 paged sectors (1024 pages)
+// and 1024 linear sectors. The flash is a RAM area
+// mapped at INTERNAL_FLASH_START_ADDRESS, programmed from 1 to 0 only like
+// NOR flash, and the SD card is a RAM disk. shell.c is compiled with its
+// open/read/write/lseek/close and dm_getaddr calls redirected to the cp_xxx
+// functions below, which dispatch to the registered file systems like the
+// newlib stubs. Build with -DCP_TEST_NO_MAP to disable the mapped copy.
+// Each copy is checked and the best of CP_RUNS runs is reported as CSV:
+//   name,bytes,time_ms,kb_per_s,reads,writes,disk_calls,disk_sectors
+// 'reads' and 'writes' count the file system calls made by the copy,
+// 'disk_calls' and 'disk_sectors' the RAM disk transfers (both directions).
+
+#include "platform_conf.h"
+#include "platform.h"
+#include "romfs.h"
+#include "mmcfs.h"
+#include "devman.h"
+#include "shell.h"
+#include "diskio.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+
+// From nffs.h, which also defines romfiles_fs (romfs.c has it already)
+int nffs_init( void );
+int nffs_format( s32 linear_bytes );
+
+#define CP_SIZE                 ( 1024 * 1024 )  // largest file
+#define CP_RUNS                 5
+#define DISK_SECTORS            32768           // 16 MB, FAT16 with 2 KB clusters
+#define DISK_SECTOR_SIZE        512
+
+static u8 *flash;
+static u8 *disk;
+static u32 disk_calls, disk_sectors;
+static u32 cp_reads, cp_writes;
+
+struct dm_dirent dm_shared_dirent;
+char dm_shared_fname[ DM_MAX_FNAME_LENGTH + 1 ];
+
+#define check( cond, ... )\
+  do { if( !( cond ) ) { printf( "FAILED: " __VA_ARGS__ ); printf( "\n" ); exit( 1 ); } } while( 0 )
+
+// ****************************************************************************
+// Platform functions
+
+u32 platform_s_flash_write( const void *from, u32 toaddr, u32 size )
+{
+  const u8 *pfrom = ( const u8* )from;
+  u8 *pto = ( u8* )( uintptr_t )toaddr;
+  u32 i;
+
+  check( toaddr >= INTERNAL_FLASH_START_ADDRESS && toaddr + size <= INTERNAL_FLASH_START_ADDRESS + INTERNAL_FLASH_SIZE,
+         "write of %u bytes at 0x%08X outside the flash", ( unsigned )size, ( unsigned )toaddr );
+  for( i = 0; i < size; i ++ )
+  {
+    check( ( pto[ i ] & pfrom[ i ] ) == pfrom[ i ], "flash byte at 0x%08X programmed from 0 to 1", ( unsigned )( toaddr + i ) );
+    pto[ i ] &= pfrom[ i ];
+  }
+  return size;
+}
+
+int platform_flash_erase_sector( u32 sector_id )
+{
+  check( sector_id < INTERNAL_FLASH_SIZE / INTERNAL_FLASH_SECTOR_SIZE, "erase of sector %u", ( unsigned )sector_id );
+  memset( flash + sector_id * INTERNAL_FLASH_SECTOR_SIZE, 0xFF, INTERNAL_FLASH_SECTOR_SIZE );
+  return PLATFORM_OK;
+}
+
+// The console code in common.c refers to it, nothing reads from it here
+int platform_uart_recv( unsigned id, unsigned timer_id, timer_data_type timeout )
+{
+  return -1;
+}
+
+// The copy never asks for a confirmation here
+int term_getch( int mode )
+{
+  return 'n';
+}
+
+timer_data_type platform_timer_read_sys(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( timer_data_type )ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+timer_data_type platform_timer_get_diff_us( unsigned id, timer_data_type start, timer_data_type end )
+{
+  return end - start;
+}
+
+// ****************************************************************************
+// RAM disk for FatFs
+
+void elua_mmc_init(void)
+{
+}
+
+DSTATUS disk_initialize( BYTE drv )
+{
+  return drv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status( BYTE drv )
+{
+  return drv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read( BYTE drv, BYTE *buff, DWORD sector, BYTE count )
+{
+  if( drv || sector + count > DISK_SECTORS )
+    return RES_PARERR;
+  memcpy( buff, disk + sector * DISK_SECTOR_SIZE, count * DISK_SECTOR_SIZE );
+  disk_calls ++;
+  disk_sectors += count;
+  return RES_OK;
+}
+
+DRESULT disk_write( BYTE drv, const BYTE *buff, DWORD sector, BYTE count )
+{
+  if( drv || sector + count > DISK_SECTORS )
+    return RES_PARERR;
+  memcpy( disk + sector * DISK_SECTOR_SIZE, buff, count * DISK_SECTOR_SIZE );
+  disk_calls ++;
+  disk_sectors += count;
+  return RES_OK;
+}
+
+DRESULT disk_ioctl( BYTE drv, BYTE ctrl, void *buff )
+{
+  return ctrl == CTRL_SYNC ? RES_OK : RES_PARERR;
+}
+
+DWORD get_fattime(void)
+{
+  return ( ( DWORD )( 2026 - 1980 ) << 25 ) | ( 1 << 21 ) | ( 1 << 16 );
+}
+
+// FatFs can't format here (_USE_MKFS is 0): write a FAT16 boot sector
+// (1 reserved sector, 2 FATs of 33 sectors, 512 root entries, 4 sectors per
+// cluster) and the two reserved FAT entries
+static void disk_format(void)
+{
+  u8 *bs = disk;
+  unsigned f;
+
+  memset( disk, 0, DISK_SECTORS * DISK_SECTOR_SIZE );
+  memcpy( bs, "\xEB\x3C\x90" "MSDOS5.0", 11 );
+  bs[ 11 ] = DISK_SECTOR_SIZE & 0xFF; bs[ 12 ] = DISK_SECTOR_SIZE >> 8;
+  bs[ 13 ] = 4;                                         // sectors per cluster
+  bs[ 14 ] = 1;                                         // reserved sectors
+  bs[ 16 ] = 2;                                         // FATs
+  bs[ 17 ] = 512 & 0xFF; bs[ 18 ] = 512 >> 8;           // root entries
+  bs[ 19 ] = DISK_SECTORS & 0xFF; bs[ 20 ] = DISK_SECTORS >> 8;
+  bs[ 21 ] = 0xF8;                                      // media
+  bs[ 22 ] = 33;                                        // sectors per FAT
+  bs[ 38 ] = 0x29;
+  memcpy( bs + 43, "NO NAME    FAT16   ", 19 );
+  bs[ 510 ] = 0x55; bs[ 511 ] = 0xAA;
+  for( f = 0; f < 2; f ++ )
+    memcpy( disk + ( 1 + f * 33 ) * DISK_SECTOR_SIZE, "\xF8\xFF\xFF\xFF", 4 );
+}
+
+// ****************************************************************************
+// File system calls used by shell.c, dispatched like the newlib stubs
+// A descriptor is the device index in the upper bits and the device fd
+
+#define CP_MAX_DEVICES          4
+
+static struct
+{
+  const char *name;
+  void *pdata;
+  const DM_DEVICE *pdev;
+} cp_devs[ CP_MAX_DEVICES ];
+static int cp_ndevs;
+static struct _reent reent;
+
+int dm_register( const char *name, void *pdata, const DM_DEVICE *pdev )
+{
+  if( name == NULL || pdev == NULL )
+    return 0;
+  check( cp_ndevs < CP_MAX_DEVICES, "too many devices" );
+  cp_devs[ cp_ndevs ].name = name;
+  cp_devs[ cp_ndevs ].pdata = pdata;
+  cp_devs[ cp_ndevs ].pdev = pdev;
+  return cp_ndevs ++;
+}
+
+#define CP_DEV( fd )            ( cp_devs + ( ( fd ) >> 8 ) )
+#define CP_FD( fd )             ( ( fd ) & 0xFF )
+
+int cp_open( const char *path, int flags, ... )
+{
+  int i, fd;
+  size_t len;
+
+  for( i = 0; i < cp_ndevs; i ++ )
+  {
+    len = strlen( cp_devs[ i ].name );
+    if( !strncmp( path, cp_devs[ i ].name, len ) && path[ len ] == '/' )
+    {
+      if( ( fd = cp_devs[ i ].pdev->p_open_r( &reent, path + len + 1, flags, 0, cp_devs[ i ].pdata ) ) < 0 )
+        return -1;
+      return ( i << 8 ) | fd;
+    }
+  }
+  return -1;
+}
+
+int cp_close( int fd )
+{
+  return CP_DEV( fd )->pdev->p_close_r( &reent, CP_FD( fd ), CP_DEV( fd )->pdata );
+}
+
+ssize_t cp_read( int fd, void *ptr, size_t len )
+{
+  cp_reads ++;
+  return CP_DEV( fd )->pdev->p_read_r( &reent, CP_FD( fd ), ptr, len, CP_DEV( fd )->pdata );
+}
+
+ssize_t cp_write( int fd, const void *ptr, size_t len )
+{
+  cp_writes ++;
+  return CP_DEV( fd )->pdev->p_write_r( &reent, CP_FD( fd ), ptr, len, CP_DEV( fd )->pdata );
+}
+
+off_t cp_lseek( int fd, off_t off, int whence )
+{
+  return CP_DEV( fd )->pdev->p_lseek_r( &reent, CP_FD( fd ), off, whence, CP_DEV( fd )->pdata );
+}
+
+const char* cp_getaddr( int fd )
+{
+#ifdef CP_TEST_NO_MAP
+  return NULL;
+#else
+  if( CP_DEV( fd )->pdev->p_getaddr_r == NULL )
+    return NULL;
+  return CP_DEV( fd )->pdev->p_getaddr_r( &reent, CP_FD( fd ), CP_DEV( fd )->pdata );
+#endif
+}
+
+// ****************************************************************************
+// Tests
+
+static u8 data[ CP_SIZE ];
+
+static void fill( u8 *buf, u32 size )
+{
+  u32 i;
+
+  for( i = 0; i < size; i ++ )
+    buf[ i ] = ( u8 )( ( i * 31 ) ^ ( i >> 9 ) );
+}
+
+static void create( const char *name, u32 size )
+{
+  u32 done;
+  int fd;
+
+  check( ( fd = cp_open( name, O_WRONLY | O_CREAT | O_TRUNC ) ) >= 0, "create %s", name );
+  for( done = 0; done < size; done += 8192 )
+    check( cp_write( fd, data + done, UMIN( size - done, 8192 ) ) == UMIN( size - done, 8192 ), "write %s", name );
+  check( cp_close( fd ) == 0, "close %s", name );
+}
+
+static void verify( const char *name, u32 size )
+{
+  static u8 rdata[ CP_SIZE + 1 ];
+  int fd;
+
+  check( ( fd = cp_open( name, O_RDONLY ) ) >= 0, "open %s", name );
+  check( cp_read( fd, rdata, size + 1 ) == size, "size of %s", name );
+  check( memcmp( data, rdata, size ) == 0, "contents of %s", name );
+  cp_close( fd );
+}
+
+// Copy 'src' ('size' bytes) to 'dest' CP_RUNS times, report the fastest copy
+static void run( const char *name, const char *src, const char *dest, u32 size )
+{
+  timer_data_type t, best = 0;
+  unsigned i;
+
+  for( i = 0; i < CP_RUNS; i ++ )
+  {
+    cp_reads = cp_writes = disk_calls = disk_sectors = 0;
+    t = platform_timer_read_sys();
+    check( shellh_cp_file( src, dest, SHELL_F_FORCE_DESTINATION | SHELL_F_SILENT ), "cp %s %s", src, dest );
+    t = platform_timer_read_sys() - t;
+    if( i == 0 || t < best )
+      best = t;
+  }
+  verify( dest, size );
+  printf( "%s,%u,%.3f,%.0f,%u,%u,%u,%u\n", name, ( unsigned )size, best / 1000.0, size * 1000000.0 / 1024 / best,
+          ( unsigned )cp_reads, ( unsigned )cp_writes, ( unsigned )disk_calls, ( unsigned )disk_sectors );
+}
+
+int main(void)
+{
+  flash = mmap( ( void* )( uintptr_t )INTERNAL_FLASH_START_ADDRESS, INTERNAL_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 );
+  check( flash != MAP_FAILED, "cannot map the flash at 0x%08X", INTERNAL_FLASH_START_ADDRESS );
+  memset( flash, 0xFF, INTERNAL_FLASH_SIZE );
+  check( ( disk = malloc( DISK_SECTORS * DISK_SECTOR_SIZE ) ) != NULL, "no memory for the disk" );
+  disk_format();
+  fill( data, CP_SIZE );
+  check( mmcfs_init() >= 0, "mmcfs_init" );
+  printf( "name,bytes,time_ms,kb_per_s,reads,writes,disk_calls,disk_sectors\n" );
+
+  create( "/mmc/src.dat", CP_SIZE );
+  run( "mmc_mmc", "/mmc/src.dat", "/mmc/dst.dat", CP_SIZE );
+
+  // WOFS and NIFFS both start at the first free flash block: WOFS first,
+  // then NIFFS is formatted over it, with 380 KB of linear sectors so that
+  // 237 are left for the paged files
+  romfs_init();
+  check( wofs_format(), "wofs_format" );
+  create( "/wo/src.dat", 256 * 1024 );
+  run( "wofs_mmc", "/wo/src.dat", "/mmc/dst.dat", 256 * 1024 );
+
+  nffs_init();
+  nffs_format( 380 * 1024 );
+  create( "/f/src.dat", 64 * 1024 );
+  run( "niffs_mmc", "/f/src.dat", "/mmc/dst.dat", 64 * 1024 );
+  create( "/f/lin_src.dat", 256 * 1024 );
+  run( "niffs_lin_mmc", "/f/lin_src.dat", "/mmc/dst.dat", 256 * 1024 );
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Host stand-in for the eLua platform_conf.h: the shell copy command over
+// WOFS and NIFFS on a simulated 512 KB internal flash with 512 byte sectors
+// and pages (like the AT32UC3A0512, mapped at INTERNAL_FLASH_START_ADDRESS
+// by cp_test.c) and FatFs on a RAM disk.
+
+#ifndef __PLATFORM_CONF_H__
+#define __PLATFORM_CONF_H__
+
+#include "type.h"
+#include "buf.h"
+#include "sermux.h"
+#include "platform.h"
+#include "auxmods.h"
+#include "lualib.h"
+
+#define BUILD_SHELL
+#define BUILD_WOFS
+#define BUILD_NIFFS
+#define BUILD_MMCFS
+#define SHELL_COMMAND_LIST              { "exit", NULL }
+
+#define INTERNAL_FLASH_SIZE             ( 512 * 1024 )
+#define INTERNAL_FLASH_SECTOR_SIZE      512
+#define INTERNAL_FLASH_PAGE_SIZE        512
+#define INTERNAL_FLASH_START_ADDRESS    0x40000000
+
+// What the rest of common.c needs to compile
+#define NUM_ADC                         0
+#define NUM_CAN                         0
+#define NUM_SPI                         0
+#define NUM_PWM                         0
+#define NUM_UART                        1
+#define NUM_PIO                         1
+#define NUM_TIMER                       1
+#define PLATFORM_TIMER_SYS_ID           0x100
+#define CON_UART_ID                     0
+#define CON_UART_SPEED                  115200
+#define CON_FLOW_TYPE                   PLATFORM_UART_FLOW_NONE
+#define CON_TIMER_ID                    PLATFORM_TIMER_SYS_ID
+#define CON_UART_XMODEM_ID              0
+#define BUILD_XMODEM
+#define TERM_LINES                      25
+#define TERM_COLS                       80
+#define BUILD_TERM
+#define TRUE                            1 // from the ASF compiler.h on the AVR32
+#define FALSE                           0
+#define PIO_PINS_PER_PORT               32
+#define PIO_PREFIX                      'A'
+#define CPU_FREQUENCY                   66000000
+#define MEM_START_ADDRESS               { 0 }
+#define MEM_END_ADDRESS                 { 0 }
+
+#endif
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Host benchmark of the shell copy (shellh_cp_file in src/shell/shell.c)
+# between WOFS, NIFFS and FatFs on a simulated flash and a RAM disk.
+# Usage: tests/cp/run.sh
+# Builds cp_test twice and prints the 1 MB copy times of both: 'before' with
+# the copy buffer limited to 256 bytes and no mapped sources (the copy as it
+# was before the large buffers), 'after' with the current code.
+set -e
+cd "$(dirname "$0")"
+ROOT=../..
+OUT=${OUT:-/tmp/cp_tests}
+CC=${CC:-gcc}
+# The eLua sources cast between u32 and pointers, as they target a 32-bit CPU
+CFLAGS="-O1 -g -Wall -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast"
+CFLAGS="$CFLAGS -DLUA_CROSS_COMPILER -I. -I$ROOT/inc -I$ROOT/inc/desktop -I$ROOT/inc/newlib -I$ROOT/inc/niffs"
+CFLAGS="$CFLAGS -I$ROOT/src/lua -I$ROOT/src/modules -I$ROOT/src/fatfs -ffunction-sections -fdata-sections"
+# inc/shell.h would pick up inc/platform_conf.h (the board one) first, and
+# mmcfs.c uses asprintf
+CFLAGS="$CFLAGS -include platform_conf.h -D_GNU_SOURCE"
+# The file systems start after the first 8 KB of the flash (the eLua image)
+LDFLAGS="-no-pie -Wl,--gc-sections -Wl,--defsym=flash_used_size=0x2000"
+# shell.c calls the file functions through the cp_test.c dispatcher
+SHELL_DEFS="-Dopen=cp_open -Dclose=cp_close -Dread=cp_read -Dwrite=cp_write -Dlseek=cp_lseek -Ddm_getaddr=cp_getaddr"
+mkdir -p $OUT
+
+# niffs.c includes romfiles.h, which romfs.c defines romfiles_fs from too
+$CC $CFLAGS -Wno-format -Dromfiles_fs=niffs_romfiles_fs -c -o $OUT/niffs.o $ROOT/src/niffs/niffs.c
+for f in niffs/niffs_api niffs/niffs_internal fatfs/ff fatfs/ccsbcs common romfs mmcfs; do
+  $CC $CFLAGS -Wno-format -c -o $OUT/$(basename $f).o $ROOT/src/$f.c
+done
+for mode in before after; do
+  DEFS=""
+  [ $mode = before ] && DEFS="-DSHELL_COPY_MAX_BUFSIZE=256 -DCP_TEST_NO_MAP"
+  $CC $CFLAGS $DEFS $SHELL_DEFS -c -o $OUT/shell_$mode.o $ROOT/src/shell/shell.c
+  $CC $CFLAGS $DEFS -o $OUT/cp_test_$mode cp_test.c $OUT/shell_$mode.o $OUT/niffs.o $OUT/niffs_api.o \
+    $OUT/niffs_internal.o $OUT/ff.o $OUT/ccsbcs.o $OUT/common.o $OUT/romfs.o $OUT/mmcfs.o $LDFLAGS
+  echo "# $mode"
+  $OUT/cp_test_$mode
+done
@@ -0,0 +1,13 @@
+// Host stand-in for the AVR32 type.h: the desktop types plus the FatFs ones
+
+#ifndef __CP_TYPE_H__
+#define __CP_TYPE_H__
+
+#include "../../inc/desktop/type.h"
+
+typedef unsigned char  BYTE;
+typedef unsigned short WORD;
+typedef u32            DWORD;
+typedef unsigned int   BOOL;
+
+#endif
@@ -0,0 +1,160 @@
+// Host test of the internal flash write path used by WOFS: romfs.c writing
+// through platform_flash_write (src/common.c) to a simulated flash.
+// The flash is a RAM area mapped at INTERNAL_FLASH_START_ADDRESS that can
+// only be programmed from 1 to 0, like NOR flash. platform_s_flash_write
+// counts a program cycle for every page it touches, as flashc_memcpy does on
+// the AVR32. For each chunk size, files are written, read back and checked,
+// and the program cycles per KB written are reported as CSV:
+//   name,bytes,writes,programs,programs_per_kb
+
+#include "platform_conf.h"
+#include "platform.h"
+#include "romfs.h"
+#include "devman.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define FLASH_PAGE_SIZE         512
+
+static u8 *flash;
+static u32 flash_programs;
+static int flash_errors;
+
+struct dm_dirent dm_shared_dirent;
+char dm_shared_fname[ DM_MAX_FNAME_LENGTH + 1 ];
+
+static const DM_DEVICE *wofs_dev;
+static void *wofs_pdata;
+
+#define check( cond, ... )\
+  do { if( !( cond ) ) { printf( "FAILED: " __VA_ARGS__ ); printf( "\n" ); exit( 1 ); } } while( 0 )
+
+// ****************************************************************************
+// Platform functions
+
+u32 platform_s_flash_write( const void *from, u32 toaddr, u32 size )
+{
+  const u8 *pfrom = ( const u8* )from;
+  u8 *pto = ( u8* )( uintptr_t )toaddr;
+  u32 i;
+
+  check( toaddr >= INTERNAL_FLASH_START_ADDRESS && toaddr + size <= INTERNAL_FLASH_START_ADDRESS + INTERNAL_FLASH_SIZE,
+         "write of %u bytes at 0x%08X outside the flash", ( unsigned )size, ( unsigned )toaddr );
+  if( size == 0 )
+    return 0;
+  flash_programs += ( toaddr + size - 1 ) / FLASH_PAGE_SIZE - toaddr / FLASH_PAGE_SIZE + 1;
+  for( i = 0; i < size; i ++ )
+  {
+    if( ( pto[ i ] & pfrom[ i ] ) != pfrom[ i ] )
+      flash_errors ++;
+    pto[ i ] &= pfrom[ i ];
+  }
+  return size;
+}
+
+int platform_flash_erase_sector( u32 sector_id )
+{
+  check( sector_id < INTERNAL_FLASH_SIZE / INTERNAL_FLASH_SECTOR_SIZE, "erase of sector %u", ( unsigned )sector_id );
+  memset( flash + sector_id * INTERNAL_FLASH_SECTOR_SIZE, 0xFF, INTERNAL_FLASH_SECTOR_SIZE );
+  return PLATFORM_OK;
+}
+
+// The console code in common.c refers to it, nothing reads from it here
+int platform_uart_recv( unsigned id, unsigned timer_id, timer_data_type timeout )
+{
+  return -1;
+}
+
+int dm_register( const char *name, void *pdata, const DM_DEVICE *pdev )
+{
+  if( name && !strcmp( name, "/wo" ) )
+  {
+    wofs_dev = pdev;
+    wofs_pdata = pdata;
+  }
+  return 0;
+}
+
+// ****************************************************************************
+// Tests
+
+static struct _reent reent;
+
+static int wofs_open( const char *name, int flags )
+{
+  return wofs_dev->p_open_r( &reent, name, flags, 0, wofs_pdata );
+}
+
+static void fill( u8 *buf, u32 size, unsigned seed )
+{
+  u32 i;
+
+  for( i = 0; i < size; i ++ )
+    buf[ i ] = ( u8 )( ( i * 31 + seed * 7 ) ^ ( i >> 8 ) );
+}
+
+// Write 'nfiles' files of 'size' bytes in 'chunk' byte writes, then check
+// them all and report the flash program cycles
+static void run( unsigned nfiles, u32 size, u32 chunk )
+{
+  static u8 data[ 8192 ], rdata[ 8192 ];
+  char name[ 32 ];
+  unsigned f;
+  u32 done, writes, bytes, programs, programmed;
+  int fd;
+
+  check( wofs_format(), "wofs_format" );
+  flash_programs = 0;
+  platform_flash_get_stats( &writes, &bytes, &programs, &programmed, 1 );
+  for( f = 0; f < nfiles; f ++ )
+  {
+    sprintf( name, "/f%u_%u.dat", f, ( unsigned )chunk );
+    fd = wofs_open( name, O_WRONLY | O_CREAT | O_TRUNC );
+    check( fd >= 0, "create %s", name );
+    fill( data, size, f );
+    for( done = 0; done < size; done += chunk )
+      check( wofs_dev->p_write_r( &reent, fd, data + done, UMIN( chunk, size - done ), wofs_pdata ) == ( _ssize_t )UMIN( chunk, size - done ),
+             "write %s", name );
+    check( wofs_dev->p_close_r( &reent, fd, wofs_pdata ) == 0, "close %s", name );
+  }
+  platform_flash_get_stats( &writes, &bytes, &programs, &programmed, 0 );
+  for( f = 0; f < nfiles; f ++ )
+  {
+    sprintf( name, "/f%u_%u.dat", f, ( unsigned )chunk );
+    fd = wofs_open( name, O_RDONLY );
+    check( fd >= 0, "open %s", name );
+    fill( data, size, f );
+    memset( rdata, 0, size );
+    check( wofs_dev->p_read_r( &reent, fd, rdata, size + 1, wofs_pdata ) == ( _ssize_t )size, "read %s", name );
+    check( memcmp( data, rdata, size ) == 0, "contents of %s", name );
+    wofs_dev->p_close_r( &reent, fd, wofs_pdata );
+  }
+  check( flash_errors == 0, "%d bytes programmed from 0 to 1", flash_errors );
+#ifdef INTERNAL_FLASH_PAGE_SIZE
+  check( programs == flash_programs, "program cycles: %u counted by common.c, %u by the flash", ( unsigned )programs, ( unsigned )flash_programs );
+#endif
+  printf( "wofs_%u_%u,%u,%u,%u,%.2f\n", ( unsigned )size, ( unsigned )chunk, ( unsigned )( nfiles * size ),
+          ( unsigned )writes, ( unsigned )flash_programs, flash_programs * 1024.0 / ( nfiles * size ) );
+}
+
+int main(void)
+{
+  static const u32 chunks[] = { 16, 128, 512, 1000 };
+  unsigned i;
+
+  flash = mmap( ( void* )( uintptr_t )INTERNAL_FLASH_START_ADDRESS, INTERNAL_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 );
+  check( flash != MAP_FAILED, "cannot map the flash at 0x%08X", INTERNAL_FLASH_START_ADDRESS );
+  memset( flash, 0xFF, INTERNAL_FLASH_SIZE );
+  romfs_init();
+  check( wofs_dev != NULL, "WOFS not registered" );
+  printf( "name,bytes,writes,programs,programs_per_kb\n" );
+  for( i = 0; i < sizeof( chunks ) / sizeof( chunks[ 0 ] ); i ++ )
+    run( 8, 4096, chunks[ i ] );
+  run( 16, 700, 128 );
+  return 0;
+}
@@ -0,0 +1,52 @@
+// Host stand-in for the eLua platform_conf.h: WOFS on a 128 KB internal flash
+// with 512 byte pages (like the AT32UC3A0128), mapped at
+// INTERNAL_FLASH_START_ADDRESS by flash_test.c. Build with
+// -DFLASH_TEST_WRITE_THROUGH to leave INTERNAL_FLASH_PAGE_SIZE undefined,
+// which turns off the write coalescing of platform_flash_write.
+
+#ifndef __PLATFORM_CONF_H__
+#define __PLATFORM_CONF_H__
+
+#include "type.h"
+#include "buf.h"
+#include "sermux.h"
+#include "platform.h"
+#include "auxmods.h"
+#include "lualib.h"
+
+#define BUILD_WOFS
+#define BUILD_NIFFS
+
+#define INTERNAL_FLASH_SIZE             ( 128 * 1024 )
+#define INTERNAL_FLASH_SECTOR_SIZE      512
+#ifndef FLASH_TEST_WRITE_THROUGH
+#define INTERNAL_FLASH_PAGE_SIZE        512
+#endif
+#define INTERNAL_FLASH_START_ADDRESS    0x40000000
+
+// What the rest of common.c needs to compile
+#define NUM_ADC                         0
+#define NUM_CAN                         0
+#define NUM_SPI                         0
+#define NUM_PWM                         0
+#define NUM_UART                        1
+#define NUM_PIO                         1
+#define NUM_TIMER                       1
+#define PLATFORM_TIMER_SYS_ID           0x100
+#define CON_UART_ID                     0
+#define CON_UART_SPEED                  115200
+#define CON_FLOW_TYPE                   PLATFORM_UART_FLOW_NONE
+#define CON_TIMER_ID                    PLATFORM_TIMER_SYS_ID
+#define CON_UART_XMODEM_ID              0
+#define BUILD_XMODEM
+#define TERM_LINES                      25
+#define TERM_COLS                       80
+#define BUILD_TERM
+#define TRUE                            1 // from the ASF compiler.h on the AVR32
+#define PIO_PINS_PER_PORT               32
+#define PIO_PREFIX                      'A'
+#define CPU_FREQUENCY                   66000000
+#define MEM_START_ADDRESS               { 0 }
+#define MEM_END_ADDRESS                 { 0 }
+
+#endif
@@ -0,0 +1,15 @@
+// Host stand-in for the newlib reent.h, just what devman.h and romfs.c need
+
+#ifndef __REENT_H__
+#define __REENT_H__
+
+#include <sys/types.h>
+
+struct _reent
+{
+  int _errno;
+};
+typedef ssize_t _ssize_t;
+typedef off_t _off_t;
+
+#endif
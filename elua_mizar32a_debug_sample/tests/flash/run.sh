@@ -0,0 +1,31 @@
+#!/bin/sh
+# Host tests of the internal flash write path (platform_flash_write in
+# src/common.c) under WOFS (src/romfs.c), on a simulated NOR flash.
+# Usage: tests/flash/run.sh
+# Builds flash_test twice: with the write coalescing (INTERNAL_FLASH_PAGE_SIZE
+# defined) and write-through, and prints the flash program cycles per KB of
+# both. The NIFFS sources are compiled too, as a build check.
+set -e
+cd "$(dirname "$0")"
+ROOT=../..
+OUT=${OUT:-/tmp/flash_tests}
+CC=${CC:-gcc}
+# The eLua sources cast between u32 and pointers, as they target a 32-bit CPU
+CFLAGS="-O1 -g -Wall -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast -fsanitize=address,undefined"
+CFLAGS="$CFLAGS -DLUA_CROSS_COMPILER -I. -I$ROOT/inc -I$ROOT/inc/desktop -I$ROOT/inc/newlib -I$ROOT/inc/niffs -I$ROOT/src/lua -I$ROOT/src/modules"
+# WOFS starts after the first 8 KB of the flash (the eLua image)
+LDFLAGS="-no-pie -Wl,--gc-sections -Wl,--defsym=flash_used_size=0x2000"
+mkdir -p $OUT
+
+for f in niffs niffs_api niffs_internal; do
+  $CC $CFLAGS -Wno-format -c -o $OUT/$f.o $ROOT/src/niffs/$f.c
+done
+for mode in coalesce write_through; do
+  DEFS=""
+  [ $mode = write_through ] && DEFS="-DFLASH_TEST_WRITE_THROUGH"
+  $CC $CFLAGS $DEFS -ffunction-sections -c -o $OUT/common_$mode.o $ROOT/src/common.c
+  $CC $CFLAGS $DEFS -ffunction-sections -c -o $OUT/romfs_$mode.o $ROOT/src/romfs.c
+  $CC $CFLAGS $DEFS -o $OUT/flash_test_$mode flash_test.c $OUT/common_$mode.o $OUT/romfs_$mode.o $LDFLAGS
+  echo "# $mode"
+  $OUT/flash_test_$mode
+done
@@ -0,0 +1,67 @@
+-- pack module tests: the position arguments of the compiled codecs and of
+-- the buffers follow string.sub (negative values count from the end), and
+-- a length prefix that doesn't fit in the source is rejected.
+-- Runs with any eLua interpreter that has the pack module.
+-- Usage: pack.lua
+
+local s = "0123456789"
+local b = pack.buffer( #s )
+pack.compile( "A" .. #s ):packinto( b, 1, s )
+
+-- buf:tostring( i, j ) gives the same slice as string.sub
+for i = -14, 13 do
+  for j = -14, 13 do
+    local got, want = b:tostring( i, j ), s:sub( i, j )
+    assert( got == want, string.format( "tostring(%d,%d): '%s', expected '%s'", i, j, got, want ) )
+  end
+  assert( b:tostring( i ) == s:sub( i ), "tostring(" .. i .. ")" )
+end
+
+-- The init argument of codec:unpack and codec:unpackall is resolved like
+-- the first argument of string.sub
+local c = pack.compile( "b" )
+for init = -14, 13 do
+  local start = init < 0 and math.max( #s + init + 1, 1 ) or math.max( init, 1 )
+  local pos, v = c:unpack( s, init )
+  if start > #s then
+    assert( pos == nil, "unpack init " .. init .. ": expected nil" )
+  else
+    assert( pos == start + 1 and v == s:byte( start ), "unpack init " .. init )
+  end
+  local t, n = c:unpackall( s, init )
+  assert( n == math.max( #s - start + 1, 0 ), "unpackall init " .. init )
+  assert( n == 0 or t[ 1 ] == s:byte( start ), "unpackall init " .. init )
+end
+
+-- A size_t length prefix close to SIZE_MAX must not wrap the bounds check
+local huge = string.rep( "\255", 8 ) .. "xx"
+assert( pack.compile( "a" ):unpack( huge ) == nil, "huge 'a' length accepted by codec:unpack" )
+assert( select( 2, pack.compile( "a" ):unpackall( huge ) ) == 0, "huge 'a' length accepted by codec:unpackall" )
+assert( select( 2, pack.unpack( huge, "a" ) ) == nil, "huge 'a' length accepted by unpack" )
+for _, f in ipairs{ "p", "P" } do
+  local short = pack.pack( f, "abc" ):sub( 1, -2 )
+  assert( pack.compile( f ):unpack( short ) == nil, "short '" .. f .. "' string accepted" )
+end
+
+-- Repeat counts and record sizes that don't fit are rejected when the
+-- format is parsed, instead of wrapping the size of the record
+local function too_large( f, ... )
+  local ok, err = pcall( f, ... )
+  assert( not ok and tostring( err ):find( "format too large", 1, true ), "accepted: " .. tostring( err ) )
+end
+too_large( pack.compile, "bA4294967295" )
+too_large( pack.compile, "i99999999999999999999" )
+too_large( pack.compile, "b2147483647b1" )
+too_large( pack.pack, "b4294967296", 1 )
+too_large( pack.unpack, "x", "b4294967296" )
+if #pack.pack( "a", "" ) == 4 then
+  -- 32-bit size_t (the target): the record size itself would wrap
+  too_large( pack.compile, "i1073741824" )
+  too_large( pack.compile, "A2147483647A2147483647A2" )
+else
+  local c = pack.compile( "i1073741824" )
+  local ok, err = pcall( c.packinto, c, pack.buffer( 4 ), 1, 1 )
+  assert( not ok and tostring( err ):find( "out of buffer", 1, true ), "'i1073741824' packed into 4 bytes" )
+end
+
+print( "pack: OK" )
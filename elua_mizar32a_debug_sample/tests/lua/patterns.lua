@@ -0,0 +1,133 @@
+-- Pattern matching differential test: runs string.find, match, gmatch and
+-- gsub over a corpus of patterns (malformed ones included) and subjects and
+-- compares the results and error messages with patterns.ref, written by the
+-- interpreter from before the patterns were compiled (the matcher of
+-- standard Lua 5.1). To keep it small, patterns.ref holds a hash of the
+-- results for each pattern and subject; print the results themselves on
+-- both interpreters to see what differs.
+-- Runs with any eLua interpreter (on the board or a desktop build).
+-- Usage: patterns.lua       compare with patterns.ref (next to this script)
+--        patterns.lua ref   print the hashes (to write a new patterns.ref)
+--        patterns.lua -     print the results
+
+local dir = ( arg and arg[ 0 ] or "" ):match( "^(.*)[/\\]" ) or "."
+local mode = arg and arg[ 1 ]
+
+local subjects = {
+  "", "a", "aaa", "hello world", "  trim me  ", "key=value; k2=v2;k3 = v3",
+  "THE (quick) [brown] fox", "a.b.c", "f(a(b)c)d)", "123 456 7890 -12.5e3",
+  "x = [[long]] .. %d", "line1\nline2\n\n", "tab\there", "nul\0in\0side",
+  "caf\233 na\239ve", "^$*+?.([%-])", "THE END", string.rep( "ab", 40 ) .. "c",
+}
+
+local patterns = {
+  -- literals and single characters
+  "", "a", "aa", "ab", "abc", "hello", "o w", "xyz", "\0", "%.", "%%", "%(", "%]", "%-",
+  "^", "$", "^a", "a$", "^$", "^hello", "d$", "^%s*(.-)%s*$",
+  -- classes
+  ".", "%a", "%A", "%c", "%d", "%D", "%l", "%p", "%s", "%S", "%u", "%w", "%W", "%x", "%z",
+  "%a+", "%d+", "%s+", "%w+", "%u+", "%p+", "%x+%.?", "%g", "%q",
+  -- sets
+  "[abc]", "[^abc]", "[a-z]+", "[^%s]+", "[%a_][%w_]*", "[]]", "[^]]", "[a-]", "[-a]",
+  "[%]]", "[%-]+", "[0-9.eE+-]+", "[^%z]+", "[\0]", "[a-c-e]",
+  -- quantifiers
+  "a*", "a+", "a-", "a?", "ab*", "ab-c", ".-b", ".*b", "a*$", "^a*", "%d*%.?%d+", "x*",
+  "(.)%1", "(a*(.)%w(%s*))", "()a()", "()", "(%w+)=(%w+)", "(%w+)%s*=%s*(%w+)",
+  "%b()", "%b[]", "%b\"\"", "f%b()", "%bxy", "%f[%w]%w+", "%f[%W]", "%f[%z]", "%f[%a]%a*",
+  "%f[^%z]", "((a)(b))", "(h)(e)(l)(l)(o)", "[%(%)]", ".-(%d+)", "%s*$",
+  -- malformed
+  "%", "a%", "[", "[a", "[^", "[a-", "[%", "(", "(a", "((a)", ")", "a)", "%b", "%ba",
+  "%f", "%fa", "%f[a", "%1", "(%1)", "(a)%2", "%0", "[]", "[^]",
+  string.rep( "(", 33 ) .. "a" .. string.rep( ")", 33 ),
+  string.rep( "(a)", 32 ),
+}
+
+local repls = { "", "<%0>", "%1-%1", "%%", "%2", "%", "[%d]" }
+
+local out, nlines, group = {}, 0, {}
+
+local function ser( ok, ... )
+  if not ok then
+    return "error " .. string.format( "%q", tostring( ( ... ) ) )
+  end
+  local t = {}
+  for i = 1, select( "#", ... ) do
+    local v = select( i, ... )
+    t[ i ] = type( v ) == "string" and string.format( "%q", v ) or tostring( v )
+  end
+  return table.concat( t, " " )
+end
+
+local function emit( what, ... )
+  local line = what .. ": " .. ser( pcall( ... ) )
+  if mode == "-" then print( line ) end
+  group[ #group + 1 ] = line
+end
+
+-- Close the results of a pattern and subject
+local function hash_group( id )
+  local s, h = table.concat( group, "\n" ), 0
+  for i = 1, #s do
+    h = ( h * 31 + s:byte( i ) ) % 16777213  -- fits integer-only builds
+  end
+  nlines = nlines + 1
+  out[ nlines ] = string.format( "%s %d %d", id, #s, h )
+  group = {}
+end
+
+local function gmatch_all( s, p )
+  local t, n = {}, 0
+  for a, b, c in string.gmatch( s, p ) do
+    n = n + 1
+    t[ n ] = ser( true, a, b, c )
+    if n == 200 then break end
+  end
+  return table.concat( t, ", " )
+end
+
+local map = { a = "A", hello = 1, [ "1" ] = false, world = "W" }
+local function repl_f( a, b )
+  if a == "a" then return nil end
+  if a == "" then return false end
+  return "<" .. tostring( a ) .. "|" .. tostring( b ) .. ">"
+end
+
+for pi, p in ipairs( patterns ) do
+  for si, s in ipairs( subjects ) do
+    local id = pi .. "/" .. si
+    emit( id .. " find", string.find, s, p )
+    emit( id .. " find 3", string.find, s, p, 3 )
+    emit( id .. " find -2", string.find, s, p, -2 )
+    emit( id .. " match", string.match, s, p )
+    emit( id .. " gmatch", gmatch_all, s, p )
+    emit( id .. " gsub t", string.gsub, s, p, map )
+    emit( id .. " gsub f 3", string.gsub, s, p, repl_f, 3 )
+    if si % 4 == 1 then
+      for ri, r in ipairs( repls ) do
+        emit( id .. " gsub " .. ri, string.gsub, s, p, r )
+      end
+    end
+    hash_group( id )
+  end
+end
+
+if mode == "ref" then
+  for i = 1, nlines do print( out[ i ] ) end
+end
+if mode then return end
+
+local fails, i = 0, 0
+for line in io.lines( dir .. "/patterns.ref" ) do
+  i = i + 1
+  if out[ i ] ~= line then
+    fails = fails + 1
+    if fails <= 20 then
+      local pi, si = line:match( "^(%d+)/(%d+)" )
+      print( string.format( "pattern %q, subject %q: results differ", patterns[ tonumber( pi ) ] or "?",
+        subjects[ tonumber( si ) ] or "?" ) )
+    end
+  end
+end
+assert( i == nlines, string.format( "%d groups, %d in patterns.ref", nlines, i ) )
+assert( fails == 0, fails .. " groups differ from patterns.ref" )
+print( string.format( "patterns: OK (%d patterns, %d subjects)", #patterns, #subjects ) )
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Runs the Lua tests with a desktop build of the eLua interpreter.
+# Usage: tests/lua/run.sh lua
+# On the board, copy the scripts to /mmc and run them one by one.
+LUA=${1:?usage: run.sh lua}
+cd "$(dirname "$0")"
+res=0
+for t in *.lua; do
+  "$LUA" $t || { echo "$t: FAILED"; res=1; }
+done
+exit $res
@@ -0,0 +1,121 @@
+-- table.sort tests: results on the usual input shapes, the stable mode, and
+-- the number of comparisons on an adversarial input built with McIlroy's
+-- "killer adversary for quicksort" (the comparator decides the values while
+-- the sort runs, so that every pivot ends up as bad as possible). The
+-- introsort must fall back to heapsort on every range that degenerates and
+-- stay within O(n log n) comparisons. The comparisons are counted through a
+-- comparator: the core sort of numbers and strings (ltable.c) runs the same
+-- introsort as the comparator one (ltablib.c), so it makes the same number of
+-- comparisons on the same values, but has no way to report them.
+-- Runs with any eLua interpreter (on the board or a desktop build).
+-- Usage: sort.lua [n] (default 2000)
+
+local n = tonumber( arg and arg[ 1 ] ) or 2000
+local log2n = math.log( n ) / math.log( 2 )
+-- Quicksort levels plus the heapsort fallbacks, well below the n^2/4
+-- comparisons that a quadratic sort needs on the adversarial input
+local max_comparisons = math.floor( 8 * n * log2n )
+
+local function check_sorted( t, lt, what )
+  lt = lt or function( a, b ) return a < b end
+  for i = 2, #t do
+    assert( not lt( t[ i ], t[ i - 1 ] ), what .. ": not sorted at " .. i )
+  end
+end
+
+-- Build an adversarial input of size 'n' for table.sort with a comparator:
+-- returns the values, in their original positions, that the adversary
+-- assigned while the sort ran. A third of the values is random and fixed
+-- beforehand: sorting them uses up the depth budget of the ranges they fall
+-- in, the remaining values then make the other ranges degenerate
+local function killer( n )
+  local gas = n + 1
+  local val, ptr = {}, {}
+  local nsolid, candidate = 0, 0
+  for i = 1, n do val[ i ] = gas; ptr[ i ] = i end
+  local function freeze( x )
+    nsolid = nsolid + 1
+    val[ x ] = nsolid
+  end
+  for i = 1, n, 3 do freeze( i ) end
+  for i = nsolid, 2, -1 do  -- shuffle the fixed values
+    local j = 3 * math.random( i ) - 2
+    val[ 3 * i - 2 ], val[ j ] = val[ j ], val[ 3 * i - 2 ]
+  end
+  table.sort( ptr, function( x, y )
+    if val[ x ] == gas and val[ y ] == gas then
+      if x == candidate then freeze( x ) else freeze( y ) end
+    end
+    if val[ x ] == gas then candidate = x
+    elseif val[ y ] == gas then candidate = y end
+    return val[ x ] < val[ y ]
+  end )
+  -- Values never compared against a frozen one still need distinct values
+  for i = 1, n do
+    if val[ i ] == gas then freeze( i ) end
+  end
+  return val
+end
+
+local function count_comparisons( t, what, stable )
+  local c = 0
+  table.sort( t, function( a, b ) c = c + 1 return a < b end, stable )
+  check_sorted( t, nil, what )
+  assert( c <= max_comparisons, string.format( "%s: %d comparisons (max %d)", what, c, max_comparisons ) )
+  return c
+end
+
+local function copy( t )
+  local r = {}
+  for i = 1, #t do r[ i ] = t[ i ] end
+  return r
+end
+
+-- Input shapes, sorted both by the core (no comparator) and by a comparator
+local shapes = {
+  random = function( i ) return math.random( n ) end,
+  sorted = function( i ) return i end,
+  reversed = function( i ) return n - i end,
+  equal = function( i ) return 7 end,
+  organ = function( i ) return i <= n / 2 and i or n - i end,
+  sawtooth = function( i ) return i % 16 end,
+}
+math.randomseed( 42 )
+for name, f in pairs( shapes ) do
+  local t = {}
+  for i = 1, n do t[ i ] = f( i ) end
+  local s, c = copy( t ), copy( t )
+  table.sort( s )
+  check_sorted( s, nil, name )
+  table.sort( c, function( a, b ) return a > b end )
+  check_sorted( c, function( a, b ) return a > b end, name .. " (comparator)" )
+  count_comparisons( copy( t ), name .. " (counted)" )
+  count_comparisons( copy( t ), name .. " (counted, stable)", true )
+  -- The core also sorts strings
+  local str = {}
+  for i = 1, n do str[ i ] = string.format( "k%05d", t[ i ] ) end
+  table.sort( str )
+  check_sorted( str, nil, name .. " (strings)" )
+end
+
+-- Stable mode: equal keys keep their order
+local recs = {}
+for i = 1, n do recs[ i ] = { key = math.random( 10 ), pos = i } end
+table.sort( recs, function( a, b ) return a.key < b.key end, true )
+for i = 2, n do
+  assert( recs[ i - 1 ].key < recs[ i ].key or recs[ i - 1 ].pos < recs[ i ].pos, "stable sort" )
+end
+
+-- The adversarial input, with a comparator
+local bad = killer( n )
+local c = count_comparisons( copy( bad ), "adversarial" )
+-- and through the core (numbers and strings)
+local s = copy( bad )
+table.sort( s )
+check_sorted( s, nil, "adversarial (core)" )
+s = {}
+for i = 1, n do s[ i ] = string.format( "%06d", bad[ i ] ) end
+table.sort( s )
+check_sorted( s, nil, "adversarial (strings)" )
+
+print( string.format( "sort: OK (n=%d, %d comparisons on the adversarial input, max %d)", n, c, max_comparisons ) )
@@ -0,0 +1,75 @@
+-- String library tests: the plain search paths of string.find and
+-- string.gsub (which skip the pattern matcher when the pattern has no
+-- special characters) must give the same results and the same errors as
+-- the matcher, and string.split.
+-- Runs with any eLua interpreter (on the board or a desktop build).
+-- Usage: strings.lua
+
+local function check_error( msg, f, ... )
+  local ok, err = pcall( f, ... )
+  assert( not ok, "no error, expected '" .. msg .. "'" )
+  assert( tostring( err ):find( msg, 1, true ), "got '" .. tostring( err ) .. "', expected '" .. msg .. "'" )
+end
+
+-- A lone ')' is an invalid capture for gsub and match, plain or not
+for _, c in ipairs{ { "a)b", ")" }, { "a)", ")" }, { "))x", "))x" }, { "a)b", "a)" }, { "", ")" } } do
+  check_error( "invalid pattern capture", string.gsub, c[ 1 ], c[ 2 ], "x" )
+  check_error( "invalid pattern capture", string.match, c[ 1 ], c[ 2 ] )
+  check_error( "invalid pattern capture", string.gmatch( c[ 1 ], c[ 2 ] ) )
+end
+-- string.find keeps the standard Lua behaviour: no special character, so
+-- a plain search
+assert( select( 2, string.find( "a)b", ")" ) ) == 2 )
+assert( string.find( "))x", "))x" ) == 1 )
+assert( string.find( "a)b", ")", 1, true ) == 2 )
+-- Other malformed patterns still fail the same way
+check_error( "malformed pattern (ends with '%')", string.gsub, "a%", "a%", "" )
+check_error( "missing '[' after '%f' in pattern", string.gsub, "abc", "%f", "" )
+check_error( "unfinished capture", string.match, "abc", "(a" )
+
+-- gsub with a plain pattern gives the same results as with the same pattern
+-- escaped for the matcher ('%' before each character makes no difference
+-- to the result but disables the plain path)
+local function escape( p )
+  return ( p:gsub( "%W", "%%%0" ) )
+end
+local function force_matcher( p )
+  return "[" .. p:sub( 1, 1 ) .. "]" .. escape( p:sub( 2 ) )
+end
+local subjects = { "", "a", "abc", "aaaa", "abababab", "xabcabcx", "a,b,,c,", "hello world, hello moon",
+                   string.rep( "ab", 100 ) .. "c" }
+local patterns = { "a", "ab", "aa", "abc", ",", "hello", "xyz", "ba", "c", "abababab" }
+local repls = { "", "X", "<%0>", "%1%1", "%%" }
+for _, s in ipairs( subjects ) do
+  for _, p in ipairs( patterns ) do
+    for _, r in ipairs( repls ) do
+      for _, max in ipairs{ 0, 1, 2, 1000 } do
+        local r1, n1 = string.gsub( s, p, r, max )
+        local r2, n2 = string.gsub( s, force_matcher( p ), r, max )
+        assert( r1 == r2 and n1 == n2, string.format( "gsub( %q, %q, %q, %d ): %q %d vs %q %d", s, p, r, max, r1, n1, r2, n2 ) )
+      end
+    end
+    local t = {}
+    local r, n = string.gsub( s, p, function( m ) t[ #t + 1 ] = m end )
+    assert( r == s and n == #t )
+    r = string.gsub( s, p, { [ p ] = "T" } )
+    assert( r == ( string.gsub( s, force_matcher( p ), "T" ) ) )
+    local i, j = string.find( s, p )
+    local i2, j2 = string.find( s, force_matcher( p ) )
+    assert( i == i2 and j == j2, string.format( "find( %q, %q )", s, p ) )
+  end
+end
+check_error( "invalid capture index", string.gsub, "abc", "b", "%2" )
+
+-- string.split
+local function join( t ) return table.concat( t, "|" ) end
+if string.split then
+  assert( join( string.split( "a,b,,c" ) ) == "a|b||c" )
+  assert( join( string.split( "" ) ) == "" and #string.split( "" ) == 1 )
+  assert( join( string.split( "a::b::c", "::" ) ) == "a|b|c" )
+  assert( join( string.split( "a,b,c,d", ",", 2 ) ) == "a|b,c,d" )
+  assert( #string.split( string.rep( "x,", 1000 ) ) == 1001 )
+  check_error( "empty separator", string.split, "abc", "" )
+end
+
+print( "strings: OK" )
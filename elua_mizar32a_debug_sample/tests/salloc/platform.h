@@ -0,0 +1,11 @@
+// Host stand-in for the eLua platform.h, just what salloc needs
+
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#include "type.h"
+
+void* platform_get_first_free_ram( unsigned id );
+void* platform_get_last_free_ram( unsigned id );
+
+#endif
@@ -0,0 +1 @@
+// Host stand-in for the eLua platform_conf.h (nothing to configure)
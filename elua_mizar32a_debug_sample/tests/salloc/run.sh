@@ -0,0 +1,32 @@
+#!/bin/sh
+# Host tests and trace replay for the simple allocator (src/salloc.c).
+# Usage: tests/salloc/run.sh [lua [scale]]
+# With a host build of the eLua core ('lua', USE_SIMPLE_ALLOCATOR is not
+# needed there) a new trace of bench/run.lua is recorded first; otherwise the
+# traces in tests/salloc/traces are replayed as well. They were recorded from
+# bench/run.lua 0.05 on x86-64 with the Lua slabs on (run_slab.trc) and off
+# (run_noslab.trc, the first 33000 operations).
+set -e
+cd "$(dirname "$0")"
+ROOT=../..
+OUT=${OUT:-/tmp/salloc_tests}
+CC=${CC:-gcc}
+CFLAGS="-O2 -Wall -DUSE_SIMPLE_ALLOCATOR -I. -I$ROOT/inc -I$ROOT/inc/desktop"
+OLD="-Dsmalloc=old_smalloc -Dsfree=old_sfree -Dsrealloc=old_srealloc -Dscalloc=old_scalloc"
+OLD="$OLD -Dplatform_get_first_free_ram=old_first_free_ram -Dplatform_get_last_free_ram=old_last_free_ram"
+mkdir -p $OUT
+
+$CC $CFLAGS -g -fsanitize=address,undefined -o $OUT/salloc_test $ROOT/src/salloc.c salloc_test.c
+$OUT/salloc_test
+
+$CC $CFLAGS $OLD -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast -c -o $OUT/salloc_old.o salloc_old.c
+$CC $CFLAGS -o $OUT/salloc_replay $ROOT/src/salloc.c $OUT/salloc_old.o salloc_replay.c
+if [ -n "$1" ]; then
+  $CC -O2 -Wall -shared -fPIC -o $OUT/salloc_trace.so salloc_trace.c
+  LUA=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+  (cd $ROOT/bench && SALLOC_TRACE=$OUT/run.trc LD_PRELOAD=$OUT/salloc_trace.so "$LUA" run.lua ${2:-0.2} > /dev/null)
+  $OUT/salloc_replay $OUT/run.trc
+fi
+for t in $(ls traces/*.trc 2> /dev/null); do
+  $OUT/salloc_replay $t
+done
@@ -0,0 +1,279 @@
+// Replays allocation traces (recorded with salloc_trace.so) on the current
+// simple allocator (src/salloc.c) and on the first-fit one it replaced
+// (salloc_old.c), on the host. Each allocator gets a fresh process with a
+// 64 KB region (the internal SRAM) and a 32 MB region (the SDRAM); the old
+// allocator keeps 32 bit pointers, so both regions are mapped below 4 GB.
+// A first pass fills every block with a pattern and checks it before each
+// realloc and free, then a timing pass replays the trace 'reps' times.
+// Usage: salloc_replay trace [reps]
+// The output is CSV: impl,ops,reps,time_s,ns_per_op,failed,corrupt,
+//                    sram_hw_kb,sdram_hw_kb,live_peak_kb
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "salloc.h"
+
+void* old_smalloc( size_t size );
+void old_sfree( void* ptr );
+void* old_srealloc( void* ptr, size_t size );
+
+#define REGION0_SIZE          ( 64 * 1024 )
+#define REGION1_SIZE          ( 32 * 1024 * 1024 )
+
+static char *region0, *region1;
+
+static void* first_free_ram( unsigned id )
+{
+  return id == 0 ? region0 : id == 1 ? region1 : NULL;
+}
+
+static void* last_free_ram( unsigned id )
+{
+  return id == 0 ? region0 + REGION0_SIZE : id == 1 ? region1 + REGION1_SIZE : NULL;
+}
+
+void* platform_get_first_free_ram( unsigned id ) { return first_free_ram( id ); }
+void* platform_get_last_free_ram( unsigned id ) { return last_free_ram( id ); }
+void* old_first_free_ram( unsigned id ) { return first_free_ram( id ); }
+void* old_last_free_ram( unsigned id ) { return last_free_ram( id ); }
+
+// ****************************************************************************
+// Trace
+
+typedef struct
+{
+  char op;
+  unsigned id;
+  size_t size;
+} trace_op;
+
+static trace_op *ops;
+static size_t nops;
+static unsigned nids;
+
+static void trace_load( const char *fname )
+{
+  FILE *fp = fopen( fname, "r" );
+  size_t cap = 0;
+  char op;
+  unsigned id;
+  unsigned long size;
+  int n;
+
+  if( fp == NULL )
+  {
+    perror( fname );
+    exit( 1 );
+  }
+  while( ( n = fscanf( fp, " %c %u", &op, &id ) ) == 2 )
+  {
+    size = 0;
+    if( op != 'f' && fscanf( fp, "%lu", &size ) != 1 )
+      break;
+    if( nops == cap )
+    {
+      cap = cap ? cap * 2 : 65536;
+      if( ( ops = realloc( ops, cap * sizeof( trace_op ) ) ) == NULL )
+        exit( 1 );
+    }
+    ops[ nops ].op = op;
+    ops[ nops ].id = id;
+    ops[ nops ++ ].size = size;
+    if( id >= nids )
+      nids = id + 1;
+  }
+  fclose( fp );
+}
+
+// ****************************************************************************
+// Replay
+
+typedef struct
+{
+  const char *name;
+  void* ( *malloc_f )( size_t );
+  void ( *free_f )( void* );
+  void* ( *realloc_f )( void*, size_t );
+} allocator;
+
+static const allocator allocators[] =
+{
+  { "old", old_smalloc, old_sfree, old_srealloc },
+  { "new", smalloc, sfree, srealloc }
+};
+
+static unsigned char **ptrs;
+static size_t *sizes;
+static unsigned long failed, corrupt;
+static size_t hw0, hw1, live, live_peak;
+
+static unsigned char pattern( unsigned id, size_t i )
+{
+  return ( unsigned char )( id * 31 + i );
+}
+
+static void check_block( unsigned id )
+{
+  size_t i;
+
+  for( i = 0; i < sizes[ id ]; i ++ )
+    if( ptrs[ id ][ i ] != pattern( id, i ) )
+    {
+      corrupt ++;
+      return;
+    }
+}
+
+static void fill_block( unsigned id, size_t from )
+{
+  size_t i;
+  char *end = ( char* )ptrs[ id ] + sizes[ id ];
+
+  for( i = from; i < sizes[ id ]; i ++ )
+    ptrs[ id ][ i ] = pattern( id, i );
+  if( ( char* )ptrs[ id ] >= region0 && ( char* )ptrs[ id ] < region0 + REGION0_SIZE )
+    hw0 = end - region0 > hw0 ? end - region0 : hw0;
+  else
+    hw1 = end - region1 > hw1 ? end - region1 : hw1;
+}
+
+static void replay( const allocator *a, int verify )
+{
+  size_t i;
+  const trace_op *o;
+  unsigned char *p;
+  size_t keep;
+
+  for( i = 0, o = ops; i < nops; i ++, o ++ )
+  {
+    switch( o->op )
+    {
+      case 'a':
+        ptrs[ o->id ] = p = o->size ? a->malloc_f( o->size ) : NULL;
+        sizes[ o->id ] = p ? o->size : 0;
+        if( p == NULL && o->size && verify )
+          failed ++;
+        if( verify && p )
+        {
+          live += o->size;
+          fill_block( o->id, 0 );
+        }
+        break;
+
+      case 'r':
+        if( ptrs[ o->id ] == NULL )
+          continue;
+        if( verify )
+          check_block( o->id );
+        if( ( p = a->realloc_f( ptrs[ o->id ], o->size ) ) == NULL )
+        {
+          failed += verify;
+          continue;
+        }
+        ptrs[ o->id ] = p;
+        if( verify )
+        {
+          // Only the bytes past the old size need a new pattern
+          live = live - sizes[ o->id ] + o->size;
+          keep = o->size < sizes[ o->id ] ? o->size : sizes[ o->id ];
+          sizes[ o->id ] = o->size;
+          fill_block( o->id, keep );
+        }
+        else
+          sizes[ o->id ] = o->size;
+        break;
+
+      case 'f':
+        if( ptrs[ o->id ] && verify )
+        {
+          check_block( o->id );
+          live -= sizes[ o->id ];
+        }
+        a->free_f( ptrs[ o->id ] );
+        ptrs[ o->id ] = NULL;
+        sizes[ o->id ] = 0;
+        continue;
+    }
+    if( live > live_peak )
+      live_peak = live;
+  }
+  // Give back what the trace left allocated
+  for( i = 0; i < nids; i ++ )
+  {
+    a->free_f( ptrs[ i ] );
+    ptrs[ i ] = NULL;
+    sizes[ i ] = 0;
+  }
+  live = 0;
+}
+
+static double now( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run( const allocator *a, unsigned reps )
+{
+  unsigned r;
+  double t0, dt;
+
+  region0 = mmap( NULL, REGION0_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0 );
+  region1 = mmap( NULL, REGION1_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0 );
+  ptrs = calloc( nids, sizeof( *ptrs ) );
+  sizes = calloc( nids, sizeof( *sizes ) );
+  if( region0 == MAP_FAILED || region1 == MAP_FAILED || !ptrs || !sizes )
+  {
+    fprintf( stderr, "%s: out of memory\n", a->name );
+    exit( 1 );
+  }
+  replay( a, 1 );
+  t0 = now();
+  for( r = 0; r < reps; r ++ )
+    replay( a, 0 );
+  dt = now() - t0;
+  printf( "%s,%lu,%u,%.4f,%.1f,%lu,%lu,%.1f,%.1f,%.1f\n", a->name, ( unsigned long )nops, reps, dt,
+          dt * 1e9 / ( ( double )nops * reps ), failed, corrupt,
+          hw0 / 1024.0, hw1 / 1024.0, live_peak / 1024.0 );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned reps = argc > 2 ? ( unsigned )atoi( argv[ 2 ] ) : 10, i;
+  int status, res = 0;
+  pid_t pid;
+
+  if( argc < 2 )
+  {
+    fprintf( stderr, "usage: %s trace [reps]\n", argv[ 0 ] );
+    return 1;
+  }
+  trace_load( argv[ 1 ] );
+  printf( "# %s: %lu operations, %u ids\n", argv[ 1 ], ( unsigned long )nops, nids );
+  printf( "impl,ops,reps,time_s,ns_per_op,failed,corrupt,sram_hw_kb,sdram_hw_kb,live_peak_kb\n" );
+  fflush( stdout );
+  // The allocators keep their state in statics, so each one runs in a child
+  for( i = 0; i < sizeof( allocators ) / sizeof( allocators[ 0 ] ); i ++ )
+  {
+    if( ( pid = fork() ) == 0 )
+    {
+      run( allocators + i, reps );
+      fflush( stdout );
+      _exit( corrupt != 0 );
+    }
+    if( pid < 0 || waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status ) || WEXITSTATUS( status ) )
+    {
+      fprintf( stderr, "%s: replay failed\n", allocators[ i ].name );
+      res = 1;
+    }
+  }
+  return res;
+}
@@ -0,0 +1,230 @@
+// Unit tests for the simple allocator (src/salloc.c) on the host.
+// Two RAM regions stand in for the internal SRAM and the SDRAM of the board.
+// Build and run with tests/salloc/run.sh.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "salloc.h"
+
+#define REGION0_SIZE          ( 64 * 1024 )
+#define REGION1_SIZE          ( 512 * 1024 )
+
+static char region0[ REGION0_SIZE ] __attribute__( ( aligned( 8 ) ) );
+static char region1[ REGION1_SIZE ] __attribute__( ( aligned( 8 ) ) );
+
+// The end of the first region is deliberately not aligned
+void* platform_get_first_free_ram( unsigned id )
+{
+  return id == 0 ? region0 : id == 1 ? region1 : NULL;
+}
+
+void* platform_get_last_free_ram( unsigned id )
+{
+  return id == 0 ? region0 + REGION0_SIZE - 5 : id == 1 ? region1 + REGION1_SIZE - 1 : NULL;
+}
+
+static int failures;
+
+#define CHECK( cond )\
+  do {\
+    if( !( cond ) )\
+    {\
+      printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond );\
+      failures ++;\
+    }\
+  } while( 0 )
+
+static int in_region( const void *p, size_t size )
+{
+  const char *c = ( const char* )p;
+
+  return ( c >= region0 && c + size <= region0 + REGION0_SIZE ) ||
+         ( c >= region1 && c + size <= region1 + REGION1_SIZE );
+}
+
+// The heap is empty (and fully merged) if each region can be allocated
+// almost entirely in one block
+static int heap_is_empty( void )
+{
+  void *p0, *p1;
+  int res;
+
+  p0 = smalloc( REGION0_SIZE - 64 );
+  p1 = smalloc( REGION1_SIZE - 64 );
+  res = p0 != NULL && p1 != NULL;
+  sfree( p0 );
+  sfree( p1 );
+  return res;
+}
+
+static void test_special_cases( void )
+{
+  void *p;
+
+  CHECK( smalloc( 0 ) == NULL );
+  sfree( NULL );
+  p = srealloc( NULL, 10 );
+  CHECK( p != NULL );
+  CHECK( srealloc( p, 0 ) == NULL );
+  CHECK( smalloc( REGION1_SIZE + REGION0_SIZE ) == NULL );
+  CHECK( heap_is_empty() );
+}
+
+static void test_alignment( void )
+{
+  void *p[ 200 ];
+  size_t i;
+
+  for( i = 0; i < 200; i ++ )
+  {
+    p[ i ] = smalloc( i + 1 );
+    CHECK( p[ i ] != NULL && ( ( size_t )p[ i ] & 7 ) == 0 && in_region( p[ i ], i + 1 ) );
+    memset( p[ i ], 0xAA, i + 1 );
+  }
+  for( i = 0; i < 200; i += 2 )
+    sfree( p[ i ] );
+  for( i = 1; i < 200; i += 2 )
+    sfree( p[ i ] );
+  CHECK( heap_is_empty() );
+}
+
+static void test_realloc( void )
+{
+  char *p, *q, *r;
+  unsigned i;
+
+  // Shrinking and growing into a free neighbour keep the block in place
+  p = smalloc( 1000 );
+  q = smalloc( 100 );
+  CHECK( p && q );
+  for( i = 0; i < 1000; i ++ )
+    p[ i ] = ( char )i;
+  CHECK( srealloc( p, 200 ) == p );
+  CHECK( srealloc( p, 900 ) == p );
+  for( i = 0; i < 200; i ++ )
+    CHECK( p[ i ] == ( char )i );
+  // Growing past an allocated neighbour moves the block with its data
+  r = srealloc( q, 50 );
+  CHECK( r == q );
+  q = srealloc( q, 4000 );
+  CHECK( q != NULL );
+  p = srealloc( p, 5000 );
+  CHECK( p != NULL && in_region( p, 5000 ) );
+  for( i = 0; i < 200; i ++ )
+    CHECK( p[ i ] == ( char )i );
+  // A failed realloc leaves the block alone
+  CHECK( srealloc( p, REGION1_SIZE * 2 ) == NULL );
+  CHECK( p[ 199 ] == ( char )199 );
+  sfree( p );
+  sfree( q );
+  CHECK( heap_is_empty() );
+}
+
+static void test_calloc( void )
+{
+  unsigned char *p;
+  unsigned i;
+  int zero = 1;
+
+  p = smalloc( 4096 );
+  memset( p, 0x55, 4096 );
+  sfree( p );
+  p = scalloc( 64, 64 );
+  CHECK( p != NULL );
+  for( i = 0; i < 4096; i ++ )
+    zero = zero && p[ i ] == 0;
+  CHECK( zero );
+  sfree( p );
+  CHECK( heap_is_empty() );
+}
+
+// Fill the heap with small blocks, free them in a shuffled order and check
+// that everything merges back
+static void test_exhaustion( void )
+{
+  static void *p[ 40000 ];
+  unsigned n = 0, i, j, again = 0;
+  void *t;
+
+  while( n < 40000 && ( p[ n ] = smalloc( 24 ) ) != NULL )
+    n ++;
+  CHECK( n > 0 && n < 40000 );
+  for( i = n - 1; i > 0; i -- )
+  {
+    j = rand() % ( i + 1 );
+    t = p[ i ], p[ i ] = p[ j ], p[ j ] = t;
+  }
+  for( i = 0; i < n; i ++ )
+    sfree( p[ i ] );
+  CHECK( heap_is_empty() );
+  while( again < n && ( p[ again ] = smalloc( 24 ) ) != NULL )
+    again ++;
+  CHECK( again == n );
+  for( i = 0; i < again; i ++ )
+    sfree( p[ i ] );
+  CHECK( heap_is_empty() );
+}
+
+// Random malloc/realloc/free with content checks
+#define STRESS_SLOTS          2000
+
+static void test_stress( void )
+{
+  static unsigned char *p[ STRESS_SLOTS ];
+  static size_t size[ STRESS_SLOTS ];
+  static unsigned char tag[ STRESS_SLOTS ];
+  unsigned long it;
+  size_t k, ns;
+  unsigned i;
+  unsigned char *q;
+  int corrupt = 0;
+
+  for( it = 0; it < 1000000 && !corrupt; it ++ )
+  {
+    i = rand() % STRESS_SLOTS;
+    ns = rand() % ( ( rand() % 8 ) ? 64 : 4096 ) + 1;
+    if( p[ i ] )
+    {
+      for( k = 0; k < size[ i ]; k ++ )
+        corrupt |= p[ i ][ k ] != tag[ i ];
+      if( rand() % 3 == 0 )
+      {
+        sfree( p[ i ] );
+        p[ i ] = NULL;
+      }
+      else if( ( q = srealloc( p[ i ], ns ) ) != NULL )
+      {
+        CHECK( ( ( size_t )q & 7 ) == 0 && in_region( q, ns ) );
+        if( ns > size[ i ] )
+          memset( q + size[ i ], tag[ i ], ns - size[ i ] );
+        p[ i ] = q;
+        size[ i ] = ns;
+      }
+    }
+    else if( ( p[ i ] = smalloc( ns ) ) != NULL )
+    {
+      CHECK( ( ( size_t )p[ i ] & 7 ) == 0 && in_region( p[ i ], ns ) );
+      size[ i ] = ns;
+      tag[ i ] = ( unsigned char )rand();
+      memset( p[ i ], tag[ i ], ns );
+    }
+  }
+  CHECK( !corrupt );
+  for( i = 0; i < STRESS_SLOTS; i ++ )
+    sfree( p[ i ] );
+  CHECK( heap_is_empty() );
+}
+
+int main( void )
+{
+  srand( 1 );
+  test_special_cases();
+  test_alignment();
+  test_realloc();
+  test_calloc();
+  test_exhaustion();
+  test_stress();
+  printf( "salloc_test: %s (%d failures)\n", failures ? "FAILED" : "OK", failures );
+  return failures != 0;
+}
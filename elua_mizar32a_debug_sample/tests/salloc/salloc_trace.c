@@ -0,0 +1,224 @@
+// Allocation trace recorder: an LD_PRELOAD library (Linux, glibc) that logs
+// the malloc, calloc, realloc and free calls of a program, for example a
+// host build of the eLua core running bench/run.lua, so that they can be
+// replayed on the simple allocators by salloc_replay.
+// Build: gcc -O2 -shared -fPIC -o salloc_trace.so salloc_trace.c
+// Use:   SALLOC_TRACE=out.trc LD_PRELOAD=./salloc_trace.so lua bench/run.lua 0.2
+// The trace has one operation per line; ids are reused after a free:
+//   a <id> <size>   allocate a new block
+//   r <id> <size>   resize the block
+//   f <id>          free the block
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t nmemb, size_t size );
+extern void *__libc_realloc( void *ptr, size_t size );
+extern void __libc_free( void *ptr );
+
+#define TRACE_HASH_SIZE       ( 1 << 21 )
+#define TRACE_MAX_IDS         ( 1 << 20 )
+#define TRACE_BUF_SIZE        65536
+
+// Live blocks: open addressing hash from the block address to its id
+static void *trace_keys[ TRACE_HASH_SIZE ];
+static unsigned trace_ids[ TRACE_HASH_SIZE ];
+// Ids given back by free, reused first
+static unsigned trace_free_ids[ TRACE_MAX_IDS ];
+static unsigned trace_nfree, trace_next_id;
+static char trace_buf[ TRACE_BUF_SIZE ];
+static unsigned trace_buflen;
+static int trace_fd = -1, trace_busy;
+
+static unsigned trace_hash( const void *p )
+{
+  return ( unsigned )( ( ( uintptr_t )p >> 3 ) * 2654435761u ) & ( TRACE_HASH_SIZE - 1 );
+}
+
+static void trace_flush( void )
+{
+  if( trace_buflen > 0 && write( trace_fd, trace_buf, trace_buflen ) < 0 )
+    trace_fd = -1;
+  trace_buflen = 0;
+}
+
+static void trace_put( char op, unsigned id, size_t size )
+{
+  char line[ 48 ], tmp[ 24 ];
+  unsigned len = 0, n;
+  unsigned long v;
+  int i;
+
+  line[ len ++ ] = op;
+  for( i = 0; i < ( op == 'f' ? 1 : 2 ); i ++ )
+  {
+    v = i == 0 ? id : ( unsigned long )size;
+    n = 0;
+    do tmp[ n ++ ] = ( char )( '0' + v % 10 ); while( v /= 10 );
+    line[ len ++ ] = ' ';
+    while( n )
+      line[ len ++ ] = tmp[ -- n ];
+  }
+  line[ len ++ ] = '\n';
+  if( trace_buflen + len > TRACE_BUF_SIZE )
+    trace_flush();
+  memcpy( trace_buf + trace_buflen, line, len );
+  trace_buflen += len;
+}
+
+// Return the hash slot of 'p' (or the empty slot where it would go)
+static unsigned trace_find( const void *p )
+{
+  unsigned h = trace_hash( p );
+
+  while( trace_keys[ h ] != NULL && trace_keys[ h ] != p )
+    h = ( h + 1 ) & ( TRACE_HASH_SIZE - 1 );
+  return h;
+}
+
+static void trace_new( void *p, size_t size )
+{
+  unsigned h, id;
+
+  if( p == NULL )
+    return;
+  id = trace_nfree > 0 ? trace_free_ids[ -- trace_nfree ] : trace_next_id ++;
+  h = trace_find( p );
+  trace_keys[ h ] = p;
+  trace_ids[ h ] = id;
+  trace_put( 'a', id, size );
+}
+
+// Remove 'p' from the live blocks, return its id (or -1 if not known)
+static long trace_remove( void *p )
+{
+  unsigned i = trace_find( p ), j, k;
+  long id;
+
+  if( trace_keys[ i ] != p )
+    return -1;
+  id = trace_ids[ i ];
+  // Shift back the entries that follow in the probe sequence
+  for( j = i; ; )
+  {
+    j = ( j + 1 ) & ( TRACE_HASH_SIZE - 1 );
+    if( trace_keys[ j ] == NULL )
+      break;
+    k = trace_hash( trace_keys[ j ] );
+    if( i < j ? ( k <= i || k > j ) : ( k <= i && k > j ) )
+    {
+      trace_keys[ i ] = trace_keys[ j ];
+      trace_ids[ i ] = trace_ids[ j ];
+      i = j;
+    }
+  }
+  trace_keys[ i ] = NULL;
+  return id;
+}
+
+static void trace_release( void *p )
+{
+  long id = trace_remove( p );
+
+  if( id >= 0 )
+  {
+    trace_put( 'f', ( unsigned )id, 0 );
+    if( trace_nfree < TRACE_MAX_IDS )
+      trace_free_ids[ trace_nfree ++ ] = ( unsigned )id;
+  }
+}
+
+static int trace_enter( void )
+{
+  if( trace_fd < 0 || trace_busy )
+    return 0;
+  trace_busy = 1;
+  return 1;
+}
+
+__attribute__( ( constructor ) ) static void trace_init( void )
+{
+  const char *fname = getenv( "SALLOC_TRACE" );
+
+  if( fname )
+    trace_fd = open( fname, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+}
+
+__attribute__( ( destructor ) ) static void trace_done( void )
+{
+  if( trace_fd >= 0 )
+  {
+    trace_flush();
+    close( trace_fd );
+    trace_fd = -1;
+  }
+}
+
+void *malloc( size_t size )
+{
+  void *p = __libc_malloc( size );
+
+  if( trace_enter() )
+  {
+    trace_new( p, size );
+    trace_busy = 0;
+  }
+  return p;
+}
+
+void *calloc( size_t nmemb, size_t size )
+{
+  void *p = __libc_calloc( nmemb, size );
+
+  if( trace_enter() )
+  {
+    trace_new( p, nmemb * size );
+    trace_busy = 0;
+  }
+  return p;
+}
+
+void *realloc( void *ptr, size_t size )
+{
+  void *p = __libc_realloc( ptr, size );
+  long id;
+  unsigned h;
+
+  if( trace_enter() )
+  {
+    if( ptr == NULL )
+      trace_new( p, size );
+    else if( size == 0 )
+      trace_release( ptr );
+    else if( p != NULL )
+    {
+      if( ( id = trace_remove( ptr ) ) < 0 )
+        trace_new( p, size );
+      else
+      {
+        h = trace_find( p );
+        trace_keys[ h ] = p;
+        trace_ids[ h ] = ( unsigned )id;
+        trace_put( 'r', ( unsigned )id, size );
+      }
+    }
+    trace_busy = 0;
+  }
+  return p;
+}
+
+void free( void *ptr )
+{
+  if( ptr && trace_enter() )
+  {
+    trace_release( ptr );
+    trace_busy = 0;
+  }
+  __libc_free( ptr );
+}
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# Decoder for the binary trace files written by the 'trace <file>' shell
+# command (see src/common.c and src/shell/shell_trace.c)
+#
+# Usage: trace_decode.py [--csv] [--pairs] <file>
+#   --csv    print the records as CSV instead of a table
+#   --pairs  also print the duration of begin/end event pairs (GC, disk I/O,
+#            CPU idle)
+
+import struct
+import sys
+
+# Keep in sync with the CMN_TRACE_xxx enum in inc/common.h
+EVENTS = [
+  "none", "int_add", "int_drop", "int_hook", "uart_rx", "uip_loop",
+  "disk_read", "disk_read_end", "disk_write", "disk_write_end",
+  "gc_full", "gc_full_end", "niffs_gc", "niffs_gc_end", "idle", "idle_end"
+]
+TRACE_USER = 0x100
+PAIRS = { "disk_read_end": "disk_read", "disk_write_end": "disk_write",
+          "gc_full_end": "gc_full", "niffs_gc_end": "niffs_gc",
+          "idle_end": "idle" }
+
+def event_name( eid ):
+  if eid < len( EVENTS ):
+    return EVENTS[ eid ]
+  if eid >= TRACE_USER:
+    return "user%d" % ( eid - TRACE_USER )
+  return "unknown%d" % eid
+
+def load( fname ):
+  data = open( fname, "rb" ).read()
+  if data[ 0:4 ] != b"ELTR":
+    raise ValueError( "not a trace file" )
+  # The byte order marker tells the endianness of the target
+  for endian in ( ">", "<" ):
+    bom, verinfo, count = struct.unpack( endian + "III", data[ 4:16 ] )
+    if bom == 0x01020304:
+      break
+  else:
+    raise ValueError( "invalid byte order marker" )
+  version, recsize = verinfo >> 16, verinfo & 0xFFFF
+  if version != 1 or recsize < 16:
+    raise ValueError( "unsupported trace version %d (record size %d)" % ( version, recsize ) )
+  records = []
+  for i in range( count ):
+    off = 16 + i * recsize
+    if off + 16 > len( data ):
+      break
+    records.append( struct.unpack( endian + "IHHII", data[ off:off + 16 ] ) )
+  return records
+
+def main( args ):
+  csv = "--csv" in args
+  pairs = "--pairs" in args
+  files = [ a for a in args if not a.startswith( "--" ) ]
+  if len( files ) != 1:
+    sys.stderr.write( "Usage: trace_decode.py [--csv] [--pairs] <file>\n" )
+    return 1
+  records = load( files[ 0 ] )
+  if csv:
+    print( "time_us,delta_us,seq,event,arg1,arg2" )
+  else:
+    print( "%10s %8s %6s  %-15s %10s %10s" % ( "time(us)", "delta", "seq", "event", "arg1", "arg2" ) )
+  prev, prevseq, open_events, durations = None, None, {}, []
+  for ts, eid, seq, arg1, arg2 in records:
+    # Timestamps are the lower 32 bits of the system timer
+    delta = 0 if prev is None else ( ts - prev ) & 0xFFFFFFFF
+    if prevseq is not None and seq != ( prevseq + 1 ) & 0xFFFF:
+      print( "# %d record(s) lost" % ( ( seq - prevseq - 1 ) & 0xFFFF ) )
+    name = event_name( eid )
+    if csv:
+      print( "%u,%u,%u,%s,%u,%u" % ( ts, delta, seq, name, arg1, arg2 ) )
+    else:
+      print( "%10u %8u %6u  %-15s %10u %10u" % ( ts, delta, seq, name, arg1, arg2 ) )
+    if name in PAIRS.values():
+      open_events[ name ] = ts
+    elif name in PAIRS and PAIRS[ name ] in open_events:
+      start = open_events.pop( PAIRS[ name ] )
+      durations.append( ( PAIRS[ name ], start, ( ts - start ) & 0xFFFFFFFF ) )
+    prev, prevseq = ts, seq
+  if pairs:
+    print( "\n%-12s %10s %10s" % ( "operation", "start(us)", "time(us)" ) )
+    for name, start, length in durations:
+      print( "%-12s %10u %10u" % ( name, start, length ) )
+  return 0
+
+if __name__ == "__main__":
+  sys.exit( main( sys.argv[ 1: ] ) )